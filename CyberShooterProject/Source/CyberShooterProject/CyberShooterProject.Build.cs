@@ -8,7 +8,7 @@ public class CyberShooterProject : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 	
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput", "UMG", "Slate","SlateCore", "NavigationSystem", "Niagara" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput", "UMG", "Slate","SlateCore", "NavigationSystem", "Niagara", "AnimationBudgetAllocator" });
 
 		PrivateDependencyModuleNames.AddRange(new string[] {  });
 
@@ -3,4 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+// Stat group shared by the game's runtime systems, shown in game with "stat CyberShooter"
+DECLARE_STATS_GROUP(TEXT("CyberShooter"), STATGROUP_CyberShooter, STATCAT_Advanced);
 
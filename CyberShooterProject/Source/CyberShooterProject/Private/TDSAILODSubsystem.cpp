@@ -0,0 +1,229 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSAILODSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSEnemyAIController.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI LOD Evaluate"), STAT_TDSAILODEvaluate, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("AI LOD Attacking"), STAT_TDSAILODAttacking, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("AI LOD Chasing"), STAT_TDSAILODChasing, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("AI LOD Idle"), STAT_TDSAILODIdle, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("AI LOD Idle Offscreen"), STAT_TDSAILODIdleOffscreen, STATGROUP_CyberShooter);
+
+namespace
+{
+	// Turns a rate in Hz into a tick interval, zero meaning every frame
+	float RateToInterval(float Rate)
+	{
+		return Rate > 0.f ? 1.f / Rate : 0.f;
+	}
+}
+
+bool UTDSAILODSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSAILODSubsystem::Deinitialize()
+{
+	Entries.Empty();
+	FMemory::Memzero(BucketCounts);
+	UpdateBucketStats();
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSAILODSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSAILODSubsystem, STATGROUP_Tickables);
+}
+
+void UTDSAILODSubsystem::RegisterController(ATDSEnemyAIController* Controller)
+{
+	if (!Controller)
+	{
+		return;
+	}
+
+	const bool bAlreadyRegistered = Entries.ContainsByPredicate([Controller](const FTDSAILODEntry& Entry)
+	{
+		return Entry.Controller == Controller;
+	});
+
+	if (bAlreadyRegistered)
+	{
+		return;
+	}
+
+	FTDSAILODEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Controller = Controller;
+
+	RequestUpdate(Controller);
+}
+
+void UTDSAILODSubsystem::UnregisterController(ATDSEnemyAIController* Controller)
+{
+	const int32 Index = Entries.IndexOfByPredicate([Controller](const FTDSAILODEntry& Entry)
+	{
+		return Entry.Controller == Controller;
+	});
+
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	// Hand the controller back ticking every frame
+	ApplyBucket(Entries[Index], ETDSAILODBucket::Attacking);
+	BucketCounts[static_cast<int32>(ETDSAILODBucket::Attacking)]--;
+
+	Entries.RemoveAtSwap(Index, EAllowShrinking::No);
+	UpdateBucketStats();
+}
+
+void UTDSAILODSubsystem::RequestUpdate(ATDSEnemyAIController* Controller)
+{
+	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+
+	for (FTDSAILODEntry& Entry : Entries)
+	{
+		if (Entry.Controller == Controller)
+		{
+			const FVector PlayerLocation = PlayerPawn ? PlayerPawn->GetActorLocation() : FVector::ZeroVector;
+			ApplyBucket(Entry, PlayerPawn ? ComputeBucket(*Controller, PlayerLocation) : ETDSAILODBucket::Idle);
+			UpdateBucketStats();
+			return;
+		}
+	}
+}
+
+void UTDSAILODSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeUntilEvaluate -= DeltaTime;
+	if (TimeUntilEvaluate > 0.f)
+	{
+		return;
+	}
+
+	TimeUntilEvaluate = EvaluationInterval;
+
+	SCOPE_CYCLE_COUNTER(STAT_TDSAILODEvaluate);
+
+	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+	const FVector PlayerLocation = PlayerPawn ? PlayerPawn->GetActorLocation() : FVector::ZeroVector;
+
+	for (int32 Index = Entries.Num() - 1; Index >= 0; --Index)
+	{
+		FTDSAILODEntry& Entry = Entries[Index];
+
+		const ATDSEnemyAIController* Controller = Entry.Controller.Get();
+		if (!Controller)
+		{
+			if (Entry.Bucket != ETDSAILODBucket::Count)
+			{
+				BucketCounts[static_cast<int32>(Entry.Bucket)]--;
+			}
+			Entries.RemoveAtSwap(Index, EAllowShrinking::No);
+			continue;
+		}
+
+		// Without a player there is nothing to react to, everyone idles
+		ApplyBucket(Entry, PlayerPawn ? ComputeBucket(*Controller, PlayerLocation) : ETDSAILODBucket::Idle);
+	}
+
+	UpdateBucketStats();
+}
+
+ETDSAILODBucket UTDSAILODSubsystem::ComputeBucket(const ATDSEnemyAIController& Controller, const FVector& PlayerLocation) const
+{
+	const APawn* Pawn = Controller.GetPawn();
+	if (!Pawn)
+	{
+		return ETDSAILODBucket::Idle;
+	}
+
+	const float DistanceSq = FVector::DistSquared2D(Pawn->GetActorLocation(), PlayerLocation);
+
+	if (Controller.GetState() == EEnemyState::Attacking || DistanceSq <= FMath::Square(NearDistance))
+	{
+		return ETDSAILODBucket::Attacking;
+	}
+
+	if (Controller.GetState() == EEnemyState::Chasing)
+	{
+		return ETDSAILODBucket::Chasing;
+	}
+
+	if (DistanceSq > FMath::Square(OffscreenDistance) && !Pawn->WasRecentlyRendered(RecentlyRenderedSeconds))
+	{
+		return ETDSAILODBucket::IdleOffscreen;
+	}
+
+	return ETDSAILODBucket::Idle;
+}
+
+void UTDSAILODSubsystem::ApplyBucket(FTDSAILODEntry& Entry, ETDSAILODBucket NewBucket)
+{
+	if (Entry.Bucket == NewBucket)
+	{
+		return;
+	}
+
+	if (Entry.Bucket != ETDSAILODBucket::Count)
+	{
+		BucketCounts[static_cast<int32>(Entry.Bucket)]--;
+	}
+	BucketCounts[static_cast<int32>(NewBucket)]++;
+	Entry.Bucket = NewBucket;
+
+	ATDSEnemyAIController* Controller = Entry.Controller.Get();
+	if (!Controller)
+	{
+		return;
+	}
+
+	Controller->SetAITickInterval(GetAITickInterval(NewBucket));
+
+	if (const ACharacter* Character = Cast<ACharacter>(Controller->GetPawn()))
+	{
+		if (UCharacterMovementComponent* MoveComp = Character->GetCharacterMovement())
+		{
+			MoveComp->SetComponentTickInterval(GetMovementTickInterval(NewBucket));
+		}
+	}
+}
+
+float UTDSAILODSubsystem::GetAITickInterval(ETDSAILODBucket Bucket) const
+{
+	switch (Bucket)
+	{
+	case ETDSAILODBucket::Chasing:
+		return RateToInterval(ChasingTickRate);
+	case ETDSAILODBucket::Idle:
+	case ETDSAILODBucket::IdleOffscreen:
+		return RateToInterval(IdleTickRate);
+	default:
+		return 0.f;
+	}
+}
+
+float UTDSAILODSubsystem::GetMovementTickInterval(ETDSAILODBucket Bucket) const
+{
+	// Movement only slows down where nobody can see the steps
+	return Bucket == ETDSAILODBucket::IdleOffscreen ? RateToInterval(OffscreenMovementTickRate) : 0.f;
+}
+
+void UTDSAILODSubsystem::UpdateBucketStats() const
+{
+	SET_DWORD_STAT(STAT_TDSAILODAttacking, BucketCounts[static_cast<int32>(ETDSAILODBucket::Attacking)]);
+	SET_DWORD_STAT(STAT_TDSAILODChasing, BucketCounts[static_cast<int32>(ETDSAILODBucket::Chasing)]);
+	SET_DWORD_STAT(STAT_TDSAILODIdle, BucketCounts[static_cast<int32>(ETDSAILODBucket::Idle)]);
+	SET_DWORD_STAT(STAT_TDSAILODIdleOffscreen, BucketCounts[static_cast<int32>(ETDSAILODBucket::IdleOffscreen)]);
+}
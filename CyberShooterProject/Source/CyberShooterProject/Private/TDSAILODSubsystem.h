@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSAILODSubsystem.generated.h"
+
+class ATDSEnemyAIController;
+
+// How much attention an enemy gets, from most to least
+UENUM()
+enum class ETDSAILODBucket : uint8
+{
+	// Attacking or right next to the player: AI and movement tick every frame
+	Attacking,
+
+	// Chasing the player: AI ticks at ChasingTickRate, movement every frame
+	Chasing,
+
+	// Idle where the player can see it: AI ticks at IdleTickRate, movement every frame so wandering stays smooth
+	Idle,
+
+	// Idle, off screen and far away: AI ticks at IdleTickRate, movement at OffscreenMovementTickRate
+	IdleOffscreen,
+
+	Count UMETA(Hidden)
+};
+
+// An enemy controller tracked by the LOD subsystem
+struct FTDSAILODEntry
+{
+	TWeakObjectPtr<ATDSEnemyAIController> Controller;
+	ETDSAILODBucket Bucket = ETDSAILODBucket::Count;
+};
+
+// This subsystem decides how often each enemy thinks. Enemies are bucketed by their AI state, distance to the player and
+// whether they were rendered recently, and each bucket sets the tick interval of the enemy's controller and movement component.
+// Enemies are re-bucketed every EvaluationInterval and straight away when their state changes, so an enemy that starts
+// attacking is back to ticking every frame immediately. Ticks that are skipped are folded into the next tick's DeltaSeconds
+// by the engine, so timers, interpolation and stuck detection keep working at a lower rate.
+UCLASS(Config = Game)
+class UTDSAILODSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only manage AI in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Starts managing an enemy controller's tick rate
+	void RegisterController(ATDSEnemyAIController* Controller);
+
+	// Stops managing an enemy controller and restores its tick rate
+	void UnregisterController(ATDSEnemyAIController* Controller);
+
+	// Re-buckets a controller straight away, called when its state changes
+	void RequestUpdate(ATDSEnemyAIController* Controller);
+
+	// Number of enemies currently in a bucket
+	int32 GetBucketCount(ETDSAILODBucket Bucket) const { return BucketCounts[static_cast<int32>(Bucket)]; }
+
+private:
+	// Works out which bucket a controller belongs in
+	ETDSAILODBucket ComputeBucket(const ATDSEnemyAIController& Controller, const FVector& PlayerLocation) const;
+
+	// Moves an entry to a bucket, updating its tick intervals if the bucket changed
+	void ApplyBucket(FTDSAILODEntry& Entry, ETDSAILODBucket NewBucket);
+
+	// Tick intervals of a bucket
+	float GetAITickInterval(ETDSAILODBucket Bucket) const;
+	float GetMovementTickInterval(ETDSAILODBucket Bucket) const;
+
+	// Pushes the bucket counts to the stat system
+	void UpdateBucketStats() const;
+
+	// Seconds between re-bucketing passes
+	UPROPERTY(Config)
+	float EvaluationInterval = 0.25f;
+
+	// How many times a second chasing and idle enemies think
+	UPROPERTY(Config)
+	float ChasingTickRate = 30.f;
+
+	UPROPERTY(Config)
+	float IdleTickRate = 5.f;
+
+	// How many times a second far away, off screen idle enemies move
+	UPROPERTY(Config)
+	float OffscreenMovementTickRate = 10.f;
+
+	// Enemies closer than this to the player always get the Attacking bucket, whatever their state
+	UPROPERTY(Config)
+	float NearDistance = 400.f;
+
+	// Idle enemies further than this that have not been rendered recently drop to IdleOffscreen
+	UPROPERTY(Config)
+	float OffscreenDistance = 1500.f;
+
+	// How long since the last render an enemy still counts as on screen
+	UPROPERTY(Config)
+	float RecentlyRenderedSeconds = 0.2f;
+
+	// Managed controllers
+	TArray<FTDSAILODEntry> Entries;
+
+	// Number of enemies in each bucket
+	int32 BucketCounts[static_cast<int32>(ETDSAILODBucket::Count)] = {};
+
+	// Time until the next re-bucketing pass
+	float TimeUntilEvaluate = 0.f;
+};
@@ -0,0 +1,251 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSAnimationBudgetSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSEnemyCharacter.h"
+#include "TDSEnemyAIController.h"
+#include "TDSEnemyMeshComponent.h"
+#include "TDSWeakArray.h"
+#include "IAnimationBudgetAllocator.h"
+#include "AnimationBudgetAllocatorParameters.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+
+DECLARE_CYCLE_STAT(TEXT("Anim Budget Significance"), STAT_TDSAnimBudgetSignificance, STATGROUP_CyberShooter);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Anim Budget (ms)"), STAT_TDSAnimBudgetMs, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Anim Budgeted Enemies"), STAT_TDSAnimBudgetedEnemies, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Anim Full Rate Enemies"), STAT_TDSAnimFullRateEnemies, STATGROUP_CyberShooter);
+
+namespace
+{
+	// What tds.Anim.Benchmark samples every frame
+	enum ETDSAnimBenchmarkSample
+	{
+		SampleFullRate,
+		SampleEnemies
+	};
+}
+
+static TAutoConsoleVariable<bool> CVarTDSAnimBudget(
+	TEXT("tds.Anim.Budget"),
+	true,
+	TEXT("Tick enemy meshes through the animation budget allocator. 0 ticks every enemy mesh at full rate."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTDSAnimBudgetMs(
+	TEXT("tds.Anim.BudgetMs"),
+	0.f,
+	TEXT("Milliseconds per frame for enemy animation. 0 uses BudgetMs from the game config."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorldAndArgs GTDSAnimBenchmarkCommand(
+	TEXT("tds.Anim.Benchmark"),
+	TEXT("Turns the enemy animation budget on or off and logs frame time, enemy mesh tick cost and full rate enemies over a few seconds. ")
+	TEXT("Spawn a crowd first (tds.AI.SpawnBenchmarkEnemies), works headless with -nullrhi. Arguments: on or off (default on), seconds (default 10)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UTDSAnimationBudgetSubsystem* AnimBudget = World ? World->GetSubsystem<UTDSAnimationBudgetSubsystem>() : nullptr;
+		if (!AnimBudget)
+		{
+			return;
+		}
+
+		const bool bUseBudget = Args.Num() == 0 || !Args[0].Equals(TEXT("off"), ESearchCase::IgnoreCase);
+		AnimBudget->StartBenchmark(bUseBudget, Args.Num() > 1 ? FCString::Atof(*Args[1]) : 10.f);
+	}));
+
+bool UTDSAnimationBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSAnimationBudgetSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	ApplyBudgetSettings();
+}
+
+void UTDSAnimationBudgetSubsystem::Deinitialize()
+{
+	Enemies.Empty();
+	Meshes.Empty();
+
+	SET_FLOAT_STAT(STAT_TDSAnimBudgetMs, 0.f);
+	SET_DWORD_STAT(STAT_TDSAnimBudgetedEnemies, 0);
+	SET_DWORD_STAT(STAT_TDSAnimFullRateEnemies, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSAnimationBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSAnimationBudgetSubsystem, STATGROUP_Tickables);
+}
+
+void UTDSAnimationBudgetSubsystem::RegisterEnemy(ATDSEnemyCharacter* Enemy)
+{
+	UTDSEnemyMeshComponent* Mesh = Enemy ? Cast<UTDSEnemyMeshComponent>(Enemy->GetMesh()) : nullptr;
+	if (!Mesh || Enemies.Contains(Enemy))
+	{
+		return;
+	}
+
+	Enemies.Add(Enemy);
+	Meshes.Add(Mesh);
+}
+
+void UTDSAnimationBudgetSubsystem::UnregisterEnemy(ATDSEnemyCharacter* Enemy)
+{
+	const int32 Index = Enemies.IndexOfByKey(Enemy);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	Enemies.RemoveAtSwap(Index, EAllowShrinking::No);
+	Meshes.RemoveAtSwap(Index, EAllowShrinking::No);
+}
+
+float UTDSAnimationBudgetSubsystem::GetBudgetMs() const
+{
+	const float OverrideMs = CVarTDSAnimBudgetMs.GetValueOnGameThread();
+	return OverrideMs > 0.f ? OverrideMs : BudgetMs;
+}
+
+void UTDSAnimationBudgetSubsystem::ApplyBudgetSettings()
+{
+	IAnimationBudgetAllocator* Allocator = IAnimationBudgetAllocator::Get(GetWorld());
+	if (!Allocator)
+	{
+		return;
+	}
+
+	const bool bEnabled = CVarTDSAnimBudget.GetValueOnGameThread();
+	const float NewBudgetMs = GetBudgetMs();
+	if (bEnabled == bAppliedEnabled && NewBudgetMs == AppliedBudgetMs)
+	{
+		return;
+	}
+
+	FAnimationBudgetAllocatorParameters Parameters;
+	Parameters.BudgetInMs = NewBudgetMs;
+	Parameters.MinQuality = MinQuality;
+	Parameters.MaxTickRate = MaxTickRate;
+	Allocator->SetParameters(Parameters);
+	Allocator->SetEnabled(bEnabled);
+
+	bAppliedEnabled = bEnabled;
+	AppliedBudgetMs = NewBudgetMs;
+
+	SET_FLOAT_STAT(STAT_TDSAnimBudgetMs, bEnabled ? NewBudgetMs : 0.f);
+}
+
+void UTDSAnimationBudgetSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Picks up console changes to the budget
+	ApplyBudgetSettings();
+
+	const APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+	const APlayerCameraManager* CameraManager = UGameplayStatics::GetPlayerCameraManager(GetWorld(), 0);
+
+	// Without a renderer nothing is ever on screen, so tick everything as if it were
+	const bool bTickEvenIfNotRendered = !FApp::CanEverRender();
+
+	int32 NumFullRate = 0;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TDSAnimBudgetSignificance);
+
+		const FVector PlayerLocation = PlayerPawn ? PlayerPawn->GetActorLocation() : FVector::ZeroVector;
+		const FVector CameraLocation = CameraManager ? CameraManager->GetCameraLocation() : PlayerLocation;
+		const float TanHalfFOV = FMath::Tan(FMath::DegreesToRadians((CameraManager ? CameraManager->GetFOVAngle() : 90.f) * 0.5f));
+		const float InvMaxDistance = 1.f / FMath::Max(SignificanceMaxDistance, 1.f);
+		const float InvFullScreenSize = 1.f / FMath::Max(FullSignificanceScreenSize, KINDA_SMALL_NUMBER);
+
+		// The budget allocator drops destroyed meshes by itself, we only have to forget our side of the pair
+		FTDSWeakArray::RemoveStaleSwap(
+			Enemies.Num(),
+			[this](int32 Index) { return !Enemies[Index].IsValid() || !Meshes[Index].IsValid(); },
+			[this](int32 Index)
+			{
+				Enemies.RemoveAtSwap(Index, EAllowShrinking::No);
+				Meshes.RemoveAtSwap(Index, EAllowShrinking::No);
+			});
+
+		for (int32 Index = 0; Index < Enemies.Num(); ++Index)
+		{
+			const ATDSEnemyCharacter* Enemy = Enemies[Index].Get();
+			UTDSEnemyMeshComponent* Mesh = Meshes[Index].Get();
+
+			// Close to the player matters most, in this top down view everything on screen is about the same size
+			const float DistanceSignificance = 1.f - FMath::Min(FVector::Dist(Enemy->GetActorLocation(), PlayerLocation) * InvMaxDistance, 1.f);
+
+			// Rough fraction of the screen the mesh bounds cover
+			const float CameraDistance = FMath::Max(FVector::Dist(Mesh->Bounds.Origin, CameraLocation), 1.f);
+			const float ScreenSize = Mesh->Bounds.SphereRadius / (CameraDistance * TanHalfFOV);
+			const float ScreenSignificance = FMath::Min(ScreenSize * InvFullScreenSize, 1.f);
+
+			const float Significance = FMath::Lerp(DistanceSignificance, ScreenSignificance, ScreenSizeWeight);
+
+			// Attack swings fire the melee hit from a notify and deaths play a montage, neither may skip frames
+			const ATDSEnemyAIController* EnemyAI = Cast<ATDSEnemyAIController>(Enemy->GetController());
+			const bool bFullRate = Enemy->IsDead() || (EnemyAI && EnemyAI->GetState() == EEnemyState::Attacking);
+			if (bFullRate)
+			{
+				NumFullRate++;
+			}
+
+			Mesh->SetComponentSignificance(Significance, bFullRate, bTickEvenIfNotRendered, !bFullRate);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_TDSAnimBudgetedEnemies, Enemies.Num());
+	SET_DWORD_STAT(STAT_TDSAnimFullRateEnemies, NumFullRate);
+
+	if (Benchmark.IsRunning())
+	{
+		Benchmark.AddSample(SampleFullRate, NumFullRate);
+		Benchmark.AddSample(SampleEnemies, Enemies.Num());
+
+		if (Benchmark.Tick())
+		{
+			FinishBenchmark();
+		}
+	}
+}
+
+void UTDSAnimationBudgetSubsystem::StartBenchmark(bool bUseBudget, float Seconds)
+{
+	CVarTDSAnimBudget->Set(bUseBudget, ECVF_SetByConsole);
+	ApplyBudgetSettings();
+
+	bBenchmarkBudget = bUseBudget;
+	Benchmark.Start(Seconds);
+	UTDSEnemyMeshComponent::ResetTickCounters();
+
+	UE_LOG(LogTemp, Log, TEXT("tds.Anim.Benchmark: budget %s (%.2f ms), measuring for %.1f s%s"),
+		bUseBudget ? TEXT("on") : TEXT("off"), GetBudgetMs(), Benchmark.GetSeconds(), FApp::CanEverRender() ? TEXT("") : TEXT(", headless"));
+}
+
+void UTDSAnimationBudgetSubsystem::FinishBenchmark()
+{
+	const int32 NumFrames = FMath::Max(Benchmark.GetNumFrames(), 1);
+	const double MeshTickMs = FPlatformTime::ToMilliseconds64(UTDSEnemyMeshComponent::GetTickCycles());
+	const int32 NumMeshTicks = UTDSEnemyMeshComponent::GetNumTicks();
+
+	UE_LOG(LogTemp, Log, TEXT("tds.Anim.Benchmark: budget %s, %.0f enemies avg, %s | enemy mesh ticks %.3f ms per frame, %.1f per frame, %.2f us each | %.1f full rate enemies avg"),
+		bBenchmarkBudget ? TEXT("on") : TEXT("off"),
+		Benchmark.GetAverage(SampleEnemies),
+		*Benchmark.GetFrameSummary(),
+		MeshTickMs / NumFrames,
+		static_cast<double>(NumMeshTicks) / NumFrames,
+		NumMeshTicks > 0 ? MeshTickMs * 1000.0 / NumMeshTicks : 0.0,
+		Benchmark.GetAverage(SampleFullRate));
+}
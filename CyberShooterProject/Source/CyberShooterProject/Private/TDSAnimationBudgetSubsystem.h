@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSBenchmark.h"
+#include "TDSAnimationBudgetSubsystem.generated.h"
+
+class ATDSEnemyCharacter;
+class UTDSEnemyMeshComponent;
+
+// This subsystem puts enemy animation on a fixed per-frame budget.
+// It turns on the engine's animation budget allocator for the world with BudgetMs from config (or tds.Anim.BudgetMs), and
+// every frame gives each registered enemy mesh a significance from its distance to the player and its size on screen, so
+// the allocator drops the tick rate of small, far away enemies first. Attacking and dying enemies are marked to never skip
+// a tick, so attack swings, their melee notifies and death montages always play at full rate.
+// Without a renderer (-nullrhi) nothing counts as on screen, so every mesh is flagged to tick anyway and the budget sees
+// the same load as in a window. tds.Anim.Benchmark measures enemy animation cost with the budget on or off.
+UCLASS(Config = Game)
+class UTDSAnimationBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only budget animation in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Starts or stops setting an enemy's mesh significance, its mesh must be a UTDSEnemyMeshComponent
+	void RegisterEnemy(ATDSEnemyCharacter* Enemy);
+	void UnregisterEnemy(ATDSEnemyCharacter* Enemy);
+
+	// Turns the budget on or off, then logs frame time, enemy mesh tick cost and full rate enemies over the next Seconds.
+	// Used by tds.Anim.Benchmark.
+	void StartBenchmark(bool bUseBudget, float Seconds);
+
+private:
+	// Pushes the budget settings to the allocator when they changed
+	void ApplyBudgetSettings();
+
+	// Budget in milliseconds currently in use
+	float GetBudgetMs() const;
+
+	// Logs the benchmark results
+	void FinishBenchmark();
+
+	// Milliseconds per frame the allocator may spend ticking enemy meshes
+	UPROPERTY(Config)
+	float BudgetMs = 1.0f;
+
+	// Lowest fraction of the full tick rate a mesh can be throttled to
+	UPROPERTY(Config)
+	float MinQuality = 0.f;
+
+	// Most frames a mesh can go between ticks
+	UPROPERTY(Config)
+	int32 MaxTickRate = 10;
+
+	// Enemies this far from the player or further get no significance from distance
+	UPROPERTY(Config)
+	float SignificanceMaxDistance = 3000.f;
+
+	// Fraction of the screen height an enemy must cover to get full significance from its size
+	UPROPERTY(Config)
+	float FullSignificanceScreenSize = 0.15f;
+
+	// How much of the significance comes from screen size, the rest comes from distance
+	UPROPERTY(Config)
+	float ScreenSizeWeight = 0.5f;
+
+	// Budgeted enemies and their meshes, at matching indices
+	TArray<TWeakObjectPtr<ATDSEnemyCharacter>> Enemies;
+	TArray<TWeakObjectPtr<UTDSEnemyMeshComponent>> Meshes;
+
+	// Settings last pushed to the allocator
+	bool bAppliedEnabled = false;
+	float AppliedBudgetMs = -1.f;
+
+	// ---- Benchmark ----
+	FTDSFrameBenchmark Benchmark;
+	bool bBenchmarkBudget = true;
+};
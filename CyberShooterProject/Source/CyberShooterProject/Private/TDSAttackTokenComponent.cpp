@@ -0,0 +1,221 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSAttackTokenComponent.h"
+#include "CyberShooterProject.h"
+#include "TDSEnemyAIController.h"
+#include "TDSEnemyCharacter.h"
+#include "TDSEnemyMeshComponent.h"
+#include "Animation/AnimInstance.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Attack Tokens Held"), STAT_TDSAttackTokensHeld, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Attack Tokens Waiting"), STAT_TDSAttackTokensWaiting, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Attack Tokens Granted"), STAT_TDSAttackTokensGranted, STATGROUP_CyberShooter);
+
+namespace
+{
+	// What tds.AI.AttackTokenBenchmark samples every frame
+	enum ETDSAttackTokenBenchmarkSample
+	{
+		SampleMontages,
+		SampleWaiting
+	};
+}
+
+static TAutoConsoleVariable<bool> CVarTDSAttackTokens(
+	TEXT("tds.AI.AttackTokens"),
+	true,
+	TEXT("Cap simultaneous enemy attackers with the player's attack tokens. 0 grants every attack straight away."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorldAndArgs GTDSAttackTokenBenchmarkCommand(
+	TEXT("tds.AI.AttackTokenBenchmark"),
+	TEXT("Turns attack tokens on or off and logs frame time, enemy animation cost, attack montages playing and enemies waiting over a few seconds. ")
+	TEXT("Spawn a crowd around the player first (tds.AI.SpawnBenchmarkEnemies) and use stat anim for the animation breakdown. ")
+	TEXT("Arguments: on or off (default on), seconds (default 10)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const APawn* PlayerPawn = World ? UGameplayStatics::GetPlayerPawn(World, 0) : nullptr;
+		UTDSAttackTokenComponent* Tokens = PlayerPawn ? PlayerPawn->FindComponentByClass<UTDSAttackTokenComponent>() : nullptr;
+		if (!Tokens)
+		{
+			return;
+		}
+
+		const bool bUseTokens = Args.Num() == 0 || !Args[0].Equals(TEXT("off"), ESearchCase::IgnoreCase);
+		Tokens->StartBenchmark(bUseTokens, Args.Num() > 1 ? FCString::Atof(*Args[1]) : 10.f);
+	}));
+
+UTDSAttackTokenComponent::UTDSAttackTokenComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+}
+
+void UTDSAttackTokenComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Holders.Empty();
+	Waiting.Empty();
+
+	SET_DWORD_STAT(STAT_TDSAttackTokensHeld, 0);
+	SET_DWORD_STAT(STAT_TDSAttackTokensWaiting, 0);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UTDSAttackTokenComponent::RequestToken(ATDSEnemyAIController* Requester)
+{
+	if (!Requester)
+	{
+		return;
+	}
+
+	const auto IsRequester = [Requester](const FTDSAttackTokenEntry& Entry) { return Entry.Controller == Requester; };
+	if (Holders.ContainsByPredicate(IsRequester) || Waiting.ContainsByPredicate(IsRequester))
+	{
+		return;
+	}
+
+	// Nobody ahead in the queue and a token free, no need to wait for the next pass
+	if (!CVarTDSAttackTokens.GetValueOnGameThread() || (Waiting.Num() == 0 && Holders.Num() < MaxTokens))
+	{
+		Grant(Requester);
+		return;
+	}
+
+	FTDSAttackTokenEntry& Entry = Waiting.AddDefaulted_GetRef();
+	Entry.Controller = Requester;
+	Entry.Time = GetWorld()->GetTimeSeconds();
+}
+
+void UTDSAttackTokenComponent::ReleaseToken(ATDSEnemyAIController* Holder)
+{
+	const auto IsHolder = [Holder](const FTDSAttackTokenEntry& Entry) { return Entry.Controller == Holder; };
+	Holders.RemoveAllSwap(IsHolder, EAllowShrinking::No);
+	Waiting.RemoveAll(IsHolder);
+}
+
+bool UTDSAttackTokenComponent::Grant(ATDSEnemyAIController* Requester)
+{
+	if (!Requester || !Requester->GetPawn())
+	{
+		return false;
+	}
+
+	FTDSAttackTokenEntry& Entry = Holders.AddDefaulted_GetRef();
+	Entry.Controller = Requester;
+	Entry.Time = GetWorld()->GetTimeSeconds();
+
+	INC_DWORD_STAT(STAT_TDSAttackTokensGranted);
+
+	// May swing straight away, or give the token straight back if it can no longer attack
+	Requester->ReceiveAttackToken();
+	return true;
+}
+
+void UTDSAttackTokenComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// Take back tokens from holders that are gone or never finished their swing
+	Holders.RemoveAllSwap([Now, this](const FTDSAttackTokenEntry& Entry)
+	{
+		return !Entry.Controller.IsValid() || Now - Entry.Time > MaxHoldSeconds;
+	}, EAllowShrinking::No);
+
+	Waiting.RemoveAll([](const FTDSAttackTokenEntry& Entry) { return !Entry.Controller.IsValid(); });
+
+	GrantTokens();
+
+	SET_DWORD_STAT(STAT_TDSAttackTokensHeld, Holders.Num());
+	SET_DWORD_STAT(STAT_TDSAttackTokensWaiting, Waiting.Num());
+
+	if (Benchmark.IsRunning())
+	{
+		Benchmark.AddSample(SampleMontages, CountAttackMontages());
+		Benchmark.AddSample(SampleWaiting, Waiting.Num());
+
+		if (Benchmark.Tick())
+		{
+			FinishBenchmark();
+		}
+	}
+}
+
+void UTDSAttackTokenComponent::GrantTokens()
+{
+	// Tokens turned off while enemies were queued, let them all through
+	const int32 TokenLimit = CVarTDSAttackTokens.GetValueOnGameThread() ? MaxTokens : MAX_int32;
+
+	const AActor* Owner = GetOwner();
+	const FVector OwnerLocation = Owner ? Owner->GetActorLocation() : FVector::ZeroVector;
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	while (Holders.Num() < TokenLimit && Waiting.Num() > 0)
+	{
+		// Lowest score wins: distance to the player, minus credit for time spent waiting
+		int32 BestIndex = INDEX_NONE;
+		float BestScore = MAX_flt;
+		for (int32 Index = 0; Index < Waiting.Num(); ++Index)
+		{
+			const APawn* Pawn = Waiting[Index].Controller.IsValid() ? Waiting[Index].Controller->GetPawn() : nullptr;
+			const float Distance = Pawn ? FVector::Dist2D(Pawn->GetActorLocation(), OwnerLocation) : MAX_flt;
+			const float Score = Distance - static_cast<float>(Now - Waiting[Index].Time) * WaitPriorityPerSecond;
+			if (BestIndex == INDEX_NONE || Score < BestScore)
+			{
+				BestIndex = Index;
+				BestScore = Score;
+			}
+		}
+
+		ATDSEnemyAIController* Requester = Waiting[BestIndex].Controller.Get();
+		Waiting.RemoveAt(BestIndex, EAllowShrinking::No);
+		Grant(Requester);
+	}
+}
+
+int32 UTDSAttackTokenComponent::CountAttackMontages() const
+{
+	int32 NumMontages = 0;
+	for (TActorIterator<ATDSEnemyCharacter> It(GetWorld()); It; ++It)
+	{
+		const UAnimInstance* AnimInstance = It->GetMesh() ? It->GetMesh()->GetAnimInstance() : nullptr;
+		if (AnimInstance && It->MeleeAttackMontage && AnimInstance->Montage_IsPlaying(It->MeleeAttackMontage))
+		{
+			NumMontages++;
+		}
+	}
+	return NumMontages;
+}
+
+void UTDSAttackTokenComponent::StartBenchmark(bool bUseTokens, float Seconds)
+{
+	CVarTDSAttackTokens->Set(bUseTokens, ECVF_SetByConsole);
+
+	bBenchmarkTokens = bUseTokens;
+	Benchmark.Start(Seconds);
+	UTDSEnemyMeshComponent::ResetTickCounters();
+
+	UE_LOG(LogTemp, Log, TEXT("tds.AI.AttackTokenBenchmark: tokens %s, measuring for %.1f s"), bUseTokens ? TEXT("on") : TEXT("off"), Benchmark.GetSeconds());
+}
+
+void UTDSAttackTokenComponent::FinishBenchmark()
+{
+	// Enemy mesh ticks are where the animation graphs and montages are evaluated
+	const int32 NumFrames = FMath::Max(Benchmark.GetNumFrames(), 1);
+	const double MeshTickMs = FPlatformTime::ToMilliseconds64(UTDSEnemyMeshComponent::GetTickCycles());
+
+	UE_LOG(LogTemp, Log, TEXT("tds.AI.AttackTokenBenchmark: tokens %s (max %d), %s | enemy animation %.3f ms per frame | %.1f attack montages playing avg | %.1f enemies waiting avg"),
+		bBenchmarkTokens ? TEXT("on") : TEXT("off"),
+		MaxTokens,
+		*Benchmark.GetFrameSummary(),
+		MeshTickMs / NumFrames,
+		Benchmark.GetAverage(SampleMontages),
+		Benchmark.GetAverage(SampleWaiting));
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "TDSBenchmark.h"
+#include "TDSAttackTokenComponent.generated.h"
+
+class ATDSEnemyAIController;
+
+// An enemy holding or waiting for an attack token
+struct FTDSAttackTokenEntry
+{
+	TWeakObjectPtr<ATDSEnemyAIController> Controller;
+
+	// When the enemy started waiting, or was granted the token
+	double Time = 0.0;
+};
+
+// This component sits on the player and caps how many enemies can attack it at once.
+// An attacking enemy asks for a token before each swing and gives it back when the swing's montage ends. Without a token it
+// holds its slot facing the player, with no montage playing and no melee hit tests, until one frees up. Free tokens go to the
+// waiting enemy with the best priority: the closest, with every second already spent waiting counted as WaitPriorityPerSecond
+// units closer, so nobody at the back of the crowd waits forever.
+// tds.AI.AttackTokens 0 grants every request straight away, which is how attacks worked before, for comparisons.
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class UTDSAttackTokenComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTDSAttackTokenComponent();
+
+	// Number of enemies that may be attacking at the same time
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Attack Tokens", meta = (ClampMin = "1"))
+	int32 MaxTokens = 3;
+
+	// How many units of distance one second of waiting is worth when picking who gets the next token
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Attack Tokens", meta = (ClampMin = "0.0"))
+	float WaitPriorityPerSecond = 150.f;
+
+	// A token not given back after this long is taken back, in case its holder never finished its swing
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Attack Tokens", meta = (ClampMin = "0.0"))
+	float MaxHoldSeconds = 3.f;
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Asks for a token. The controller's ReceiveAttackToken is called when it is granted, possibly straight away.
+	void RequestToken(ATDSEnemyAIController* Requester);
+
+	// Gives a token back, or stops waiting for one
+	void ReleaseToken(ATDSEnemyAIController* Holder);
+
+	int32 GetNumHolders() const { return Holders.Num(); }
+	int32 GetNumWaiting() const { return Waiting.Num(); }
+
+	// Turns tokens on or off, then logs frame time, enemy animation cost, attack montages playing and enemies waiting over
+	// the next Seconds. Used by tds.AI.AttackTokenBenchmark.
+	void StartBenchmark(bool bUseTokens, float Seconds);
+
+private:
+	// Hands free tokens to the waiting enemies with the best priority
+	void GrantTokens();
+
+	// Grants a token, returns false if the requester is gone
+	bool Grant(ATDSEnemyAIController* Requester);
+
+	// Number of enemies currently playing their melee attack montage, for the benchmark
+	int32 CountAttackMontages() const;
+
+	// Enemies holding a token, and when they got it
+	TArray<FTDSAttackTokenEntry> Holders;
+
+	// Enemies waiting for a token, and since when
+	TArray<FTDSAttackTokenEntry> Waiting;
+
+	// Logs the benchmark results
+	void FinishBenchmark();
+
+	// ---- Benchmark ----
+	FTDSFrameBenchmark Benchmark;
+	bool bBenchmarkTokens = true;
+};
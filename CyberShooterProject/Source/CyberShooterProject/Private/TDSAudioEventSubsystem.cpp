@@ -0,0 +1,227 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSAudioEventSubsystem.h"
+#include "CyberShooterProject.h"
+#include "AudioDevice.h"
+#include "Components/AudioComponent.h"
+#include "Engine/World.h"
+#include "Sound/SoundBase.h"
+
+DECLARE_CYCLE_STAT(TEXT("Audio Events Flush"), STAT_TDSAudioEventsFlush, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Audio Events Requested"), STAT_TDSAudioEventsRequested, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Audio Events Coalesced"), STAT_TDSAudioEventsCoalesced, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Audio Events Dropped"), STAT_TDSAudioEventsDropped, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Audio Events Played"), STAT_TDSAudioEventsPlayed, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Audio Pooled Voices"), STAT_TDSAudioPooledVoices, STATGROUP_CyberShooter);
+
+bool UTDSAudioEventSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSAudioEventSubsystem::Deinitialize()
+{
+	// The pooled components are destroyed with their host actor when the world goes away
+	PendingRequests.Empty();
+	MergedRequests.Empty();
+	Voices.Empty();
+	VoiceCategories.Empty();
+	VoiceHost = nullptr;
+
+	SET_DWORD_STAT(STAT_TDSAudioPooledVoices, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSAudioEventSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSAudioEventSubsystem, STATGROUP_Tickables);
+}
+
+void UTDSAudioEventSubsystem::PlaySound(ETDSAudioCategory Category, USoundBase* Sound, const FVector& Location, float Volume, float Pitch)
+{
+	if (!Sound)
+	{
+		return;
+	}
+
+	FTDSAudioRequest& Request = PendingRequests.AddDefaulted_GetRef();
+	Request.Sound = Sound;
+	Request.Location = Location;
+	Request.Volume = Volume;
+	Request.Pitch = Pitch;
+	Request.Category = Category;
+
+	NumRequested++;
+	INC_DWORD_STAT(STAT_TDSAudioEventsRequested);
+}
+
+void UTDSAudioEventSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (PendingRequests.Num() == 0)
+	{
+		return;
+	}
+
+	FlushRequests();
+}
+
+void UTDSAudioEventSubsystem::FlushRequests()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TDSAudioEventsFlush);
+
+	UWorld* World = GetWorld();
+
+	// Merge requests for the same sound that are close to each other, keeping the loudest volume
+	MergedRequests.Reset();
+	const float CoalesceDistanceSq = FMath::Square(CoalesceDistance);
+
+	for (const FTDSAudioRequest& Request : PendingRequests)
+	{
+		FTDSAudioRequest* Merged = MergedRequests.FindByPredicate([&Request, CoalesceDistanceSq](const FTDSAudioRequest& Other)
+		{
+			return Other.Sound == Request.Sound
+				&& Other.Category == Request.Category
+				&& FVector::DistSquared(Other.Location, Request.Location) <= CoalesceDistanceSq;
+		});
+
+		if (Merged)
+		{
+			Merged->Volume = FMath::Max(Merged->Volume, Request.Volume);
+			NumCoalesced++;
+			INC_DWORD_STAT(STAT_TDSAudioEventsCoalesced);
+			continue;
+		}
+
+		MergedRequests.Add(Request);
+	}
+
+	PendingRequests.Reset();
+
+	// Without an audio device there is nothing to play, the merged requests only count towards the stats.
+	// Merging still happens first so the counters read the same with -nosound and in automation as in a normal game.
+	if (!World || !World->bAllowAudioPlayback || !World->GetAudioDevice().IsValid())
+	{
+		NumDropped += MergedRequests.Num();
+		INC_DWORD_STAT_BY(STAT_TDSAudioEventsDropped, MergedRequests.Num());
+		return;
+	}
+
+	// Count the voices still playing from earlier frames
+	int32 PlayingVoices[static_cast<int32>(ETDSAudioCategory::Count)] = {};
+	for (int32 VoiceIndex = 0; VoiceIndex < Voices.Num(); ++VoiceIndex)
+	{
+		if (Voices[VoiceIndex] && Voices[VoiceIndex]->IsPlaying())
+		{
+			PlayingVoices[static_cast<int32>(VoiceCategories[VoiceIndex])]++;
+		}
+	}
+
+	for (const FTDSAudioRequest& Request : MergedRequests)
+	{
+		const int32 CategoryIndex = static_cast<int32>(Request.Category);
+
+		// The category is at its cap, this sound would only be buried under the ones already playing
+		if (PlayingVoices[CategoryIndex] >= GetMaxVoices(Request.Category))
+		{
+			NumDropped++;
+			INC_DWORD_STAT(STAT_TDSAudioEventsDropped);
+			continue;
+		}
+
+		UAudioComponent* Voice = AcquireVoice();
+		if (!Voice)
+		{
+			NumDropped++;
+			INC_DWORD_STAT(STAT_TDSAudioEventsDropped);
+			continue;
+		}
+
+		Voice->SetSound(Request.Sound);
+		Voice->SetWorldLocation(Request.Location);
+		Voice->SetVolumeMultiplier(Request.Volume);
+		Voice->SetPitchMultiplier(Request.Pitch);
+		Voice->Play();
+
+		VoiceCategories[Voices.IndexOfByKey(Voice)] = Request.Category;
+		PlayingVoices[CategoryIndex]++;
+
+		NumPlayed++;
+		INC_DWORD_STAT(STAT_TDSAudioEventsPlayed);
+	}
+
+	SET_DWORD_STAT(STAT_TDSAudioPooledVoices, Voices.Num());
+}
+
+UAudioComponent* UTDSAudioEventSubsystem::AcquireVoice()
+{
+	// Reuse a voice that has finished playing
+	for (UAudioComponent* Voice : Voices)
+	{
+		if (Voice && !Voice->IsPlaying())
+		{
+			return Voice;
+		}
+	}
+
+	if (Voices.Num() >= MaxPooledVoices)
+	{
+		return nullptr;
+	}
+
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	// One hidden actor hosts every pooled voice
+	if (!VoiceHost)
+	{
+		FActorSpawnParameters Params;
+		Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		VoiceHost = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, Params);
+		if (!VoiceHost)
+		{
+			return nullptr;
+		}
+
+		USceneComponent* HostRoot = NewObject<USceneComponent>(VoiceHost, TEXT("Root"));
+		VoiceHost->SetRootComponent(HostRoot);
+		HostRoot->RegisterComponent();
+	}
+
+	// Voices are never destroyed when they finish, they go back to waiting for the next sound
+	UAudioComponent* Voice = NewObject<UAudioComponent>(VoiceHost);
+	Voice->bAutoActivate = false;
+	Voice->bAutoDestroy = false;
+	Voice->bStopWhenOwnerDestroyed = false;
+	Voice->SetUsingAbsoluteLocation(true);
+	Voice->SetupAttachment(VoiceHost->GetRootComponent());
+	Voice->RegisterComponent();
+
+	Voices.Add(Voice);
+	VoiceCategories.Add(ETDSAudioCategory::Weapon);
+
+	return Voice;
+}
+
+int32 UTDSAudioEventSubsystem::GetMaxVoices(ETDSAudioCategory Category) const
+{
+	switch (Category)
+	{
+	case ETDSAudioCategory::Weapon:
+		return MaxWeaponVoices;
+	case ETDSAudioCategory::Impact:
+		return MaxImpactVoices;
+	case ETDSAudioCategory::Hurt:
+		return MaxHurtVoices;
+	case ETDSAudioCategory::Death:
+		return MaxDeathVoices;
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSAudioEventSubsystem.generated.h"
+
+class UAudioComponent;
+class USoundBase;
+
+// What kind of sound a request is, each category has its own voice cap
+UENUM()
+enum class ETDSAudioCategory : uint8
+{
+	Weapon,
+	Impact,
+	Hurt,
+	Death,
+	Count UMETA(Hidden)
+};
+
+// A sound waiting to be played at the end of the frame
+struct FTDSAudioRequest
+{
+	USoundBase* Sound = nullptr;
+	FVector Location = FVector::ZeroVector;
+	float Volume = 1.f;
+	float Pitch = 1.f;
+	ETDSAudioCategory Category = ETDSAudioCategory::Weapon;
+};
+
+// This subsystem plays the game's one-shot combat sounds. Sounds are requested by category during the frame and played once
+// per frame: requests for the same sound close to each other are merged into one voice, each category is capped to a number
+// of voices playing at once, and the voices are played on a small pool of reused audio components instead of a new component
+// per sound. Without an audio device (-nosound, dedicated servers, automation) requests are still counted but nothing is played.
+UCLASS(Config = Game)
+class UTDSAudioEventSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only play sounds in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Requests a one-shot sound at Location, it is played (or merged or dropped) at the end of the frame
+	void PlaySound(ETDSAudioCategory Category, USoundBase* Sound, const FVector& Location, float Volume = 1.f, float Pitch = 1.f);
+
+	// Running totals, also published to "stat CyberShooter"
+	int32 GetNumRequested() const { return NumRequested; }
+	int32 GetNumCoalesced() const { return NumCoalesced; }
+	int32 GetNumDropped() const { return NumDropped; }
+	int32 GetNumPlayed() const { return NumPlayed; }
+
+private:
+	// Merges this frame's requests and plays what fits in the voice budget
+	void FlushRequests();
+
+	// Returns a pooled audio component that is not playing, creating one if the pool is not full yet
+	UAudioComponent* AcquireVoice();
+
+	// Returns the voice cap of a category
+	int32 GetMaxVoices(ETDSAudioCategory Category) const;
+
+	// Requests for the same sound closer than this within one frame are played as a single voice
+	UPROPERTY(Config)
+	float CoalesceDistance = 300.f;
+
+	// Voices each category may have playing at once
+	UPROPERTY(Config)
+	int32 MaxWeaponVoices = 4;
+
+	UPROPERTY(Config)
+	int32 MaxImpactVoices = 6;
+
+	UPROPERTY(Config)
+	int32 MaxHurtVoices = 4;
+
+	UPROPERTY(Config)
+	int32 MaxDeathVoices = 3;
+
+	// Most audio components the pool will ever create
+	UPROPERTY(Config)
+	int32 MaxPooledVoices = 24;
+
+	// Actor that owns the pooled audio components
+	UPROPERTY()
+	TObjectPtr<AActor> VoiceHost;
+
+	// The pooled audio components, and the category each one was last played for
+	UPROPERTY()
+	TArray<TObjectPtr<UAudioComponent>> Voices;
+	TArray<ETDSAudioCategory> VoiceCategories;
+
+	// Requests made this frame
+	TArray<FTDSAudioRequest> PendingRequests;
+
+	// Requests left after merging, scratch buffer reused every frame
+	TArray<FTDSAudioRequest> MergedRequests;
+
+	int32 NumRequested = 0;
+	int32 NumCoalesced = 0;
+	int32 NumDropped = 0;
+	int32 NumPlayed = 0;
+};
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSBenchmark.h"
+#include "Engine/World.h"
+#include "Misc/App.h"
+
+void FTDSFrameBenchmark::Start(float InSeconds)
+{
+	Seconds = FMath::Max(InSeconds, 0.1f);
+	TimeLeft = Seconds;
+	NumFrames = 0;
+	FrameTime = 0.0;
+	WorstFrameTime = 0.0;
+	Samples.Reset();
+}
+
+void FTDSFrameBenchmark::AddSample(int32 Index, double Value)
+{
+	if (Index >= Samples.Num())
+	{
+		Samples.SetNumZeroed(Index + 1);
+	}
+	Samples[Index] += Value;
+}
+
+bool FTDSFrameBenchmark::Tick()
+{
+	if (!IsRunning())
+	{
+		return false;
+	}
+
+	const double DeltaTime = FApp::GetDeltaTime();
+
+	NumFrames++;
+	FrameTime += DeltaTime;
+	WorstFrameTime = FMath::Max(WorstFrameTime, DeltaTime);
+
+	TimeLeft -= DeltaTime;
+	if (TimeLeft <= 0.f)
+	{
+		TimeLeft = 0.f;
+		return true;
+	}
+
+	return false;
+}
+
+double FTDSFrameBenchmark::GetAverageFrameMs() const
+{
+	return FrameTime * 1000.0 / FMath::Max(NumFrames, 1);
+}
+
+double FTDSFrameBenchmark::GetAverage(int32 Index) const
+{
+	return Samples.IsValidIndex(Index) ? Samples[Index] / FMath::Max(NumFrames, 1) : 0.0;
+}
+
+FString FTDSFrameBenchmark::GetFrameSummary() const
+{
+	return FString::Printf(TEXT("%d frames | frame %.2f ms avg, %.2f ms worst"), NumFrames, GetAverageFrameMs(), GetWorstFrameMs());
+}
+
+void FTDSFrameBenchmark::Run(UWorld* World, float Seconds, TFunction<void(FTDSFrameBenchmark&)> OnFrame, TFunction<void(const FTDSFrameBenchmark&)> OnFinished)
+{
+	if (!World)
+	{
+		return;
+	}
+
+	// Owned by the delegate, which removes itself once the window has run out
+	TSharedRef<FTDSFrameBenchmark> Benchmark = MakeShared<FTDSFrameBenchmark>();
+	Benchmark->Start(Seconds);
+
+	TSharedRef<FDelegateHandle> Handle = MakeShared<FDelegateHandle>();
+	*Handle = FWorldDelegates::OnWorldPostActorTick.AddLambda(
+		[WeakWorld = TWeakObjectPtr<UWorld>(World), Benchmark, Handle, OnFrame = MoveTemp(OnFrame), OnFinished = MoveTemp(OnFinished)](UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+		{
+			// Removing the delegate destroys this lambda, so nothing captured is touched after that
+			const FDelegateHandle SelfHandle = *Handle;
+
+			if (!WeakWorld.IsValid())
+			{
+				FWorldDelegates::OnWorldPostActorTick.Remove(SelfHandle);
+				return;
+			}
+
+			if (InWorld != WeakWorld.Get())
+			{
+				return;
+			}
+
+			OnFrame(*Benchmark);
+			if (Benchmark->Tick())
+			{
+				OnFinished(*Benchmark);
+				FWorldDelegates::OnWorldPostActorTick.Remove(SelfHandle);
+			}
+		});
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Measures a benchmark over a few seconds of real frames, for the tds.*.Benchmark commands that compare two settings
+// while the room plays instead of timing a fixed loop. Start opens the window, every frame the owner adds what it samples
+// with AddSample and then calls Tick, which returns true on the frame the window runs out. Frame time comes from
+// FApp::GetDeltaTime, so it is the whole frame, run with vsync off for meaningful numbers.
+struct FTDSFrameBenchmark
+{
+	// Opens a window of Seconds (at least 0.1 s) and clears everything measured so far
+	void Start(float InSeconds);
+
+	// Stops measuring without reporting
+	void Cancel() { TimeLeft = 0.f; }
+
+	bool IsRunning() const { return TimeLeft > 0.f; }
+
+	// Adds Value to sample Index for the current frame, samples are averaged per frame
+	void AddSample(int32 Index, double Value);
+
+	// Ends the current frame. Returns true once, on the frame the window runs out.
+	bool Tick();
+
+	float GetSeconds() const { return Seconds; }
+	int32 GetNumFrames() const { return NumFrames; }
+	double GetAverageFrameMs() const;
+	double GetWorstFrameMs() const { return WorstFrameTime * 1000.0; }
+
+	// Per frame average of sample Index
+	double GetAverage(int32 Index) const;
+
+	// "N frames | frame X ms avg, Y ms worst", the part every report starts with
+	FString GetFrameSummary() const;
+
+	// Runs a benchmark from the world's post actor tick, for subjects that do not tick on their own. OnFrame adds the
+	// frame's samples and OnFinished logs the report. The run is dropped if the world goes away first.
+	static void Run(UWorld* World, float Seconds, TFunction<void(FTDSFrameBenchmark&)> OnFrame, TFunction<void(const FTDSFrameBenchmark&)> OnFinished);
+
+private:
+	float Seconds = 0.f;
+	float TimeLeft = 0.f;
+	int32 NumFrames = 0;
+	double FrameTime = 0.0;
+	double WorstFrameTime = 0.0;
+	TArray<double, TInlineAllocator<4>> Samples;
+};
@@ -2,6 +2,7 @@
 
 
 #include "TDSCharacter.h"
+#include "CyberShooterProject.h"
 
 #include "InputCoreTypes.h"
 
@@ -22,14 +23,36 @@
 #include "Engine/World.h"
 #include "Engine/Engine.h"
 #include "TDSUpgradeComponent.h"
+#include "TDSAttackTokenComponent.h"
 #include "TDSProjectile.h"
+#include "TDSProjectilePoolSubsystem.h"
+#include "TDSProjectileSubsystem.h"
+#include "TDSHitscanSubsystem.h"
+#include "TDSAudioEventSubsystem.h"
+#include "TDSCollisionChannels.h"
+#include "TDSSpatialGridSubsystem.h"
+#include "TDSEffectSubsystem.h"
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
 #include "InputActionValue.h"
-#include "NiagaraFunctionLibrary.h"
+#include "NiagaraComponent.h"
 #include "TDSHUDWidget.h"
 #include "Blueprint/UserWidget.h"
 #include "Sound/SoundBase.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Muzzle Flash Triggers"), STAT_TDSMuzzleFlashTriggers, STATGROUP_CyberShooter);
+
+static TAutoConsoleVariable<int32> CVarTDSForceHitscan(
+	TEXT("tds.Weapon.ForceHitscan"),
+	0,
+	TEXT("Forces every weapon to resolve its shots with traces instead of projectiles, for performance comparisons.\n")
+	TEXT("0: use each weapon's FireMode (default)\n")
+	TEXT("1: hitscan for all weapons"),
+	ECVF_Default);
+
+// The socket on the weapon mesh that shots and the muzzle flash come out of
+static const FName MuzzleSocketName(TEXT("Muzzle"));
 
 // Sets default values
 ATDSCharacter::ATDSCharacter()
@@ -81,6 +104,9 @@ ATDSCharacter::ATDSCharacter()
 	Camera->SetupAttachment(CameraBoom);
 	Camera->bUsePawnControlRotation = false;
 
+	// The capsule never touches the player's own projectiles
+	GetCapsuleComponent()->SetCollisionProfileName(TDSCollisionProfiles::PlayerPawn);
+
 	// ===== Prevent mesh from blocking camera =====
 	GetMesh()->SetCollisionResponseToChannel(ECC_Camera, ECR_Ignore);
 
@@ -94,8 +120,16 @@ ATDSCharacter::ATDSCharacter()
 	WeaponMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 	WeaponMesh->SetGenerateOverlapEvents(false);
 
+	// Create the muzzle flash on the muzzle socket, it stays asleep until the first shot
+	MuzzleFlashComponent = CreateDefaultSubobject<UNiagaraComponent>(TEXT("MuzzleFlash"));
+	MuzzleFlashComponent->SetupAttachment(WeaponMesh, MuzzleSocketName);
+	MuzzleFlashComponent->bAutoActivate = false;
+
 	// Create the upgrade component
 	UpgradeComponent = CreateDefaultSubobject<UTDSUpgradeComponent>(TEXT("UpgradeComponent"));
+
+	// Create the attack token component
+	AttackTokenComponent = CreateDefaultSubobject<UTDSAttackTokenComponent>(TEXT("AttackTokenComponent"));
 }
 
 // Called when the game starts or when spawned
@@ -147,8 +181,45 @@ void ATDSCharacter::BeginPlay()
 	if (WeaponMesh)
 	{
 		WeaponDefaultRelativeLocation = WeaponMesh->GetRelativeLocation();
+
+		// The weapon mesh never changes at runtime, so the socket only needs looking up once
+		bHasMuzzleSocket = WeaponMesh->DoesSocketExist(MuzzleSocketName);
+	}
+
+	// Give the muzzle flash component its effect, the system instance is created once here and reused for every shot
+	if (MuzzleFlashComponent)
+	{
+		MuzzleFlashComponent->SetAsset(MuzzleFlashEffect);
+
+		// Counted once, like any other effect component, so the pooled and per-shot paths can be compared
+		if (MuzzleFlashEffect)
+		{
+			if (UTDSEffectSubsystem* Effects = GetWorld()->GetSubsystem<UTDSEffectSubsystem>())
+			{
+				Effects->RecordComponent(MuzzleFlashComponent);
+			}
+		}
+	}
+
+	// Pre-spawn the projectiles so firing never has to spawn an actor
+	WarmProjectilePool();
+
+	// Join the spatial grid so enemies can find us without physics queries
+	if (UTDSSpatialGridSubsystem* SpatialGrid = GetWorld()->GetSubsystem<UTDSSpatialGridSubsystem>())
+	{
+		SpatialGrid->RegisterAgent(this, ETDSGridAgent::Player);
+	}
+
+}
+
+void ATDSCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTDSSpatialGridSubsystem* SpatialGrid = GetWorld()->GetSubsystem<UTDSSpatialGridSubsystem>())
+	{
+		SpatialGrid->UnregisterAgent(this);
 	}
 
+	Super::EndPlay(EndPlayReason);
 }
 
 void ATDSCharacter::Tick(float DeltaSeconds)
@@ -159,6 +230,13 @@ void ATDSCharacter::Tick(float DeltaSeconds)
 	if (!bIsDead) {
 		FaceMouseCursor();
 	}
+
+	// Emit every shot owed this frame, however many that is at the current fire rate
+	TArray<float, TInlineAllocator<16>> ShotAges;
+	if (FireAccumulator.Advance(DeltaSeconds, CurrentFireInterval, MaxShotsPerFrame, MaxShotAge, ShotAges) > 0)
+	{
+		FireBatch(ShotAges);
+	}
 		
 
 	// Handle recoil return
@@ -234,90 +312,132 @@ void ATDSCharacter::Move(const FInputActionValue& Value)
 // Handles starting the firing of projectiles
 void ATDSCharacter::StartFiring()
 {
-	if (bIsFiring && !GetWorldTimerManager().IsTimerActive(FireTimerHandle))
-	{
-		bIsFiring = false;
-	}
-
-	if (bIsFiring)
+	if (bIsFiring || bIsDead)
 	{
 		return;
 	}
 
 	bIsFiring = true;
 
-	const float FireInterval = FMath::Max(CurrentFireInterval, 0.01f);
-
-	// Fire immediately
-	FireOnce();
-
-	// Then start looping
-	GetWorldTimerManager().ClearTimer(FireTimerHandle);
-	GetWorldTimerManager().SetTimer(
-		FireTimerHandle,
-		this,
-		&ATDSCharacter::FireOnce,
-		FireInterval,
-		true
-	);
+	// Fire immediately if the weapon has cooled down, Tick takes care of the rest
+	if (FireAccumulator.PressTrigger(FMath::Max(CurrentFireInterval, 0.01f)))
+	{
+		FireOnce();
+	}
 }
 
 void ATDSCharacter::StopFiring()
 {
 	bIsFiring = false;
-	GetWorldTimerManager().ClearTimer(FireTimerHandle);
+	FireAccumulator.ReleaseTrigger();
 }
+
 void ATDSCharacter::FireOnce()
+{
+	const float ShotAge = 0.f;
+	FireBatch(MakeArrayView(&ShotAge, 1));
+}
+
+void ATDSCharacter::FireBatch(TArrayView<const float> ShotAges)
 {
 	// Make sure we have a projectile class to spawn
 	if (!ProjectileClass) return;
 	if (!WeaponMesh) return;
 
-	// Default fallback
-	FVector SpawnLocation = GetActorLocation() + GetActorForwardVector() * 80.f + FVector(0.f, 0.f, 20.f);
-
-	// Use muzzle socket location if it exists
-	if (WeaponMesh->DoesSocketExist(TEXT("Muzzle")))
+	for (const float ShotAge : ShotAges)
 	{
-		SpawnLocation = WeaponMesh->GetSocketLocation(TEXT("Muzzle"));
+		SpawnShot(ShotAge);
 	}
 
+	// Feedback is played once per batch, several shots in one frame would only stack on top of each other
+	PlayFireFeedback();
+}
+
+void ATDSCharacter::SpawnShot(float ShotAge)
+{
+	// Start from the muzzle, looked up once per frame however many shots are fired
+	FVector SpawnLocation = GetMuzzleTransform().GetLocation();
+
 	// Keep using the character's facing direction for projectile movement
 	const FRotator SpawnRotation = GetActorRotation();
 
 	// Add a small offset to the spawn location to prevent immediate collision with the player
 	SpawnLocation += GetActorForwardVector() * 20.f;
 
-	FActorSpawnParameters Params;
-	Params.Owner = this;
-	Params.Instigator = this;
-	Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	// Hitscan shots are resolved instantly, so they start right at the muzzle and ignore how long ago they were due
+	if (UsesHitscan())
+	{
+		if (UTDSHitscanSubsystem* HitscanSubsystem = GetWorld()->GetSubsystem<UTDSHitscanSubsystem>())
+		{
+			HitscanSubsystem->QueueShot(
+				ProjectileClass,
+				GetMuzzleTransform().GetLocation(),
+				GetActorForwardVector(),
+				HitscanRange,
+				CurrentProjectileDamage,
+				this,
+				this,
+				HitscanTracerSeconds
+			);
+		}
+		return;
+	}
+
+	// Move the shot forward by however long ago it was due, so bullet spacing matches the fire rate at any frame rate
+	SpawnLocation += GetActorForwardVector() * CurrentProjectileSpeed * ShotAge;
 
-	ATDSProjectile* Projectile = GetWorld()->SpawnActor<ATDSProjectile>(
-		ProjectileClass,
-		SpawnLocation,
-		SpawnRotation,
-		Params
-	);
+	const FTransform SpawnTransform(SpawnRotation, SpawnLocation);
 
-	if (Projectile)
+	// Projectile classes flagged for batched simulation never become actors
+	if (ProjectileClass->GetDefaultObject<ATDSProjectile>()->UsesBatchedSimulation())
 	{
-		Projectile->InitialiseProjectile(CurrentProjectileDamage, CurrentProjectileSpeed);
+		if (UTDSProjectileSubsystem* ProjectileSubsystem = GetWorld()->GetSubsystem<UTDSProjectileSubsystem>())
+		{
+			ProjectileSubsystem->SpawnProjectile(
+				ProjectileClass,
+				SpawnTransform,
+				this,
+				this,
+				CurrentProjectileDamage,
+				CurrentProjectileSpeed,
+				ShotAge
+			);
+		}
 	}
-
-	// Spawn muzzle flash effect if we have one and the socket exists
-	if (MuzzleFlashEffect && WeaponMesh && WeaponMesh->DoesSocketExist(TEXT("Muzzle")))
+	// Otherwise take a sleeping projectile from the pool and launch it
+	else if (UTDSProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UTDSProjectilePoolSubsystem>())
 	{
-		const FVector MuzzleLocation = WeaponMesh->GetSocketLocation(TEXT("Muzzle"));
-		const FRotator MuzzleRotation = WeaponMesh->GetSocketRotation(TEXT("Muzzle"));
-
-		UNiagaraFunctionLibrary::SpawnSystemAtLocation(
-			GetWorld(),
-			MuzzleFlashEffect,
-			MuzzleLocation,
-			MuzzleRotation
+		ProjectilePool->AcquireProjectile(
+			ProjectileClass,
+			SpawnTransform,
+			this,
+			this,
+			CurrentProjectileDamage,
+			CurrentProjectileSpeed,
+			ShotAge
 		);
 	}
+}
+
+void ATDSCharacter::PlayFireFeedback()
+{
+	// Restart the muzzle flash if we have one and the socket exists. Resetting replays the burst on the existing
+	// system instance, so no component or instance is allocated per shot.
+	if (MuzzleFlashEffect && MuzzleFlashComponent && bHasMuzzleSocket)
+	{
+		UTDSEffectSubsystem* Effects = GetWorld()->GetSubsystem<UTDSEffectSubsystem>();
+		if (Effects && UTDSEffectSubsystem::UsePerShotSpawns())
+		{
+			// The old path, a new component at the muzzle for every shot, kept for measuring against
+			const FTransform& Muzzle = GetMuzzleTransform();
+			Effects->SpawnEffect(MuzzleFlashEffect, Muzzle.GetLocation(), Muzzle.Rotator());
+		}
+		else
+		{
+			MuzzleFlashComponent->Activate(true);
+		}
+		INC_DWORD_STAT(STAT_TDSMuzzleFlashTriggers);
+	}
 
 	// Apply recoil by setting the current weapon offset to the recoil distance.
 	WeaponCurrentOffset.X = -RecoilDistance;
@@ -341,17 +461,69 @@ void ATDSCharacter::FireOnce()
 		);
 
 
-		UGameplayStatics::PlaySoundAtLocation(
-			this,
-			FireSound,
-			GetActorLocation(),
-			FireSoundVolume,
-			FireSoundPitch
+		if (UTDSAudioEventSubsystem* Audio = GetWorld()->GetSubsystem<UTDSAudioEventSubsystem>())
+		{
+			Audio->PlaySound(
+				ETDSAudioCategory::Weapon,
+				FireSound,
+				GetActorLocation(),
+				FireSoundVolume,
+				FireSoundPitch
+			);
+		}
+	}
+
+}
+
+
+const FTransform& ATDSCharacter::GetMuzzleTransform()
+{
+	// Already looked up this frame
+	if (CachedMuzzleFrame == GFrameCounter)
+	{
+		return CachedMuzzleTransform;
+	}
+
+	CachedMuzzleFrame = GFrameCounter;
+
+	if (WeaponMesh && bHasMuzzleSocket)
+	{
+		CachedMuzzleTransform = WeaponMesh->GetSocketTransform(MuzzleSocketName);
+	}
+	else
+	{
+		// Default fallback
+		CachedMuzzleTransform = FTransform(
+			GetActorRotation(),
+			GetActorLocation() + GetActorForwardVector() * 80.f + FVector(0.f, 0.f, 20.f)
 		);
 	}
 
+	return CachedMuzzleTransform;
+}
+
+bool ATDSCharacter::UsesHitscan() const
+{
+	return FireMode == ETDSWeaponFireMode::Hitscan || CVarTDSForceHitscan.GetValueOnGameThread() != 0;
 }
 
+void ATDSCharacter::WarmProjectilePool()
+{
+	if (!ProjectileClass || !GetWorld()) return;
+
+	UTDSProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UTDSProjectilePoolSubsystem>();
+	if (!ProjectilePool) return;
+
+	// Batched projectiles and hitscan shots (configured or forced by tds.Weapon.ForceHitscan) are not actors, there is nothing to pool
+	const ATDSProjectile* ProjectileDefaults = ProjectileClass->GetDefaultObject<ATDSProjectile>();
+	if (ProjectileDefaults->UsesBatchedSimulation() || UsesHitscan()) return;
+
+	// The most projectiles that can be alive at once is their lifetime divided by the fire interval
+	const float FireInterval = FMath::Max(CurrentFireInterval, 0.01f);
+	const int32 MaxInFlight = FMath::CeilToInt(ProjectileDefaults->GetLifeSeconds() / FireInterval);
+
+	ProjectilePool->WarmPool(ProjectileClass, MaxInFlight + ProjectilePoolSlack);
+}
 
 void ATDSCharacter::FaceMouseCursor()
 {
@@ -381,6 +553,11 @@ void ATDSCharacter::HandleTakeAnyDamage(
 	const UDamageType* DamageType,
 	AController* InstigatedBy,
 	AActor* DamageCauser)
+{
+	ReceiveResolvedDamage(Damage);
+}
+
+void ATDSCharacter::ReceiveResolvedDamage(float Damage)
 {
 	// Ignore non-positive damage
 	if (Damage <= 0.f) return;
@@ -388,10 +565,10 @@ void ATDSCharacter::HandleTakeAnyDamage(
 	// If we're already dead, ignore further damage
 	if (bIsDead) return;
 
-	// Play damage sound if we have one
+	// Play damage sound if we have one. The player's own feedback skips the audio event subsystem, where it would
+	// share the capped Hurt voices with every enemy in the room and could be dropped.
 	if (DamageSound)
 	{
-
 		UGameplayStatics::PlaySoundAtLocation(
 			this,
 			DamageSound,
@@ -482,6 +659,12 @@ void ATDSCharacter::HandleDeath()
 
 	bIsDead = true;
 
+	// A dead player can no longer be found by enemies
+	if (UTDSSpatialGridSubsystem* SpatialGrid = GetWorld()->GetSubsystem<UTDSSpatialGridSubsystem>())
+	{
+		SpatialGrid->UnregisterAgent(this);
+	}
+
 	// Stop firing immediately
 	StopFiring();
 
@@ -499,9 +682,9 @@ void ATDSCharacter::HandleDeath()
 
 	float DeathDelay = 1.0f;
 
-	// Play death sound if available
+	// Play death sound if available, directly like the damage sound so enemy deaths can never crowd it out
 	if (DeathSound)
-		{
+	{
 		UGameplayStatics::PlaySoundAtLocation(
 			this,
 			DeathSound,
@@ -603,6 +786,12 @@ void ATDSCharacter::ApplyRecalculatedStats(
 	CurrentProjectileDamage = FMath::Max(0.f, NewProjectileDamage);
 	CurrentProjectileSpeed = FMath::Max(0.f, NewProjectileSpeed);
 
+	// A faster fire rate keeps more projectiles in flight, grow the pool now rather than mid-fight
+	if (HasActorBegunPlay())
+	{
+		WarmProjectilePool();
+	}
+
 	// Update movement speed in the character movement component
 	if (UCharacterMovementComponent* MoveComp = GetCharacterMovement())
 	{
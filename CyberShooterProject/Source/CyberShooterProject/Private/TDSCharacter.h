@@ -7,6 +7,7 @@
 #include "NiagaraSystem.h"
 #include "Camera/CameraShakeBase.h"
 #include "Animation/AnimMontage.h"
+#include "TDSFireAccumulator.h"
 #include "TDSCharacter.generated.h"
 
 
@@ -17,6 +18,18 @@ class UInputMappingContext;
 class UInputAction;
 struct FInputActionValue;
 class ATDSProjectile;
+class UNiagaraComponent;
+
+// How the weapon resolves its shots
+UENUM(BlueprintType)
+enum class ETDSWeaponFireMode : uint8
+{
+	// Shots are projectiles that travel through the world
+	Projectile,
+
+	// Shots are resolved instantly with a line trace from the muzzle
+	Hitscan
+};
 
 UCLASS()
 class ATDSCharacter : public ACharacter
@@ -64,6 +77,11 @@ public:
 	float GetCurrentProjectileDamage() const { return CurrentProjectileDamage; }
 	float GetCurrentProjectileSpeed() const { return CurrentProjectileSpeed; }
 
+	TSubclassOf<ATDSProjectile> GetProjectileClass() const { return ProjectileClass; }
+
+	// Applies damage that has already been summed for this frame by the damage subsystem
+	void ReceiveResolvedDamage(float Damage);
+
 	// Applies healing to the character, ensuring it does not exceed MaxHealth
 	UFUNCTION(BlueprintCallable, Category = "Health")
 	void Heal(float HealAmount);
@@ -84,10 +102,17 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	TObjectPtr<class UTDSUpgradeComponent> UpgradeComponent;
 
+	// Caps how many enemies can attack the player at the same time
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	TObjectPtr<class UTDSAttackTokenComponent> AttackTokenComponent;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Called when the character is removed from the world
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// Called every game tick to update
 	virtual void Tick(float DeltaSeconds) override;
 
@@ -142,6 +167,10 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon|Effects")
 	UNiagaraSystem* MuzzleFlashEffect;
 
+	// The one muzzle flash component, attached to the Muzzle socket and restarted on every shot instead of spawning a new system
+	UPROPERTY(VisibleAnywhere, Category = "Weapon|Effects")
+	TObjectPtr<UNiagaraComponent> MuzzleFlashComponent;
+
 	// The camera shake class to use when firing the weapon.
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon|Effects")
 	TSubclassOf<UCameraShakeBase> FireCameraShakeClass;
@@ -150,6 +179,13 @@ private:
 	FVector WeaponDefaultRelativeLocation = FVector::ZeroVector;
 	FVector WeaponCurrentOffset = FVector::ZeroVector;
 
+	// Whether the weapon mesh has a Muzzle socket, checked once at BeginPlay
+	bool bHasMuzzleSocket = false;
+
+	// The muzzle transform, looked up at most once per frame and shared by every shot fired that frame
+	FTransform CachedMuzzleTransform = FTransform::Identity;
+	uint64 CachedMuzzleFrame = MAX_uint64;
+
 	// --- HUD ---
 
 	// The HUD widget class to use for the player's HUD
@@ -224,6 +260,22 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category="Combat")
 	TSubclassOf<class ATDSProjectile> ProjectileClass;
 
+	// Whether shots are fired as projectiles or resolved instantly with traces. Hitscan still uses ProjectileClass for its impact and tracer visuals.
+	UPROPERTY(EditDefaultsOnly, Category = "Combat")
+	ETDSWeaponFireMode FireMode = ETDSWeaponFireMode::Projectile;
+
+	// How far a hitscan shot reaches
+	UPROPERTY(EditDefaultsOnly, Category = "Combat|Hitscan", meta = (ClampMin = "0.0"))
+	float HitscanRange = 3000.f;
+
+	// How long a hitscan tracer stays on screen
+	UPROPERTY(EditDefaultsOnly, Category = "Combat|Hitscan", meta = (ClampMin = "0.0"))
+	float HitscanTracerSeconds = 0.06f;
+
+	// Extra projectiles to keep warm in the pool on top of the number that can be in flight at the current fire rate
+	UPROPERTY(EditDefaultsOnly, Category = "Combat|Pooling", meta = (ClampMin = "0"))
+	int32 ProjectilePoolSlack = 8;
+
 	// A property that can change the fire rate 
 	UPROPERTY(EditDefaultsOnly, Category="Combat")
 	float BaseFireInterval = 0.25f;
@@ -244,8 +296,17 @@ private:
 	UPROPERTY(VisibleAnywhere, Category = "Stats|Current")
 	float CurrentProjectileSpeed = 2000.f;
 
-	// Timer handle to manage the firing rate
-	FTimerHandle FireTimerHandle;
+	// The most shots emitted in a single frame, owed shots beyond this (e.g. after a hitch) are dropped
+	UPROPERTY(EditDefaultsOnly, Category = "Combat", meta = (ClampMin = "1"))
+	int32 MaxShotsPerFrame = 32;
+
+	// The oldest a shot is allowed to be when it spawns. Shots are moved forward by their age without a sweep,
+	// so after a hitch this keeps them from being placed through whatever is in front of the muzzle.
+	UPROPERTY(EditDefaultsOnly, Category = "Combat", meta = (ClampMin = "0.0"))
+	float MaxShotAge = 1.f / 30.f;
+
+	// Counts the shots owed each frame to manage the firing rate
+	FTDSFireAccumulator FireAccumulator;
 	// Whether the player is currently firing
 	bool bIsFiring = false;
 
@@ -288,6 +349,24 @@ private:
 	// Handles firing a single projectile
 	void FireOnce();
 
+	// Fires one projectile per entry in ShotAges (how long ago each shot was due) and plays the fire feedback once
+	void FireBatch(TArrayView<const float> ShotAges);
+
+	// Fires a single shot: a hitscan trace, or a projectile moved forward by how long ago the shot was due
+	void SpawnShot(float ShotAge);
+
+	// Plays the muzzle flash, recoil, camera shake and fire sound
+	void PlayFireFeedback();
+
+	// Returns where shots leave the weapon this frame: the Muzzle socket if it exists, otherwise a point in front of the character
+	const FTransform& GetMuzzleTransform();
+
+	// Makes sure the projectile pool holds enough projectiles for the current fire rate
+	void WarmProjectilePool();
+
+	// Whether shots are currently resolved with traces, either by weapon config or forced by tds.Weapon.ForceHitscan
+	bool UsesHitscan() const;
+
 	// This will get the mouse aim point on the player to make sure that walls are not affecting rotation
 	bool GetMouseAimPointOnPlayerPlane(APlayerController& PC, FVector& OutAimPoint) const;
 
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+
+// Custom collision channels, these must match the DefaultChannelResponses in DefaultEngine.ini
+
+// Object channel of player projectiles, also used to trace the batched projectiles
+#define ECC_TDSProjectile ECC_GameTraceChannel1
+
+// Object channel of enemy capsules
+#define ECC_TDSEnemyHurtbox ECC_GameTraceChannel2
+
+// Collision profile names, defined in DefaultEngine.ini
+namespace TDSCollisionProfiles
+{
+	// Projectiles: query only, blocks the world and enemies, ignores other projectiles
+	inline const FName Projectile(TEXT("Projectile"));
+
+	// Enemy capsules: blocks the world and projectiles, overlaps pawns and other enemies
+	inline const FName EnemyHurtbox(TEXT("EnemyHurtbox"));
+
+	// Player capsule: a Pawn that never touches the player's own projectiles
+	inline const FName PlayerPawn(TEXT("PlayerPawn"));
+
+	// Exit and pickup triggers: query only, overlaps pawns and nothing else
+	inline const FName PawnTrigger(TEXT("PawnTrigger"));
+}
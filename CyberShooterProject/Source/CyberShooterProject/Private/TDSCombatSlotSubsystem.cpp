@@ -0,0 +1,280 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSCombatSlotSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSEnemyAIController.h"
+#include "TDSEnemyCharacter.h"
+#include "TDSNavigationCacheSubsystem.h"
+#include "NavigationSystem.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Combat Slot Assign"), STAT_TDSCombatSlotAssign, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Combat Slot Chasers"), STAT_TDSCombatSlotChasers, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Slot Projections"), STAT_TDSCombatSlotProjections, STATGROUP_CyberShooter);
+
+static TAutoConsoleVariable<float> CVarTDSSlotRecalcInterval(
+	TEXT("tds.AI.SlotRecalcInterval"),
+	0.8f,
+	TEXT("Seconds between combat slot assignment passes."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTDSSlotSpacing(
+	TEXT("tds.AI.SlotSpacing"),
+	140.f,
+	TEXT("Distance between neighbouring combat slots, and between the rings of slots around the player."),
+	ECVF_Default);
+
+namespace
+{
+	// One ring of slots around the player
+	struct FTDSSlotRing
+	{
+		float Radius = 0.f;
+		int32 Capacity = 0;
+		int32 FirstSlot = 0;
+		int32 NumFree = 0;
+	};
+
+	// Angle of a slot on its ring, odd rings are staggered by half a slot so the rings do not line up
+	float GetSlotAngle(const FTDSSlotRing& Ring, int32 RingIndex, int32 SlotInRing)
+	{
+		const float Step = 2.f * PI / Ring.Capacity;
+		return Step * SlotInRing + ((RingIndex & 1) ? Step * 0.5f : 0.f);
+	}
+}
+
+bool UTDSCombatSlotSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSCombatSlotSubsystem::Deinitialize()
+{
+	Chasers.Empty();
+	Candidates.Empty();
+	SlotTaken.Empty();
+
+	SET_DWORD_STAT(STAT_TDSCombatSlotChasers, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSCombatSlotSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSCombatSlotSubsystem, STATGROUP_Tickables);
+}
+
+void UTDSCombatSlotSubsystem::RegisterChaser(ATDSEnemyAIController* Controller)
+{
+	if (!Controller || Chasers.Contains(Controller))
+	{
+		return;
+	}
+
+	Chasers.Add(Controller);
+	bAssignPending = true;
+
+	// Until the next pass, aim for the point on the slot circle in line with where the enemy already is
+	APawn* Pawn = Controller->GetPawn();
+	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+	if (Pawn && PlayerPawn)
+	{
+		const FVector PlayerLoc = PlayerPawn->GetActorLocation();
+		const FVector ToPawn = (Pawn->GetActorLocation() - PlayerLoc).GetSafeNormal2D();
+		const FVector2D Jitter = Controller->GetSlotJitterOffset();
+
+		Controller->ReceiveSlotTarget(PlayerLoc + ToPawn * Controller->GetSlotRadius() + FVector(Jitter.X, Jitter.Y, 0.f));
+	}
+}
+
+void UTDSCombatSlotSubsystem::UnregisterChaser(ATDSEnemyAIController* Controller)
+{
+	Chasers.RemoveSwap(Controller, EAllowShrinking::No);
+}
+
+void UTDSCombatSlotSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeUntilAssign -= DeltaTime;
+	if (TimeUntilAssign > 0.f && !bAssignPending)
+	{
+		return;
+	}
+
+	TimeUntilAssign = FMath::Max(CVarTDSSlotRecalcInterval.GetValueOnGameThread(), 0.f);
+	bAssignPending = false;
+
+	AssignSlots();
+}
+
+void UTDSCombatSlotSubsystem::AssignSlots()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TDSCombatSlotAssign);
+
+	UWorld* World = GetWorld();
+	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(World, 0);
+	if (!World || !PlayerPawn)
+	{
+		return;
+	}
+
+	const FVector PlayerLoc = PlayerPawn->GetActorLocation();
+
+	// Gather the chasers that are still alive, dropping the ones whose pawn died or went away
+	Candidates.Reset();
+	float BaseRadius = TNumericLimits<float>::Max();
+
+	for (int32 Index = Chasers.Num() - 1; Index >= 0; --Index)
+	{
+		ATDSEnemyAIController* Controller = Chasers[Index].Get();
+		const ATDSEnemyCharacter* Enemy = Controller ? Cast<ATDSEnemyCharacter>(Controller->GetPawn()) : nullptr;
+		if (!Enemy || Enemy->IsDead())
+		{
+			Chasers.RemoveAtSwap(Index, EAllowShrinking::No);
+			continue;
+		}
+
+		const FVector PawnLoc = Enemy->GetActorLocation();
+		const FVector2D ToPawn(PawnLoc - PlayerLoc);
+
+		FTDSSlotCandidate& Candidate = Candidates.AddDefaulted_GetRef();
+		Candidate.Controller = Controller;
+		Candidate.PawnLocation = PawnLoc;
+		Candidate.DistanceSq = ToPawn.SizeSquared();
+		Candidate.Bearing = FMath::Atan2(ToPawn.Y, ToPawn.X);
+		Candidate.SortId = Controller->GetUniqueID();
+
+		BaseRadius = FMath::Min(BaseRadius, Controller->GetSlotRadius());
+	}
+
+	SET_DWORD_STAT(STAT_TDSCombatSlotChasers, Candidates.Num());
+
+	if (Candidates.Num() == 0)
+	{
+		return;
+	}
+
+	// Closest first, ties broken by id so two passes over the same positions always give the same answer
+	Candidates.Sort([](const FTDSSlotCandidate& A, const FTDSSlotCandidate& B)
+	{
+		return A.DistanceSq != B.DistanceSq ? A.DistanceSq < B.DistanceSq : A.SortId < B.SortId;
+	});
+
+	// Lay out just enough rings of slots for everyone, each ring holding as many slots as fit at the spacing
+	const float Spacing = FMath::Max(CVarTDSSlotSpacing.GetValueOnGameThread(), 1.f);
+
+	TArray<FTDSSlotRing, TInlineAllocator<8>> Rings;
+	int32 TotalSlots = 0;
+	while (TotalSlots < Candidates.Num())
+	{
+		FTDSSlotRing& Ring = Rings.AddDefaulted_GetRef();
+		Ring.Radius = BaseRadius + Spacing * (Rings.Num() - 1);
+		Ring.Capacity = FMath::Max(1, FMath::FloorToInt(2.f * PI * Ring.Radius / Spacing));
+		Ring.FirstSlot = TotalSlots;
+		Ring.NumFree = Ring.Capacity;
+		TotalSlots += Ring.Capacity;
+	}
+
+	SlotTaken.Init(false, TotalSlots);
+
+	// Each chaser takes the innermost ring with room, and on it the free slot closest to its current bearing
+	TArray<FNavigationProjectionWork> Projections;
+	Projections.Reserve(Candidates.Num());
+
+	for (const FTDSSlotCandidate& Candidate : Candidates)
+	{
+		int32 RingIndex = 0;
+		while (Rings[RingIndex].NumFree == 0)
+		{
+			RingIndex++;
+		}
+
+		FTDSSlotRing& Ring = Rings[RingIndex];
+
+		int32 BestSlot = INDEX_NONE;
+		float BestAngle = 0.f;
+		float BestDelta = TNumericLimits<float>::Max();
+
+		for (int32 SlotInRing = 0; SlotInRing < Ring.Capacity; ++SlotInRing)
+		{
+			if (SlotTaken[Ring.FirstSlot + SlotInRing])
+			{
+				continue;
+			}
+
+			const float Angle = GetSlotAngle(Ring, RingIndex, SlotInRing);
+			const float Delta = FMath::Abs(FMath::FindDeltaAngleRadians(Candidate.Bearing, Angle));
+			if (Delta < BestDelta)
+			{
+				BestDelta = Delta;
+				BestAngle = Angle;
+				BestSlot = SlotInRing;
+			}
+		}
+
+		SlotTaken[Ring.FirstSlot + BestSlot] = true;
+		Ring.NumFree--;
+
+		// Enemies with a wider preferred radius keep it, the ring only ever pushes them further out
+		ATDSEnemyAIController* Controller = Candidate.Controller.Get();
+		const float Radius = FMath::Max(Ring.Radius, Controller->GetSlotRadius());
+		const FVector2D Jitter = Controller->GetSlotJitterOffset();
+
+		const FVector Desired = PlayerLoc + FVector(
+			FMath::Cos(BestAngle) * Radius + Jitter.X,
+			FMath::Sin(BestAngle) * Radius + Jitter.Y,
+			0.f
+		);
+
+		Projections.Emplace(Desired);
+	}
+
+	// Slots in the open are projected from the room's navigation cache, the rest go to the navigation system
+	UTDSNavigationCacheSubsystem* NavCache = World->GetSubsystem<UTDSNavigationCacheSubsystem>();
+
+	TArray<FNavigationProjectionWork> Misses;
+	MissIndices.Reset();
+
+	for (int32 Index = 0; Index < Projections.Num(); ++Index)
+	{
+		FNavigationProjectionWork& Projection = Projections[Index];
+
+		FVector Projected;
+		if (NavCache && NavCache->ProjectPoint(Projection.Point, 200.f, Projected))
+		{
+			Projection.OutLocation = FNavLocation(Projected);
+			Projection.bResult = true;
+		}
+		else
+		{
+			Misses.Emplace(Projection.Point);
+			MissIndices.Add(Index);
+		}
+	}
+
+	// Project the misses to the navmesh in one batch so every slot is reachable
+	UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(World);
+	if (NavSys && Misses.Num() > 0)
+	{
+		// The 200 unit extent allows for a wider search around each slot, so a slot just off the navmesh still finds a point
+		NavSys->BatchProjectPoints(Misses, FVector(200.f, 200.f, 200.f));
+		INC_DWORD_STAT_BY(STAT_TDSCombatSlotProjections, Misses.Num());
+
+		for (int32 MissIndex = 0; MissIndex < Misses.Num(); ++MissIndex)
+		{
+			Projections[MissIndices[MissIndex]] = Misses[MissIndex];
+		}
+	}
+
+	for (int32 Index = 0; Index < Candidates.Num(); ++Index)
+	{
+		const FNavigationProjectionWork& Projection = Projections[Index];
+		const FVector SlotTarget = Projection.bResult ? Projection.OutLocation.Location : Projection.Point;
+
+		Candidates[Index].Controller->ReceiveSlotTarget(SlotTarget);
+	}
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSCombatSlotSubsystem.generated.h"
+
+class ATDSEnemyAIController;
+
+// One chaser's entry in a slot assignment pass
+struct FTDSSlotCandidate
+{
+	TWeakObjectPtr<ATDSEnemyAIController> Controller;
+	FVector PawnLocation = FVector::ZeroVector;
+	float DistanceSq = 0.f;
+	float Bearing = 0.f;
+	uint32 SortId = 0;
+};
+
+// This subsystem hands out the combat slots around the player. Instead of every chasing enemy running its own overlap query
+// and navmesh projection on a timer, all registered chasers are assigned in one pass per interval:
+// - slots are laid out on rings around the player, spaced so neighbouring enemies do not overlap, with more rings as the crowd grows
+// - chasers are sorted by distance to the player (then by id, so the result is deterministic) and, in that order, take the
+//   free slot closest to their current bearing, so closer enemies win conflicts and nobody has to cross the circle
+// - every slot is projected to the navmesh, from the room's navigation cache where it can, the rest in a single batch
+// Each controller is then handed its slot and just steers towards it.
+UCLASS()
+class UTDSCombatSlotSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only assign slots in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Adds a chaser to the slot assignment. It is given a rough slot straight away and a proper one on the next pass.
+	void RegisterChaser(ATDSEnemyAIController* Controller);
+
+	// Removes a chaser from the slot assignment
+	void UnregisterChaser(ATDSEnemyAIController* Controller);
+
+	// Number of chasers currently holding a slot
+	int32 GetNumChasers() const { return Chasers.Num(); }
+
+private:
+	// Assigns every registered chaser a slot around the player
+	void AssignSlots();
+
+	// Registered chasers
+	TArray<TWeakObjectPtr<ATDSEnemyAIController>> Chasers;
+
+	// Scratch buffers reused every pass
+	TArray<FTDSSlotCandidate> Candidates;
+	TArray<bool> SlotTaken;
+	TArray<int32> MissIndices;
+
+	// Time until the next assignment pass
+	float TimeUntilAssign = 0.f;
+
+	// Set when a chaser joins, so it gets a proper slot on the next tick rather than at the end of the interval
+	bool bAssignPending = false;
+};
@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSDamageSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSCharacter.h"
+#include "TDSEnemyCharacter.h"
+#include "TDSPlayerController.h"
+#include "TDSHUDWidget.h"
+#include "TDSHordeSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/DamageType.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_CYCLE_STAT(TEXT("Damage Resolve"), STAT_TDSDamageResolve, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damage Events Queued"), STAT_TDSDamageEventsQueued, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damage Targets Resolved"), STAT_TDSDamageTargetsResolved, STATGROUP_CyberShooter);
+
+bool UTDSDamageSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSDamageSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Resolve after every actor has ticked, so projectile hits from physics and melee hits from anim notifies land in the same pass
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UTDSDamageSubsystem::HandleWorldPostActorTick);
+}
+
+void UTDSDamageSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	PendingEvents.Empty();
+	AggregatedDamage.Empty();
+	TargetToAggregateIndex.Empty();
+
+	Super::Deinitialize();
+}
+
+void UTDSDamageSubsystem::QueueDamage(AActor* Target, float Amount, AController* InstigatedBy, AActor* DamageCauser, const FVector& HitLocation, int32 HitItem)
+{
+	if (!Target || Amount <= 0.f)
+	{
+		return;
+	}
+
+	FTDSDamageEvent& Event = PendingEvents.AddDefaulted_GetRef();
+	Event.Target = Target;
+	Event.Amount = Amount;
+	Event.InstigatedBy = InstigatedBy;
+	Event.DamageCauser = DamageCauser;
+	Event.HitLocation = HitLocation;
+	Event.HitItem = HitItem;
+
+	INC_DWORD_STAT(STAT_TDSDamageEventsQueued);
+}
+
+void UTDSDamageSubsystem::HandleWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld == GetWorld())
+	{
+		ResolvePendingDamage();
+	}
+}
+
+void UTDSDamageSubsystem::ResolvePendingDamage()
+{
+	if (PendingEvents.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TDSDamageResolve);
+
+	AggregatedDamage.Reset();
+	TargetToAggregateIndex.Reset();
+
+	const UTDSHordeSubsystem* Horde = GetWorld()->GetSubsystem<UTDSHordeSubsystem>();
+
+	// Sum the hits per target, the latest hit decides who gets the credit and where the hit happened
+	for (const FTDSDamageEvent& Event : PendingEvents)
+	{
+		AActor* Target = Event.Target.Get();
+		if (!Target)
+		{
+			continue;
+		}
+
+		// Horde proxies share their host actor, each instance is its own target
+		const int32 HitItem = Horde && Horde->IsProxyHost(Target) ? Event.HitItem : INDEX_NONE;
+
+		int32& AggregateIndex = TargetToAggregateIndex.FindOrAdd(TPair<AActor*, int32>(Target, HitItem), INDEX_NONE);
+		if (AggregateIndex == INDEX_NONE)
+		{
+			AggregateIndex = AggregatedDamage.AddDefaulted();
+			AggregatedDamage[AggregateIndex].Target = Target;
+			AggregatedDamage[AggregateIndex].HitItem = HitItem;
+		}
+
+		FTDSAggregatedDamage& Aggregated = AggregatedDamage[AggregateIndex];
+		Aggregated.TotalAmount += Event.Amount;
+		Aggregated.HitCount++;
+		Aggregated.InstigatedBy = Event.InstigatedBy;
+		Aggregated.DamageCauser = Event.DamageCauser;
+		Aggregated.HitLocation = Event.HitLocation;
+	}
+
+	// Applying damage can queue more damage (e.g. death effects), keep those for the next pass
+	PendingEvents.Reset();
+
+	ATDSEnemyCharacter* LastDamagedEnemy = nullptr;
+
+	for (const FTDSAggregatedDamage& Aggregated : AggregatedDamage)
+	{
+		ApplyAggregatedDamage(Aggregated);
+
+		if (ATDSEnemyCharacter* Enemy = Cast<ATDSEnemyCharacter>(Aggregated.Target.Get()))
+		{
+			LastDamagedEnemy = Enemy;
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_TDSDamageTargetsResolved, AggregatedDamage.Num());
+
+	// The HUD only tracks one enemy, so it is updated once for the last enemy hit this frame
+	if (LastDamagedEnemy)
+	{
+		if (ATDSPlayerController* PC = Cast<ATDSPlayerController>(GetWorld()->GetFirstPlayerController()))
+		{
+			if (UTDSHUDWidget* HUD = PC->GetHUDWidget())
+			{
+				HUD->ShowEnemyHealth(LastDamagedEnemy);
+			}
+		}
+	}
+}
+
+void UTDSDamageSubsystem::ApplyAggregatedDamage(const FTDSAggregatedDamage& Aggregated)
+{
+	AActor* Target = Aggregated.Target.Get();
+	if (!Target)
+	{
+		return;
+	}
+
+	// Our own characters take the summed damage directly, skipping the dynamic delegate dispatch
+	if (ATDSEnemyCharacter* Enemy = Cast<ATDSEnemyCharacter>(Target))
+	{
+		Enemy->ReceiveResolvedDamage(Aggregated.TotalAmount);
+		return;
+	}
+
+	if (ATDSCharacter* Player = Cast<ATDSCharacter>(Target))
+	{
+		Player->ReceiveResolvedDamage(Aggregated.TotalAmount);
+		return;
+	}
+
+	if (Aggregated.HitItem != INDEX_NONE)
+	{
+		if (UTDSHordeSubsystem* Horde = GetWorld()->GetSubsystem<UTDSHordeSubsystem>())
+		{
+			if (Horde->IsProxyHost(Target))
+			{
+				Horde->ReceiveResolvedDamage(Target, Aggregated.HitItem, Aggregated.TotalAmount);
+				return;
+			}
+		}
+	}
+
+	// Anything else still goes through the engine's damage path so Blueprint damage handlers keep working
+	UGameplayStatics::ApplyDamage(
+		Target,
+		Aggregated.TotalAmount,
+		Aggregated.InstigatedBy.Get(),
+		Aggregated.DamageCauser.Get(),
+		UDamageType::StaticClass()
+	);
+}
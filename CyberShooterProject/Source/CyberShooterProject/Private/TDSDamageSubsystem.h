@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSDamageSubsystem.generated.h"
+
+class AController;
+
+// A single hit waiting to be resolved
+struct FTDSDamageEvent
+{
+	TWeakObjectPtr<AActor> Target;
+	TWeakObjectPtr<AController> InstigatedBy;
+	TWeakObjectPtr<AActor> DamageCauser;
+	FVector HitLocation = FVector::ZeroVector;
+	float Amount = 0.f;
+
+	// Instance hit on an instanced target (a horde proxy), INDEX_NONE otherwise
+	int32 HitItem = INDEX_NONE;
+};
+
+// All the hits a single target took this frame, summed up
+struct FTDSAggregatedDamage
+{
+	TWeakObjectPtr<AActor> Target;
+	TWeakObjectPtr<AController> InstigatedBy;
+	TWeakObjectPtr<AActor> DamageCauser;
+	FVector HitLocation = FVector::ZeroVector;
+	float TotalAmount = 0.f;
+	int32 HitCount = 0;
+	int32 HitItem = INDEX_NONE;
+};
+
+// This subsystem batches damage. Projectile hits, melee hits and any future area damage queue their damage here during the frame,
+// and it is resolved in a single pass once every actor has ticked: hits on the same target are summed, the target takes the damage
+// once (so death fires once), and hurt feedback and the HUD are updated once per target per frame instead of once per hit.
+// It replaces the per-hit UGameplayStatics::ApplyDamage -> OnTakeAnyDamage dynamic delegate path for the game's own damage.
+UCLASS()
+class UTDSDamageSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only resolve damage in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Queues damage on Target, it is applied when the frame's damage is resolved. HitItem is the hit result's Item, it only
+	// matters for horde proxies, which share one actor and are told apart by instance.
+	void QueueDamage(AActor* Target, float Amount, AController* InstigatedBy, AActor* DamageCauser, const FVector& HitLocation, int32 HitItem = INDEX_NONE);
+
+	// Resolves all queued damage straight away
+	void ResolvePendingDamage();
+
+private:
+	// Resolves the frame's damage once all actors have ticked
+	void HandleWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+
+	// Applies one target's summed damage
+	void ApplyAggregatedDamage(const FTDSAggregatedDamage& Aggregated);
+
+	// Hits queued this frame
+	TArray<FTDSDamageEvent> PendingEvents;
+
+	// Scratch buffers reused every resolve
+	TArray<FTDSAggregatedDamage> AggregatedDamage;
+	TMap<TPair<AActor*, int32>, int32> TargetToAggregateIndex;
+
+	FDelegateHandle PostActorTickHandle;
+};
@@ -0,0 +1,286 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSDistanceBandSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSEnemyAIController.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Distance Band Pass"), STAT_TDSDistanceBandPass, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Distance Band Enemies"), STAT_TDSDistanceBandEnemies, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Distance Band Checks"), STAT_TDSDistanceBandChecks, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Distance Band Events"), STAT_TDSDistanceBandEvents, STATGROUP_CyberShooter);
+
+static TAutoConsoleVariable<bool> CVarTDSDistanceBands(
+	TEXT("tds.AI.DistanceBands"),
+	true,
+	TEXT("Drive enemy state changes from distance band events. 0 makes every enemy check its distance to the player on every AI update."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTDSDistanceBandClosingSpeed(
+	TEXT("tds.AI.DistanceBandClosingSpeed"),
+	1500.f,
+	TEXT("Fastest the player and an enemy can close on each other, in units per second. Enemies outside all their radii are not re-checked before they could have crossed the outer one."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTDSDistanceBandMaxInterval(
+	TEXT("tds.AI.DistanceBandMaxInterval"),
+	0.5f,
+	TEXT("Longest time in seconds an enemy outside all its radii goes between checks, however far away it is."),
+	ECVF_Default);
+
+bool UTDSDistanceBandSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSDistanceBandSubsystem::Deinitialize()
+{
+	Controllers.Empty();
+	for (TArray<float>& Radii : RadiiSq)
+	{
+		Radii.Empty();
+	}
+	OuterRadius.Empty();
+	Bands.Empty();
+	NextCheckTime.Empty();
+
+	SET_DWORD_STAT(STAT_TDSDistanceBandEnemies, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSDistanceBandSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSDistanceBandSubsystem, STATGROUP_Tickables);
+}
+
+bool UTDSDistanceBandSubsystem::IsEnabled()
+{
+	return CVarTDSDistanceBands.GetValueOnGameThread();
+}
+
+void UTDSDistanceBandSubsystem::RegisterController(ATDSEnemyAIController* Controller, TConstArrayView<float> Radii)
+{
+	if (!Controller || Controllers.Contains(Controller))
+	{
+		return;
+	}
+
+	ensureMsgf(Radii.Num() <= MaxRadii, TEXT("Distance bands support at most %d radii, the rest are ignored"), MaxRadii);
+
+	Controllers.Add(Controller);
+
+	float Outer = 0.f;
+	for (int32 RadiusIndex = 0; RadiusIndex < MaxRadii; ++RadiusIndex)
+	{
+		// Unused radii are never crossed, so they never add to the band
+		const bool bUsed = Radii.IsValidIndex(RadiusIndex);
+		RadiiSq[RadiusIndex].Add(bUsed ? FMath::Square(Radii[RadiusIndex]) : MAX_flt);
+		Outer = bUsed ? FMath::Max(Outer, Radii[RadiusIndex]) : Outer;
+	}
+
+	OuterRadius.Add(Outer);
+	Bands.Add(UnknownBand);
+	NextCheckTime.Add(0.0);
+}
+
+void UTDSDistanceBandSubsystem::UnregisterController(ATDSEnemyAIController* Controller)
+{
+	const int32 Index = Controllers.IndexOfByKey(Controller);
+	if (Index != INDEX_NONE)
+	{
+		RemoveAtSwap(Index);
+	}
+}
+
+uint8 UTDSDistanceBandSubsystem::GetBand(const ATDSEnemyAIController* Controller) const
+{
+	const int32 Index = Controllers.IndexOfByKey(Controller);
+	return Index != INDEX_NONE ? Bands[Index] : UnknownBand;
+}
+
+void UTDSDistanceBandSubsystem::ResetBand(const ATDSEnemyAIController* Controller)
+{
+	const int32 Index = Controllers.IndexOfByKey(Controller);
+	if (Index != INDEX_NONE)
+	{
+		Bands[Index] = UnknownBand;
+		NextCheckTime[Index] = 0.0;
+	}
+}
+
+void UTDSDistanceBandSubsystem::RemoveAtSwap(int32 Index)
+{
+	Controllers.RemoveAtSwap(Index, EAllowShrinking::No);
+	for (TArray<float>& Radii : RadiiSq)
+	{
+		Radii.RemoveAtSwap(Index, EAllowShrinking::No);
+	}
+	OuterRadius.RemoveAtSwap(Index, EAllowShrinking::No);
+	Bands.RemoveAtSwap(Index, EAllowShrinking::No);
+	NextCheckTime.RemoveAtSwap(Index, EAllowShrinking::No);
+}
+
+void UTDSDistanceBandSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SET_DWORD_STAT(STAT_TDSDistanceBandEnemies, Controllers.Num());
+
+	const bool bEnabled = IsEnabled();
+	if (!bEnabled)
+	{
+		bWasEnabled = false;
+		return;
+	}
+
+	// Enemies went back to their own distance checks for a while, so every band has to be reported again
+	if (!bWasEnabled)
+	{
+		bWasEnabled = true;
+		for (int32 Index = 0; Index < Controllers.Num(); ++Index)
+		{
+			Bands[Index] = UnknownBand;
+			NextCheckTime[Index] = 0.0;
+		}
+	}
+
+	const APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+	if (!PlayerPawn || Controllers.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TDSDistanceBandPass);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const FVector PlayerLocation = PlayerPawn->GetActorLocation();
+
+	// Drop enemies destroyed without unregistering first, so the indices gathered below stay put
+	for (int32 Index = Controllers.Num() - 1; Index >= 0; --Index)
+	{
+		const ATDSEnemyAIController* Controller = Controllers[Index].Get();
+		if (!Controller || !Controller->GetPawn())
+		{
+			RemoveAtSwap(Index);
+		}
+	}
+
+	// Gather the enemies due a check into flat arrays
+	CheckedIndices.Reset();
+	CheckedX.Reset();
+	CheckedY.Reset();
+	for (TArray<float>& Radii : CheckedRadiiSq)
+	{
+		Radii.Reset();
+	}
+
+	for (int32 Index = 0; Index < Controllers.Num(); ++Index)
+	{
+		if (NextCheckTime[Index] > Now)
+		{
+			continue;
+		}
+
+		const FVector Location = Controllers[Index]->GetPawn()->GetActorLocation();
+		CheckedIndices.Add(Index);
+		CheckedX.Add(static_cast<float>(Location.X));
+		CheckedY.Add(static_cast<float>(Location.Y));
+		for (int32 RadiusIndex = 0; RadiusIndex < MaxRadii; ++RadiusIndex)
+		{
+			CheckedRadiiSq[RadiusIndex].Add(RadiiSq[RadiusIndex][Index]);
+		}
+	}
+
+	const int32 NumChecked = CheckedIndices.Num();
+	INC_DWORD_STAT_BY(STAT_TDSDistanceBandChecks, NumChecked);
+
+	ComputeBands(NumChecked, FVector2f(PlayerLocation.X, PlayerLocation.Y));
+
+	const float ClosingSpeed = FMath::Max(CVarTDSDistanceBandClosingSpeed.GetValueOnGameThread(), 1.f);
+	const float MaxInterval = FMath::Max(CVarTDSDistanceBandMaxInterval.GetValueOnGameThread(), 0.f);
+
+	Changes.Reset();
+	for (int32 Checked = 0; Checked < NumChecked; ++Checked)
+	{
+		const int32 Index = CheckedIndices[Checked];
+		const uint8 NewBand = CheckedBands[Checked];
+
+		// Outside every radius, nothing can happen before the player could have covered the gap
+		const float DistSq = CheckedDistSq[Checked];
+		if (DistSq > FMath::Square(OuterRadius[Index]))
+		{
+			const float Slack = FMath::Sqrt(DistSq) - OuterRadius[Index];
+			NextCheckTime[Index] = Now + FMath::Min(Slack / ClosingSpeed, MaxInterval);
+		}
+		else
+		{
+			NextCheckTime[Index] = 0.0;
+		}
+
+		if (NewBand != Bands[Index])
+		{
+			Bands[Index] = NewBand;
+			Changes.Emplace(Controllers[Index], NewBand);
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_TDSDistanceBandEvents, Changes.Num());
+
+	// Callbacks change state, which may unregister or register enemies, so they run after the pass
+	for (const TPair<TWeakObjectPtr<ATDSEnemyAIController>, uint8>& Change : Changes)
+	{
+		if (ATDSEnemyAIController* Controller = Change.Key.Get())
+		{
+			Controller->OnDistanceBandChanged(Change.Value);
+		}
+	}
+}
+
+void UTDSDistanceBandSubsystem::ComputeBands(int32 NumChecked, const FVector2f& PlayerLocation)
+{
+	CheckedDistSq.SetNumUninitialized(NumChecked);
+	CheckedBands.SetNumUninitialized(NumChecked);
+
+	static_assert(MaxRadii == 2, "ComputeBands tests exactly two radii per enemy");
+
+	const float* X = CheckedX.GetData();
+	const float* Y = CheckedY.GetData();
+	const float* InnerSq = CheckedRadiiSq[0].GetData();
+	const float* OuterSq = CheckedRadiiSq[1].GetData();
+	float* DistSq = CheckedDistSq.GetData();
+	uint8* OutBands = CheckedBands.GetData();
+
+	// Four enemies at a time: squared distance to the player, then one compare per radius, the band being how many radii it is outside of
+	const VectorRegister4Float PlayerX = VectorSetFloat1(PlayerLocation.X);
+	const VectorRegister4Float PlayerY = VectorSetFloat1(PlayerLocation.Y);
+
+	int32 Index = 0;
+	for (; Index + 4 <= NumChecked; Index += 4)
+	{
+		const VectorRegister4Float DeltaX = VectorSubtract(VectorLoad(X + Index), PlayerX);
+		const VectorRegister4Float DeltaY = VectorSubtract(VectorLoad(Y + Index), PlayerY);
+		const VectorRegister4Float LaneDistSq = VectorMultiplyAdd(DeltaX, DeltaX, VectorMultiply(DeltaY, DeltaY));
+		VectorStore(LaneDistSq, DistSq + Index);
+
+		const int32 OutsideInner = VectorMaskBits(VectorCompareGT(LaneDistSq, VectorLoad(InnerSq + Index)));
+		const int32 OutsideOuter = VectorMaskBits(VectorCompareGT(LaneDistSq, VectorLoad(OuterSq + Index)));
+
+		for (int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			OutBands[Index + Lane] = static_cast<uint8>(((OutsideInner >> Lane) & 1) + ((OutsideOuter >> Lane) & 1));
+		}
+	}
+
+	// Leftovers one at a time, same math
+	for (; Index < NumChecked; ++Index)
+	{
+		const float DeltaX = X[Index] - PlayerLocation.X;
+		const float DeltaY = Y[Index] - PlayerLocation.Y;
+		DistSq[Index] = DeltaX * DeltaX + DeltaY * DeltaY;
+		OutBands[Index] = static_cast<uint8>((DistSq[Index] > InnerSq[Index] ? 1 : 0) + (DistSq[Index] > OuterSq[Index] ? 1 : 0));
+	}
+}
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSDistanceBandSubsystem.generated.h"
+
+class ATDSEnemyAIController;
+
+// This subsystem tells enemies when the player crosses one of the distance rings they care about, so their state machine
+// reacts to events instead of every enemy measuring its distance to the player every update.
+// Each enemy registers up to MaxRadii radii, innermost first, and is in band N when it is outside exactly N of them.
+// Once per frame the subsystem gathers the enemies' positions into flat arrays and works out every band four enemies at a
+// time with SIMD, then calls ATDSEnemyAIController::OnDistanceBandChanged for the enemies whose band changed.
+// Enemies outside all their radii are only re-checked once the player could have closed the gap to the outer radius at
+// tds.AI.DistanceBandClosingSpeed, so a far away crowd is gathered a few times a second instead of every frame.
+UCLASS()
+class UTDSDistanceBandSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Most radii one enemy can register
+	static constexpr int32 MaxRadii = 2;
+
+	// Band of an enemy that has not been checked yet
+	static constexpr uint8 UnknownBand = 0xFF;
+
+	// Only track enemies in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Whether enemies' state changes come from band events (tds.AI.DistanceBands) rather than their own distance checks
+	static bool IsEnabled();
+
+	// Starts tracking a controller's pawn against the player. Radii are innermost first. Its first band is reported on the next pass.
+	void RegisterController(ATDSEnemyAIController* Controller, TConstArrayView<float> Radii);
+
+	// Stops tracking a controller
+	void UnregisterController(ATDSEnemyAIController* Controller);
+
+	// Last band reported to a controller, UnknownBand if it is not tracked or not checked yet
+	uint8 GetBand(const ATDSEnemyAIController* Controller) const;
+
+	// Forgets the band reported to a controller, so the next pass reports its current band again even if it has not
+	// changed. For controllers that left the state their band put them in.
+	void ResetBand(const ATDSEnemyAIController* Controller);
+
+private:
+	// Works out the band of every enemy gathered this frame
+	void ComputeBands(int32 NumChecked, const FVector2f& PlayerLocation);
+
+	// Removes the entry at Index from every array
+	void RemoveAtSwap(int32 Index);
+
+	// Tracked controllers, and per controller, at matching indices:
+	// the squared radii (MAX_flt for unused ones), the current band and when it is next due a check
+	TArray<TWeakObjectPtr<ATDSEnemyAIController>> Controllers;
+	TArray<float> RadiiSq[MaxRadii];
+	TArray<float> OuterRadius;
+	TArray<uint8> Bands;
+	TArray<double> NextCheckTime;
+
+	// Scratch arrays for one pass, holding only the enemies due a check: their entry index, position and new band
+	TArray<int32> CheckedIndices;
+	TArray<float> CheckedX;
+	TArray<float> CheckedY;
+	TArray<float> CheckedRadiiSq[MaxRadii];
+	TArray<float> CheckedDistSq;
+	TArray<uint8> CheckedBands;
+
+	// Band changes found this pass, dispatched once the pass is done because callbacks may register and unregister
+	TArray<TPair<TWeakObjectPtr<ATDSEnemyAIController>, uint8>> Changes;
+
+	// Whether band events were on last frame, so turning them back on re-reports every band
+	bool bWasEnabled = false;
+};
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSEffectSubsystem.h"
+#include "CyberShooterProject.h"
+#include "NiagaraComponent.h"
+#include "NiagaraFunctionLibrary.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect Components Created"), STAT_TDSEffectComponentsCreated, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Effect Components Created Per Minute"), STAT_TDSEffectComponentsPerMinute, STATGROUP_CyberShooter);
+
+static TAutoConsoleVariable<int32> CVarTDSPerShotEffectSpawns(
+	TEXT("tds.FX.PerShotSpawns"),
+	0,
+	TEXT("How muzzle flashes and impact effects get their Niagara components, for comparing allocation rates.\n")
+	TEXT("0: reuse the character's muzzle flash component and pooled impact components (default)\n")
+	TEXT("1: spawn a new component for every muzzle flash and impact, like before pooling"),
+	ECVF_Default);
+
+namespace
+{
+	// Window the per-minute stat counts over, in seconds
+	constexpr double CreationWindowSeconds = 60.0;
+
+	// How often components that no longer exist are forgotten, in seconds
+	constexpr double PruneIntervalSeconds = 10.0;
+}
+
+bool UTDSEffectSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSEffectSubsystem::Deinitialize()
+{
+	KnownComponents.Empty();
+	CreationTimes.Empty();
+
+	SET_DWORD_STAT(STAT_TDSEffectComponentsPerMinute, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSEffectSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSEffectSubsystem, STATGROUP_Tickables);
+}
+
+bool UTDSEffectSubsystem::UsePerShotSpawns()
+{
+	return CVarTDSPerShotEffectSpawns.GetValueOnGameThread() != 0;
+}
+
+UNiagaraComponent* UTDSEffectSubsystem::SpawnEffect(UNiagaraSystem* Effect, const FVector& Location, const FRotator& Rotation)
+{
+	if (!Effect)
+	{
+		return nullptr;
+	}
+
+	// AutoRelease hands the component back to the world's pool once the effect finishes, so steady firing stops allocating
+	UNiagaraComponent* Component = UNiagaraFunctionLibrary::SpawnSystemAtLocation(
+		this,
+		Effect,
+		Location,
+		Rotation,
+		FVector::OneVector,
+		true,
+		true,
+		UsePerShotSpawns() ? ENCPoolMethod::None : ENCPoolMethod::AutoRelease
+	);
+
+	RecordComponent(Component);
+
+	return Component;
+}
+
+void UTDSEffectSubsystem::RecordComponent(const UNiagaraComponent* Component)
+{
+	if (!Component)
+	{
+		return;
+	}
+
+	bool bAlreadyKnown = false;
+	KnownComponents.Add(FObjectKey(Component), &bAlreadyKnown);
+	if (bAlreadyKnown)
+	{
+		return;
+	}
+
+	NumCreated++;
+	CreationTimes.Add(GetWorld()->GetTimeSeconds());
+	INC_DWORD_STAT(STAT_TDSEffectComponentsCreated);
+}
+
+void UTDSEffectSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// Creation times are added in order, so everything older than the window is at the front
+	const double WindowStart = Now - CreationWindowSeconds;
+	int32 NumExpired = 0;
+	while (NumExpired < CreationTimes.Num() && CreationTimes[NumExpired] < WindowStart)
+	{
+		NumExpired++;
+	}
+	if (NumExpired > 0)
+	{
+		CreationTimes.RemoveAt(0, NumExpired, EAllowShrinking::No);
+	}
+
+	SET_DWORD_STAT(STAT_TDSEffectComponentsPerMinute, CreationTimes.Num());
+
+	if (Now >= NextPruneTime)
+	{
+		NextPruneTime = Now + PruneIntervalSeconds;
+
+		for (auto It = KnownComponents.CreateIterator(); It; ++It)
+		{
+			if (!It->ResolveObjectPtr())
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+}
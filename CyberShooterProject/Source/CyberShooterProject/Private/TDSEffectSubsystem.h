@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "TDSEffectSubsystem.generated.h"
+
+class UNiagaraComponent;
+class UNiagaraSystem;
+
+// This subsystem spawns the weapons' one-shot Niagara effects and counts the components they cost. By default effects are
+// played on components from the world's Niagara pool. With tds.FX.PerShotSpawns enabled every effect gets a new component
+// again, so both can be measured on the same map. Every component an effect plays on is reported here, components seen
+// before are reuses, and new ones over the last minute are published to "stat CyberShooter".
+UCLASS()
+class UTDSEffectSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only track effects in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Whether effects should spawn a new component each time instead of reusing one (tds.FX.PerShotSpawns)
+	static bool UsePerShotSpawns();
+
+	// Plays a one-shot effect at Location, on a pooled component unless per-shot spawns are enabled
+	UNiagaraComponent* SpawnEffect(UNiagaraSystem* Effect, const FVector& Location, const FRotator& Rotation);
+
+	// Reports a component an effect is played on, it is counted as created the first time it is seen
+	void RecordComponent(const UNiagaraComponent* Component);
+
+	// Components created since the world started, and in the last minute
+	int32 GetNumCreated() const { return NumCreated; }
+	int32 GetNumCreatedLastMinute() const { return CreationTimes.Num(); }
+
+private:
+	// Components already counted. Entries are dropped once their component is destroyed, so the set stays as big as
+	// the Niagara pool (or the effects still playing) rather than growing with every shot.
+	TSet<FObjectKey> KnownComponents;
+
+	// World time of every component created in the last minute, oldest first
+	TArray<double> CreationTimes;
+
+	// When KnownComponents is next checked for destroyed components
+	double NextPruneTime = 0.0;
+
+	int32 NumCreated = 0;
+};
@@ -2,16 +2,32 @@
 
 
 #include "TDSEnemyAIController.h"
-#include "Kismet/KismetSystemLibrary.h"
 #include "Kismet/GameplayStatics.h"
 #include "NavigationSystem.h"
-#include "TimerManager.h"
 #include "Animation/AnimInstance.h"
 #include "TDSEnemyCharacter.h"
+#include "TDSEnemyArchetype.h"
+#include "TDSCombatSlotSubsystem.h"
+#include "TDSAILODSubsystem.h"
+#include "TDSPathRequestSubsystem.h"
+#include "TDSFlowFieldSubsystem.h"
+#include "TDSEnemyManager.h"
+#include "TDSEnemyDecision.h"
+#include "TDSAttackTokenComponent.h"
+#include "TDSNavigationCacheSubsystem.h"
+#include "TDSDistanceBandSubsystem.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/DamageType.h"
 #include "GameFramework/Character.h"
+#include "HAL/IConsoleManager.h"
 
+static TAutoConsoleVariable<int32> CVarTDSForceFlowField(
+	TEXT("tds.AI.ForceFlowField"),
+	0,
+	TEXT("Forces every enemy to chase along the shared flow field, for performance comparisons.\n")
+	TEXT("0: use each enemy's archetype ChaseMovementMode (default)\n")
+	TEXT("1: flow field for all enemies"),
+	ECVF_Default);
 
 void ATDSEnemyAIController::OnPossess(APawn* InPawn)
 {
@@ -21,17 +37,76 @@ void ATDSEnemyAIController::OnPossess(APawn* InPawn)
 	// Get reference to the player pawn
 	PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
 
-	// Randomize initial slot angle for this AI to ensure they start in different positions around the player
-	SlotAngleRad = FMath::FRandRange(0.f, 2 * PI);
-	bSlotAngleInit = true;
+	// Everything below reads our pawn's archetype tuning
+	const ATDSEnemyCharacter* EnemyCharacter = Cast<ATDSEnemyCharacter>(InPawn);
+	Tuning = EnemyCharacter ? &EnemyCharacter->GetTuning() : &UTDSEnemyArchetype::GetDefaultTuning();
 
 	SetState(EEnemyState::Idle); // Start in idle state
 
-	SlotJitterOffset = FVector2D(
-		FMath::FRandRange(-slotJitter, slotJitter),
-		FMath::FRandRange(-slotJitter, slotJitter)
+	Runtime.SlotJitterOffset = FVector2f(
+		FMath::FRandRange(-GetTuning().SlotJitter, GetTuning().SlotJitter),
+		FMath::FRandRange(-GetTuning().SlotJitter, GetTuning().SlotJitter)
 	);
 
+	// Let the enemy manager run our AI alongside every other enemy's, instead of ticking ourselves
+	if (UTDSEnemyManager* EnemyManager = GetWorld()->GetSubsystem<UTDSEnemyManager>())
+	{
+		Runtime.bBatchedTick = EnemyManager->RegisterController(this);
+	}
+
+	// Let the LOD subsystem pick how often we think
+	if (UTDSAILODSubsystem* LODSubsystem = GetWorld()->GetSubsystem<UTDSAILODSubsystem>())
+	{
+		LODSubsystem->RegisterController(this);
+	}
+
+	// Have the player crossing our attack range and chase distance reported to us, instead of measuring it every update
+	if (UTDSDistanceBandSubsystem* DistanceBands = GetWorld()->GetSubsystem<UTDSDistanceBandSubsystem>())
+	{
+		const float Radii[] = { GetTuning().AttackRange, GetTuning().ChaseDistance };
+		DistanceBands->RegisterController(this, Radii);
+	}
+}
+
+void ATDSEnemyAIController::OnUnPossess()
+{
+	// Give our slot back, the pawn is gone
+	UnregisterFromCombatSlot();
+	StopFollowingFlowField();
+
+	// Nothing left for our timers to act on
+	ClearAITimer(WanderTimer);
+	ClearAITimer(AttackTimer);
+	ReleaseAttackToken();
+
+	if (UTDSAILODSubsystem* LODSubsystem = GetWorld()->GetSubsystem<UTDSAILODSubsystem>())
+	{
+		LODSubsystem->UnregisterController(this);
+	}
+
+	if (UTDSDistanceBandSubsystem* DistanceBands = GetWorld()->GetSubsystem<UTDSDistanceBandSubsystem>())
+	{
+		DistanceBands->UnregisterController(this);
+	}
+
+	if (UTDSPathRequestSubsystem* PathSubsystem = GetWorld()->GetSubsystem<UTDSPathRequestSubsystem>())
+	{
+		PathSubsystem->UnregisterController(this);
+	}
+
+	if (Runtime.bBatchedTick)
+	{
+		if (UTDSEnemyManager* EnemyManager = GetWorld()->GetSubsystem<UTDSEnemyManager>())
+		{
+			EnemyManager->UnregisterController(this);
+		}
+		Runtime.bBatchedTick = false;
+	}
+
+	// The archetype goes with the pawn
+	Tuning = nullptr;
+
+	Super::OnUnPossess();
 }
 
 void ATDSEnemyAIController::Tick(float DeltaSeconds)
@@ -39,16 +114,59 @@ void ATDSEnemyAIController::Tick(float DeltaSeconds)
 	// Call the base class Tick
 	Super::Tick(DeltaSeconds);
 
+	TickAI(DeltaSeconds);
+}
+
+bool ATDSEnemyAIController::GatherBatchedDecision(float DeltaSeconds, FTDSEnemyDecisionInput& OutInput)
+{
+	// The part of AAIController::Tick we still need without an actor tick: turning towards the focus
+	UpdateControlRotation(DeltaSeconds);
+
+	return GatherDecisionInput(DeltaSeconds, OutInput);
+}
+
+void ATDSEnemyAIController::SetAITickInterval(float TickInterval)
+{
+	if (Runtime.bBatchedTick)
+	{
+		if (UTDSEnemyManager* EnemyManager = GetWorld()->GetSubsystem<UTDSEnemyManager>())
+		{
+			EnemyManager->SetTickInterval(this, TickInterval);
+			return;
+		}
+	}
+
+	SetActorTickInterval(TickInterval);
+}
+
+void ATDSEnemyAIController::TickAI(float DeltaSeconds)
+{
+	FTDSEnemyDecisionInput Input;
+	if (!GatherDecisionInput(DeltaSeconds, Input)) return;
+
+	// Same three stages the enemy manager runs for every batched enemy, just for us alone
+	FTDSEnemyDecisionOutput Output;
+	FTDSEnemyDecision::Compute(Input, Output);
+
+	ApplyDecision(Input, Output);
+}
+
+bool ATDSEnemyAIController::GatherDecisionInput(float DeltaSeconds, FTDSEnemyDecisionInput& OutInput)
+{
 	// If we don't have a pawn, do nothing
-	if (!GetPawn()) return; 
+	APawn* ControlledPawn = GetPawn();
+	if (!ControlledPawn) return false;
 
 	// If the pawn is dead, stop all movement and do nothing else
-	if (ATDSEnemyCharacter* EnemyCharacter = Cast<ATDSEnemyCharacter>(GetPawn()))
+	if (ATDSEnemyCharacter* EnemyCharacter = Cast<ATDSEnemyCharacter>(ControlledPawn))
 	{
 		if (EnemyCharacter->IsDead())
 		{
+			StopFollowingFlowField();
+			CancelPathRequests();
 			StopMovement();
-			return;
+			ClearAITimer(WanderTimer);
+			return false;
 		}
 	}
 
@@ -58,70 +176,57 @@ void ATDSEnemyAIController::Tick(float DeltaSeconds)
 		PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0); 
 	}
 
-	// Check if we need to change states based on distance to player
-	UpdateStateTransitions(); 
-	
-	// Execute behavior based on current state
-	RunState(DeltaSeconds);
-
-	// Check if we're stuck and try to unstick if necessary
-	HandleStuck(DeltaSeconds); 
+	OutInput.DeltaSeconds = DeltaSeconds;
+	OutInput.PawnLocation = ControlledPawn->GetActorLocation();
+	OutInput.PawnRotation = ControlledPawn->GetActorRotation();
+	OutInput.bHasPlayer = PlayerPawn != nullptr;
+	OutInput.PlayerLocation = PlayerPawn ? PlayerPawn->GetActorLocation() : FVector::ZeroVector;
+	OutInput.State = Runtime.State;
+	OutInput.bIsAttacking = Runtime.bIsAttacking;
+	OutInput.bStateFromDistanceBands = Runtime.bBandsDriveState && UTDSDistanceBandSubsystem::IsEnabled();
+	OutInput.WanderTarget = FVector(Runtime.WanderTarget);
+	OutInput.bHasWanderTarget = Runtime.bHasWanderTarget;
+	OutInput.CurrentSlotTarget = FVector(Runtime.CurrentSlotTarget);
+	OutInput.SmoothedSlotTarget = FVector(Runtime.SmoothedSlotTarget);
+	OutInput.LastLocation = FVector(Runtime.LastLocation);
+	OutInput.StuckTime = Runtime.StuckTime;
+
+	const FTDSEnemyTuning& EnemyTuning = GetTuning();
+	OutInput.ChaseDistance = EnemyTuning.ChaseDistance;
+	OutInput.AttackRange = EnemyTuning.AttackRange;
+	OutInput.ChaseTurnSpeed = EnemyTuning.ChaseTurnSpeed;
+	OutInput.SlotSmoothingSpeed = EnemyTuning.SlotSmoothingSpeed;
+	OutInput.StuckSpeedThreshold = EnemyTuning.StuckSpeedThreshold;
+	OutInput.StuckTimeToTrigger = EnemyTuning.StuckTimeToTrigger;
+	return true;
 }
 
-void ATDSEnemyAIController::UpdateStateTransitions()
+void ATDSEnemyAIController::ApplyDecision(const FTDSEnemyDecisionInput& Input, const FTDSEnemyDecisionOutput& Output)
 {
-	// Ensure we have valid references
-	if (!PlayerPawn || !GetPawn()) return;
-
-	// Calculate distance to player
-	const float Dist = FVector::Dist2D(PlayerPawn->GetActorLocation(), GetPawn()->GetActorLocation());
+	if (!GetPawn()) return;
 
-	switch (State) 
+	if (!Output.bStateChanged)
 	{
-		// In Idle state, if the player comes within chase distance, switch to Chasing
-		case EEnemyState::Idle:
-		{
-			if (Dist <= ChaseDistance)
-			{
-				SetState(EEnemyState::Chasing);
-			}
-			break;
-		}
-		// In Chasing state, if we get within attack range, switch to Attacking. If the player gets too far away, switch back to Idle
-		case EEnemyState::Chasing:
-		{
-			if (Dist <= AttackRange)
-			{
-				SetState(EEnemyState::Attacking);
-			}
-			else if (Dist > ChaseDistance)
-			{
-				SetState(EEnemyState::Idle);
-			}
-			break;
-		}
-
-		// In Attacking state, if the player moves out of attack range but is still within chase distance, switch back to Chasing. If the player moves out of chase distance, switch back to Idle
-		case EEnemyState::Attacking:
-		{
-			if (Dist > ChaseDistance)
-			{
-				SetState(EEnemyState::Idle);
-			}
-			else if (Dist > AttackRange)
-			{
-				SetState(EEnemyState::Chasing);
-			}
-			break;
-		
-		}
+		ApplyBehaviour(Input, Output);
+		return;
 	}
+
+	SetState(Output.NewState);
+
+	// Entering a state moves slot and wander targets and starts or stops attacking, so decide the new state's
+	// behaviour from what SetState left behind. Only enemies that changed state pay for this second pass.
+	FTDSEnemyDecisionInput NewInput;
+	if (!GatherDecisionInput(Input.DeltaSeconds, NewInput)) return;
+
+	FTDSEnemyDecisionOutput NewOutput;
+	FTDSEnemyDecision::ComputeBehaviour(NewInput, NewOutput);
+	ApplyBehaviour(NewInput, NewOutput);
 }
 
 void ATDSEnemyAIController::SetState(EEnemyState NewState)
 {
 	// If we're already in the desired state, do nothing
-	if (State == NewState) return; 
+	if (Runtime.State == NewState) return; 
 
 	// Guard against trying to change state if we don't have a pawn or if the pawn is dead
 	if (ATDSEnemyCharacter* EnemyCharacter = Cast<ATDSEnemyCharacter>(GetPawn()))
@@ -132,7 +237,7 @@ void ATDSEnemyAIController::SetState(EEnemyState NewState)
 		}
 	}
 
-	switch (State)
+	switch (Runtime.State)
 	{
 		case EEnemyState::Attacking:
 		{
@@ -145,10 +250,14 @@ void ATDSEnemyAIController::SetState(EEnemyState NewState)
 		}
 	}
 
+	// Paths asked for in the old state no longer apply
+	CancelPathRequests();
+	StopFollowingFlowField();
+
 	// Update to the new state
-	State = NewState;
+	Runtime.State = NewState;
 
-	switch (State)
+	switch (Runtime.State)
 	{
 		case EEnemyState::Idle:
 		{
@@ -158,8 +267,8 @@ void ATDSEnemyAIController::SetState(EEnemyState NewState)
 			// Stop any movement when entering idle
 			StopMovement();
 
-			// Clear any existing slot timers
-			GetWorldTimerManager().ClearTimer(SlotTimerHandle);
+			// Give our combat slot back
+			UnregisterFromCombatSlot();
 
 			PickNewWanderTarget(); // immediate first target
 			break;
@@ -170,21 +279,12 @@ void ATDSEnemyAIController::SetState(EEnemyState NewState)
 			// Ensure we're not attacking when we start chasing
 			StopAttacking();
 			// Clear wander target so we can start chasing immediately
-			bHasWanderTarget = false;
+			Runtime.bHasWanderTarget = false;
 			// Clear any existing wander timers
-			GetWorldTimerManager().ClearTimer(WanderTimerHandle);
-
-			// Update the target slot around the player immediately when we start chasing
-			UpdateSlotTarget();
-
-			// Set timer to update the target slot around the player at regular intervals while chasing
-			GetWorldTimerManager().SetTimer(
-				SlotTimerHandle,
-				this,
-				&ATDSEnemyAIController::UpdateSlotTarget,
-				slotRecalcInterval,
-				true
-			);
+			ClearAITimer(WanderTimer);
+
+			// Ask for a combat slot around the player, the slot subsystem keeps it updated while we chase and attack
+			RegisterForCombatSlot();
 			break;
 		}
 		case EEnemyState::Attacking:
@@ -196,61 +296,71 @@ void ATDSEnemyAIController::SetState(EEnemyState NewState)
 		}
 	}
 
+	// Re-bucket straight away so an enemy that starts attacking is not left thinking at the idle rate
+	if (UTDSAILODSubsystem* LODSubsystem = GetWorld()->GetSubsystem<UTDSAILODSubsystem>())
+	{
+		LODSubsystem->RequestUpdate(this);
+	}
 }
 
-void ATDSEnemyAIController::RunState(float DeltaSeconds)
+void ATDSEnemyAIController::ApplyBehaviour(const FTDSEnemyDecisionInput& Input, const FTDSEnemyDecisionOutput& Output)
 {
-	// Ensure we have a valid pawn reference
-	if (!GetPawn()) return;
+	// Face the player while chasing and attacking
+	if (Output.bRotate)
+	{
+		GetPawn()->SetActorRotation(Output.NewRotation);
+	}
 
-	switch (State)
+	switch (Runtime.State)
 	{
 		case EEnemyState::Idle:
 		{
 			// If we don't have a wander target, the timer will handle it.
-			if (!bHasWanderTarget) return;
+			if (!Runtime.bHasWanderTarget) break;
 
-			const float DistToTarget = FVector::Dist2D(WanderTarget, GetPawn()->GetActorLocation());
-			if (DistToTarget <= 120.f)
+			if (Output.WanderDist <= 120.f)
 			{
-				bHasWanderTarget = false; // Clear the target so we pick a new one after a delay
+				Runtime.bHasWanderTarget = false; // Clear the target so we pick a new one after a delay
+				CancelPathRequests();
 				StopMovement(); // Stop movement when we reach the wander target
 				StartWanderAfterDelay(); // Start a new wander after a short delay to create more natural idle behavior
-				return;
+				break;
 			}
 
 			// Update timer for the last move
-			TimeSinceLastWanderMove += DeltaSeconds;
-			if (TimeSinceLastWanderMove >= WanderRepathCooldown)
+			Runtime.TimeSinceLastWanderMove += Input.DeltaSeconds;
+			if (Runtime.TimeSinceLastWanderMove >= GetTuning().WanderRepathCooldown)
 			{
 				// If we've been moving towards the wander target for a while, pick a new one to prevent getting stuck trying to reach an unreachable point
-				MoveToLocation(WanderTarget, 80.f, true);
-				TimeSinceLastWanderMove = 0.f;
+				RequestMoveTo(FVector(Runtime.WanderTarget), 80.f, true);
+				Runtime.TimeSinceLastWanderMove = 0.f;
 			}
 			break;
 		}
 
 		case EEnemyState::Chasing:
 		{
-			// Face player while chasing (your smooth rotation)
-			RotatePawnTowardPlayer(DeltaSeconds);
+			Runtime.SmoothedSlotTarget = FVector3f(Output.SmoothedSlotTarget);
 
-			// Smooth slot targetting to help with rotation and make movement look more natural instead of robotic snapping to the slot position
-			SmoothedSlotTarget = FMath::VInterpTo(SmoothedSlotTarget, CurrentSlotTarget, DeltaSeconds, SlotSmoothingSpeed);
-			const float SlotDist = FVector::Dist2D(SmoothedSlotTarget, GetPawn()->GetActorLocation());
+			// Far from the slot, let the shared flow field steer us instead of pathfinding
+			if (UpdateFlowFieldFollowing(Output.SlotDist))
+			{
+				break;
+			}
 
 			// Only move towards the slot if we're not close enough to it, and use a cooldown to prevent excessive pathfinding calls which can cause performance issues
-			if (SlotDist > StopDistance)
+			if (Output.SlotDist > GetTuning().StopDistance)
 			{
-				TimeSinceLastMove += DeltaSeconds;
-				if (TimeSinceLastMove >= RepathCooldown)
+				Runtime.TimeSinceLastMove += Input.DeltaSeconds;
+				if (Runtime.TimeSinceLastMove >= GetTuning().RepathCooldown)
 				{
-					MoveToLocation(SmoothedSlotTarget, StopDistance, true);
-					TimeSinceLastMove = 0.f;
+					RequestMoveTo(FVector(Runtime.SmoothedSlotTarget), GetTuning().StopDistance, false);
+					Runtime.TimeSinceLastMove = 0.f;
 				}
 			}
 			else
 			{
+				CancelPathRequests();
 				StopMovement(); // Stop movement if we're close enough to the slot to prevent jittery movement
 			}
 			break;
@@ -258,28 +368,184 @@ void ATDSEnemyAIController::RunState(float DeltaSeconds)
 
 		case EEnemyState::Attacking:
 		{
-			// Attacking is handles by the timer so just keep facing the player to ensure we look in the right direction while attacking
-			RotatePawnTowardPlayer(DeltaSeconds);
 			// Ensure we stay still while attacking, in case we got here from chasing and were still moving. We want to be stationary while attacking.
 			StopMovement();
 			break;
 		}
 	}
+
+	// Stuck detection, sidestep if we have not moved for a while
+	Runtime.StuckTime = Output.StuckTime;
+	Runtime.LastLocation = FVector3f(Output.LastLocation);
+	if (Output.bUnstick)
+	{
+		Unstick();
+	}
+}
+
+void ATDSEnemyAIController::RequestMoveTo(const FVector& Goal, float AcceptanceRadius, bool bWandering)
+{
+	UTDSPathRequestSubsystem* PathSubsystem = GetWorld()->GetSubsystem<UTDSPathRequestSubsystem>();
+	if (!PathSubsystem)
+	{
+		MoveToLocation(Goal, AcceptanceRadius, true);
+		return;
+	}
+
+	// Chasers about to reach attack range get their paths first, then the rest of the chasers, then wanderers
+	ETDSPathPriority Priority = ETDSPathPriority::Wandering;
+	if (!bWandering)
+	{
+		const bool bClosingIn = PlayerPawn && FVector::Dist2D(PlayerPawn->GetActorLocation(), GetPawn()->GetActorLocation()) <= GetTuning().AttackRange * 2.f;
+		Priority = bClosingIn ? ETDSPathPriority::Attacking : ETDSPathPriority::Chasing;
+	}
+
+	PathSubsystem->RequestPath(this, Goal, AcceptanceRadius, Priority);
+}
+
+void ATDSEnemyAIController::CancelPathRequests()
+{
+	if (UTDSPathRequestSubsystem* PathSubsystem = GetWorld()->GetSubsystem<UTDSPathRequestSubsystem>())
+	{
+		PathSubsystem->CancelRequests(this);
+	}
+}
+
+const FTDSEnemyTuning& ATDSEnemyAIController::GetTuning() const
+{
+	return Tuning ? *Tuning : UTDSEnemyArchetype::GetDefaultTuning();
+}
+
+void ATDSEnemyAIController::CopyDeprecatedTuning(FTDSEnemyTuning& OutTuning) const
+{
+	OutTuning.WanderRadius = WanderRadius_DEPRECATED;
+	OutTuning.WanderRepathCooldown = WanderRepathCooldown_DEPRECATED;
+	OutTuning.WanderPauseMin = WanderPauseMin_DEPRECATED;
+	OutTuning.WanderPauseMax = WanderPauseMax_DEPRECATED;
+	OutTuning.StuckSpeedThreshold = StuckSpeedThreshold_DEPRECATED;
+	OutTuning.StuckTimeToTrigger = StuckTimeToTrigger_DEPRECATED;
+	OutTuning.ChaseTurnSpeed = ChaseTurnSpeed_DEPRECATED;
+	OutTuning.SlotRadius = SlotRadius_DEPRECATED;
+	OutTuning.SlotJitter = slotJitter_DEPRECATED;
+	OutTuning.SlotSmoothingSpeed = SlotSmoothingSpeed_DEPRECATED;
+	OutTuning.AttackInterval = AttackInterval_DEPRECATED;
+	OutTuning.ChaseDistance = ChaseDistance_DEPRECATED;
+	OutTuning.StopDistance = StopDistance_DEPRECATED;
+	OutTuning.ChaseMovementMode = ChaseMovementMode_DEPRECATED;
+	OutTuning.FlowFieldHandoffDistance = FlowFieldHandoffDistance_DEPRECATED;
+	OutTuning.AttackCooldown = AttackCooldown_DEPRECATED;
+
+	// The controller's range decided when to attack, so it wins over the character's
+	OutTuning.AttackRange = AttackRange_DEPRECATED;
+}
+
+float ATDSEnemyAIController::GetSlotRadius() const
+{
+	return GetTuning().SlotRadius;
+}
+
+bool ATDSEnemyAIController::UsesFlowField() const
+{
+	return GetTuning().ChaseMovementMode == ETDSChaseMovementMode::FlowField || CVarTDSForceFlowField.GetValueOnGameThread() != 0;
+}
+
+bool ATDSEnemyAIController::UpdateFlowFieldFollowing(float SlotDist)
+{
+	UTDSFlowFieldSubsystem* FlowFieldSubsystem = UsesFlowField() ? GetWorld()->GetSubsystem<UTDSFlowFieldSubsystem>() : nullptr;
+	ACharacter* ControlledCharacter = Cast<ACharacter>(GetPawn());
+
+	// Off the field or close to the slot, go back to pathfinding
+	FVector Direction;
+	if (!FlowFieldSubsystem || !ControlledCharacter || SlotDist <= GetTuning().FlowFieldHandoffDistance
+		|| !FlowFieldSubsystem->SampleDirection(ControlledCharacter->GetActorLocation(), Direction))
+	{
+		StopFollowingFlowField();
+		return false;
+	}
+
+	if (!Runtime.bFollowingFlowField)
+	{
+		// Drop the path we were following, the field steers us from here
+		CancelPathRequests();
+		StopMovement();
+
+		FlowFieldSubsystem->AddFollower(ControlledCharacter);
+		Runtime.bFollowingFlowField = true;
+	}
+
+	return true;
+}
+
+void ATDSEnemyAIController::StopFollowingFlowField()
+{
+	if (!Runtime.bFollowingFlowField)
+	{
+		return;
+	}
+
+	Runtime.bFollowingFlowField = false;
+
+	if (UTDSFlowFieldSubsystem* FlowFieldSubsystem = GetWorld()->GetSubsystem<UTDSFlowFieldSubsystem>())
+	{
+		FlowFieldSubsystem->RemoveFollower(Cast<ACharacter>(GetPawn()));
+	}
+
+	Runtime.TimeSinceLastMove = GetTuning().RepathCooldown; // path to the slot straight away
+}
+
+void ATDSEnemyAIController::ReceivePath(const FVector& Goal, float AcceptanceRadius, FNavPathSharedPtr Path)
+{
+	if (!GetPawn() || !Path.IsValid())
+	{
+		return;
+	}
+
+	// Same move MoveToLocation(Goal, AcceptanceRadius, true) would make, just with the path already found
+	FAIMoveRequest MoveRequest(Goal);
+	MoveRequest.SetAcceptanceRadius(AcceptanceRadius);
+	MoveRequest.SetReachTestIncludesAgentRadius(true);
+	MoveRequest.SetAllowPartialPath(true);
+	MoveRequest.SetCanStrafe(true);
+
+	// Let the path follower repath on its own if the navmesh changes under the path
+	Path->EnableRecalculationOnInvalidation(true);
+
+	RequestMove(MoveRequest, Path);
+}
+
+void ATDSEnemyAIController::SetAITimer(FTDSTimerHandle& Handle, void (ATDSEnemyAIController::*Callback)(), float Delay)
+{
+	if (UTDSEnemyManager* EnemyManager = GetWorld()->GetSubsystem<UTDSEnemyManager>())
+	{
+		FTDSTimerWheel& TimerWheel = EnemyManager->GetTimerWheel();
+
+		// Re-arming replaces the pending timer, like FTimerManager::SetTimer on a live handle
+		TimerWheel.Cancel(Handle);
+		Handle = TimerWheel.Arm(Delay, FSimpleDelegate::CreateUObject(this, Callback));
+	}
+}
+
+void ATDSEnemyAIController::ClearAITimer(FTDSTimerHandle& Handle)
+{
+	if (!Handle.IsValid())
+	{
+		return;
+	}
+
+	if (UTDSEnemyManager* EnemyManager = GetWorld()->GetSubsystem<UTDSEnemyManager>())
+	{
+		EnemyManager->GetTimerWheel().Cancel(Handle);
+	}
+	Handle.Invalidate();
 }
 
 void ATDSEnemyAIController::StartWanderAfterDelay()
 {
 	// Randomize the delay before picking a new wander target to create more natural idle behavior, so the AI doesn't always pause for the same amount of time before moving again
-	const float Delay = FMath::FRandRange(WanderPauseMin, WanderPauseMax);
+	const float Delay = FMath::FRandRange(GetTuning().WanderPauseMin, GetTuning().WanderPauseMax);
 
 	// Set a timer to pick a new wander target after the randomized delay
-	GetWorldTimerManager().SetTimer(
-		WanderTimerHandle,
-		this,
-		&ATDSEnemyAIController::PickNewWanderTarget,
-		Delay,
-		false
-	);
+	SetAITimer(WanderTimer, &ATDSEnemyAIController::PickNewWanderTarget, Delay);
 }
 
 void ATDSEnemyAIController::PickNewWanderTarget()
@@ -287,17 +553,30 @@ void ATDSEnemyAIController::PickNewWanderTarget()
 	// Ensure we have a valid pawn reference before trying to pick a wander target
 	if (!GetPawn()) return;
 
-	// Get a random reachable point within WanderRadius of the AI's current location to use as the new wander target. This uses the navigation system to ensure the point is actually reachable, which helps prevent the AI from getting stuck trying to reach an unreachable location.
+	// Get a random reachable point within our archetype's WanderRadius of the AI's current location to use as the new wander target. This uses the navigation system to ensure the point is actually reachable, which helps prevent the AI from getting stuck trying to reach an unreachable location.
 	const FVector Origin = GetPawn()->GetActorLocation();
 
+	// Rooms are static, so the room's navigation cache can usually answer without a navmesh query
+	if (UTDSNavigationCacheSubsystem* NavCache = GetWorld()->GetSubsystem<UTDSNavigationCacheSubsystem>())
+	{
+		FVector CachedPoint;
+		if (NavCache->SampleWanderPoint(Origin, GetTuning().WanderRadius, CachedPoint))
+		{
+			Runtime.WanderTarget = FVector3f(CachedPoint);
+			Runtime.bHasWanderTarget = true;
+			Runtime.TimeSinceLastMove = GetTuning().WanderRepathCooldown; // force move immediately
+			return;
+		}
+	}
+
 	FNavLocation Result;
 	if (UNavigationSystemV1* Nav = UNavigationSystemV1::GetCurrent(GetWorld()))
 	{
-		if (Nav->GetRandomReachablePointInRadius(Origin, WanderRadius, Result))
+		if (Nav->GetRandomReachablePointInRadius(Origin, GetTuning().WanderRadius, Result))
 		{
-			WanderTarget = Result.Location;
-			bHasWanderTarget = true;
-			TimeSinceLastMove = WanderRepathCooldown; // force move immediately
+			Runtime.WanderTarget = FVector3f(Result.Location);
+			Runtime.bHasWanderTarget = true;
+			Runtime.TimeSinceLastMove = GetTuning().WanderRepathCooldown; // force move immediately
 		}
 	}
 }
@@ -306,26 +585,72 @@ void ATDSEnemyAIController::PickNewWanderTarget()
 void ATDSEnemyAIController::StartAttacking()
 {
 	// If already attacking, do nothing
-	if (bIsAttacking) return;
+	if (Runtime.bIsAttacking) return;
 	// Set attacking flag
-	bIsAttacking = true;
+	Runtime.bIsAttacking = true;
 
 	// Stop movement to attack
 	StopMovement();
 
-	// Perform the first attack immediately
+	// Ask for the first swing straight away, it starts as soon as the player's attack tokens allow
+	RequestAttackToken();
+
+}
+
+UTDSAttackTokenComponent* ATDSEnemyAIController::GetAttackTokens() const
+{
+	return PlayerPawn ? PlayerPawn->FindComponentByClass<UTDSAttackTokenComponent>() : nullptr;
+}
+
+void ATDSEnemyAIController::RequestAttackToken()
+{
+	if (!Runtime.bIsAttacking) return;
+
+	// A player without tokens lets everyone swing
+	UTDSAttackTokenComponent* AttackTokens = GetAttackTokens();
+	if (!AttackTokens)
+	{
+		DoMeleeAttack();
+		return;
+	}
+
+	// Hold our slot facing the player until a token is free, ReceiveAttackToken may be called from in here
+	Runtime.bWaitingForAttackToken = true;
+	AttackTokens->RequestToken(this);
+}
+
+void ATDSEnemyAIController::ReceiveAttackToken()
+{
+	Runtime.bWaitingForAttackToken = false;
+
 	DoMeleeAttack();
 
+	// Only a swing that started its montage keeps the token, until the montage ends
+	if (!Runtime.bAttackInProgress)
+	{
+		ReleaseAttackToken();
+	}
+}
+
+void ATDSEnemyAIController::ReleaseAttackToken()
+{
+	Runtime.bWaitingForAttackToken = false;
+
+	if (UTDSAttackTokenComponent* AttackTokens = GetAttackTokens())
+	{
+		AttackTokens->ReleaseToken(this);
+	}
 }
 
 void ATDSEnemyAIController::StopAttacking()
 {
 	// Clear attacking flags
-	bIsAttacking = false;
-	bAttackInProgress = false;
+	Runtime.bIsAttacking = false;
+	Runtime.bAttackInProgress = false;
 
-	// Clear the attack timer
-	GetWorldTimerManager().ClearTimer(AttackTimerHandle);
+	// Clear the attack timer and give back our attack token, or stop waiting for one
+	ClearAITimer(AttackTimer);
+	ReleaseAttackToken();
 	// Clear focus to allow movement again
 	ClearFocus(EAIFocusPriority::Gameplay);
 
@@ -357,16 +682,26 @@ void ATDSEnemyAIController::DoMeleeAttack()
 		}
 	}
 	// Ensure we have valid references
-	if (!PlayerPawn || !GetPawn() || !bIsAttacking || bAttackInProgress) return;
+	if (!PlayerPawn || !GetPawn() || !Runtime.bIsAttacking || Runtime.bAttackInProgress) return;
 
 	// Calculate distance to player
 	const float Dist = FVector::Dist2D(PlayerPawn->GetActorLocation(), GetPawn()->GetActorLocation());
 
 	// If within attack range, apply damage
-	if (Dist > AttackRange)
+	if (Dist > GetTuning().AttackRange)
 	{
-		// If out of range, stop attacking
-		StopAttacking();
+		// If out of range, go back to chasing the way leaving attack range does, which also stops attacking. Only stopping
+		// would leave us in the attacking state without attacking if the player came straight back into range.
+		SetState(FTDSEnemyDecision::TransitionForBand(Runtime.State, 1));
+
+		// Band events only come when the band changes, have ours reported again so coming back into range re-enters attacking
+		if (Runtime.bBandsDriveState)
+		{
+			if (UTDSDistanceBandSubsystem* DistanceBands = GetWorld()->GetSubsystem<UTDSDistanceBandSubsystem>())
+			{
+				DistanceBands->ResetBand(this);
+			}
+		}
 		return;
 	}
 	// Get the enemy character and play the attack animation. 
@@ -377,6 +712,7 @@ void ATDSEnemyAIController::DoMeleeAttack()
 			if (ControlledCharacter->MeleeAttackMontage)
 			{
 				AnimInstance->Montage_Play(ControlledCharacter->MeleeAttackMontage,1.2f);
+				Runtime.bAttackInProgress = true;
 				FOnMontageEnded EndDelegate;
 				EndDelegate.BindUObject(this, &ATDSEnemyAIController::OnAttackMontageEnded);
 				AnimInstance->Montage_SetEndDelegate(EndDelegate, ControlledCharacter->MeleeAttackMontage);
@@ -388,7 +724,7 @@ void ATDSEnemyAIController::DoMeleeAttack()
 
 
 	// Fallback if montage is missing
-	bAttackInProgress = false;
+	Runtime.bAttackInProgress = false;
 }
 
 void ATDSEnemyAIController::OnAttackMontageEnded(UAnimMontage* Montage, bool bInterrupted)
@@ -400,174 +736,70 @@ void ATDSEnemyAIController::OnAttackMontageEnded(UAnimMontage* Montage, bool bIn
 			return;
 		}
 
-	bAttackInProgress = false;
+	Runtime.bAttackInProgress = false;
+
+	// Let the next enemy in line swing while we cool down
+	ReleaseAttackToken();
+
 	// If the attack was interrupted 
-	if (!bIsAttacking)
+	if (!Runtime.bIsAttacking)
 	{
 		return;
 	}
 
-	GetWorldTimerManager().SetTimer(
-		AttackTimerHandle,
-		this,
-		&ATDSEnemyAIController::DoMeleeAttack,
-		AttackCooldown,
-		false
-	);
+	SetAITimer(AttackTimer, &ATDSEnemyAIController::RequestAttackToken, GetTuning().AttackCooldown);
 }
 
-void ATDSEnemyAIController::UpdateSlotTarget()
+void ATDSEnemyAIController::OnDistanceBandChanged(uint8 NewBand)
 {
-	// Ensure we have valid references
-	if (!PlayerPawn || !GetPawn()) return;
-
-	// Recalculate the target position for the AI to occupy around the player
-	CurrentSlotTarget = ComputeSlotTarget();
-
-	if(SmoothedSlotTarget.IsZero())
-	{
-		SmoothedSlotTarget = CurrentSlotTarget; // Initialize smoothed target to current target if it's the first update
-	}
-}
-
-FVector ATDSEnemyAIController::ComputeSlotTarget() const
-{
-	// Get the player's location
-	FVector PlayerLoc = PlayerPawn->GetActorLocation();
-	
-	const float Angle = SlotAngleRad; // Use the current angle for this AI to determine its position around the player
-
-	// Calculate the offset from the player based on the angle and desired radius
-	FVector Offset(
-		FMath::Cos(Angle) * SlotRadius,
-		FMath::Sin(Angle) * SlotRadius,
-		0.f
-	);
+	if (!GetPawn()) return;
 
-	// Add a little noise so it doesn't look robotic
-	Offset.X += SlotJitterOffset.X;
-	Offset.Y += SlotJitterOffset.Y;
-
-	// Calculate the desired position by adding the offset to the player's location
-	FVector Desired = PlayerLoc + Offset;
-
-	// Check for nearby pawns to avoid overlapping with them
-	TArray<AActor*> Nearby;
-	UKismetSystemLibrary::SphereOverlapActors(
-		GetWorld(),
-		Desired,
-		140.f, // Radius for overlap
-		{ UEngineTypes::ConvertToObjectType(ECC_Pawn) },
-		APawn::StaticClass(),
-		{ GetPawn() },
-		Nearby
-	);
+	// From our first band on, these events change our state instead of the decision pass's distance checks
+	Runtime.bBandsDriveState = true;
 
-	// Calculate a push vector to move away from nearby pawns and prevent clustering
-	FVector Push(0.f, 0.f, 0.f);
-	for (AActor* A: Nearby)
+	// A band can be skipped between two passes, e.g. straight from outside chase distance into attack range, so step
+	// through the states in between as the distance checks would have over consecutive updates
+	for (int32 Step = 0; Step < 2; ++Step)
 	{
-		if (!A || A == GetPawn()) continue; // Ignore invalid actors and the player
-
-		// Calculate a push vector away from nearby pawns to prevent clustering
-		FVector ToActor = Desired - A->GetActorLocation();
-		ToActor.Z = 0.f; // Only push in the horizontal plane
-
-		const float Len = ToActor.Size();
-		if (Len > 1.f) 
+		const EEnemyState NewState = FTDSEnemyDecision::TransitionForBand(Runtime.State, NewBand);
+		if (NewState == Runtime.State)
 		{
-			Push += (ToActor / Len) * (140.f - Len); // Push stronger the closer we are to the other pawn, with a max push at 140 units
+			break;
 		}
-	}
 
-	Desired += Push; // Apply the push to the desired position
+		SetState(NewState);
 
-	// Project to navmesh so it's always reachable
-	FNavLocation Projected;
-	// Use a larger extent for projection to allow for more flexible positioning around the player
-	if (const UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld()))
-	{
-		// The FVector(200.f, 200.f, 200.f) extent allows for a wider search area around the desired point, which can help find a valid navigation point even if the exact desired location is not on the navmesh.
-		if (NavSys->ProjectPointToNavigation(Desired, Projected, FVector(200.f, 200.f, 200.f)))
+		// SetState refuses changes for a dead pawn
+		if (Runtime.State != NewState)
 		{
-			return Projected.Location;
+			break;
 		}
 	}
-
-	return Desired;
 }
 
-void ATDSEnemyAIController::RotatePawnTowardPlayer(float DeltaSeconds)
+void ATDSEnemyAIController::ReceiveSlotTarget(const FVector& SlotTarget)
 {
-	// Ensure we have valid references
-	if (!PlayerPawn || !GetPawn()) return;
-
-	// Get the pawn location and calculate the direction vector to the player
-	const FVector PawnLoc = GetPawn()->GetActorLocation();
-	FVector ToPlayer = PlayerPawn->GetActorLocation() - PawnLoc;
-	ToPlayer.Z = 0.f;
-
-	// If the player is exactly above or below the AI, we can't calculate a rotation, so just return
-	if (ToPlayer.IsNearlyZero()) return;
-
-	// Calculate the target rotation to face the player and smoothly interpolate towards it
-	const FRotator TargetRot = ToPlayer.Rotation();
-	const FRotator NewRot = FMath::RInterpTo(
-		GetPawn()->GetActorRotation(),
-		TargetRot,
-		DeltaSeconds,
-		ChaseTurnSpeed
-	);
-
-	GetPawn()->SetActorRotation(NewRot);
-}
+	Runtime.CurrentSlotTarget = FVector3f(SlotTarget);
 
-void ATDSEnemyAIController::HandleStuck(float DeltaSeconds)
-{
-	// If we're idle or attacking, we don't consider ourselves stuck and just reset the timer and last location. Stuck detection is only relevant while we're trying to move towards a target (chasing), so we can ignore it in other states.
-	if (State == EEnemyState::Idle || bIsAttacking)
+	if (Runtime.SmoothedSlotTarget.IsZero())
 	{
-		StuckTime = 0.f;
-		LastLocation = GetPawn()->GetActorLocation();
-		return;
+		Runtime.SmoothedSlotTarget = Runtime.CurrentSlotTarget; // Initialize smoothed target to current target if it's the first update
 	}
+}
 
-	// Ensure we have a valid pawn reference
-	APawn* P = GetPawn();
-	if (!P) return;
-
-	// Get the current location of the pawn
-	const FVector Current = P->GetActorLocation();
-
-	// If this is the first tick or we have no valid last location, initialize it and return
-	if (LastLocation.IsZero())
+void ATDSEnemyAIController::RegisterForCombatSlot()
+{
+	if (UTDSCombatSlotSubsystem* Slots = GetWorld()->GetSubsystem<UTDSCombatSlotSubsystem>())
 	{
-		LastLocation = Current;
-		return;
+		Slots->RegisterChaser(this);
 	}
+}
 
-	// Calculate the speed of the pawn based on the distance traveled since the last tick
-	const float Speed = FVector::Dist(Current, LastLocation) / FMath::Max(DeltaSeconds, 0.001f);
-	LastLocation = Current;
-
-	// Only consider "stuck" while we are meant to be moving (chasing, not attacking)
-	if (bIsAttacking) { StuckTime = 0.f; return; }
-
-	// If the speed is below the threshold, increment the stuck timer. If it exceeds the time to trigger, attempt to unstick.
-	if (Speed < StuckSpeedThreshold)
-	{
-		StuckTime += DeltaSeconds;
-		// If we've been below the speed threshold for long enough, we consider ourselves stuck and attempt to unstick
-		if (StuckTime >= StuckTimeToTrigger)
-		{
-			Unstick();
-			StuckTime = 0.f;
-		}
-	}
-	else
+void ATDSEnemyAIController::UnregisterFromCombatSlot()
+{
+	if (UTDSCombatSlotSubsystem* Slots = GetWorld()->GetSubsystem<UTDSCombatSlotSubsystem>())
 	{
-		// If we're moving above the speed threshold, reset the stuck timer
-		StuckTime = 0.f;
+		Slots->UnregisterChaser(this);
 	}
 }
 
@@ -583,11 +815,12 @@ void ATDSEnemyAIController::Unstick()
 	FVector Nudge = Right * Sign * FMath::RandRange(180.f, 220.f);
 	Nudge.Z = 0.f;
 
-	CurrentSlotTarget += Nudge;   // shift target a bit
-	SmoothedSlotTarget = CurrentSlotTarget;
+	Runtime.CurrentSlotTarget += FVector3f(Nudge);   // shift target a bit
+	Runtime.SmoothedSlotTarget = Runtime.CurrentSlotTarget;
 
+	CancelPathRequests();
 	StopMovement();
-	TimeSinceLastMove = RepathCooldown; // force a repath immediately next tick
+	Runtime.TimeSinceLastMove = GetTuning().RepathCooldown; // force a repath immediately next tick
 }
 
 void ATDSEnemyAIController::SetOrientRotationToMovement(bool bEnable)
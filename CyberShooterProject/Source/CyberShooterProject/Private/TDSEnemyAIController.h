@@ -5,8 +5,15 @@
 #include "CoreMinimal.h"
 #include "AIController.h"
 #include "Animation/AnimMontage.h"
+#include "NavigationSystemTypes.h"
+#include "TDSTimerWheel.h"
 #include "TDSEnemyAIController.generated.h"
 
+class UTDSAttackTokenComponent;
+struct FTDSEnemyTuning;
+struct FTDSEnemyDecisionInput;
+struct FTDSEnemyDecisionOutput;
+
 UENUM(BlueprintType)
 enum class EEnemyState : uint8
 {
@@ -15,6 +22,71 @@ enum class EEnemyState : uint8
 	Attacking UMETA(DisplayName = "Attacking")
 };
 
+// How a chasing enemy finds its way to its combat slot
+UENUM(BlueprintType)
+enum class ETDSChaseMovementMode : uint8
+{
+	// Every enemy pathfinds to its slot on its own
+	Pathfinding,
+
+	// Enemies far from their slot follow the shared flow field towards the player, and pathfind for the last stretch
+	FlowField
+};
+
+// Everything the AI changes about one enemy while it runs. Tuning lives once per archetype (see FTDSEnemyTuning), so this
+// is all an enemy's AI carries of its own. Positions are single precision, rooms are nowhere near big enough to need doubles,
+// and the flags are packed into one byte.
+struct FTDSEnemyRuntimeState
+{
+	FVector3f WanderTarget = FVector3f::ZeroVector;
+
+	// Stuck detection: where we were last update and for how long we have barely moved
+	FVector3f LastLocation = FVector3f::ZeroVector;
+	float StuckTime = 0.f;
+
+	// Slot handed out by the combat slot subsystem, and the smoothed target we actually move to
+	FVector3f CurrentSlotTarget = FVector3f::ZeroVector;
+	FVector3f SmoothedSlotTarget = FVector3f::ZeroVector;
+
+	// Random offset added to our slot so enemies do not cluster too tightly
+	FVector2f SlotJitterOffset = FVector2f::ZeroVector;
+
+	// Time since the last path request while chasing and while wandering
+	float TimeSinceLastMove = 0.f;
+	float TimeSinceLastWanderMove = 0.f;
+
+	EEnemyState State = EEnemyState::Idle;
+
+	uint8 bHasWanderTarget : 1;
+
+	// Whether we are in the attacking state, and whether a swing's montage is playing
+	uint8 bIsAttacking : 1;
+	uint8 bAttackInProgress : 1;
+
+	// Whether we are waiting for an attack token, the cheap part of attacking with no montage playing
+	uint8 bWaitingForAttackToken : 1;
+
+	// Whether the flow field subsystem is currently steering our pawn
+	uint8 bFollowingFlowField : 1;
+
+	// Whether the enemy manager runs our AI instead of our own actor tick
+	uint8 bBatchedTick : 1;
+
+	// Whether the distance band subsystem has reported our band yet, from then on its events change our state
+	uint8 bBandsDriveState : 1;
+
+	FTDSEnemyRuntimeState()
+		: bHasWanderTarget(false)
+		, bIsAttacking(false)
+		, bAttackInProgress(false)
+		, bWaitingForAttackToken(false)
+		, bFollowingFlowField(false)
+		, bBatchedTick(false)
+		, bBandsDriveState(false)
+	{
+	}
+};
+
 
 UCLASS()
 class ATDSEnemyAIController : public AAIController
@@ -25,105 +97,126 @@ class ATDSEnemyAIController : public AAIController
 public:
 	// Sets default values for this controller's properties
 	virtual void OnPossess(APawn* InPawn) override;
-	// Called every frame
+	virtual void OnUnPossess() override;
+	// Called every frame when the enemy manager is not batching our tick
 	virtual void Tick(float DeltaSeconds) override;
 
+	// Gather stage of a batched update, called by the enemy manager on the game thread instead of Tick.
+	// Returns false when there is nothing to decide this update.
+	bool GatherBatchedDecision(float DeltaSeconds, FTDSEnemyDecisionInput& OutInput);
+
+	// Apply stage: writes a decision back and issues the move, rotation and attack commands it asks for, on the game thread
+	void ApplyDecision(const FTDSEnemyDecisionInput& Input, const FTDSEnemyDecisionOutput& Output);
+
+	// Sets how often our AI runs, on the enemy manager when batched or as our actor tick interval otherwise
+	void SetAITickInterval(float TickInterval);
+
 	void StopAttacking();
 
+	// Called by the player's attack token component when we may swing
+	void ReceiveAttackToken();
+
+	// Whether we are in range and attacking but holding our slot until an attack token frees up
+	bool IsWaitingForAttackToken() const { return Runtime.bWaitingForAttackToken; }
+
+	// Current FSM state, read by the AI LOD subsystem
+	EEnemyState GetState() const { return Runtime.State; }
+
+	// Tuning of the archetype of the pawn we possess, the default archetype's without one
+	const FTDSEnemyTuning& GetTuning() const;
+
+	// Called by the combat slot subsystem with the slot this enemy should move to
+	void ReceiveSlotTarget(const FVector& SlotTarget);
+
+	// Called by the distance band subsystem when the player crosses our attack range or chase distance, moves the FSM on
+	void OnDistanceBandChanged(uint8 NewBand);
+
+	// Called by the path request subsystem when a path we asked for is ready
+	void ReceivePath(const FVector& Goal, float AcceptanceRadius, FNavPathSharedPtr Path);
+
+	// Copies the tuning Blueprint controller classes set before archetypes, for enemy classes that have no archetype yet
+	void CopyDeprecatedTuning(FTDSEnemyTuning& OutTuning) const;
+
+	// Slot settings read by the combat slot subsystem
+	float GetSlotRadius() const;
+	FVector2D GetSlotJitterOffset() const { return FVector2D(Runtime.SlotJitterOffset); }
+
 protected:
 
 	// ---- FSM ----
-	EEnemyState State = EEnemyState::Idle;
-
 	void SetState(EEnemyState NewState);
-	void UpdateStateTransitions();
-	void RunState(float DeltaSeconds);
-
-	// ---- Idle State ----
 
-	// Parameters for wandering behavior when in idle state
-	UPROPERTY(EditDefaultsOnly, Category = "AI|Idle")
-	float WanderRadius = 900.f;
+	// Copies what the decision pass reads out of this controller and its pawn. Returns false without a live pawn.
+	bool GatherDecisionInput(float DeltaSeconds, FTDSEnemyDecisionInput& OutInput);
 
-	// Time interval for recalculating wander target to prevent excessive pathfinding calls
-	UPROPERTY(EditDefaultsOnly, Category = "AI|Idle")
-	float WanderRepathCooldown = 0.5f;
+	// Carries out the behaviour of the current state from a decision that did not change state
+	void ApplyBehaviour(const FTDSEnemyDecisionInput& Input, const FTDSEnemyDecisionOutput& Output);
 
-	// Minimum and maximum time the AI will pause before moving to a new wander target, used to create more natural idle behavior
-	UPROPERTY(EditDefaultsOnly, Category = "AI|Idle")
-	float WanderPauseMin = 0.5f;
+	// Timer for picking the next wander target, on the enemy manager's timer wheel
+	FTDSTimerHandle WanderTimer;
 
-	// Maximum time the AI will pause before moving to a new wander target, used to create more natural idle behavior
-	UPROPERTY(EditDefaultsOnly, Category = "AI|Idle")
-	float WanderPauseMax = 1.5f;
+	// What the AI changes about this enemy as it runs
+	FTDSEnemyRuntimeState Runtime;
 
-	// Timer handle for managing wander target updates
-	FTimerHandle WanderTimerHandle;
-	FVector WanderTarget = FVector::ZeroVector;
-	bool bHasWanderTarget = false;
+	// Tuning shared with every enemy of our pawn's archetype, set on possess. The pawn holds the archetype, so it
+	// outlives our use of it.
+	const FTDSEnemyTuning* Tuning = nullptr;
 
-	// Variables for stuck detection
-	FVector LastLocation = FVector::ZeroVector;
-	float StuckTime = 0.f;
+	// ---- Deprecated tuning ----
+	// Tuning now lives on UTDSEnemyArchetype. These still load what Blueprint controller classes set (see [CoreRedirects] in
+	// DefaultEngine.ini) and are copied into the fallback archetype of enemy classes without an archetype. Remove them
+	// once every enemy class has one.
 
-	// Parameters for stuck detection
-	UPROPERTY(EditDefaultsOnly, Category = "Movement|Stuck")
-	float StuckSpeedThreshold = 5.f;   // units/sec (very low)
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float WanderRadius_DEPRECATED = 900.f;
 
-	// Time the AI must be below the speed threshold before we consider it stuck
-	UPROPERTY(EditDefaultsOnly, Category = "Movement|Stuck")
-	float StuckTimeToTrigger = 0.6f;   // seconds
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float WanderRepathCooldown_DEPRECATED = 0.5f;
 
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float WanderPauseMin_DEPRECATED = 0.5f;
 
-	UPROPERTY(EditDefaultsOnly, Category = "Rotation")
-	float ChaseTurnSpeed = 8.f; // Speed at which the AI will rotate to face the player when within chase distance
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float WanderPauseMax_DEPRECATED = 1.5f;
 
-	// Radius around the player where the AI will try to position itself for combat
-	UPROPERTY(EditDefaultsOnly, Category="Combat|Slots")
-	float SlotRadius = 150.f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float StuckSpeedThreshold_DEPRECATED = 5.f;
 
-	// Slight random offset added to the AI's position when trying to occupy a combat slot, to prevent them from clustering too tightly
-	UPROPERTY(EditDefaultsOnly, Category = "Combat|Slots")
-	float slotJitter = 8.f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float StuckTimeToTrigger_DEPRECATED = 0.6f;
 
-	// Time interval for recalculating combat slots to allow for dynamic repositioning during combat
-	UPROPERTY(EditDefaultsOnly, Category = "Combat|Slots")
-	float slotRecalcInterval = 0.8f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float ChaseTurnSpeed_DEPRECATED = 8.f;
 
-	// Speed at which the AI will move towards its target combat slot position, used for smoothing movement around the player
-	UPROPERTY(EditDefaultsOnly, Category = "Combat|Slots")
-	float SlotSmoothingSpeed = 6.f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float SlotRadius_DEPRECATED = 150.f;
 
-	FVector SmoothedSlotTarget = FVector::ZeroVector;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float slotJitter_DEPRECATED = 8.f;
 
-	float SlotAngleRad = 0.f; // Current angle around the player for the AI to position itself in combat
-	bool bSlotAngleInit = false; // Whether the initial slot angle has been set, used to ensure the AI starts in a unique position around the player
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float SlotSmoothingSpeed_DEPRECATED = 6.f;
 
-	// Timer handle for managing combat slot recalculations
-	FTimerHandle SlotTimerHandle;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float AttackRange_DEPRECATED = 150.f;
 
-	// Current target position for the AI to move towards when trying to occupy a combat slot around the player
-	FVector CurrentSlotTarget = FVector::ZeroVector;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float AttackInterval_DEPRECATED = 0.8f;
 
-	// Distance at which the AI can attack the player
-	UPROPERTY(EditDefaultsOnly, Category="Combat")
-	float AttackRange = 150.f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float ChaseDistance_DEPRECATED = 2000.f;
 
-	// Damage dealt per attack
-	UPROPERTY(EditDefaultsOnly, Category = "Combat")
-	float AttackDamage = 10.f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float StopDistance_DEPRECATED = 20.f;
 
-	// Time interval between attacks
-	UPROPERTY(EditDefaultsOnly, Category = "Combat")
-	float AttackInterval = 0.8f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	ETDSChaseMovementMode ChaseMovementMode_DEPRECATED = ETDSChaseMovementMode::Pathfinding;
 
-	// Distance at which the AI will start chasing the player
-	UPROPERTY(EditDefaultsOnly, Category = "AI")
-	float ChaseDistance = 2000.0f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float FlowFieldHandoffDistance_DEPRECATED = 400.f;
 
-	// Distance at which the AI will stop moving towards the player
-	UPROPERTY(EditDefaultsOnly, Category = "AI")
-	float StopDistance = 20.0f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float AttackCooldown_DEPRECATED = 0.5f;
 
 private:
 
@@ -131,52 +224,61 @@ private:
 	void PickNewWanderTarget();
 	void StartWanderAfterDelay();
 
-	// Function to handle stuck detection and recovery
-	void HandleStuck(float DeltaSeconds);
+	// Sidesteps out of the crowd when stuck detection says we have not moved for a while
 	void Unstick();
 
-	// Function to smoothly rotate the AI's pawn to face the player when within chase distance
-	void RotatePawnTowardPlayer(float DeltaSeconds);
+	// The FSM update when not batched: gather, compute and apply for this controller alone
+	void TickAI(float DeltaSeconds);
 
-	// Function to calculate and update the AI's target position for occupying a combat slot around the player
-	void UpdateSlotTarget();
+	// Queues a move through the path request subsystem, which pathfinds asynchronously within a per frame budget
+	void RequestMoveTo(const FVector& Goal, float AcceptanceRadius, bool bWandering);
 
-	// Function to compute the ideal position for the AI to occupy around the player based on the current number of enemies and their positions
-	FVector ComputeSlotTarget() const;
+	// Drops any queued or in flight path, used whenever we stop moving on purpose
+	void CancelPathRequests();
 
-	// Timer handle for managing attack intervals
-	FTimerHandle AttackTimerHandle;
+	// Whether chasing follows the flow field, from ChaseMovementMode or tds.AI.ForceFlowField
+	bool UsesFlowField() const;
+
+	// Follows the flow field while chasing if it reaches us and we are far from our slot. Returns true while following.
+	bool UpdateFlowFieldFollowing(float SlotDist);
+
+	// Stops being steered by the flow field
+	void StopFollowingFlowField();
+
+	// Joins or leaves the combat slot subsystem's assignment
+	void RegisterForCombatSlot();
+	void UnregisterFromCombatSlot();
+
+	// Timer for the next attack, on the enemy manager's timer wheel
+	FTDSTimerHandle AttackTimer;
+
+	// Arms or re-arms one of our timers on the enemy manager's timer wheel. Callbacks are bound weakly, so a timer
+	// outliving us is dropped, and a handle cleared by ClearAITimer never fires even if its tick has already come.
+	void SetAITimer(FTDSTimerHandle& Handle, void (ATDSEnemyAIController::*Callback)(), float Delay);
+	void ClearAITimer(FTDSTimerHandle& Handle);
 
 	// Functions to manage attacking behavior
 	void StartAttacking();
 
 	void DoMeleeAttack();
 
-	// Whether the AI is currently attacking
-	bool bIsAttacking = false;
+	// Asks the player's attack token component for a swing, or swings straight away if the player has none
+	void RequestAttackToken();
 
-	UFUNCTION()
-	void OnAttackMontageEnded(UAnimMontage* Montage, bool bInterrupted);
+	// Gives our attack token back, or stops waiting for one
+	void ReleaseAttackToken();
 
-	UPROPERTY(EditAnywhere, Category = "Attack")
-	float AttackCooldown = 0.5f; // Time in seconds between attacks
+	UTDSAttackTokenComponent* GetAttackTokens() const;
 
-	// Whether an attack is currently in progress (used to prevent overlapping attacks and ensure proper timing)
-	bool bAttackInProgress = false;
+	UFUNCTION()
+	void OnAttackMontageEnded(UAnimMontage* Montage, bool bInterrupted);
 
 	// Reference to the player pawn
 	UPROPERTY()
 	APawn* PlayerPawn = nullptr;
 
-	// Cooldown time for pathfinding updates to prevent excessive calls
-	float RepathCooldown = 0.2f;
-	float TimeSinceLastMove = 0.f;
-
-	float TimeSinceLastWanderMove = 0.f;
 	void SetOrientRotationToMovement(bool bEnable);
 
-	FVector2D SlotJitterOffset = FVector2D::ZeroVector;
-
 };
 
 
@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSEnemyArchetype.h"
+#include "TDSEnemyCharacter.h"
+#include "TDSEnemyAIController.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+namespace
+{
+	// What every enemy carried of its own before archetypes, in the order it was declared on the controller and character.
+	// Only used to size the "before" column of tds.AI.MemoryReport.
+	struct FTDSLegacyEnemyInstanceData
+	{
+		// ATDSEnemyAIController
+		EEnemyState State;
+		float WanderRadius, WanderRepathCooldown, WanderPauseMin, WanderPauseMax;
+		FVector WanderTarget;
+		bool bHasWanderTarget;
+		FVector LastLocation;
+		float StuckTime;
+		float StuckSpeedThreshold, StuckTimeToTrigger, ChaseTurnSpeed, SlotRadius, SlotJitter, SlotSmoothingSpeed;
+		FVector SmoothedSlotTarget, CurrentSlotTarget;
+		float AttackRange, AttackDamage, AttackInterval, ChaseDistance, StopDistance;
+		ETDSChaseMovementMode ChaseMovementMode;
+		float FlowFieldHandoffDistance;
+		bool bWaitingForAttackToken, bIsAttacking, bFollowingFlowField, bBatchedTick, bBandsDriveState;
+		float AttackCooldown;
+		bool bAttackInProgress;
+		float RepathCooldown, TimeSinceLastMove, TimeSinceLastWanderMove;
+		FVector2D SlotJitterOffset;
+
+		// ATDSEnemyCharacter
+		float MaxHealth, CharacterAttackRange, CharacterAttackDamage;
+	};
+
+	// The deprecated tuning properties still on every instance until Blueprints have moved to archetypes
+	struct FTDSDeprecatedEnemyTuningData
+	{
+		// ATDSEnemyAIController
+		float WanderRadius, WanderRepathCooldown, WanderPauseMin, WanderPauseMax;
+		float StuckSpeedThreshold, StuckTimeToTrigger, ChaseTurnSpeed, SlotRadius, SlotJitter, SlotSmoothingSpeed;
+		float AttackRange, AttackInterval, ChaseDistance, StopDistance;
+		ETDSChaseMovementMode ChaseMovementMode;
+		float FlowFieldHandoffDistance, AttackCooldown;
+
+		// ATDSEnemyCharacter
+		TObjectPtr<UTDSEnemyArchetype> DeprecatedTuningArchetype;
+		float MaxHealth, AttackRange, AttackDamage;
+	};
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GTDSEnemyMemoryReportCommand(
+	TEXT("tds.AI.MemoryReport"),
+	TEXT("Logs the bytes each enemy instance carries with tuning shared through archetypes, against the old per instance tuning, ")
+	TEXT("and the measured size of the enemies in the room."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World)
+		{
+			return;
+		}
+
+		// Per instance bytes now: the actors themselves, which hold the compact runtime state, two pointers to the archetype
+		// and, until Blueprints have moved to archetypes, the deprecated tuning properties
+		const int32 CurrentBytes = static_cast<int32>(sizeof(ATDSEnemyAIController) + sizeof(ATDSEnemyCharacter));
+		const int32 DeprecatedBytes = static_cast<int32>(sizeof(FTDSDeprecatedEnemyTuningData));
+		const int32 AfterBytes = CurrentBytes - DeprecatedBytes;
+
+		// Before, the runtime state was wider and all the tuning was copied into every instance instead of those two pointers
+		const int32 MovedBytes = static_cast<int32>(sizeof(FTDSEnemyRuntimeState) + sizeof(const FTDSEnemyTuning*) + sizeof(TObjectPtr<UTDSEnemyArchetype>));
+		const int32 BeforeBytes = AfterBytes - MovedBytes + static_cast<int32>(sizeof(FTDSLegacyEnemyInstanceData));
+
+		UE_LOG(LogTemp, Log, TEXT("tds.AI.MemoryReport: controller %d bytes, character %d bytes, runtime state %d bytes, tuning %d bytes once per archetype"),
+			static_cast<int32>(sizeof(ATDSEnemyAIController)), static_cast<int32>(sizeof(ATDSEnemyCharacter)),
+			static_cast<int32>(sizeof(FTDSEnemyRuntimeState)), static_cast<int32>(sizeof(FTDSEnemyTuning)));
+		UE_LOG(LogTemp, Log, TEXT("tds.AI.MemoryReport: per enemy instance %d bytes before archetypes, %d bytes now, %d bytes once the %d bytes of deprecated tuning are removed (%d saved)"),
+			BeforeBytes, CurrentBytes, AfterBytes, DeprecatedBytes, BeforeBytes - AfterBytes);
+
+		// The enemies in the room, measured, and what the whole room costs either way
+		int32 NumEnemies = 0;
+		SIZE_T MeasuredBytes = 0;
+		TSet<const UTDSEnemyArchetype*> ArchetypesInUse;
+		for (TActorIterator<ATDSEnemyCharacter> It(World); It; ++It)
+		{
+			NumEnemies++;
+			MeasuredBytes += It->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+			if (AController* Controller = It->GetController())
+			{
+				MeasuredBytes += Controller->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+			}
+			ArchetypesInUse.Add(It->GetArchetype() ? It->GetArchetype() : ATDSEnemyCharacter::GetClassArchetype(It->GetClass()));
+		}
+
+		if (NumEnemies == 0)
+		{
+			UE_LOG(LogTemp, Log, TEXT("tds.AI.MemoryReport: no enemies in the room to measure"));
+			return;
+		}
+
+		const int32 SharedBytes = ArchetypesInUse.Num() * static_cast<int32>(sizeof(FTDSEnemyTuning));
+		UE_LOG(LogTemp, Log, TEXT("tds.AI.MemoryReport: %d enemies of %d archetypes, %llu bytes measured per enemy (actor and controller, exclusive)"),
+			NumEnemies, ArchetypesInUse.Num(), static_cast<uint64>(MeasuredBytes / NumEnemies));
+		UE_LOG(LogTemp, Log, TEXT("tds.AI.MemoryReport: room total %d bytes before archetypes, %d bytes now, %d bytes without deprecated tuning, each including %d bytes of shared tuning"),
+			NumEnemies * BeforeBytes, NumEnemies * CurrentBytes + SharedBytes, NumEnemies * AfterBytes + SharedBytes, SharedBytes);
+	}));
+
+const FTDSEnemyTuning& UTDSEnemyArchetype::GetDefaultTuning()
+{
+	return GetDefault<UTDSEnemyArchetype>()->Tuning;
+}
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "TDSEnemyAIController.h"
+#include "TDSEnemyArchetype.generated.h"
+
+class ATDSEnemyCharacter;
+
+// Everything that tunes how one kind of enemy fights and moves. It lives once on an archetype asset and every enemy of
+// that archetype reads it through a pointer, instead of each character and controller carrying its own copy.
+USTRUCT(BlueprintType)
+struct FTDSEnemyTuning
+{
+	GENERATED_BODY()
+
+	// ---- Health ----
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Health", meta = (ClampMin = "1.0"))
+	float MaxHealth = 100.f;
+
+	// ---- Combat ----
+
+	// Distance at which the enemy can attack the player, used for both the attack decision and the melee hit
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Combat", meta = (ClampMin = "0.0"))
+	float AttackRange = 150.f;
+
+	// Damage dealt per attack
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Combat", meta = (ClampMin = "0.0"))
+	float AttackDamage = 10.f;
+
+	// Time between a horde proxy's attacks
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Combat", meta = (ClampMin = "0.0"))
+	float AttackInterval = 0.8f;
+
+	// Time in seconds between the end of one attack montage and asking for the next swing
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Combat", meta = (ClampMin = "0.0"))
+	float AttackCooldown = 0.5f;
+
+	// ---- Chase ----
+
+	// Distance at which the enemy will start chasing the player
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Chase", meta = (ClampMin = "0.0"))
+	float ChaseDistance = 2000.f;
+
+	// Distance at which the enemy will stop moving towards its slot
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Chase", meta = (ClampMin = "0.0"))
+	float StopDistance = 20.f;
+
+	// Cooldown between path requests while chasing, to prevent excessive pathfinding
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Chase", meta = (ClampMin = "0.0"))
+	float RepathCooldown = 0.2f;
+
+	// Speed at which the enemy rotates to face the player while chasing and attacking
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Chase", meta = (ClampMin = "0.0"))
+	float ChaseTurnSpeed = 8.f;
+
+	// Whether chasing uses per enemy pathfinding or the shared flow field
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Chase")
+	ETDSChaseMovementMode ChaseMovementMode = ETDSChaseMovementMode::Pathfinding;
+
+	// Closer than this to its slot, a flow field enemy switches to pathfinding to reach the slot itself
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Chase", meta = (ClampMin = "0.0"))
+	float FlowFieldHandoffDistance = 400.f;
+
+	// ---- Combat slots ----
+
+	// Radius around the player where the enemy will try to position itself for combat
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Slots", meta = (ClampMin = "0.0"))
+	float SlotRadius = 150.f;
+
+	// Largest random offset added to the enemy's slot, to prevent enemies from clustering too tightly
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Slots", meta = (ClampMin = "0.0"))
+	float SlotJitter = 8.f;
+
+	// Speed at which the enemy's slot target follows the slot it was handed, for smoothing movement around the player
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Slots", meta = (ClampMin = "0.0"))
+	float SlotSmoothingSpeed = 6.f;
+
+	// ---- Idle ----
+
+	// How far from where it stands an idle enemy picks its wander targets
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Idle", meta = (ClampMin = "0.0"))
+	float WanderRadius = 900.f;
+
+	// Time between path requests towards the wander target
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Idle", meta = (ClampMin = "0.0"))
+	float WanderRepathCooldown = 0.5f;
+
+	// Shortest and longest pause before moving to a new wander target
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Idle", meta = (ClampMin = "0.0"))
+	float WanderPauseMin = 0.5f;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Idle", meta = (ClampMin = "0.0"))
+	float WanderPauseMax = 1.5f;
+
+	// ---- Stuck detection ----
+
+	// Speed in units per second below which the enemy counts as not moving
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Stuck", meta = (ClampMin = "0.0"))
+	float StuckSpeedThreshold = 5.f;
+
+	// Time the enemy must be below the speed threshold before we consider it stuck
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Stuck", meta = (ClampMin = "0.0"))
+	float StuckTimeToTrigger = 0.6f;
+};
+
+// One kind of enemy: the character class to spawn and the tuning every enemy of this kind shares.
+// Enemies point at their archetype (ATDSEnemyCharacter::Archetype), rooms list the archetypes they spawn
+// (UTDSRoomDefinition::Enemies), and enemies without one fall back to this class's defaults.
+UCLASS(BlueprintType)
+class UTDSEnemyArchetype : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// Character spawned for this archetype. Rooms fall back to their default enemy class when this is not set.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Archetype")
+	TSubclassOf<ATDSEnemyCharacter> EnemyClass;
+
+	// Tuning shared by every enemy of this archetype
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Archetype", meta = (ShowOnlyInnerProperties))
+	FTDSEnemyTuning Tuning;
+
+	// Tuning used by enemies that have no archetype set
+	static const FTDSEnemyTuning& GetDefaultTuning();
+};
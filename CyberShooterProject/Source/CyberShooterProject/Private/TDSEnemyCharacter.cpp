@@ -5,20 +5,32 @@
 
 #include "Engine/Engine.h"
 #include "TDSEnemyAIController.h"
+#include "TDSEnemyArchetype.h"
 #include "Kismet/GameplayStatics.h"
 #include "Components/CapsuleComponent.h"
 #include "Animation/AnimInstance.h"
 #include "TDSGameInstance.h"
 #include "TDSPlayerController.h"
 #include "TDSHUDWidget.h"
+#include "TDSDamageSubsystem.h"
+#include "TDSAudioEventSubsystem.h"
+#include "TDSCollisionChannels.h"
+#include "TDSSpatialGridSubsystem.h"
+#include "TDSHordeSubsystem.h"
+#include "TDSSeparationSubsystem.h"
+#include "TDSAnimationBudgetSubsystem.h"
+#include "TDSEnemyMeshComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "TimerManager.h"
 
 // Sets default values
-ATDSEnemyCharacter::ATDSEnemyCharacter()
+ATDSEnemyCharacter::ATDSEnemyCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer
+		.SetDefaultSubobjectClass<UTDSEnemyMovementComponent>(ACharacter::CharacterMovementComponentName)
+		.SetDefaultSubobjectClass<UTDSEnemyMeshComponent>(ACharacter::MeshComponentName))
 {
- 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// Enemies have nothing to do in their own tick, their AI runs from the enemy manager and movement from its component
+	PrimaryActorTick.bCanEverTick = false;
 
 	// Set AI Controller class
 	AIControllerClass = ATDSEnemyAIController::StaticClass();
@@ -35,7 +47,7 @@ ATDSEnemyCharacter::ATDSEnemyCharacter()
 	// Set rotation rate for smooth turning
 	GetCharacterMovement()->RotationRate = FRotator(0.0f, 0.0f, 0.0f);
 
-	// Enable RVO avoidance for better navigation around other characters
+	// Enable RVO avoidance for better navigation around other characters, BeginPlay turns it off again for classes using separation steering
 	GetCharacterMovement()->bUseRVOAvoidance = true;
 
 	GetCharacterMovement()->AvoidanceConsiderationRadius = 220.f; // Set the radius for avoidance consideration
@@ -43,9 +55,8 @@ ATDSEnemyCharacter::ATDSEnemyCharacter()
 	// Set the avoidance weight to prioritize avoiding other characters
 	GetCharacterMovement()->AvoidanceWeight = 0.4f;
 
-	// Set the capsule component to generate overlap events for detecting damage0,  
-	GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_Pawn,ECR_Overlap);
-	GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_Camera, ECR_Ignore);
+	// The capsule is the enemy's hurtbox: it blocks projectiles and the world, and overlaps the player and other enemies
+	GetCapsuleComponent()->SetCollisionProfileName(TDSCollisionProfiles::EnemyHurtbox);
 
 	if (GetMesh())
 	{
@@ -60,17 +71,45 @@ void ATDSEnemyCharacter::BeginPlay()
 	Super::BeginPlay();
 	
 	// Initialize health
-	CurrentHealth = MaxHealth;
+	CurrentHealth = GetMaxHealth();
 
 	// Bind the OnTakeDamage function to handle damage events
 	OnTakeAnyDamage.AddDynamic(this, &ATDSEnemyCharacter::HandleTakeAnyDamage);
+
+	// Join the spatial grid so proximity queries can find us
+	if (UTDSSpatialGridSubsystem* SpatialGrid = GetWorld()->GetSubsystem<UTDSSpatialGridSubsystem>())
+	{
+		SpatialGrid->RegisterAgent(this, ETDSGridAgent::Enemy);
+	}
+
+	// Join the separation pass or stay with RVO, whichever this class uses
+	SetAvoidanceMode(AvoidanceMode);
+
+	// Let the animation budget decide how often our mesh ticks
+	if (UTDSAnimationBudgetSubsystem* AnimBudget = GetWorld()->GetSubsystem<UTDSAnimationBudgetSubsystem>())
+	{
+		AnimBudget->RegisterEnemy(this);
+	}
 }
 
-// Called every frame
-void ATDSEnemyCharacter::Tick(float DeltaTime)
+void ATDSEnemyCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	if (UTDSAnimationBudgetSubsystem* AnimBudget = GetWorld()->GetSubsystem<UTDSAnimationBudgetSubsystem>())
+	{
+		AnimBudget->UnregisterEnemy(this);
+	}
+
+	if (UTDSSeparationSubsystem* Separation = GetWorld()->GetSubsystem<UTDSSeparationSubsystem>())
+	{
+		Separation->UnregisterAgent(this);
+	}
 
+	if (UTDSSpatialGridSubsystem* SpatialGrid = GetWorld()->GetSubsystem<UTDSSpatialGridSubsystem>())
+	{
+		SpatialGrid->UnregisterAgent(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called to bind functionality to input
@@ -94,13 +133,13 @@ void ATDSEnemyCharacter::HandleTakeAnyDamage(
 		return;
 	}
 
-	// Reduce health by damage amount
-	CurrentHealth = FMath::Clamp(CurrentHealth - Damage, 0.f, MaxHealth);
+	ReceiveResolvedDamage(Damage);
 
-	// Play hurt sound if assigned
-	if(HurtSound)
+	// Damage from outside the game's damage subsystem (e.g. Blueprints) still updates the HUD itself,
+	// after the damage is applied so it shows the new health. An enemy that just died has nothing left to show.
+	if (bIsDead)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, HurtSound, GetActorLocation(), HurtSoundVolume);
+		return;
 	}
 
 	if (ATDSPlayerController* PC = Cast<ATDSPlayerController>(GetWorld()->GetFirstPlayerController()))
@@ -110,6 +149,28 @@ void ATDSEnemyCharacter::HandleTakeAnyDamage(
 			HUD->ShowEnemyHealth(this);
 		}
 	}
+}
+
+void ATDSEnemyCharacter::ReceiveResolvedDamage(float Damage)
+{
+	// If already dead, ignore further damage
+	if (bIsDead)
+	{
+		return;
+	}
+
+	// Reduce health by damage amount
+	CurrentHealth = FMath::Clamp(CurrentHealth - Damage, 0.f, GetMaxHealth());
+
+	// Play hurt sound if assigned
+	if(HurtSound)
+	{
+		if (UTDSAudioEventSubsystem* Audio = GetWorld()->GetSubsystem<UTDSAudioEventSubsystem>())
+		{
+			Audio->PlaySound(ETDSAudioCategory::Hurt, HurtSound, GetActorLocation(), HurtSoundVolume);
+		}
+	}
+
 	// Check for death
 	if (CurrentHealth <= 0.f)
 	{
@@ -117,6 +178,114 @@ void ATDSEnemyCharacter::HandleTakeAnyDamage(
 	}
 }
 
+float ATDSEnemyCharacter::GetMaxHealth() const
+{
+	return GetTuning().MaxHealth;
+}
+
+void ATDSEnemyCharacter::SetCurrentHealth(float NewHealth)
+{
+	CurrentHealth = FMath::Clamp(NewHealth, 0.f, GetMaxHealth());
+}
+
+void ATDSEnemyCharacter::SetArchetype(UTDSEnemyArchetype* NewArchetype)
+{
+	ensureMsgf(!HasActorBegunPlay(), TEXT("%s: the archetype has to be set before BeginPlay"), *GetName());
+	Archetype = NewArchetype;
+}
+
+const FTDSEnemyTuning& ATDSEnemyCharacter::GetTuning() const
+{
+	if (Archetype)
+	{
+		return Archetype->Tuning;
+	}
+
+	const UTDSEnemyArchetype* ClassArchetype = GetClassArchetype(GetClass());
+	return ClassArchetype ? ClassArchetype->Tuning : UTDSEnemyArchetype::GetDefaultTuning();
+}
+
+UTDSEnemyArchetype* ATDSEnemyCharacter::GetClassArchetype(TSubclassOf<ATDSEnemyCharacter> EnemyClass)
+{
+	if (!EnemyClass)
+	{
+		return nullptr;
+	}
+
+	ATDSEnemyCharacter* Defaults = EnemyClass->GetDefaultObject<ATDSEnemyCharacter>();
+	if (Defaults->Archetype)
+	{
+		return Defaults->Archetype;
+	}
+
+	// Built on first use rather than on load, so Blueprint class defaults are in by then. Transient and owned by the class
+	// default object, so it lives as long as the class and every enemy of the class shares it.
+	if (!Defaults->DeprecatedTuningArchetype)
+	{
+		UTDSEnemyArchetype* ClassArchetype = NewObject<UTDSEnemyArchetype>(Defaults, NAME_None, RF_Transient);
+		ClassArchetype->EnemyClass = EnemyClass;
+
+		FTDSEnemyTuning& ClassTuning = ClassArchetype->Tuning;
+		if (const UClass* ControllerClass = Defaults->AIControllerClass.Get())
+		{
+			if (const ATDSEnemyAIController* ControllerDefaults = Cast<ATDSEnemyAIController>(ControllerClass->GetDefaultObject()))
+			{
+				ControllerDefaults->CopyDeprecatedTuning(ClassTuning);
+			}
+		}
+
+		// The character's own health and damage, its range only counted for the melee hit and the controller's decided the attack
+		ClassTuning.MaxHealth = Defaults->MaxHealth_DEPRECATED;
+		ClassTuning.AttackDamage = Defaults->AttackDamage_DEPRECATED;
+
+		Defaults->DeprecatedTuningArchetype = ClassArchetype;
+	}
+
+	return Defaults->DeprecatedTuningArchetype;
+}
+
+void ATDSEnemyCharacter::FillHordeSettings(FTDSHordeSettings& Settings, const UTDSEnemyArchetype* InArchetype) const
+{
+	const FTDSEnemyTuning& EnemyTuning = InArchetype ? InArchetype->Tuning : GetTuning();
+
+	Settings.ProxyMesh = HordeProxyMesh;
+	Settings.ProxyMeshTransform = GetMesh() ? GetMesh()->GetRelativeTransform() : FTransform::Identity;
+	Settings.MaxHealth = EnemyTuning.MaxHealth;
+	Settings.AttackRange = EnemyTuning.AttackRange;
+	Settings.AttackDamage = EnemyTuning.AttackDamage;
+	Settings.ChaseDistance = EnemyTuning.ChaseDistance;
+	Settings.AttackInterval = EnemyTuning.AttackInterval;
+	Settings.WanderRadius = EnemyTuning.WanderRadius;
+	Settings.WanderPauseMin = EnemyTuning.WanderPauseMin;
+	Settings.WanderPauseMax = EnemyTuning.WanderPauseMax;
+	Settings.SlotRadius = EnemyTuning.SlotRadius;
+	Settings.FlowFieldHandoffDistance = EnemyTuning.FlowFieldHandoffDistance;
+	Settings.MoveSpeed = GetCharacterMovement()->MaxWalkSpeed;
+	Settings.HurtSound = HurtSound;
+	Settings.HurtSoundVolume = HurtSoundVolume;
+	Settings.DeathSound = DeathSound;
+	Settings.DeathSoundVolume = DeathSoundVolume;
+}
+
+void ATDSEnemyCharacter::SetAvoidanceMode(ETDSAvoidanceMode NewMode)
+{
+	AvoidanceMode = NewMode;
+
+	GetCharacterMovement()->SetAvoidanceEnabled(AvoidanceMode == ETDSAvoidanceMode::RVO);
+
+	if (UTDSSeparationSubsystem* Separation = GetWorld()->GetSubsystem<UTDSSeparationSubsystem>())
+	{
+		if (AvoidanceMode == ETDSAvoidanceMode::Separation && !bIsDead)
+		{
+			Separation->RegisterAgent(this);
+		}
+		else
+		{
+			Separation->UnregisterAgent(this);
+		}
+	}
+}
+
 void ATDSEnemyCharacter::PerformMeleeHit()
 {
 	// If already dead, do not perform attack
@@ -125,22 +294,26 @@ void ATDSEnemyCharacter::PerformMeleeHit()
 		return;
 	}
 
-	// Get the player pawn to apply damage to
-	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
-	if (!PlayerPawn) return;
+	UTDSSpatialGridSubsystem* SpatialGrid = GetWorld()->GetSubsystem<UTDSSpatialGridSubsystem>();
+	UTDSDamageSubsystem* DamageSubsystem = GetWorld()->GetSubsystem<UTDSDamageSubsystem>();
+	if (!SpatialGrid || !DamageSubsystem) return;
 
-	// Check if player is within attack range
-	const float Dist = FVector::Dist2D(GetActorLocation(), PlayerPawn->GetActorLocation());
-	if (Dist > AttackRange) return;
+	// Find the players within attack range through the spatial grid
+	TArray<AActor*, TInlineAllocator<4>> Targets;
+	const FTDSEnemyTuning& EnemyTuning = GetTuning();
+	SpatialGrid->QueryRadius(GetActorLocation(), EnemyTuning.AttackRange, ETDSGridAgent::Player, Targets);
 
-	// Apply damage to the player
-	UGameplayStatics::ApplyDamage(
-		PlayerPawn,
-		AttackDamage,
-		GetController(),
-		this,
-		UDamageType::StaticClass()
-	);
+	// Queue damage on them, it is applied with the rest of the frame's hits
+	for (AActor* Target : Targets)
+	{
+		DamageSubsystem->QueueDamage(
+			Target,
+			EnemyTuning.AttackDamage,
+			GetController(),
+			this,
+			Target->GetActorLocation()
+		);
+	}
 }
 
 void ATDSEnemyCharacter::HandleDeath()
@@ -152,6 +325,18 @@ void ATDSEnemyCharacter::HandleDeath()
 
 	bIsDead = true;
 
+	// Dead enemies no longer take part in proximity queries
+	if (UTDSSpatialGridSubsystem* SpatialGrid = GetWorld()->GetSubsystem<UTDSSpatialGridSubsystem>())
+	{
+		SpatialGrid->UnregisterAgent(this);
+	}
+
+	// Dead enemies are not steered around the crowd any more
+	if (UTDSSeparationSubsystem* Separation = GetWorld()->GetSubsystem<UTDSSeparationSubsystem>())
+	{
+		Separation->UnregisterAgent(this);
+	}
+
 	// Stop AI logic
 	if (ATDSEnemyAIController* EnemyAI = Cast<ATDSEnemyAIController>(GetController()))
 	{
@@ -190,7 +375,10 @@ void ATDSEnemyCharacter::HandleDeath()
 	// Play death sound if assigned
 	if (DeathSound)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, DeathSound, GetActorLocation(), DeathSoundVolume);
+		if (UTDSAudioEventSubsystem* Audio = GetWorld()->GetSubsystem<UTDSAudioEventSubsystem>())
+		{
+			Audio->PlaySound(ETDSAudioCategory::Death, DeathSound, GetActorLocation(), DeathSoundVolume);
+		}
 	}
 
 	// Play death montage if available
@@ -5,9 +5,14 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Animation/AnimMontage.h"
+#include "TDSEnemyMovementComponent.h"
 #include "TDSEnemyCharacter.generated.h"
 
 class USoundBase;
+class UStaticMesh;
+class UTDSEnemyArchetype;
+struct FTDSHordeSettings;
+struct FTDSEnemyTuning;
 
 // Forward declaration of the delegate
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEnemyDied, AActor*, DeadEnemy);
@@ -18,8 +23,8 @@ class ATDSEnemyCharacter : public ACharacter
 	GENERATED_BODY()
 
 public:
-	// Sets default values for this character's properties
-	ATDSEnemyCharacter();
+	// Sets default values for this character's properties, with the enemy movement component in place of the default one
+	ATDSEnemyCharacter(const FObjectInitializer& ObjectInitializer);
 
 	// Delegate for when the enemy dies
 	UPROPERTY(BlueprintAssignable, Category = "Events")
@@ -45,14 +50,43 @@ public:
 	UFUNCTION()
 	void HandleDeath();
 
+	// Applies damage that has already been summed for this frame by the damage subsystem: one health change, one hurt sound and death at most once
+	void ReceiveResolvedDamage(float Damage);
+
 
 	// Returns the current health value
 	UFUNCTION(BlueprintCallable, Category = "Health")
 	float GetCurrentHealth() const { return CurrentHealth; }
 
-	// Returns the maximum health value
+	// Returns the maximum health value, from our archetype
 	UFUNCTION(BlueprintCallable, Category = "Health")
-	float GetMaxHealth() const { return MaxHealth; }
+	float GetMaxHealth() const;
+
+	// Sets the current health, used to carry damage over when a horde proxy is promoted to this actor
+	void SetCurrentHealth(float NewHealth);
+
+	// The archetype this enemy was spawned as, nullptr means the default tuning
+	const UTDSEnemyArchetype* GetArchetype() const { return Archetype; }
+
+	// Sets the archetype, only before BeginPlay (spawn deferred), since our controller reads the tuning when it possesses us
+	void SetArchetype(UTDSEnemyArchetype* NewArchetype);
+
+	// Tuning shared with every enemy of our archetype, or with every enemy of our class when we have none
+	const FTDSEnemyTuning& GetTuning() const;
+
+	// Archetype enemies of this class use when none is set: the class's Archetype default, or one built once per class
+	// from the deprecated tuning properties on the class and its AI controller class
+	static UTDSEnemyArchetype* GetClassArchetype(TSubclassOf<ATDSEnemyCharacter> EnemyClass);
+
+	// Mesh used to draw this enemy as a horde proxy, horde spawning is skipped for classes without one
+	UStaticMesh* GetHordeProxyMesh() const { return HordeProxyMesh; }
+
+	// Copies the tuning a horde proxy of this class needs, from InArchetype's tuning if given or else from ours
+	void FillHordeSettings(FTDSHordeSettings& Settings, const UTDSEnemyArchetype* InArchetype = nullptr) const;
+
+	// Switches between RVO avoidance and separation steering, used by the avoidance benchmark
+	void SetAvoidanceMode(ETDSAvoidanceMode NewMode);
+	ETDSAvoidanceMode GetAvoidanceMode() const { return AvoidanceMode; }
 
 protected:
 
@@ -74,20 +108,33 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-	// Health properties
-	UPROPERTY(EditDefaultsOnly, Category = "Health")
-	float MaxHealth = 100.f;
+	// Called when the enemy is removed from the world
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+	// Health, MaxHealth comes from our archetype
 	float CurrentHealth;
 
+	// Health, combat and AI tuning shared with every enemy of this kind. Set on the class for enemies placed or spawned
+	// by class, and per spawn by rooms that mix archetypes.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Archetype")
+	TObjectPtr<UTDSEnemyArchetype> Archetype;
 
-	// Distance at which the AI can attack the player
-	UPROPERTY(EditDefaultsOnly, Category = "Combat")
-	float AttackRange = 150.f;
+	// Fallback archetype built from the deprecated tuning, only ever set on the class default object
+	UPROPERTY(Transient)
+	TObjectPtr<UTDSEnemyArchetype> DeprecatedTuningArchetype;
 
-	// Damage dealt per attack
-	UPROPERTY(EditDefaultsOnly, Category = "Combat")
-	float AttackDamage = 10.f;
+	// ---- Deprecated tuning ----
+	// Tuning now lives on UTDSEnemyArchetype. These still load what Blueprint enemy classes set (see [CoreRedirects] in
+	// DefaultEngine.ini) and feed GetClassArchetype. Remove them once every enemy class has an archetype.
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float MaxHealth_DEPRECATED = 100.f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float AttackRange_DEPRECATED = 150.f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the enemy's archetype instead"))
+	float AttackDamage_DEPRECATED = 10.f;
 
 	// Function to handle taking damage
 	UFUNCTION()
@@ -114,10 +161,17 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Audio|Death", meta = (ClampMin = "0.0"))
 	float DeathSoundVolume = 1.0f;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	// Static stand-in for the skeletal mesh, drawn instanced while this enemy runs as a far away horde proxy.
+	// It is placed with the skeletal mesh's relative transform.
+	UPROPERTY(EditDefaultsOnly, Category = "Horde")
+	TObjectPtr<UStaticMesh> HordeProxyMesh;
 
+	// How this enemy class keeps out of other enemies' way: the engine's RVO avoidance, or the cheaper separation steering
+	// computed for every enemy at once from the spatial grid
+	UPROPERTY(EditDefaultsOnly, Category = "Movement|Avoidance")
+	ETDSAvoidanceMode AvoidanceMode = ETDSAvoidanceMode::RVO;
+
+public:	
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSEnemyDecision.h"
+
+namespace
+{
+	// Exact comparison of the bits of two values, so -0 and 0 or two NaNs are told apart
+	template<typename T>
+	bool SameBits(const T& A, const T& B)
+	{
+		return FMemory::Memcmp(&A, &B, sizeof(T)) == 0;
+	}
+}
+
+void FTDSEnemyDecision::Compute(const FTDSEnemyDecisionInput& Input, FTDSEnemyDecisionOutput& Output)
+{
+	Output = FTDSEnemyDecisionOutput();
+
+	const EEnemyState NewState = ComputeTransition(Input);
+	if (NewState != Input.State)
+	{
+		Output.NewState = NewState;
+		Output.bStateChanged = true;
+		return;
+	}
+
+	ComputeBehaviour(Input, Output);
+}
+
+EEnemyState FTDSEnemyDecision::ComputeTransition(const FTDSEnemyDecisionInput& Input)
+{
+	// Without a player there is nothing to react to, and with distance bands the state already changed when the band did
+	if (!Input.bHasPlayer || Input.bStateFromDistanceBands)
+	{
+		return Input.State;
+	}
+
+	// Calculate distance to player
+	const float Dist = FVector::Dist2D(Input.PlayerLocation, Input.PawnLocation);
+
+	return TransitionForBand(Input.State, ComputeDistanceBand(Dist, Input.AttackRange, Input.ChaseDistance));
+}
+
+uint8 FTDSEnemyDecision::ComputeDistanceBand(float Distance, float AttackRange, float ChaseDistance)
+{
+	return static_cast<uint8>((Distance > AttackRange ? 1 : 0) + (Distance > ChaseDistance ? 1 : 0));
+}
+
+EEnemyState FTDSEnemyDecision::TransitionForBand(EEnemyState State, uint8 Band)
+{
+	switch (State)
+	{
+		// In Idle state, if the player comes within chase distance, switch to Chasing
+		case EEnemyState::Idle:
+		{
+			if (Band <= 1)
+			{
+				return EEnemyState::Chasing;
+			}
+			break;
+		}
+		// In Chasing state, if we get within attack range, switch to Attacking. If the player gets too far away, switch back to Idle
+		case EEnemyState::Chasing:
+		{
+			if (Band == 0)
+			{
+				return EEnemyState::Attacking;
+			}
+			else if (Band >= 2)
+			{
+				return EEnemyState::Idle;
+			}
+			break;
+		}
+		// In Attacking state, if the player moves out of attack range but is still within chase distance, switch back to Chasing. If the player moves out of chase distance, switch back to Idle
+		case EEnemyState::Attacking:
+		{
+			if (Band >= 2)
+			{
+				return EEnemyState::Idle;
+			}
+			else if (Band == 1)
+			{
+				return EEnemyState::Chasing;
+			}
+			break;
+		}
+	}
+
+	return State;
+}
+
+void FTDSEnemyDecision::ComputeBehaviour(const FTDSEnemyDecisionInput& Input, FTDSEnemyDecisionOutput& Output)
+{
+	Output.NewState = Input.State;
+	Output.bStateChanged = false;
+	Output.SmoothedSlotTarget = Input.SmoothedSlotTarget;
+
+	switch (Input.State)
+	{
+		case EEnemyState::Idle:
+		{
+			if (Input.bHasWanderTarget)
+			{
+				Output.WanderDist = FVector::Dist2D(Input.WanderTarget, Input.PawnLocation);
+			}
+			break;
+		}
+		case EEnemyState::Chasing:
+		{
+			// Smooth slot targetting so the enemy eases towards its slot instead of snapping to it
+			Output.SmoothedSlotTarget = FMath::VInterpTo(Input.SmoothedSlotTarget, Input.CurrentSlotTarget, Input.DeltaSeconds, Input.SlotSmoothingSpeed);
+			Output.SlotDist = FVector::Dist2D(Output.SmoothedSlotTarget, Input.PawnLocation);
+			break;
+		}
+		default:
+			break;
+	}
+
+	// Chasing and attacking enemies keep turning towards the player
+	if (Input.bHasPlayer && Input.State != EEnemyState::Idle)
+	{
+		FVector ToPlayer = Input.PlayerLocation - Input.PawnLocation;
+		ToPlayer.Z = 0.f;
+
+		// If the player is exactly above or below the enemy there is no direction to face
+		if (!ToPlayer.IsNearlyZero())
+		{
+			Output.NewRotation = FMath::RInterpTo(Input.PawnRotation, ToPlayer.Rotation(), Input.DeltaSeconds, Input.ChaseTurnSpeed);
+			Output.bRotate = true;
+		}
+	}
+
+	// Stuck detection is only relevant while we are trying to move towards a target
+	Output.StuckTime = Input.StuckTime;
+	Output.LastLocation = Input.PawnLocation;
+	if (Input.State == EEnemyState::Idle || Input.bIsAttacking)
+	{
+		Output.StuckTime = 0.f;
+		return;
+	}
+
+	// First update, or no valid last location yet
+	if (Input.LastLocation.IsZero())
+	{
+		return;
+	}
+
+	// Speed of the pawn from the distance travelled since the last update
+	const float Speed = FVector::Dist(Input.PawnLocation, Input.LastLocation) / FMath::Max(Input.DeltaSeconds, 0.001f);
+
+	// Below the speed threshold for long enough, we consider ourselves stuck
+	if (Speed < Input.StuckSpeedThreshold)
+	{
+		Output.StuckTime += Input.DeltaSeconds;
+		if (Output.StuckTime >= Input.StuckTimeToTrigger)
+		{
+			Output.bUnstick = true;
+			Output.StuckTime = 0.f;
+		}
+	}
+	else
+	{
+		Output.StuckTime = 0.f;
+	}
+}
+
+bool FTDSEnemyDecision::Identical(const FTDSEnemyDecisionOutput& A, const FTDSEnemyDecisionOutput& B)
+{
+	return A.NewState == B.NewState
+		&& A.bStateChanged == B.bStateChanged
+		&& A.bRotate == B.bRotate
+		&& A.bUnstick == B.bUnstick
+		&& SameBits(A.NewRotation, B.NewRotation)
+		&& SameBits(A.WanderDist, B.WanderDist)
+		&& SameBits(A.SmoothedSlotTarget, B.SmoothedSlotTarget)
+		&& SameBits(A.SlotDist, B.SlotDist)
+		&& SameBits(A.LastLocation, B.LastLocation)
+		&& SameBits(A.StuckTime, B.StuckTime);
+}
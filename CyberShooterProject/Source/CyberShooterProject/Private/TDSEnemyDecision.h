@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TDSEnemyAIController.h"
+
+// Everything one enemy's decision pass reads, copied out of its controller and pawn on the game thread
+struct FTDSEnemyDecisionInput
+{
+	float DeltaSeconds = 0.f;
+
+	FVector PawnLocation = FVector::ZeroVector;
+	FRotator PawnRotation = FRotator::ZeroRotator;
+
+	// Player location, only meaningful when bHasPlayer is set
+	FVector PlayerLocation = FVector::ZeroVector;
+	bool bHasPlayer = false;
+
+	EEnemyState State = EEnemyState::Idle;
+	bool bIsAttacking = false;
+
+	// Set when the distance band subsystem drives our state changes, the decision pass then leaves the state alone
+	bool bStateFromDistanceBands = false;
+
+	FVector WanderTarget = FVector::ZeroVector;
+	bool bHasWanderTarget = false;
+
+	FVector CurrentSlotTarget = FVector::ZeroVector;
+	FVector SmoothedSlotTarget = FVector::ZeroVector;
+
+	// Stuck detection state
+	FVector LastLocation = FVector::ZeroVector;
+	float StuckTime = 0.f;
+
+	// Tuning
+	float ChaseDistance = 0.f;
+	float AttackRange = 0.f;
+	float ChaseTurnSpeed = 0.f;
+	float SlotSmoothingSpeed = 0.f;
+	float StuckSpeedThreshold = 0.f;
+	float StuckTimeToTrigger = 0.f;
+};
+
+// What the decision pass wants done, written back to the controller and turned into move and montage commands on the game thread
+struct FTDSEnemyDecisionOutput
+{
+	// State the FSM moves to this update. When it differs from the input state, the rest of the output is not filled in:
+	// entering a state can hand out a new slot target, so the controller decides again after SetState.
+	EEnemyState NewState = EEnemyState::Idle;
+	bool bStateChanged = false;
+
+	// Rotation that turns the pawn towards the player, when bRotate is set
+	FRotator NewRotation = FRotator::ZeroRotator;
+	bool bRotate = false;
+
+	// Distance to the wander target while idle
+	float WanderDist = 0.f;
+
+	// Slot target after smoothing, and the distance to it, while chasing
+	FVector SmoothedSlotTarget = FVector::ZeroVector;
+	float SlotDist = 0.f;
+
+	// Stuck detection state after this update, and whether the enemy should sidestep out of the crowd
+	FVector LastLocation = FVector::ZeroVector;
+	float StuckTime = 0.f;
+	bool bUnstick = false;
+};
+
+// The enemy FSM's per update math: state transitions, slot smoothing, facing and stuck detection.
+// It only reads its input, so the enemy manager can run it for every enemy across worker threads.
+struct FTDSEnemyDecision
+{
+	// Runs the state transition and, when the state does not change, the behaviour of the current state
+	static void Compute(const FTDSEnemyDecisionInput& Input, FTDSEnemyDecisionOutput& Output);
+
+	// State the FSM moves to from the distance to the player, or the current state when distance band events drive it
+	static EEnemyState ComputeTransition(const FTDSEnemyDecisionInput& Input);
+
+	// Distance band of the 2D distance to the player: 0 within attack range, 1 within chase distance, 2 further away.
+	// The same bands the distance band subsystem reports. It compares squared distances instead, so right on a radius the
+	// two can disagree by a rounding step, this one keeps the FSM's original distance compares.
+	static uint8 ComputeDistanceBand(float Distance, float AttackRange, float ChaseDistance);
+
+	// State the FSM moves to from State when the player is in Band
+	static EEnemyState TransitionForBand(EEnemyState State, uint8 Band);
+
+	// Behaviour of Input.State, leaves NewState at Input.State
+	static void ComputeBehaviour(const FTDSEnemyDecisionInput& Input, FTDSEnemyDecisionOutput& Output);
+
+	// Whether two outputs are the same down to the bit, used to check the parallel pass against the serial one
+	static bool Identical(const FTDSEnemyDecisionOutput& A, const FTDSEnemyDecisionOutput& B);
+};
@@ -0,0 +1,490 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSEnemyManager.h"
+#include "CyberShooterProject.h"
+#include "TDSEnemyAIController.h"
+#include "TDSEnemyCharacter.h"
+#include "TDSBenchmark.h"
+#include "TDSWeakArray.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "EngineUtils.h"
+#include "NavigationSystem.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy Manager Tick"), STAT_TDSEnemyManagerTick, STATGROUP_CyberShooter);
+DECLARE_CYCLE_STAT(TEXT("Enemy Manager Gather"), STAT_TDSEnemyManagerGather, STATGROUP_CyberShooter);
+DECLARE_CYCLE_STAT(TEXT("Enemy Manager Compute"), STAT_TDSEnemyManagerCompute, STATGROUP_CyberShooter);
+DECLARE_CYCLE_STAT(TEXT("Enemy Manager Apply"), STAT_TDSEnemyManagerApply, STATGROUP_CyberShooter);
+DECLARE_CYCLE_STAT(TEXT("AI Timer Wheel Advance"), STAT_TDSTimerWheelAdvance, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("AI Timers Active"), STAT_TDSTimersActive, STATGROUP_CyberShooter);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("AI Timers Armed/s"), STAT_TDSTimersArmedPerSecond, STATGROUP_CyberShooter);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("AI Timers Cancelled/s"), STAT_TDSTimersCancelledPerSecond, STATGROUP_CyberShooter);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("AI Timers Fired/s"), STAT_TDSTimersFiredPerSecond, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Enemy Manager Records"), STAT_TDSEnemyManagerRecords, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy Manager AI Updates"), STAT_TDSEnemyManagerUpdates, STATGROUP_CyberShooter);
+
+static TAutoConsoleVariable<bool> CVarTDSBatchedTick(
+	TEXT("tds.AI.BatchedTick"),
+	true,
+	TEXT("Run enemy AI from the enemy manager's single tick function. Read when an enemy is possessed, so change it before spawning."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<bool> CVarTDSParallelDecisions(
+	TEXT("tds.AI.ParallelDecisions"),
+	true,
+	TEXT("Run the compute stage of the batched enemy AI across worker threads with ParallelFor instead of on the game thread."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTDSParallelDecisionsMinBatch(
+	TEXT("tds.AI.ParallelDecisionsMinBatch"),
+	32,
+	TEXT("Fewest enemies handed to one worker by the parallel compute stage, smaller frames stay on the game thread."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<bool> CVarTDSVerifyParallelDecisions(
+	TEXT("tds.AI.VerifyParallelDecisions"),
+	false,
+	TEXT("Also run the compute stage serially every frame and log any enemy whose parallel result differs in any bit."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorldAndArgs GTDSDecisionChunkBenchmarkCommand(
+	TEXT("tds.AI.DecisionChunkBenchmark"),
+	TEXT("Times the enemy decision compute stage split into 1 to 16 chunks over copies of the last frame's enemies and checks the results match the serial pass bit for bit. ")
+	TEXT("Optional arguments: number of agents (default 10000), iterations (default 50)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const UTDSEnemyManager* EnemyManager = World ? World->GetSubsystem<UTDSEnemyManager>() : nullptr)
+		{
+			const int32 NumAgents = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000;
+			const int32 Iterations = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 50;
+			EnemyManager->RunDecisionChunkBenchmark(FMath::Max(NumAgents, 1), FMath::Max(Iterations, 1));
+		}
+	}));
+
+namespace
+{
+	// Runs the compute stage over every input split into NumChunks contiguous ranges, one ParallelFor task each.
+	// One chunk runs inline on the calling thread. How many chunks run at once is up to the task graph's worker threads.
+	void ComputeDecisionsChunked(TConstArrayView<FTDSEnemyDecisionInput> Inputs, TArrayView<FTDSEnemyDecisionOutput> Outputs, int32 NumChunks)
+	{
+		const int32 Num = Inputs.Num();
+		const int32 ChunkSize = FMath::DivideAndRoundUp(Num, FMath::Max(NumChunks, 1));
+
+		ParallelFor(NumChunks, [Inputs, Outputs, Num, ChunkSize](int32 Chunk)
+		{
+			const int32 End = FMath::Min((Chunk + 1) * ChunkSize, Num);
+			for (int32 Index = Chunk * ChunkSize; Index < End; ++Index)
+			{
+				FTDSEnemyDecision::Compute(Inputs[Index], Outputs[Index]);
+			}
+		}, NumChunks <= 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GTDSSpawnBenchmarkEnemiesCommand(
+	TEXT("tds.AI.SpawnBenchmarkEnemies"),
+	TEXT("Spawns enemies on random reachable points around the player, copying the class of an enemy already in the room. ")
+	TEXT("Optional argument: number of enemies (default 100)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		TArray<ATDSEnemyCharacter*> Spawned;
+		UTDSEnemyManager::SpawnBenchmarkEnemies(World, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100, Spawned);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GTDSTickBenchmarkCommand(
+	TEXT("tds.AI.TickBenchmark"),
+	TEXT("Spawns a crowd with enemy AI on the manager's batched tick or on per actor ticks, logs frame and game thread time over a few seconds, ")
+	TEXT("then removes the crowd. Run once per mode with -trace=cpu, the window is bookmarked in Unreal Insights. ")
+	TEXT("Arguments: batched or actor (default batched), number of enemies (default 100), seconds (default 10)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World)
+		{
+			return;
+		}
+
+		const bool bBatched = Args.Num() == 0 || !Args[0].Equals(TEXT("actor"), ESearchCase::IgnoreCase);
+		const int32 NumEnemies = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 100;
+		const float Seconds = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 10.f;
+		const TCHAR* ModeName = bBatched ? TEXT("batched") : TEXT("actor");
+
+		// The setting is read when an enemy is possessed, so it has to be set before the crowd spawns
+		CVarTDSBatchedTick->Set(bBatched, ECVF_SetByConsole);
+
+		TArray<ATDSEnemyCharacter*> Spawned;
+		UTDSEnemyManager::SpawnBenchmarkEnemies(World, NumEnemies, Spawned);
+		if (Spawned.Num() == 0)
+		{
+			return;
+		}
+
+		TArray<TWeakObjectPtr<ATDSEnemyCharacter>> Crowd(Spawned);
+		const int32 NumSpawned = Spawned.Num();
+
+		UE_LOG(LogTemp, Log, TEXT("tds.AI.TickBenchmark: %d enemies on %s ticks, measuring for %.1f s"), NumSpawned, ModeName, Seconds);
+		TRACE_BOOKMARK(TEXT("tds.AI.TickBenchmark %s start"), ModeName);
+
+		enum { SampleGameThreadMs };
+		FTDSFrameBenchmark::Run(World, Seconds,
+			[](FTDSFrameBenchmark& Benchmark)
+			{
+				Benchmark.AddSample(SampleGameThreadMs, FPlatformTime::ToMilliseconds(GGameThreadTime));
+			},
+			[Crowd, NumSpawned, ModeName](const FTDSFrameBenchmark& Benchmark)
+			{
+				TRACE_BOOKMARK(TEXT("tds.AI.TickBenchmark %s end"), ModeName);
+				UE_LOG(LogTemp, Log, TEXT("tds.AI.TickBenchmark: %s ticks, %d enemies, %s | game thread %.2f ms avg"),
+					ModeName, NumSpawned, *Benchmark.GetFrameSummary(), Benchmark.GetAverage(SampleGameThreadMs));
+
+				for (const TWeakObjectPtr<ATDSEnemyCharacter>& Enemy : Crowd)
+				{
+					if (Enemy.IsValid())
+					{
+						Enemy->Destroy();
+					}
+				}
+			});
+	}));
+
+void FTDSEnemyManagerTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Manager && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Manager->TickEnemies(DeltaTime);
+	}
+}
+
+FString FTDSEnemyManagerTickFunction::DiagnosticMessage()
+{
+	return TEXT("UTDSEnemyManager::TickEnemies");
+}
+
+FName FTDSEnemyManagerTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return FName(TEXT("TDSEnemyManager"));
+}
+
+bool UTDSEnemyManager::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSEnemyManager::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Same group the controllers' own ticks ran in, so the FSM still runs before movement
+	TickFunction.Manager = this;
+	TickFunction.TickGroup = TG_PrePhysics;
+	TickFunction.bCanEverTick = true;
+	TickFunction.bStartWithTickEnabled = true;
+	TickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void UTDSEnemyManager::Deinitialize()
+{
+	if (TickFunction.IsTickFunctionRegistered())
+	{
+		TickFunction.UnRegisterTickFunction();
+	}
+	TickFunction.Manager = nullptr;
+
+	TimerWheel.Reset();
+
+	Records.Empty();
+	DecisionControllers.Empty();
+	DecisionInputs.Empty();
+	DecisionOutputs.Empty();
+	VerifyOutputs.Empty();
+	SET_DWORD_STAT(STAT_TDSEnemyManagerRecords, 0);
+	SET_DWORD_STAT(STAT_TDSTimersActive, 0);
+
+	Super::Deinitialize();
+}
+
+bool UTDSEnemyManager::RegisterController(ATDSEnemyAIController* Controller)
+{
+	if (!Controller || !CVarTDSBatchedTick.GetValueOnGameThread())
+	{
+		return false;
+	}
+
+	const bool bAlreadyRegistered = Records.ContainsByPredicate([Controller](const FTDSEnemyRecord& Record)
+	{
+		return Record.Controller == Controller;
+	});
+
+	if (!bAlreadyRegistered)
+	{
+		FTDSEnemyRecord& Record = Records.AddDefaulted_GetRef();
+		Record.Controller = Controller;
+	}
+
+	Controller->SetActorTickEnabled(false);
+	return true;
+}
+
+void UTDSEnemyManager::UnregisterController(ATDSEnemyAIController* Controller)
+{
+	const int32 Index = Records.IndexOfByPredicate([Controller](const FTDSEnemyRecord& Record)
+	{
+		return Record.Controller == Controller;
+	});
+
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	Records.RemoveAtSwap(Index, EAllowShrinking::No);
+
+	if (Controller)
+	{
+		Controller->SetActorTickEnabled(true);
+	}
+}
+
+void UTDSEnemyManager::SetTickInterval(const ATDSEnemyAIController* Controller, float TickInterval)
+{
+	for (FTDSEnemyRecord& Record : Records)
+	{
+		if (Record.Controller == Controller)
+		{
+			// Start a slower enemy at a random point of its interval, so a whole room dropping a bucket does not update on the same frame
+			if (TickInterval > Record.TickInterval)
+			{
+				Record.TimeUntilTick = FMath::FRandRange(0.f, TickInterval);
+			}
+			else
+			{
+				Record.TimeUntilTick = FMath::Min(Record.TimeUntilTick, TickInterval);
+			}
+
+			Record.TickInterval = TickInterval;
+			return;
+		}
+	}
+}
+
+void UTDSEnemyManager::TickEnemies(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TDSEnemyManagerTick);
+	TRACE_CPUPROFILER_EVENT_SCOPE(TDSEnemyManager_TickEnemies);
+
+	// Fire the AI timers that came due since last frame before anyone decides anything, as the world timer manager did
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TDSTimerWheelAdvance);
+		TimerWheel.Advance(DeltaTime);
+	}
+
+	// Turn the wheel's counters into per second rates once a second
+	TimerStatsTime += DeltaTime;
+	if (TimerStatsTime >= 1.f)
+	{
+		SET_FLOAT_STAT(STAT_TDSTimersArmedPerSecond, TimerWheel.NumArmed / TimerStatsTime);
+		SET_FLOAT_STAT(STAT_TDSTimersCancelledPerSecond, TimerWheel.NumCancelled / TimerStatsTime);
+		SET_FLOAT_STAT(STAT_TDSTimersFiredPerSecond, TimerWheel.NumFired / TimerStatsTime);
+		TimerWheel.ResetCounters();
+		TimerStatsTime = 0.f;
+	}
+	SET_DWORD_STAT(STAT_TDSTimersActive, TimerWheel.GetNumActive());
+
+	DecisionControllers.Reset();
+	DecisionInputs.Reset();
+
+	// Gather: pick the enemies due this frame and copy what their decisions read into flat arrays
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TDSEnemyManagerGather);
+		TRACE_CPUPROFILER_EVENT_SCOPE(TDSEnemyManager_Gather);
+
+		// A controller destroyed without reaching UnregisterController leaves a record behind, forget those before gathering
+		FTDSWeakArray::RemoveStaleSwap(
+			Records.Num(),
+			[this](int32 Index) { return !Records[Index].Controller.IsValid(); },
+			[this](int32 Index) { Records.RemoveAtSwap(Index, EAllowShrinking::No); });
+
+		for (FTDSEnemyRecord& Record : Records)
+		{
+			ATDSEnemyAIController* Controller = Record.Controller.Get();
+
+			Record.PendingDeltaTime += DeltaTime;
+			Record.TimeUntilTick -= DeltaTime;
+			if (Record.TimeUntilTick > 0.f)
+			{
+				continue;
+			}
+
+			// Like a skipped actor tick, the next update gets all the time that passed
+			const float AIDeltaTime = Record.PendingDeltaTime;
+			Record.PendingDeltaTime = 0.f;
+			Record.TimeUntilTick = FMath::Max(Record.TimeUntilTick + Record.TickInterval, 0.f);
+
+			FTDSEnemyDecisionInput Input;
+			if (Controller->GatherBatchedDecision(AIDeltaTime, Input))
+			{
+				DecisionControllers.Add(Controller);
+				DecisionInputs.Add(Input);
+			}
+		}
+	}
+
+	const int32 NumUpdates = DecisionInputs.Num();
+	DecisionOutputs.SetNum(NumUpdates, EAllowShrinking::No);
+
+	// Compute: pure math over the flat arrays, each enemy only writes its own output
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TDSEnemyManagerCompute);
+		TRACE_CPUPROFILER_EVENT_SCOPE(TDSEnemyManager_Compute);
+
+		const bool bParallel = CVarTDSParallelDecisions.GetValueOnGameThread();
+		const int32 MinBatch = FMath::Max(CVarTDSParallelDecisionsMinBatch.GetValueOnGameThread(), 1);
+
+		ComputeDecisions(DecisionInputs, DecisionOutputs, bParallel, MinBatch);
+
+		if (bParallel && CVarTDSVerifyParallelDecisions.GetValueOnGameThread())
+		{
+			VerifyOutputs.SetNum(NumUpdates, EAllowShrinking::No);
+			for (int32 Index = 0; Index < NumUpdates; ++Index)
+			{
+				FTDSEnemyDecision::Compute(DecisionInputs[Index], VerifyOutputs[Index]);
+				if (!FTDSEnemyDecision::Identical(DecisionOutputs[Index], VerifyOutputs[Index]))
+				{
+					UE_LOG(LogTemp, Warning, TEXT("UTDSEnemyManager: parallel decision for %s differs from the serial one"), *GetNameSafe(DecisionControllers[Index].Get()));
+				}
+			}
+		}
+	}
+
+	// Apply: write the results back and issue the commands, in the order the enemies were gathered
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TDSEnemyManagerApply);
+		TRACE_CPUPROFILER_EVENT_SCOPE(TDSEnemyManager_Apply);
+
+		for (int32 Index = 0; Index < NumUpdates; ++Index)
+		{
+			if (ATDSEnemyAIController* Controller = DecisionControllers[Index].Get())
+			{
+				Controller->ApplyDecision(DecisionInputs[Index], DecisionOutputs[Index]);
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_TDSEnemyManagerRecords, Records.Num());
+	INC_DWORD_STAT_BY(STAT_TDSEnemyManagerUpdates, NumUpdates);
+}
+
+int32 UTDSEnemyManager::SpawnBenchmarkEnemies(UWorld* World, int32 NumEnemies, TArray<ATDSEnemyCharacter*>& OutEnemies)
+{
+	const APawn* PlayerPawn = World ? UGameplayStatics::GetPlayerPawn(World, 0) : nullptr;
+	UNavigationSystemV1* NavSys = World ? FNavigationSystem::GetCurrent<UNavigationSystemV1>(World) : nullptr;
+	if (!PlayerPawn || !NavSys)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("tds.AI.SpawnBenchmarkEnemies: needs a player and a navmesh"));
+		return 0;
+	}
+
+	TSubclassOf<ATDSEnemyCharacter> EnemyClass = ATDSEnemyCharacter::StaticClass();
+	for (TActorIterator<ATDSEnemyCharacter> It(World); It; ++It)
+	{
+		EnemyClass = It->GetClass();
+		break;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	int32 NumSpawned = 0;
+	for (int32 Index = 0; Index < NumEnemies; ++Index)
+	{
+		FNavLocation SpawnPoint;
+		if (NavSys->GetRandomReachablePointInRadius(PlayerPawn->GetActorLocation(), 2500.f, SpawnPoint))
+		{
+			const FVector SpawnLocation = SpawnPoint.Location + FVector(0.f, 0.f, 100.f);
+			if (ATDSEnemyCharacter* Enemy = World->SpawnActor<ATDSEnemyCharacter>(EnemyClass, FTransform(SpawnLocation), SpawnParams))
+			{
+				OutEnemies.Add(Enemy);
+				NumSpawned++;
+			}
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("tds.AI.SpawnBenchmarkEnemies: spawned %d %s"), NumSpawned, *GetNameSafe(EnemyClass));
+	return NumSpawned;
+}
+
+void UTDSEnemyManager::ComputeDecisions(TConstArrayView<FTDSEnemyDecisionInput> Inputs, TArrayView<FTDSEnemyDecisionOutput> Outputs, bool bParallel, int32 MinBatch)
+{
+	check(Inputs.Num() == Outputs.Num());
+
+	ParallelFor(TEXT("TDSEnemyManager.Compute"), Inputs.Num(), MinBatch, [Inputs, Outputs](int32 Index)
+	{
+		FTDSEnemyDecision::Compute(Inputs[Index], Outputs[Index]);
+	}, bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+}
+
+void UTDSEnemyManager::RunDecisionChunkBenchmark(int32 NumAgents, int32 Iterations) const
+{
+	if (DecisionInputs.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("tds.AI.DecisionChunkBenchmark: no enemies were updated last frame, spawn some first (tds.AI.SpawnBenchmarkEnemies)"));
+		return;
+	}
+
+	// Copies of last frame's enemies, so the numbers come from real positions and states
+	TArray<FTDSEnemyDecisionInput> Inputs;
+	Inputs.SetNumUninitialized(NumAgents);
+	for (int32 Index = 0; Index < NumAgents; ++Index)
+	{
+		Inputs[Index] = DecisionInputs[Index % DecisionInputs.Num()];
+	}
+
+	TArray<FTDSEnemyDecisionOutput> SerialOutputs;
+	SerialOutputs.SetNum(NumAgents);
+	ComputeDecisionsChunked(Inputs, SerialOutputs, 1);
+
+	// The calling thread works on chunks too, so this is the most that can run at once
+	const int32 NumThreads = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+
+	UE_LOG(LogTemp, Log, TEXT("tds.AI.DecisionChunkBenchmark: %d agents, %d iterations, split into 1 to 16 chunks over %d task graph worker threads"),
+		NumAgents, Iterations, NumThreads - 1);
+
+	TArray<FTDSEnemyDecisionOutput> Outputs;
+	Outputs.SetNum(NumAgents);
+
+	double SerialMs = 0.0;
+	for (int32 NumChunks = 1; NumChunks <= 16; NumChunks *= 2)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			ComputeDecisionsChunked(Inputs, Outputs, NumChunks);
+		}
+		const double Ms = (FPlatformTime::Seconds() - StartTime) * 1000.0 / Iterations;
+
+		if (NumChunks == 1)
+		{
+			SerialMs = Ms;
+		}
+
+		int32 NumMismatches = 0;
+		for (int32 Index = 0; Index < NumAgents; ++Index)
+		{
+			if (!FTDSEnemyDecision::Identical(Outputs[Index], SerialOutputs[Index]))
+			{
+				NumMismatches++;
+			}
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("  %2d chunks (at most %2d at once): %.3f ms (%.2fx), %s"),
+			NumChunks, FMath::Min(NumChunks, NumThreads), Ms, Ms > 0.0 ? SerialMs / Ms : 0.0,
+			NumMismatches == 0 ? TEXT("bit identical to serial") : *FString::Printf(TEXT("%d MISMATCHES"), NumMismatches));
+	}
+}
@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSEnemyDecision.h"
+#include "TDSTimerWheel.h"
+#include "TDSEnemyManager.generated.h"
+
+class ATDSEnemyAIController;
+class ATDSEnemyCharacter;
+class UTDSEnemyManager;
+
+// The one tick function that runs every managed enemy's AI
+USTRUCT()
+struct FTDSEnemyManagerTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UTDSEnemyManager* Manager = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	virtual FName DiagnosticContext(bool bDetailed) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FTDSEnemyManagerTickFunction> : public TStructOpsTypeTraitsBase2<FTDSEnemyManagerTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+// One managed enemy, kept packed so the AI pass walks a flat array
+struct FTDSEnemyRecord
+{
+	TWeakObjectPtr<ATDSEnemyAIController> Controller;
+
+	// Seconds between AI updates, zero for every frame. Set by the AI LOD subsystem.
+	float TickInterval = 0.f;
+
+	// Time until the next AI update
+	float TimeUntilTick = 0.f;
+
+	// Time since the last AI update, handed to it as its delta like a skipped actor tick would be
+	float PendingDeltaTime = 0.f;
+};
+
+// This subsystem runs the AI of every enemy from a single tick function, instead of one actor tick per enemy controller
+// and pawn. Controllers register when they possess their pawn, which turns their own actor tick off, and the manager then
+// calls their FSM in sequence from a packed array every frame in TG_PrePhysics, the group their own ticks used to run in.
+// Per enemy tick intervals from the AI LOD subsystem are honoured by the manager instead of the tick task manager.
+// Each frame runs in three stages: gather copies the due enemies' positions and state into flat arrays on the game thread,
+// compute runs FTDSEnemyDecision over them with ParallelFor (tds.AI.ParallelDecisions), and apply writes the results back
+// and issues the move, rotation and montage commands on the game thread, in the same order the serial update used.
+// The movement component keeps its own tick, it has to run in the physics-related part of the frame.
+// tds.AI.BatchedTick 0 leaves newly possessed controllers on their own actor ticks, for comparisons.
+// The manager also owns the timer wheel the enemies' wander and attack timers run on, advanced at the start of every
+// manager tick, so re-arming them does not churn the world timer manager's heap.
+UCLASS()
+class UTDSEnemyManager : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only manage enemies in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// Starts running a controller's AI from the batched tick and disables its own tick.
+	// Returns false when batching is off, the controller then keeps ticking itself.
+	bool RegisterController(ATDSEnemyAIController* Controller);
+
+	// Stops running a controller's AI and gives it its own tick back
+	void UnregisterController(ATDSEnemyAIController* Controller);
+
+	// Changes how often a managed controller's AI runs
+	void SetTickInterval(const ATDSEnemyAIController* Controller, float TickInterval);
+
+	// Runs the AI of every managed enemy that is due, called by the tick function
+	void TickEnemies(float DeltaTime);
+
+	// Number of managed enemies
+	int32 GetNumEnemies() const { return Records.Num(); }
+
+	// Timers for enemy AI, see FTDSTimerWheel
+	FTDSTimerWheel& GetTimerWheel() { return TimerWheel; }
+
+	// Spawns enemies on random reachable points around the player for the benchmarks, copying the class of an enemy
+	// already in the room. Appends them to OutEnemies and returns how many were spawned.
+	static int32 SpawnBenchmarkEnemies(UWorld* World, int32 NumEnemies, TArray<ATDSEnemyCharacter*>& OutEnemies);
+
+	// The compute stage of the decision pass: FTDSEnemyDecision::Compute for every input, spread over worker threads with
+	// ParallelFor in batches of at least MinBatch enemies, or run in order on the calling thread when bParallel is off
+	static void ComputeDecisions(TConstArrayView<FTDSEnemyDecisionInput> Inputs, TArrayView<FTDSEnemyDecisionOutput> Outputs, bool bParallel, int32 MinBatch);
+
+	// Times the compute stage over copies of the last frame's inputs split into 1 to 16 chunks, logs the scaling and checks
+	// every chunk count produces bit for bit the same output as the serial pass. The task graph's thread count is fixed at
+	// startup, so this varies the number of chunks the work is split into, not the number of threads.
+	void RunDecisionChunkBenchmark(int32 NumAgents, int32 Iterations) const;
+
+private:
+	FTDSEnemyManagerTickFunction TickFunction;
+
+	// Managed enemies
+	TArray<FTDSEnemyRecord> Records;
+
+	// Decision pass scratch, reused every frame. The enemies due this frame and their inputs and outputs at matching indices.
+	TArray<TWeakObjectPtr<ATDSEnemyAIController>> DecisionControllers;
+	TArray<FTDSEnemyDecisionInput> DecisionInputs;
+	TArray<FTDSEnemyDecisionOutput> DecisionOutputs;
+
+	// Serial outputs the parallel ones are checked against with tds.AI.VerifyParallelDecisions
+	TArray<FTDSEnemyDecisionOutput> VerifyOutputs;
+
+	FTDSTimerWheel TimerWheel;
+
+	// Time since the timer rates were last turned into per second stats
+	float TimerStatsTime = 0.f;
+};
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSEnemyMeshComponent.h"
+#include "CyberShooterProject.h"
+#include "HAL/PlatformTime.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy Mesh Tick"), STAT_TDSEnemyMeshTick, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy Mesh Ticks"), STAT_TDSEnemyMeshTicks, STATGROUP_CyberShooter);
+
+uint64 UTDSEnemyMeshComponent::TickCycles = 0;
+int32 UTDSEnemyMeshComponent::NumTicks = 0;
+
+UTDSEnemyMeshComponent::UTDSEnemyMeshComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Join the allocator on BeginPlay, but leave significance to the animation budget subsystem
+	SetAutoRegisterWithBudgetAllocator(true);
+	SetAutoCalculateSignificance(false);
+}
+
+void UTDSEnemyMeshComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TDSEnemyMeshTick);
+	INC_DWORD_STAT(STAT_TDSEnemyMeshTicks);
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	TickCycles += FPlatformTime::Cycles64() - StartCycles;
+	NumTicks++;
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "TDSEnemyMeshComponent.generated.h"
+
+// Skeletal mesh for enemies, ticked by the engine's animation budget allocator.
+// The allocator spends a fixed number of milliseconds per frame on enemy animation and lowers the tick rate of the least
+// significant meshes, interpolating between their updates, to stay inside it. Significance comes from the animation budget
+// subsystem every frame instead of the allocator's own distance check, see UTDSAnimationBudgetSubsystem.
+// The component also times its own ticks for tds.Anim.Benchmark.
+UCLASS()
+class UTDSEnemyMeshComponent : public USkeletalMeshComponentBudgeted
+{
+	GENERATED_BODY()
+
+public:
+	UTDSEnemyMeshComponent(const FObjectInitializer& ObjectInitializer);
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Time spent in enemy mesh ticks and how many there were since the last reset, read by tds.Anim.Benchmark
+	static uint64 GetTickCycles() { return TickCycles; }
+	static int32 GetNumTicks() { return NumTicks; }
+	static void ResetTickCounters() { TickCycles = 0; NumTicks = 0; }
+
+private:
+	static uint64 TickCycles;
+	static int32 NumTicks;
+};
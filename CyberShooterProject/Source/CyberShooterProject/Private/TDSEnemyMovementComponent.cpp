@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSEnemyMovementComponent.h"
+#include "CyberShooterProject.h"
+#include "TDSEnemyCharacter.h"
+#include "TDSBenchmark.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy Movement Tick"), STAT_TDSEnemyMovementTick, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy Movement Wall Checks"), STAT_TDSEnemyMovementWallChecks, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy Movement Sweeping Moves"), STAT_TDSEnemyMovementSweeping, STATGROUP_CyberShooter);
+
+namespace
+{
+	// Time spent in enemy movement ticks and how many there were since tds.Movement.Benchmark last sampled them
+	uint64 GTDSEnemyMovementCycles = 0;
+	int32 GTDSEnemyMovementTicks = 0;
+
+	// What tds.Movement.Benchmark samples every frame
+	enum ETDSMovementBenchmarkSample
+	{
+		SampleMovementMs,
+		SampleMovementTicks
+	};
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GTDSMovementBenchmarkCommand(
+	TEXT("tds.Movement.Benchmark"),
+	TEXT("Switches every enemy to NavWalking or walking physics and logs the movement component cost per enemy over a few seconds. ")
+	TEXT("Spawn a crowd first (tds.AI.SpawnBenchmarkEnemies). Arguments: navwalking or walking (default navwalking), seconds (default 5)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World)
+		{
+			return;
+		}
+
+		const bool bNavWalking = Args.Num() == 0 || !Args[0].Equals(TEXT("walking"), ESearchCase::IgnoreCase);
+		const float Seconds = Args.Num() > 1 ? FMath::Max(FCString::Atof(*Args[1]), 0.1f) : 5.f;
+
+		int32 NumEnemies = 0;
+		for (TActorIterator<ATDSEnemyCharacter> It(World); It; ++It)
+		{
+			if (UTDSEnemyMovementComponent* MoveComp = Cast<UTDSEnemyMovementComponent>(It->GetCharacterMovement()))
+			{
+				MoveComp->SetNavWalkingEnabled(bNavWalking);
+				NumEnemies++;
+			}
+		}
+
+		GTDSEnemyMovementCycles = 0;
+		GTDSEnemyMovementTicks = 0;
+
+		UE_LOG(LogTemp, Log, TEXT("tds.Movement.Benchmark: %d enemies switched to %s, measuring for %.1f s"),
+			NumEnemies, bNavWalking ? TEXT("NavWalking") : TEXT("walking"), Seconds);
+
+		FTDSFrameBenchmark::Run(World, Seconds,
+			[](FTDSFrameBenchmark& Benchmark)
+			{
+				Benchmark.AddSample(SampleMovementMs, FPlatformTime::ToMilliseconds64(GTDSEnemyMovementCycles));
+				Benchmark.AddSample(SampleMovementTicks, GTDSEnemyMovementTicks);
+				GTDSEnemyMovementCycles = 0;
+				GTDSEnemyMovementTicks = 0;
+			},
+			[bNavWalking, NumEnemies](const FTDSFrameBenchmark& Benchmark)
+			{
+				const double MovementMs = Benchmark.GetAverage(SampleMovementMs);
+				const double MovementTicks = Benchmark.GetAverage(SampleMovementTicks);
+
+				UE_LOG(LogTemp, Log, TEXT("tds.Movement.Benchmark: %s, %d enemies, %s | %.3f ms movement per frame | %.2f us per enemy tick"),
+					bNavWalking ? TEXT("NavWalking") : TEXT("walking"),
+					NumEnemies,
+					*Benchmark.GetFrameSummary(),
+					MovementMs,
+					MovementTicks > 0.0 ? MovementMs * 1000.0 / MovementTicks : 0.0);
+			});
+	}));
+
+UTDSEnemyMovementComponent::UTDSEnemyMovementComponent()
+{
+	// Snap to the navmesh with a projection that is only refreshed every so often, instead of sweeping for the floor every move
+	bProjectNavMeshWalking = true;
+	NavMeshProjectionInterval = 0.1f;
+	NavMeshProjectionInterpSpeed = 12.f;
+
+	// Only sweep near walls, see UpdateWallSweep
+	bSweepWhileNavWalking = false;
+}
+
+void UTDSEnemyMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	SetNavWalkingEnabled(bUseNavWalking);
+}
+
+void UTDSEnemyMovementComponent::SetNavWalkingEnabled(bool bEnable)
+{
+	bUseNavWalking = bEnable;
+	DefaultLandMovementMode = bUseNavWalking ? MOVE_NavWalking : MOVE_Walking;
+
+	// Switch now if on the ground, otherwise land in the new mode
+	if (IsMovingOnGround())
+	{
+		SetMovementMode(DefaultLandMovementMode);
+	}
+	else
+	{
+		SetGroundMovementMode(DefaultLandMovementMode);
+	}
+
+	bSweepWhileNavWalking = false;
+	TimeUntilWallCheck = 0.f;
+}
+
+void UTDSEnemyMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TDSEnemyMovementTick);
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	GTDSEnemyMovementCycles += FPlatformTime::Cycles64() - StartCycles;
+	GTDSEnemyMovementTicks++;
+}
+
+void UTDSEnemyMovementComponent::PhysNavWalking(float deltaTime, int32 Iterations)
+{
+	UpdateWallSweep(deltaTime);
+
+	Super::PhysNavWalking(deltaTime, Iterations);
+
+	if (bSweepWhileNavWalking)
+	{
+		INC_DWORD_STAT(STAT_TDSEnemyMovementSweeping);
+	}
+}
+
+void UTDSEnemyMovementComponent::UpdateWallSweep(float DeltaTime)
+{
+	TimeUntilWallCheck -= DeltaTime;
+	if (TimeUntilWallCheck > 0.f)
+	{
+		return;
+	}
+	TimeUntilWallCheck = WallCheckInterval;
+
+	INC_DWORD_STAT(STAT_TDSEnemyMovementWallChecks);
+
+#if WITH_RECAST
+	// Also count the ground we may cover before the next check
+	const float CheckDistance = WallSweepDistance + Velocity.Size2D() * WallCheckInterval;
+
+	if (const ARecastNavMesh* NavMesh = Cast<ARecastNavMesh>(GetNavData()))
+	{
+		const float WallDistance = NavMesh->FindDistanceToWall(GetActorFeetLocation(), nullptr, CheckDistance);
+		bSweepWhileNavWalking = WallDistance < CheckDistance;
+		return;
+	}
+#endif
+
+	// No way to tell how close the walls are, so keep sweeping
+	bSweepWhileNavWalking = true;
+}
+
+void UTDSEnemyMovementComponent::CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration)
+{
+	// Take last update's steering out first, so acceleration and friction work on the velocity path following asked for
+	Velocity -= AppliedSeparation;
+	AppliedSeparation = FVector::ZeroVector;
+
+	Super::CalcVelocity(DeltaTime, Friction, bFluid, BrakingDeceleration);
+
+	if (SeparationVelocity.IsZero() || !IsMovingOnGround())
+	{
+		return;
+	}
+
+	// Never push the enemy past its normal top speed
+	const FVector RequestedVelocity = Velocity;
+	Velocity = (RequestedVelocity + SeparationVelocity).GetClampedToMaxSize2D(GetMaxSpeed());
+	AppliedSeparation = Velocity - RequestedVelocity;
+}
+
+void UTDSEnemyMovementComponent::StopMovementImmediately()
+{
+	Super::StopMovementImmediately();
+
+	AppliedSeparation = FVector::ZeroVector;
+}
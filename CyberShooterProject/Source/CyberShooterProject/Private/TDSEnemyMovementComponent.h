@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "TDSEnemyMovementComponent.generated.h"
+
+// How an enemy class keeps out of other enemies' way
+UENUM(BlueprintType)
+enum class ETDSAvoidanceMode : uint8
+{
+	// The engine's RVO avoidance, every enemy negotiates with the avoidance manager
+	RVO,
+
+	// Separation and cohesion steering from the spatial grid, one pass for every enemy per frame
+	Separation,
+
+	// No avoidance, for comparisons
+	None
+};
+
+// Character movement for enemies.
+// Enemies only ever move on flat navmesh floors, so by default they use the NavWalking fast path instead of full walking
+// physics: the capsule is snapped to the navmesh height with a projection that is cached between NavMeshProjectionInterval
+// updates, and there are no floor sweeps or step ups. The one capsule sweep per move is only made while the enemy is
+// within WallSweepDistance of a navmesh edge, which is looked up every WallCheckInterval. Path following, MaxWalkSpeed,
+// RotationRate and bOrientRotationToMovement all work as with walking, and off the navmesh the engine drops back to walking.
+// It also adds the separation subsystem's steering on top of the velocity path following and movement input ask for,
+// as a bias that is taken out again before the next velocity update so it never compounds.
+UCLASS()
+class UTDSEnemyMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTDSEnemyMovementComponent();
+
+	// Whether enemies use the NavWalking fast path on the ground instead of walking physics
+	UPROPERTY(EditDefaultsOnly, Category = "Enemy Movement")
+	bool bUseNavWalking = true;
+
+	// Closer than this to a navmesh edge, NavWalking sweeps the capsule so the enemy cannot clip into the wall behind it
+	UPROPERTY(EditDefaultsOnly, Category = "Enemy Movement", meta = (ClampMin = "0.0"))
+	float WallSweepDistance = 80.f;
+
+	// Seconds between navmesh edge distance lookups
+	UPROPERTY(EditDefaultsOnly, Category = "Enemy Movement", meta = (ClampMin = "0.0"))
+	float WallCheckInterval = 0.25f;
+
+	// Switches between NavWalking and walking on the ground, used by the movement benchmark
+	void SetNavWalkingEnabled(bool bEnable);
+
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Velocity to add on top of the requested one while on the ground, set every frame by the separation subsystem
+	void SetSeparationVelocity(const FVector& InSeparationVelocity) { SeparationVelocity = InSeparationVelocity; }
+
+	virtual void CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration) override;
+	virtual void StopMovementImmediately() override;
+
+protected:
+	virtual void PhysNavWalking(float deltaTime, int32 Iterations) override;
+
+private:
+	// Turns the NavWalking capsule sweep on near navmesh edges and off in the open
+	void UpdateWallSweep(float DeltaTime);
+
+	// Time until the next navmesh edge distance lookup
+	float TimeUntilWallCheck = 0.f;
+
+	// Steering asked for by the separation subsystem
+	FVector SeparationVelocity = FVector::ZeroVector;
+
+	// Part of Velocity that came from the steering last update
+	FVector AppliedSeparation = FVector::ZeroVector;
+};
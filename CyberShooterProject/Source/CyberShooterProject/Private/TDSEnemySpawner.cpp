@@ -18,7 +18,7 @@ ATDSEnemySpawner::ATDSEnemySpawner()
 }
 
 
-ATDSEnemyCharacter* ATDSEnemySpawner::SpawnEnemy(TSubclassOf<ATDSEnemyCharacter> EnemyClass)
+ATDSEnemyCharacter* ATDSEnemySpawner::SpawnEnemy(TSubclassOf<ATDSEnemyCharacter> EnemyClass, UTDSEnemyArchetype* Archetype)
 {
 	// Check if the world context is valid and the EnemyClass is set
     if (!GetWorld() || !EnemyClass)
@@ -26,16 +26,27 @@ ATDSEnemyCharacter* ATDSEnemySpawner::SpawnEnemy(TSubclassOf<ATDSEnemyCharacter>
         return nullptr;
     }
 
-	// Set up spawn parameters to ensure the enemy spawns even if there are collisions at the spawn location
-    FActorSpawnParameters SpawnParams;
-    SpawnParams.SpawnCollisionHandlingOverride =
-        ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
-
-	// Spawn the enemy actor at the spawner's location and rotation
-    return GetWorld()->SpawnActor<ATDSEnemyCharacter>(
+	// Spawn the enemy actor at the spawner's location and rotation, making sure it spawns even if there are collisions at the spawn location.
+	// The spawn is deferred so the archetype is set before the enemy begins play and its controller reads the tuning.
+    ATDSEnemyCharacter* Enemy = GetWorld()->SpawnActorDeferred<ATDSEnemyCharacter>(
         EnemyClass,
         GetActorTransform(),
-        SpawnParams
+        nullptr,
+        nullptr,
+        ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn
     );
+
+    if (!Enemy)
+    {
+        return nullptr;
+    }
+
+    if (Archetype)
+    {
+        Enemy->SetArchetype(Archetype);
+    }
+
+    Enemy->FinishSpawning(GetActorTransform());
+    return Enemy;
 }
 
@@ -7,6 +7,8 @@
 #include "TDSEnemyCharacter.h"
 #include "TDSEnemySpawner.generated.h"
 
+class UTDSEnemyArchetype;
+
 UCLASS()
 class ATDSEnemySpawner : public AActor
 {
@@ -16,9 +18,9 @@ public:
 	// Sets default values for this actor's properties
 	ATDSEnemySpawner();
 
-	/// Spawns an enemy of the specified class at the spawner's location and rotation.
+	/// Spawns an enemy of the specified class at the spawner's location and rotation, as Archetype if given.
 	UFUNCTION(BlueprintCallable)
-	ATDSEnemyCharacter* SpawnEnemy(TSubclassOf<ATDSEnemyCharacter> EnemyClass);
+	ATDSEnemyCharacter* SpawnEnemy(TSubclassOf<ATDSEnemyCharacter> EnemyClass, UTDSEnemyArchetype* Archetype = nullptr);
 
 protected:
 	
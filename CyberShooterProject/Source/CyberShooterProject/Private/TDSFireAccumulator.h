@@ -0,0 +1,77 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Counts how many shots are owed each frame at a given fire interval, independent of the frame rate.
+// A looping timer can fire at most once per frame, so once the interval drops below the frame time the real fire rate
+// silently caps at the frame rate. The accumulator instead emits every owed shot in one batch, along with how long ago
+// each shot should have happened so the projectile can be moved forward by that much.
+struct FTDSFireAccumulator
+{
+	// Time left until the next shot is due. Zero or below means a shot is owed.
+	float TimeUntilNextShot = 0.f;
+
+	// Whether the trigger is held
+	bool bTriggerHeld = false;
+
+	// Called when the trigger is pressed. Returns true if a shot can be fired straight away (the weapon has cooled down).
+	bool PressTrigger(float FireInterval)
+	{
+		bTriggerHeld = true;
+
+		if (TimeUntilNextShot > 0.f)
+		{
+			return false;
+		}
+
+		TimeUntilNextShot = FireInterval;
+		return true;
+	}
+
+	// Called when the trigger is released. The weapon keeps cooling down but no shots are banked.
+	void ReleaseTrigger()
+	{
+		bTriggerHeld = false;
+	}
+
+	// Advances the accumulator by DeltaSeconds and appends the age of every shot owed this frame to OutShotAges,
+	// oldest first. The age is how long before the end of the frame the shot was due. At most MaxShots are emitted,
+	// anything beyond that (e.g. after a long hitch) is dropped rather than fired as a burst. The oldest shots are the
+	// ones dropped, and ages are clamped to MaxShotAge, so a hitch never moves a shot further than one frame's worth
+	// of flight from the muzzle.
+	template <typename AllocatorType>
+	int32 Advance(float DeltaSeconds, float FireInterval, int32 MaxShots, float MaxShotAge, TArray<float, AllocatorType>& OutShotAges)
+	{
+		FireInterval = FMath::Max(FireInterval, UE_KINDA_SMALL_NUMBER);
+		TimeUntilNextShot -= DeltaSeconds;
+
+		// Not firing, just cool down without banking shots
+		if (!bTriggerHeld)
+		{
+			TimeUntilNextShot = FMath::Max(TimeUntilNextShot, 0.f);
+			return 0;
+		}
+
+		// Skip straight past the oldest owed shots that do not fit in this frame's batch
+		if (TimeUntilNextShot <= 0.f)
+		{
+			const int32 NumOwed = FMath::FloorToInt(-TimeUntilNextShot / FireInterval) + 1;
+			const int32 NumDropped = FMath::Max(NumOwed - FMath::Max(MaxShots, 0), 0);
+			TimeUntilNextShot += NumDropped * FireInterval;
+		}
+
+		// The guard on MaxShots only catches rounding in the skip above
+		int32 NumShots = 0;
+		while (TimeUntilNextShot <= 0.f)
+		{
+			if (NumShots < MaxShots)
+			{
+				OutShotAges.Add(FMath::Min(-TimeUntilNextShot, MaxShotAge));
+				NumShots++;
+			}
+			TimeUntilNextShot += FireInterval;
+		}
+
+		return NumShots;
+	}
+};
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSFlowField.h"
+
+namespace
+{
+	// Neighbour offsets, the four straight ones first so corner cutting can be checked against them
+	const FIntPoint NeighbourOffsets[8] = {
+		FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1),
+		FIntPoint(1, 1), FIntPoint(-1, 1), FIntPoint(1, -1), FIntPoint(-1, -1)
+	};
+
+	// An open cell in the Dijkstra frontier
+	struct FFrontierNode
+	{
+		float Distance;
+		int32 Index;
+	};
+
+	// Whether stepping by Offset from Cell is allowed: straight steps must follow a link, and diagonals must be walkable
+	// both ways round through the straight neighbours so they never clip a wall's corner
+	bool CanStep(const FTDSWalkabilityGrid& Grid, const FIntPoint& Cell, const FIntPoint& Offset)
+	{
+		if (Offset.X == 0 || Offset.Y == 0)
+		{
+			return Grid.IsLinked(Cell, Offset);
+		}
+
+		const FIntPoint StepX(Offset.X, 0);
+		const FIntPoint StepY(0, Offset.Y);
+		return Grid.IsLinked(Cell, StepX) && Grid.IsLinked(Cell + StepX, StepY)
+			&& Grid.IsLinked(Cell, StepY) && Grid.IsLinked(Cell + StepY, StepX);
+	}
+}
+
+TSharedPtr<FTDSFlowField> FTDSFlowField::Build(const FTDSWalkabilityGrid& Grid, const FIntPoint& GoalCell)
+{
+	TSharedPtr<FTDSFlowField> Field = MakeShared<FTDSFlowField>();
+	Field->GoalCell = GoalCell;
+	Field->Distances.Init(MAX_flt, Grid.Num());
+	Field->Directions.Init(FVector2f::ZeroVector, Grid.Num());
+
+	if (!Grid.IsValidCell(GoalCell) || !Grid.Walkable[Grid.ToIndex(GoalCell)])
+	{
+		return Field;
+	}
+
+	TArray<FFrontierNode> Frontier;
+	Frontier.Reserve(Grid.Num() / 4);
+
+	const auto FrontierOrder = [](const FFrontierNode& A, const FFrontierNode& B)
+	{
+		return A.Distance < B.Distance;
+	};
+
+	const int32 GoalIndex = Grid.ToIndex(GoalCell);
+	Field->Distances[GoalIndex] = 0.f;
+	Frontier.HeapPush({ 0.f, GoalIndex }, FrontierOrder);
+
+	while (Frontier.Num() > 0)
+	{
+		FFrontierNode Node;
+		Frontier.HeapPop(Node, FrontierOrder, EAllowShrinking::No);
+
+		// Stale entry, the cell was reached more cheaply after this was pushed
+		if (Node.Distance > Field->Distances[Node.Index])
+		{
+			continue;
+		}
+
+		const FIntPoint Cell(Node.Index % Grid.SizeX, Node.Index / Grid.SizeX);
+
+		for (int32 OffsetIndex = 0; OffsetIndex < 8; ++OffsetIndex)
+		{
+			const FIntPoint& Offset = NeighbourOffsets[OffsetIndex];
+			if (!CanStep(Grid, Cell, Offset))
+			{
+				continue;
+			}
+
+			const int32 NeighbourIndex = Grid.ToIndex(Cell + Offset);
+			const float StepCost = OffsetIndex < 4 ? 1.f : UE_SQRT_2;
+			const float NewDistance = Node.Distance + StepCost;
+
+			if (NewDistance < Field->Distances[NeighbourIndex])
+			{
+				Field->Distances[NeighbourIndex] = NewDistance;
+				Frontier.HeapPush({ NewDistance, NeighbourIndex }, FrontierOrder);
+			}
+		}
+	}
+
+	// Point every reachable cell at its cheapest neighbour
+	for (int32 Index = 0; Index < Grid.Num(); ++Index)
+	{
+		const float Distance = Field->Distances[Index];
+		if (Index == GoalIndex || Distance == MAX_flt)
+		{
+			continue;
+		}
+
+		const FIntPoint Cell(Index % Grid.SizeX, Index / Grid.SizeX);
+
+		float BestDistance = Distance;
+		FIntPoint BestOffset = FIntPoint::ZeroValue;
+
+		for (const FIntPoint& Offset : NeighbourOffsets)
+		{
+			if (CanStep(Grid, Cell, Offset))
+			{
+				const float NeighbourDistance = Field->Distances[Grid.ToIndex(Cell + Offset)];
+				if (NeighbourDistance < BestDistance)
+				{
+					BestDistance = NeighbourDistance;
+					BestOffset = Offset;
+				}
+			}
+		}
+
+		Field->Directions[Index] = FVector2f(BestOffset.X, BestOffset.Y).GetSafeNormal();
+	}
+
+	return Field;
+}
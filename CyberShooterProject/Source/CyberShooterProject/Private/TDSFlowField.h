@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TDSWalkabilityGrid.h"
+
+// Distances to a goal cell over a walkability grid, and the direction to walk from every cell to get closer to it.
+// Built by BuildFlowField, which only reads its inputs, so it can run on a worker thread.
+struct FTDSFlowField
+{
+	// Cell everything flows towards
+	FIntPoint GoalCell = FIntPoint::ZeroValue;
+
+	// Path cost from each cell to the goal, in cells. MAX_flt where the goal cannot be reached.
+	TArray<float> Distances;
+
+	// Unit direction towards the neighbour closest to the goal, zero on the goal and on unreachable cells
+	TArray<FVector2f> Directions;
+
+	// Runs Dijkstra from GoalCell over the grid (8 neighbours, no corner cutting) and fills in the directions
+	static TSharedPtr<FTDSFlowField> Build(const FTDSWalkabilityGrid& Grid, const FIntPoint& GoalCell);
+};
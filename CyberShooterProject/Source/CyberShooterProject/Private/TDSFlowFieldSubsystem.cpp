@@ -0,0 +1,258 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSFlowFieldSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSNavigationCacheSubsystem.h"
+#include "NavigationSystem.h"
+#include "NavigationPath.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+
+DECLARE_CYCLE_STAT(TEXT("Flow Field Build"), STAT_TDSFlowFieldBuild, STATGROUP_CyberShooter);
+DECLARE_CYCLE_STAT(TEXT("Flow Field Steering"), STAT_TDSFlowFieldSteer, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Flow Field Builds"), STAT_TDSFlowFieldBuilds, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Flow Field Followers"), STAT_TDSFlowFieldFollowers, STATGROUP_CyberShooter);
+
+static FAutoConsoleCommandWithWorldAndArgs GTDSFlowFieldBenchmarkCommand(
+	TEXT("tds.FlowField.Benchmark"),
+	TEXT("Times one flow field build plus a direction sample per enemy against one synchronous pathfind per enemy, ")
+	TEXT("from random walkable cells to the player. Optional argument: number of enemies (default 200)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UTDSFlowFieldSubsystem* FlowFieldSubsystem = World ? World->GetSubsystem<UTDSFlowFieldSubsystem>() : nullptr)
+		{
+			FlowFieldSubsystem->RunBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 200);
+		}
+	}));
+
+bool UTDSFlowFieldSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSFlowFieldSubsystem::Deinitialize()
+{
+	// The build only holds its own references to the grid, but wait for it so it does not outlive the world
+	if (BuildTask.IsValid())
+	{
+		BuildTask.Wait();
+		BuildTask = {};
+	}
+
+	Field.Reset();
+	Grid.Reset();
+	Followers.Empty();
+
+	SET_DWORD_STAT(STAT_TDSFlowFieldFollowers, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSFlowFieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSFlowFieldSubsystem, STATGROUP_Tickables);
+}
+
+void UTDSFlowFieldSubsystem::AddFollower(ACharacter* Follower)
+{
+	if (Follower)
+	{
+		Followers.AddUnique(Follower);
+		bFieldWanted = true;
+	}
+}
+
+void UTDSFlowFieldSubsystem::RemoveFollower(ACharacter* Follower)
+{
+	Followers.RemoveSingleSwap(Follower, EAllowShrinking::No);
+}
+
+bool UTDSFlowFieldSubsystem::SampleDirection(const FVector& Location, FVector& OutDirection)
+{
+	bFieldWanted = true;
+
+	if (!Grid.IsValid() || !Field.IsValid())
+	{
+		return false;
+	}
+
+	const FIntPoint Cell = Grid->ToCell(Location);
+	if (!Grid->IsValidCell(Cell))
+	{
+		return false;
+	}
+
+	const FVector2f& Direction = Field->Directions[Grid->ToIndex(Cell)];
+	if (Direction.IsZero())
+	{
+		return false;
+	}
+
+	OutDirection = FVector(Direction.X, Direction.Y, 0.f);
+	return true;
+}
+
+void UTDSFlowFieldSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Swap in a finished build
+	if (BuildTask.IsValid() && BuildTask.IsCompleted())
+	{
+		Field = BuildTask.GetResult();
+		BuildTask = {};
+	}
+
+	Followers.RemoveAllSwap([](const TWeakObjectPtr<ACharacter>& Follower) { return !Follower.IsValid(); }, EAllowShrinking::No);
+	SET_DWORD_STAT(STAT_TDSFlowFieldFollowers, Followers.Num());
+
+	if (!bFieldWanted)
+	{
+		return;
+	}
+
+	if (!AcquireGrid())
+	{
+		return;
+	}
+
+	// Rebuild whenever the player crosses into another cell, one build at a time
+	if (const APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0))
+	{
+		const FIntPoint PlayerCell = Grid->ToCell(PlayerPawn->GetActorLocation());
+		if (!BuildTask.IsValid() && PlayerCell != BuildGoalCell)
+		{
+			LaunchBuild(PlayerCell);
+		}
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TDSFlowFieldSteer);
+
+	for (const TWeakObjectPtr<ACharacter>& FollowerPtr : Followers)
+	{
+		ACharacter* Follower = FollowerPtr.Get();
+
+		FVector Direction;
+		if (SampleDirection(Follower->GetActorLocation(), Direction))
+		{
+			Follower->AddMovementInput(Direction);
+		}
+	}
+}
+
+void UTDSFlowFieldSubsystem::LaunchBuild(const FIntPoint& GoalCell)
+{
+	BuildGoalCell = GoalCell;
+
+	// The grid is read only from here on, so the task can share it without copying
+	BuildTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [BuildGrid = Grid, GoalCell]()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TDSFlowFieldBuild);
+		return FTDSFlowField::Build(*BuildGrid, GoalCell);
+	});
+
+	INC_DWORD_STAT(STAT_TDSFlowFieldBuilds);
+}
+
+bool UTDSFlowFieldSubsystem::AcquireGrid()
+{
+	if (!Grid.IsValid())
+	{
+		if (const UTDSNavigationCacheSubsystem* NavCache = GetWorld()->GetSubsystem<UTDSNavigationCacheSubsystem>())
+		{
+			Grid = NavCache->GetWalkabilityGrid();
+		}
+	}
+
+	return Grid.IsValid();
+}
+
+void UTDSFlowFieldSubsystem::RunBenchmark(int32 NumEnemies)
+{
+	NumEnemies = FMath::Max(NumEnemies, 1);
+
+	UWorld* World = GetWorld();
+	const APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(World, 0);
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+	if (!PlayerPawn || !NavSys)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("tds.FlowField.Benchmark: needs a player and a navmesh"));
+		return;
+	}
+
+	// Finish the room's grid straight away, the benchmark is allowed to hitch
+	bFieldWanted = true;
+	if (UTDSNavigationCacheSubsystem* NavCache = World->GetSubsystem<UTDSNavigationCacheSubsystem>())
+	{
+		NavCache->FinishBuild();
+	}
+	if (!AcquireGrid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("tds.FlowField.Benchmark: no navmesh to sample"));
+		return;
+	}
+
+	const FVector PlayerLocation = PlayerPawn->GetActorLocation();
+	const FIntPoint PlayerCell = Grid->ToCell(PlayerLocation);
+
+	// Enemy stand-ins on random walkable cells, at the navmesh points the grid sampled so the pathfinds start somewhere valid
+	TArray<FVector> Starts;
+	FRandomStream Random(1337);
+	for (int32 Attempt = 0; Starts.Num() < NumEnemies && Attempt < NumEnemies * 20; ++Attempt)
+	{
+		const int32 Index = Grid->ToIndex(FIntPoint(Random.RandHelper(Grid->SizeX), Random.RandHelper(Grid->SizeY)));
+		if (Grid->Walkable[Index])
+		{
+			Starts.Add(Grid->CellPoints[Index]);
+		}
+	}
+
+	if (Starts.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("tds.FlowField.Benchmark: no walkable cells found"));
+		return;
+	}
+
+	double StartTime = FPlatformTime::Seconds();
+	const TSharedPtr<FTDSFlowField> BenchField = FTDSFlowField::Build(*Grid, PlayerCell);
+	const double BuildTime = FPlatformTime::Seconds() - StartTime;
+
+	int32 NumOnField = 0;
+	StartTime = FPlatformTime::Seconds();
+	for (const FVector& Start : Starts)
+	{
+		const FIntPoint Cell = Grid->ToCell(Start);
+		if (Grid->IsValidCell(Cell) && !BenchField->Directions[Grid->ToIndex(Cell)].IsZero())
+		{
+			NumOnField++;
+		}
+	}
+	const double SampleTime = FPlatformTime::Seconds() - StartTime;
+
+	int32 NumPathsFound = 0;
+	StartTime = FPlatformTime::Seconds();
+	for (const FVector& Start : Starts)
+	{
+		const UNavigationPath* Path = UNavigationSystemV1::FindPathToLocationSynchronously(World, Start, PlayerLocation);
+		if (Path && Path->IsValid())
+		{
+			NumPathsFound++;
+		}
+	}
+	const double PathTime = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogTemp, Log, TEXT("tds.FlowField.Benchmark: %d enemies, %dx%d grid of %.0f | field build %.3f ms (worker) + samples %.3f ms (%d on field) | synchronous pathfinds %.3f ms (%d found)"),
+		Starts.Num(),
+		Grid->SizeX,
+		Grid->SizeY,
+		Grid->CellSize,
+		BuildTime * 1000.0,
+		SampleTime * 1000.0,
+		NumOnField,
+		PathTime * 1000.0,
+		NumPathsFound);
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Task.h"
+#include "TDSFlowField.h"
+#include "TDSFlowFieldSubsystem.generated.h"
+
+class ACharacter;
+
+// This subsystem keeps one flow field towards the player that every chasing enemy can follow, instead of each of them
+// pathfinding on its own to nearly the same place:
+// - the field runs over the room's walkability grid, sampled once when the room loads by the navigation cache subsystem
+//   (see FTDSWalkabilityGrid). Neighbouring cells are only linked when a navmesh raycast runs between their centres.
+// - whenever the player crosses into another cell, Dijkstra is run from the player's cell over that grid on a worker thread,
+//   and the finished field replaces the old one on the game thread
+// - enemies added as followers are steered along the field every frame with AddMovementInput
+// Controllers check SampleDirection first and fall back to normal pathing where the field does not reach.
+UCLASS()
+class UTDSFlowFieldSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only build fields in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Direction to walk from Location to get closer to the player. Returns false when Location is off the field
+	// (outside the grid, on an unwalkable or unreachable cell, in the player's cell) or no field is ready yet.
+	bool SampleDirection(const FVector& Location, FVector& OutDirection);
+
+	// Starts or stops steering a character along the field every frame
+	void AddFollower(ACharacter* Follower);
+	void RemoveFollower(ACharacter* Follower);
+
+	// Times a field build plus NumEnemies samples against NumEnemies synchronous pathfinds to the player, logged to
+	// LogTemp. Used by tds.FlowField.Benchmark.
+	void RunBenchmark(int32 NumEnemies);
+
+private:
+	// Picks up the room's walkability grid from the navigation cache subsystem once it is built. Returns true once there is one.
+	bool AcquireGrid();
+
+	// Starts a field build towards GoalCell on a worker thread
+	void LaunchBuild(const FIntPoint& GoalCell);
+
+	// Walkability of the room, shared read only with the navigation cache and the build tasks
+	TSharedPtr<const FTDSWalkabilityGrid> Grid;
+
+	// Field currently followed, and the build that will replace it
+	TSharedPtr<FTDSFlowField> Field;
+	UE::Tasks::TTask<TSharedPtr<FTDSFlowField>> BuildTask;
+
+	// Goal cell of the running or last finished build
+	FIntPoint BuildGoalCell = FIntPoint(MAX_int32, MAX_int32);
+
+	// Characters steered along the field
+	TArray<TWeakObjectPtr<ACharacter>> Followers;
+
+	// Set when anyone asks for the field, so rooms without flow field users never build one
+	bool bFieldWanted = false;
+};
@@ -34,6 +34,7 @@ void UTDSGameInstance::StartNewRun(int32 NewSeed)
 
 	RunSeed = NewSeed;
 	CurrentRoomIndex = 0;
+	CurrentRoomDefinition = nullptr;
 	LastCombatRoomIndex = INDEX_NONE;
 	LastRewardRoomIndex = INDEX_NONE;
 }
@@ -123,6 +124,9 @@ void UTDSGameInstance::LoadNextRoom()
 
     UE_LOG(LogTemp, Warning, TEXT("Opening level: %s"), *NextRoom->LevelName.ToString());
 
+    // The room manager in the new level spawns its enemies from this
+    CurrentRoomDefinition = NextRoom;
+
     UGameplayStatics::OpenLevel(this, NextRoom->LevelName);
 }
 
@@ -52,6 +52,10 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Run")
 	TArray<TObjectPtr<UTDSRoomDefinition>> RewardRooms;
 
+	// Room definition picked by the last LoadNextRoom, read by the room manager for the enemies to spawn. Null before the first room.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Run")
+	TObjectPtr<UTDSRoomDefinition> CurrentRoomDefinition;
+
 	// This is the index of the current room that the player is in. It can be used to determine which room definition to use when generating the next room.
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Run")
 	int32 CurrentRoomIndex = 0;
@@ -0,0 +1,452 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSHitscanSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSProjectile.h"
+#include "TDSDamageSubsystem.h"
+#include "TDSAudioEventSubsystem.h"
+#include "TDSCollisionChannels.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hitscan Tick"), STAT_TDSHitscanTick, STATGROUP_CyberShooter);
+DECLARE_CYCLE_STAT(TEXT("Hitscan Async Trace Wait"), STAT_TDSHitscanTraceWait, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitscan Traces"), STAT_TDSHitscanTraces, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitscan Hits"), STAT_TDSHitscanHits, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Hitscan Tracers Live"), STAT_TDSHitscanTracersLive, STATGROUP_CyberShooter);
+
+static TAutoConsoleVariable<int32> CVarTDSHitscanAsyncTraces(
+	TEXT("tds.Hitscan.AsyncTraces"),
+	0,
+	TEXT("How hitscan shots are traced.\n")
+	TEXT("0: one batch of blocking traces spread over task threads, hits applied in the same frame (default)\n")
+	TEXT("1: async traces issued at the end of the frame, hits applied at the start of the next frame"),
+	ECVF_Default);
+
+namespace
+{
+	// Smallest number of traces handed to one task of the blocking batch, fewer than this is not worth a task
+	constexpr int32 TracesPerTask = 32;
+}
+
+bool UTDSHitscanSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSHitscanSubsystem::Deinitialize()
+{
+	PendingShots.Empty();
+	TraceIgnoredActors.Empty();
+	TraceHits.Empty();
+	TraceBlocked.Empty();
+	InFlightShots.Empty();
+	InFlightTraces.Empty();
+	TracerStarts.Empty();
+	TracerEnds.Empty();
+	TracerRemaining.Empty();
+	TracerDurations.Empty();
+	TracerTypes.Empty();
+	Types.Empty();
+	InstanceHost = nullptr;
+
+	SET_DWORD_STAT(STAT_TDSHitscanTracersLive, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSHitscanSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSHitscanSubsystem, STATGROUP_Tickables);
+}
+
+void UTDSHitscanSubsystem::QueueShot(
+	TSubclassOf<ATDSProjectile> ProjectileClass,
+	const FVector& Start,
+	const FVector& Direction,
+	float Range,
+	float Damage,
+	AActor* InOwner,
+	APawn* InInstigator,
+	float TracerSeconds)
+{
+	const int32 TypeIndex = FindOrAddType(ProjectileClass);
+	if (TypeIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	FTDSHitscanShot& Shot = PendingShots.AddDefaulted_GetRef();
+	Shot.Start = Start;
+	Shot.End = Start + Direction.GetSafeNormal() * Range;
+	Shot.Damage = Damage;
+	Shot.TracerSeconds = TracerSeconds;
+	Shot.TypeIndex = TypeIndex;
+	Shot.Owner = InOwner;
+	Shot.Instigator = InInstigator;
+}
+
+void UTDSHitscanSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_TDSHitscanTick);
+
+	if (!GetWorld())
+	{
+		return;
+	}
+
+	// Age the old tracers first so this frame's shots are drawn at full thickness
+	UpdateTracers(DeltaTime);
+
+	// Traces left over from a frame in async mode are always consumed, so switching modes never loses a shot
+	ConsumeAsyncTraces();
+
+	if (CVarTDSHitscanAsyncTraces.GetValueOnGameThread() != 0)
+	{
+		IssueAsyncTraces();
+	}
+	else
+	{
+		ResolveShots();
+	}
+
+	UpdateInstances();
+
+	SET_DWORD_STAT(STAT_TDSHitscanTracersLive, TracerStarts.Num());
+}
+
+void UTDSHitscanSubsystem::ResolveShots()
+{
+	const int32 NumShots = PendingShots.Num();
+	if (NumShots == 0)
+	{
+		return;
+	}
+
+	UWorld* World = GetWorld();
+
+	// Resolve the shooters on the game thread, the trace tasks only read plain pointers
+	TraceIgnoredActors.SetNumUninitialized(NumShots, EAllowShrinking::No);
+	for (int32 Index = 0; Index < NumShots; ++Index)
+	{
+		TraceIgnoredActors[Index] = PendingShots[Index].Owner.Get();
+	}
+
+	TraceHits.SetNum(NumShots, EAllowShrinking::No);
+	TraceBlocked.SetNumUninitialized(NumShots, EAllowShrinking::No);
+
+	// Trace the whole frame's shots as one batch. Scene queries only read the physics scene, which is how UWorld runs
+	// its own async traces on task threads, so the batch is spread over the workers and the game thread waits on it once.
+	ParallelFor(TEXT("TDSHitscanSubsystem.Trace"), NumShots, TracesPerTask, [this, World](int32 Index)
+	{
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TDSHitscanTrace), false);
+
+		// Never hit the actor that fired the shot
+		if (TraceIgnoredActors[Index])
+		{
+			QueryParams.AddIgnoredActor(TraceIgnoredActors[Index]);
+		}
+
+		// Same channel as the projectiles, so hitscan shots hit exactly what a projectile would
+		const FTDSHitscanShot& Shot = PendingShots[Index];
+		TraceBlocked[Index] = World->LineTraceSingleByChannel(TraceHits[Index], Shot.Start, Shot.End, ECC_TDSProjectile, QueryParams);
+	});
+
+	INC_DWORD_STAT_BY(STAT_TDSHitscanTraces, NumShots);
+
+	// Damage, sounds and effects are applied back on the game thread, in the order the shots were fired
+	for (int32 Index = 0; Index < NumShots; ++Index)
+	{
+		ApplyShot(PendingShots[Index], TraceBlocked[Index] ? &TraceHits[Index] : nullptr);
+	}
+
+	PendingShots.Reset();
+}
+
+void UTDSHitscanSubsystem::IssueAsyncTraces()
+{
+	if (PendingShots.Num() == 0)
+	{
+		return;
+	}
+
+	UWorld* World = GetWorld();
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TDSHitscanAsyncTrace), false);
+
+	// Issue every trace for this frame in one batch, the results are read at the start of next frame
+	for (const FTDSHitscanShot& Shot : PendingShots)
+	{
+		QueryParams.ClearIgnoredSourceObjects();
+		if (AActor* ShotOwner = Shot.Owner.Get())
+		{
+			QueryParams.AddIgnoredActor(ShotOwner);
+		}
+
+		InFlightTraces.Add(World->AsyncLineTraceByChannel(
+			EAsyncTraceType::Single,
+			Shot.Start,
+			Shot.End,
+			ECC_TDSProjectile,
+			QueryParams
+		));
+	}
+
+	INC_DWORD_STAT_BY(STAT_TDSHitscanTraces, PendingShots.Num());
+
+	InFlightShots.Append(PendingShots);
+	PendingShots.Reset();
+}
+
+void UTDSHitscanSubsystem::ConsumeAsyncTraces()
+{
+	if (InFlightShots.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TDSHitscanTraceWait);
+
+	UWorld* World = GetWorld();
+
+	for (int32 Index = 0; Index < InFlightShots.Num(); ++Index)
+	{
+		const FTDSHitscanShot& Shot = InFlightShots[Index];
+
+		// A missing result means the trace was dropped, queue the shot again so it is traced this frame
+		FTraceDatum Result;
+		if (!World->QueryTraceData(InFlightTraces[Index], Result))
+		{
+			PendingShots.Add(Shot);
+			continue;
+		}
+
+		const FHitResult* BlockingHit = Result.OutHits.FindByPredicate([](const FHitResult& Hit)
+		{
+			return Hit.bBlockingHit;
+		});
+
+		ApplyShot(Shot, BlockingHit);
+	}
+
+	InFlightShots.Reset();
+	InFlightTraces.Reset();
+}
+
+void UTDSHitscanSubsystem::ApplyShot(const FTDSHitscanShot& Shot, const FHitResult* Hit)
+{
+	FVector TracerEnd = Shot.End;
+
+	if (Hit)
+	{
+		INC_DWORD_STAT(STAT_TDSHitscanHits);
+
+		TracerEnd = Hit->ImpactPoint;
+
+		// Same rules as ATDSProjectile::OnHit, there is no projectile actor so the shooter is the damage causer
+		AActor* ShotOwner = Shot.Owner.Get();
+		AActor* HitActor = Hit->GetActor();
+		if (HitActor && HitActor != ShotOwner)
+		{
+			if (UTDSDamageSubsystem* DamageSubsystem = GetWorld()->GetSubsystem<UTDSDamageSubsystem>())
+			{
+				APawn* ShotInstigator = Shot.Instigator.Get();
+
+				DamageSubsystem->QueueDamage(
+					HitActor,
+					Shot.Damage,
+					ShotInstigator ? ShotInstigator->GetController() : nullptr,
+					ShotOwner,
+					Hit->ImpactPoint,
+					Hit->Item
+				);
+			}
+		}
+
+		const FTDSHitscanType& Type = Types[Shot.TypeIndex];
+		if (Type.ImpactSound)
+		{
+			if (UTDSAudioEventSubsystem* Audio = GetWorld()->GetSubsystem<UTDSAudioEventSubsystem>())
+			{
+				Audio->PlaySound(ETDSAudioCategory::Impact, Type.ImpactSound, Hit->ImpactPoint, Type.ImpactSoundVolume);
+			}
+		}
+
+		ATDSProjectile::SpawnImpactEffect(this, Type.ImpactEffect, *Hit);
+	}
+
+	if (Shot.TracerSeconds > 0.f)
+	{
+		TracerStarts.Add(Shot.Start);
+		TracerEnds.Add(TracerEnd);
+		TracerRemaining.Add(Shot.TracerSeconds);
+		TracerDurations.Add(Shot.TracerSeconds);
+		TracerTypes.Add(Shot.TypeIndex);
+	}
+}
+
+void UTDSHitscanSubsystem::UpdateTracers(float DeltaTime)
+{
+	// Walk backwards so faded tracers can be swap-removed without skipping anyone
+	for (int32 Index = TracerStarts.Num() - 1; Index >= 0; --Index)
+	{
+		TracerRemaining[Index] -= DeltaTime;
+		if (TracerRemaining[Index] > 0.f)
+		{
+			continue;
+		}
+
+		TracerStarts.RemoveAtSwap(Index, EAllowShrinking::No);
+		TracerEnds.RemoveAtSwap(Index, EAllowShrinking::No);
+		TracerRemaining.RemoveAtSwap(Index, EAllowShrinking::No);
+		TracerDurations.RemoveAtSwap(Index, EAllowShrinking::No);
+		TracerTypes.RemoveAtSwap(Index, EAllowShrinking::No);
+	}
+}
+
+void UTDSHitscanSubsystem::UpdateInstances()
+{
+	for (FTDSHitscanType& Type : Types)
+	{
+		Type.InstanceTransforms.Reset();
+	}
+
+	// Stretch the projectile mesh from the muzzle to the hit, thinning out as the tracer fades
+	for (int32 Index = 0; Index < TracerStarts.Num(); ++Index)
+	{
+		FTDSHitscanType& Type = Types[TracerTypes[Index]];
+
+		const FVector Segment = TracerEnds[Index] - TracerStarts[Index];
+		const float Length = Segment.Size();
+		if (Length <= UE_KINDA_SMALL_NUMBER)
+		{
+			continue;
+		}
+
+		const float Fade = FMath::Clamp(TracerRemaining[Index] / TracerDurations[Index], 0.f, 1.f);
+		const FVector Scale(Length / Type.MeshLength, Type.MeshThickness.X * Fade, Type.MeshThickness.Y * Fade);
+
+		Type.InstanceTransforms.Add(FTransform(Segment.ToOrientationQuat(), TracerStarts[Index] + Segment * 0.5f, Scale));
+	}
+
+	for (FTDSHitscanType& Type : Types)
+	{
+		UInstancedStaticMeshComponent* Instances = Type.Instances;
+		if (!Instances)
+		{
+			continue;
+		}
+
+		// Match the instance count to the number of live tracers, then overwrite every transform in one batch
+		const int32 WantedCount = Type.InstanceTransforms.Num();
+		const int32 CurrentCount = Instances->GetInstanceCount();
+
+		if (CurrentCount < WantedCount)
+		{
+			TArray<FTransform> NewInstances;
+			NewInstances.Init(FTransform::Identity, WantedCount - CurrentCount);
+			Instances->AddInstances(NewInstances, false, true);
+		}
+		else if (CurrentCount > WantedCount)
+		{
+			TArray<int32> InstancesToRemove;
+			for (int32 InstanceIndex = WantedCount; InstanceIndex < CurrentCount; ++InstanceIndex)
+			{
+				InstancesToRemove.Add(InstanceIndex);
+			}
+			Instances->RemoveInstances(InstancesToRemove);
+		}
+
+		if (WantedCount > 0)
+		{
+			Instances->BatchUpdateInstancesTransforms(0, Type.InstanceTransforms, true, true, true);
+		}
+	}
+}
+
+int32 UTDSHitscanSubsystem::FindOrAddType(TSubclassOf<ATDSProjectile> ProjectileClass)
+{
+	if (!ProjectileClass)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 ExistingIndex = Types.IndexOfByPredicate([ProjectileClass](const FTDSHitscanType& Type)
+	{
+		return Type.ProjectileClass == ProjectileClass;
+	});
+
+	if (ExistingIndex != INDEX_NONE)
+	{
+		return ExistingIndex;
+	}
+
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return INDEX_NONE;
+	}
+
+	// One hidden actor hosts the instanced tracers of every projectile class
+	if (!InstanceHost)
+	{
+		FActorSpawnParameters Params;
+		Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		InstanceHost = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, Params);
+		if (!InstanceHost)
+		{
+			return INDEX_NONE;
+		}
+
+		USceneComponent* HostRoot = NewObject<USceneComponent>(InstanceHost, TEXT("Root"));
+		InstanceHost->SetRootComponent(HostRoot);
+		HostRoot->RegisterComponent();
+	}
+
+	// Mirror the class defaults so hitscan shots sound and look like the projectile they replace
+	const ATDSProjectile* ProjectileDefaults = ProjectileClass->GetDefaultObject<ATDSProjectile>();
+
+	FTDSHitscanType& NewType = Types.AddDefaulted_GetRef();
+	NewType.ProjectileClass = ProjectileClass;
+	NewType.ImpactSound = ProjectileDefaults->GetImpactSound();
+	NewType.ImpactSoundVolume = ProjectileDefaults->GetImpactSoundVolume();
+	NewType.ImpactEffect = ProjectileDefaults->GetImpactEffect();
+
+	UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(InstanceHost);
+	Instances->SetupAttachment(InstanceHost->GetRootComponent());
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetGenerateOverlapEvents(false);
+	Instances->SetCanEverAffectNavigation(false);
+	Instances->SetCastShadow(false);
+	Instances->SetMobility(EComponentMobility::Movable);
+
+	if (const UStaticMeshComponent* MeshDefaults = ProjectileDefaults->GetMeshComponent())
+	{
+		if (UStaticMesh* StaticMesh = MeshDefaults->GetStaticMesh())
+		{
+			Instances->SetStaticMesh(StaticMesh);
+			for (int32 MaterialIndex = 0; MaterialIndex < MeshDefaults->GetNumMaterials(); ++MaterialIndex)
+			{
+				Instances->SetMaterial(MaterialIndex, MeshDefaults->GetMaterial(MaterialIndex));
+			}
+
+			// The tracer is the projectile mesh stretched along X, keeping its thickness
+			const FVector MeshScale = MeshDefaults->GetRelativeScale3D();
+			NewType.MeshLength = FMath::Max(StaticMesh->GetBounds().BoxExtent.X * 2.f, 1.f);
+			NewType.MeshThickness = FVector2D(MeshScale.Y, MeshScale.Z);
+		}
+	}
+
+	Instances->RegisterComponent();
+	NewType.Instances = Instances;
+
+	return Types.Num() - 1;
+}
@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "TDSHitscanSubsystem.generated.h"
+
+class ATDSProjectile;
+class UInstancedStaticMeshComponent;
+class UNiagaraSystem;
+class USoundBase;
+
+// Impact and tracer settings of one projectile class, read once from its class defaults so hitscan shots look and sound like the projectile
+USTRUCT()
+struct FTDSHitscanType
+{
+	GENERATED_BODY()
+
+	// The projectile class these settings were read from
+	UPROPERTY()
+	TSubclassOf<ATDSProjectile> ProjectileClass;
+
+	// The instanced mesh that draws every live tracer of this class
+	UPROPERTY()
+	TObjectPtr<UInstancedStaticMeshComponent> Instances;
+
+	// Sound and effect to play on impact
+	UPROPERTY()
+	TObjectPtr<USoundBase> ImpactSound;
+
+	float ImpactSoundVolume = 1.f;
+
+	UPROPERTY()
+	TObjectPtr<UNiagaraSystem> ImpactEffect;
+
+	// Length of the projectile mesh along its forward axis, used to stretch it over the tracer
+	float MeshLength = 100.f;
+
+	// Thickness of the projectile mesh, the tracer starts this thick and thins out as it fades
+	FVector2D MeshThickness = FVector2D::UnitVector;
+
+	// Scratch buffer reused every frame to upload instance transforms
+	TArray<FTransform> InstanceTransforms;
+};
+
+// A shot waiting for its trace
+struct FTDSHitscanShot
+{
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	float Damage = 0.f;
+	float TracerSeconds = 0.f;
+	int32 TypeIndex = INDEX_NONE;
+	TWeakObjectPtr<AActor> Owner;
+	TWeakObjectPtr<APawn> Instigator;
+};
+
+// This subsystem resolves hitscan shots. Shots fired during the frame are queued and traced together in one batch on the
+// Projectile channel, so a shot can never tunnel through a thin capsule the way a fast projectile can. By default the batch
+// runs across task threads and is applied in the same frame. With tds.Hitscan.AsyncTraces enabled the traces are issued with
+// UWorld::AsyncLineTraceByChannel and applied at the start of the next frame instead, like tds.Projectiles.AsyncSweeps.
+// Hits go through the damage and audio subsystems and reuse the impact sound and effect of the weapon's projectile class.
+// Each shot leaves a short tracer drawn through one instanced static mesh per projectile class, stretched from the muzzle to the hit.
+UCLASS()
+class UTDSHitscanSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only resolve hitscan shots in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Queues a hitscan shot from Start along Direction, traced with this frame's other shots
+	void QueueShot(
+		TSubclassOf<ATDSProjectile> ProjectileClass,
+		const FVector& Start,
+		const FVector& Direction,
+		float Range,
+		float Damage,
+		AActor* InOwner,
+		APawn* InInstigator,
+		float TracerSeconds);
+
+private:
+	// Returns the index of the type entry for the given class, creating it on first use
+	int32 FindOrAddType(TSubclassOf<ATDSProjectile> ProjectileClass);
+
+	// Traces every queued shot as one parallel batch and applies their hits this frame
+	void ResolveShots();
+
+	// Issues an async trace for every queued shot, their hits are applied next frame
+	void IssueAsyncTraces();
+
+	// Applies the results of the async traces issued last frame
+	void ConsumeAsyncTraces();
+
+	// Applies damage, impact sound and effect for a shot, and starts its tracer. Hit is null for a miss.
+	void ApplyShot(const FTDSHitscanShot& Shot, const FHitResult* Hit);
+
+	// Ages the tracers, dropping the ones that have faded out
+	void UpdateTracers(float DeltaTime);
+
+	// Uploads this frame's tracer transforms to the instanced meshes
+	void UpdateInstances();
+
+	// Actor that owns the instanced mesh components
+	UPROPERTY()
+	TObjectPtr<AActor> InstanceHost;
+
+	// Known projectile classes
+	UPROPERTY()
+	TArray<FTDSHitscanType> Types;
+
+	// Shots fired this frame
+	TArray<FTDSHitscanShot> PendingShots;
+
+	// Scratch buffers for the same-frame trace batch, one entry per pending shot
+	TArray<AActor*> TraceIgnoredActors;
+	TArray<FHitResult> TraceHits;
+	TArray<bool> TraceBlocked;
+
+	// Shots whose async traces were issued last frame, and the trace of each
+	TArray<FTDSHitscanShot> InFlightShots;
+	TArray<FTraceHandle> InFlightTraces;
+
+	// ---- Live tracers, struct-of-arrays ----
+	TArray<FVector> TracerStarts;
+	TArray<FVector> TracerEnds;
+	TArray<float> TracerRemaining;
+	TArray<float> TracerDurations;
+	TArray<int32> TracerTypes;
+};
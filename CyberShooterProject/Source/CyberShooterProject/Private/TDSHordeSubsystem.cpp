@@ -0,0 +1,480 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSHordeSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSEnemyCharacter.h"
+#include "TDSEnemyAIController.h"
+#include "TDSEnemyArchetype.h"
+#include "TDSCollisionChannels.h"
+#include "TDSDamageSubsystem.h"
+#include "TDSAudioEventSubsystem.h"
+#include "TDSFlowFieldSubsystem.h"
+#include "TDSGameInstance.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "NavigationSystem.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Horde Tick"), STAT_TDSHordeTick, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Horde Proxies"), STAT_TDSHordeProxies, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Horde Promoted Actors"), STAT_TDSHordePromoted, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Horde Promotions"), STAT_TDSHordePromotions, STATGROUP_CyberShooter);
+
+static TAutoConsoleVariable<float> CVarTDSHordePromotionDistance(
+	TEXT("tds.Horde.PromotionDistance"),
+	300.f,
+	TEXT("Proxies closer than this to the player are swapped for full enemy actors."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTDSHordeMaxPromotedActors(
+	TEXT("tds.Horde.MaxPromotedActors"),
+	24,
+	TEXT("Most enemy actors promoted from proxies alive at once. Proxies past the cap keep fighting as proxies."),
+	ECVF_Default);
+
+namespace
+{
+	// Same distance ATDSEnemyAIController uses for arriving at a wander target
+	constexpr float WanderArriveDistance = 120.f;
+
+	// Where free instances are parked, well below any room
+	const FTransform HiddenInstanceTransform(FQuat::Identity, FVector(0.f, 0.f, -100000.f), FVector(0.01f));
+}
+
+bool UTDSHordeSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSHordeSubsystem::Deinitialize()
+{
+	Archetypes.Empty();
+	HostActors.Empty();
+	PromotedEnemies.Empty();
+	NumProxies = 0;
+
+	SET_DWORD_STAT(STAT_TDSHordeProxies, 0);
+	SET_DWORD_STAT(STAT_TDSHordePromoted, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSHordeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSHordeSubsystem, STATGROUP_Tickables);
+}
+
+bool UTDSHordeSubsystem::CanUseProxies(TSubclassOf<ATDSEnemyCharacter> EnemyClass)
+{
+	return EnemyClass && EnemyClass->GetDefaultObject<ATDSEnemyCharacter>()->GetHordeProxyMesh() != nullptr;
+}
+
+bool UTDSHordeSubsystem::SpawnProxy(TSubclassOf<ATDSEnemyCharacter> EnemyClass, const FTransform& Transform, UTDSEnemyArchetype* EnemyArchetype)
+{
+	if (!CanUseProxies(EnemyClass))
+	{
+		return false;
+	}
+
+	const int32 ArchetypeIndex = FindOrAddArchetype(EnemyClass, EnemyArchetype);
+	if (ArchetypeIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	FTDSHordeArchetype& Archetype = Archetypes[ArchetypeIndex];
+	UInstancedStaticMeshComponent* Mesh = Archetype.Mesh.Get();
+	if (!Mesh)
+	{
+		return false;
+	}
+
+	// Reuse a hidden instance if there is one, so existing instance indices never move
+	int32 Slot = INDEX_NONE;
+	if (Archetype.FreeSlots.Num() > 0)
+	{
+		Slot = Archetype.FreeSlots.Pop(EAllowShrinking::No);
+	}
+	else
+	{
+		Slot = Mesh->AddInstance(HiddenInstanceTransform, true);
+		Archetype.Alive.AddZeroed();
+		Archetype.Locations.AddZeroed();
+		Archetype.Yaws.AddZeroed();
+		Archetype.Healths.AddZeroed();
+		Archetype.States.AddZeroed();
+		Archetype.SlotAngles.AddZeroed();
+		Archetype.AttackCooldowns.AddZeroed();
+		Archetype.WanderTargets.AddZeroed();
+		Archetype.WanderWaits.AddZeroed();
+	}
+
+	Archetype.Alive[Slot] = 1;
+	Archetype.Locations[Slot] = Transform.GetLocation();
+	Archetype.Yaws[Slot] = Transform.Rotator().Yaw;
+	Archetype.Healths[Slot] = Archetype.Settings.MaxHealth;
+	Archetype.States[Slot] = EEnemyState::Idle;
+	Archetype.SlotAngles[Slot] = 0.f;
+	Archetype.AttackCooldowns[Slot] = 0.f;
+	Archetype.WanderTargets[Slot] = Transform.GetLocation();
+	Archetype.WanderWaits[Slot] = FMath::FRandRange(Archetype.Settings.WanderPauseMin, Archetype.Settings.WanderPauseMax);
+
+	NumProxies++;
+	return true;
+}
+
+int32 UTDSHordeSubsystem::FindOrAddArchetype(TSubclassOf<ATDSEnemyCharacter> EnemyClass, UTDSEnemyArchetype* EnemyArchetype)
+{
+	const int32 ExistingIndex = Archetypes.IndexOfByPredicate([EnemyClass, EnemyArchetype](const FTDSHordeArchetype& Archetype)
+	{
+		return Archetype.EnemyClass == EnemyClass && Archetype.EnemyArchetype.Get() == EnemyArchetype;
+	});
+
+	if (ExistingIndex != INDEX_NONE)
+	{
+		return ExistingIndex;
+	}
+
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return INDEX_NONE;
+	}
+
+	// Each enemy class gets its own hidden host, so a hit's actor and instance index identify the proxy
+	FActorSpawnParameters Params;
+	Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AActor* Host = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, Params);
+	if (!Host)
+	{
+		return INDEX_NONE;
+	}
+
+	USceneComponent* HostRoot = NewObject<USceneComponent>(Host, TEXT("Root"));
+	Host->SetRootComponent(HostRoot);
+	HostRoot->RegisterComponent();
+
+	FTDSHordeArchetype& NewArchetype = Archetypes.AddDefaulted_GetRef();
+	NewArchetype.EnemyClass = EnemyClass;
+	NewArchetype.EnemyArchetype = EnemyArchetype;
+
+	// Copy the tuning from the class defaults and the archetype, so a proxy plays like the actor it stands in for
+	const ATDSEnemyCharacter* EnemyDefaults = EnemyClass->GetDefaultObject<ATDSEnemyCharacter>();
+	EnemyDefaults->FillHordeSettings(NewArchetype.Settings, EnemyArchetype);
+
+	// Proxies are hurtboxes like the enemy capsule, but never block anything physically
+	UInstancedStaticMeshComponent* Mesh = NewObject<UInstancedStaticMeshComponent>(Host);
+	Mesh->SetupAttachment(Host->GetRootComponent());
+	Mesh->SetStaticMesh(NewArchetype.Settings.ProxyMesh);
+	Mesh->SetCollisionProfileName(TDSCollisionProfiles::EnemyHurtbox);
+	Mesh->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	Mesh->SetGenerateOverlapEvents(false);
+	Mesh->SetCanEverAffectNavigation(false);
+	Mesh->SetMobility(EComponentMobility::Movable);
+	Mesh->RegisterComponent();
+
+	NewArchetype.Host = Host;
+	NewArchetype.Mesh = Mesh;
+	HostActors.Add(Host);
+
+	return Archetypes.Num() - 1;
+}
+
+bool UTDSHordeSubsystem::IsProxyHost(const AActor* Actor) const
+{
+	return Actor && HostActors.Contains(Actor);
+}
+
+void UTDSHordeSubsystem::ReceiveResolvedDamage(const AActor* Host, int32 InstanceIndex, float Damage)
+{
+	const int32 ArchetypeIndex = HostActors.IndexOfByKey(Host);
+	if (!Archetypes.IsValidIndex(ArchetypeIndex))
+	{
+		return;
+	}
+
+	FTDSHordeArchetype& Archetype = Archetypes[ArchetypeIndex];
+	if (!Archetype.Alive.IsValidIndex(InstanceIndex) || !Archetype.Alive[InstanceIndex])
+	{
+		return;
+	}
+
+	const FTDSHordeSettings& Settings = Archetype.Settings;
+	const FVector Location = Archetype.Locations[InstanceIndex];
+
+	Archetype.Healths[InstanceIndex] = FMath::Clamp(Archetype.Healths[InstanceIndex] - Damage, 0.f, Settings.MaxHealth);
+
+	UTDSAudioEventSubsystem* Audio = GetWorld()->GetSubsystem<UTDSAudioEventSubsystem>();
+	if (Audio && Settings.HurtSound)
+	{
+		Audio->PlaySound(ETDSAudioCategory::Hurt, Settings.HurtSound, Location, Settings.HurtSoundVolume);
+	}
+
+	if (Archetype.Healths[InstanceIndex] > 0.f)
+	{
+		return;
+	}
+
+	// Same bookkeeping as ATDSEnemyCharacter::HandleDeath
+	RemoveProxy(Archetype, InstanceIndex);
+
+	if (UTDSGameInstance* GI = GetWorld()->GetGameInstance<UTDSGameInstance>())
+	{
+		GI->RecordEnemyEliminated();
+	}
+
+	if (Audio && Settings.DeathSound)
+	{
+		Audio->PlaySound(ETDSAudioCategory::Death, Settings.DeathSound, Location, Settings.DeathSoundVolume);
+	}
+
+	OnProxyDied.Broadcast();
+}
+
+void UTDSHordeSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	PromotedEnemies.RemoveAllSwap([](const TWeakObjectPtr<ATDSEnemyCharacter>& Enemy)
+	{
+		return !Enemy.IsValid() || Enemy->IsDead();
+	}, EAllowShrinking::No);
+
+	SET_DWORD_STAT(STAT_TDSHordeProxies, NumProxies);
+	SET_DWORD_STAT(STAT_TDSHordePromoted, PromotedEnemies.Num());
+
+	if (NumProxies == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TDSHordeTick);
+
+	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+
+	TArray<int32> Promotions;
+	for (FTDSHordeArchetype& Archetype : Archetypes)
+	{
+		Promotions.Reset();
+		TickArchetype(Archetype, DeltaTime, PlayerPawn, Promotions);
+
+		for (const int32 Slot : Promotions)
+		{
+			PromoteProxy(Archetype, Slot);
+		}
+
+		UpdateInstances(Archetype);
+	}
+}
+
+void UTDSHordeSubsystem::TickArchetype(FTDSHordeArchetype& Archetype, float DeltaTime, APawn* PlayerPawn, TArray<int32>& OutPromotions)
+{
+	const FTDSHordeSettings& Settings = Archetype.Settings;
+
+	UTDSFlowFieldSubsystem* FlowField = GetWorld()->GetSubsystem<UTDSFlowFieldSubsystem>();
+	UTDSDamageSubsystem* DamageSubsystem = GetWorld()->GetSubsystem<UTDSDamageSubsystem>();
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	const FVector PlayerLocation = PlayerPawn ? PlayerPawn->GetActorLocation() : FVector::ZeroVector;
+	const float PromotionDistanceSq = FMath::Square(CVarTDSHordePromotionDistance.GetValueOnGameThread());
+	int32 PromotionsLeft = CVarTDSHordeMaxPromotedActors.GetValueOnGameThread() - PromotedEnemies.Num();
+
+	for (int32 Slot = 0; Slot < Archetype.Alive.Num(); ++Slot)
+	{
+		if (!Archetype.Alive[Slot])
+		{
+			continue;
+		}
+
+		FVector& Location = Archetype.Locations[Slot];
+		EEnemyState& State = Archetype.States[Slot];
+
+		const float Dist = PlayerPawn ? FVector::Dist2D(PlayerLocation, Location) : MAX_flt;
+
+		// Close enough to matter, hand over to a full actor
+		if (PlayerPawn && PromotionsLeft > 0 && FMath::Square(Dist) <= PromotionDistanceSq)
+		{
+			OutPromotions.Add(Slot);
+			PromotionsLeft--;
+			continue;
+		}
+
+		// Same transitions as FTDSEnemyDecision::TransitionForBand
+		const EEnemyState OldState = State;
+		switch (State)
+		{
+		case EEnemyState::Idle:
+			if (Dist <= Settings.ChaseDistance)
+			{
+				State = EEnemyState::Chasing;
+			}
+			break;
+		case EEnemyState::Chasing:
+			if (Dist <= Settings.AttackRange)
+			{
+				State = EEnemyState::Attacking;
+			}
+			else if (Dist > Settings.ChaseDistance)
+			{
+				State = EEnemyState::Idle;
+			}
+			break;
+		case EEnemyState::Attacking:
+			if (Dist > Settings.ChaseDistance)
+			{
+				State = EEnemyState::Idle;
+			}
+			else if (Dist > Settings.AttackRange)
+			{
+				State = EEnemyState::Chasing;
+			}
+			break;
+		}
+
+		if (State != OldState && State == EEnemyState::Chasing)
+		{
+			// Keep the side of the player we approached from as our slot
+			const FVector2D FromPlayer(Location.X - PlayerLocation.X, Location.Y - PlayerLocation.Y);
+			Archetype.SlotAngles[Slot] = FMath::Atan2(FromPlayer.Y, FromPlayer.X);
+		}
+
+		FVector MoveDirection = FVector::ZeroVector;
+
+		switch (State)
+		{
+		case EEnemyState::Idle:
+		{
+			// Pause, then walk to a random reachable point, like the controller's wander
+			float& WanderWait = Archetype.WanderWaits[Slot];
+			if (WanderWait > 0.f)
+			{
+				WanderWait -= DeltaTime;
+				if (WanderWait <= 0.f && NavSys)
+				{
+					FNavLocation WanderPoint;
+					if (NavSys->GetRandomReachablePointInRadius(Location, Settings.WanderRadius, WanderPoint))
+					{
+						Archetype.WanderTargets[Slot] = WanderPoint.Location;
+					}
+				}
+				break;
+			}
+
+			const FVector ToTarget = Archetype.WanderTargets[Slot] - Location;
+			if (ToTarget.Size2D() <= WanderArriveDistance)
+			{
+				WanderWait = FMath::FRandRange(Settings.WanderPauseMin, Settings.WanderPauseMax);
+				break;
+			}
+
+			MoveDirection = ToTarget.GetSafeNormal2D();
+			break;
+		}
+		case EEnemyState::Chasing:
+		{
+			const float SlotAngle = Archetype.SlotAngles[Slot];
+			const FVector SlotTarget = PlayerLocation + FVector(FMath::Cos(SlotAngle), FMath::Sin(SlotAngle), 0.f) * Settings.SlotRadius;
+			const FVector ToSlot = SlotTarget - Location;
+
+			// The shared flow field keeps proxies out of walls while they are far away, the last stretch is a straight line
+			if (!FlowField || ToSlot.Size2D() <= Settings.FlowFieldHandoffDistance || !FlowField->SampleDirection(Location, MoveDirection))
+			{
+				MoveDirection = ToSlot.GetSafeNormal2D();
+			}
+			break;
+		}
+		case EEnemyState::Attacking:
+		{
+			// Only reached when the promotion cap is full, proxies then hit the player on the attack interval
+			float& Cooldown = Archetype.AttackCooldowns[Slot];
+			Cooldown -= DeltaTime;
+			if (Cooldown <= 0.f && DamageSubsystem && PlayerPawn)
+			{
+				DamageSubsystem->QueueDamage(PlayerPawn, Settings.AttackDamage, nullptr, Archetype.Host.Get(), PlayerLocation);
+				Cooldown = Settings.AttackInterval;
+			}
+			break;
+		}
+		}
+
+		Location += MoveDirection * Settings.MoveSpeed * DeltaTime;
+
+		// Face where we are going, or the player while fighting
+		if (State != EEnemyState::Idle && PlayerPawn)
+		{
+			Archetype.Yaws[Slot] = (PlayerLocation - Location).Rotation().Yaw;
+		}
+		else if (!MoveDirection.IsNearlyZero())
+		{
+			Archetype.Yaws[Slot] = MoveDirection.Rotation().Yaw;
+		}
+	}
+}
+
+void UTDSHordeSubsystem::PromoteProxy(FTDSHordeArchetype& Archetype, int32 Slot)
+{
+	const FTransform SpawnTransform(FRotator(0.f, Archetype.Yaws[Slot], 0.f), Archetype.Locations[Slot]);
+	const float Health = Archetype.Healths[Slot];
+
+	// Same spawn rules as ATDSEnemySpawner, deferred so the archetype is in place before the enemy begins play
+	// and its controller reads the tuning
+	ATDSEnemyCharacter* Enemy = GetWorld()->SpawnActorDeferred<ATDSEnemyCharacter>(Archetype.EnemyClass, SpawnTransform, nullptr, nullptr,
+		ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+	if (!Enemy)
+	{
+		return;
+	}
+
+	if (UTDSEnemyArchetype* EnemyArchetype = Archetype.EnemyArchetype.Get())
+	{
+		Enemy->SetArchetype(EnemyArchetype);
+	}
+	Enemy->FinishSpawning(SpawnTransform);
+
+	// Carry the damage the proxy took over to the actor
+	Enemy->SetCurrentHealth(Health);
+
+	RemoveProxy(Archetype, Slot);
+	PromotedEnemies.Add(Enemy);
+
+	INC_DWORD_STAT(STAT_TDSHordePromotions);
+
+	OnProxyPromoted.Broadcast(Enemy);
+}
+
+void UTDSHordeSubsystem::RemoveProxy(FTDSHordeArchetype& Archetype, int32 Slot)
+{
+	Archetype.Alive[Slot] = 0;
+	Archetype.FreeSlots.Add(Slot);
+	NumProxies--;
+}
+
+void UTDSHordeSubsystem::UpdateInstances(FTDSHordeArchetype& Archetype)
+{
+	UInstancedStaticMeshComponent* Mesh = Archetype.Mesh.Get();
+	if (!Mesh || Archetype.Alive.Num() == 0)
+	{
+		return;
+	}
+
+	const FTransform& MeshOffset = Archetype.Settings.ProxyMeshTransform;
+
+	Archetype.InstanceTransforms.Reset();
+	for (int32 Slot = 0; Slot < Archetype.Alive.Num(); ++Slot)
+	{
+		// Free instances are shrunk and parked out of sight, which also takes them out of hit tests
+		if (!Archetype.Alive[Slot])
+		{
+			Archetype.InstanceTransforms.Add(HiddenInstanceTransform);
+			continue;
+		}
+
+		const FTransform ActorTransform(FRotator(0.f, Archetype.Yaws[Slot], 0.f), Archetype.Locations[Slot]);
+		Archetype.InstanceTransforms.Add(MeshOffset * ActorTransform);
+	}
+
+	Mesh->BatchUpdateInstancesTransforms(0, Archetype.InstanceTransforms, true, true, true);
+}
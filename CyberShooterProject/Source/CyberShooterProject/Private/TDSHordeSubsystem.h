@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSEnemyAIController.h"
+#include "TDSHordeSubsystem.generated.h"
+
+class ATDSEnemyCharacter;
+class UTDSEnemyArchetype;
+class UInstancedStaticMeshComponent;
+class UStaticMesh;
+class USoundBase;
+
+DECLARE_MULTICAST_DELEGATE(FOnHordeProxyDied);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnHordeProxyPromoted, ATDSEnemyCharacter*);
+
+// Tuning a horde proxy copies from its enemy class and archetype, so proxies and full enemies play the same
+struct FTDSHordeSettings
+{
+	// From ATDSEnemyCharacter
+	TObjectPtr<UStaticMesh> ProxyMesh;
+	FTransform ProxyMeshTransform;
+	float MoveSpeed = 600.f;
+	TObjectPtr<USoundBase> HurtSound;
+	float HurtSoundVolume = 1.f;
+	TObjectPtr<USoundBase> DeathSound;
+	float DeathSoundVolume = 1.f;
+
+	// From the enemy's archetype tuning
+	float MaxHealth = 100.f;
+	float AttackRange = 150.f;
+	float AttackDamage = 10.f;
+	float ChaseDistance = 2000.f;
+	float AttackInterval = 0.8f;
+	float WanderRadius = 900.f;
+	float WanderPauseMin = 0.5f;
+	float WanderPauseMax = 1.5f;
+	float SlotRadius = 150.f;
+	float FlowFieldHandoffDistance = 400.f;
+};
+
+// Every proxy of one enemy class and archetype. Proxy data is kept as parallel arrays indexed by the proxy's instance in Mesh, so a hit on
+// an instance is a hit on the proxy with that index. Dead and promoted proxies leave a hidden instance behind that the next
+// spawn reuses, which keeps instance indices stable for hits that are still waiting to be resolved.
+struct FTDSHordeArchetype
+{
+	TSubclassOf<ATDSEnemyCharacter> EnemyClass;
+
+	// Archetype promoted proxies are spawned as, nullptr for the class's own
+	TWeakObjectPtr<UTDSEnemyArchetype> EnemyArchetype;
+
+	FTDSHordeSettings Settings;
+
+	// Renders and collides the proxies, owned by a hidden host actor
+	TWeakObjectPtr<AActor> Host;
+	TWeakObjectPtr<UInstancedStaticMeshComponent> Mesh;
+
+	TArray<uint8> Alive;
+	TArray<FVector> Locations;
+	TArray<float> Yaws;
+	TArray<float> Healths;
+	TArray<EEnemyState> States;
+	TArray<float> SlotAngles;
+	TArray<float> AttackCooldowns;
+	TArray<FVector> WanderTargets;
+	TArray<float> WanderWaits;
+
+	// Hidden instances ready for reuse
+	TArray<int32> FreeSlots;
+
+	// Scratch buffer for the instance transform upload
+	TArray<FTransform> InstanceTransforms;
+};
+
+// This subsystem runs enemies that are far from the player as lightweight proxies instead of full ATDSEnemyCharacter actors.
+// A proxy is a few entries in per-class arrays, drawn with one instanced static mesh per class, and its Idle / Chasing /
+// Attacking logic mirrors ATDSEnemyAIController: wandering between random reachable points, following the chase flow field
+// towards a slot around the player, and hitting the player on the attack interval. Once a proxy gets within
+// tds.Horde.PromotionDistance of the player it is swapped for a full enemy actor with the same health, up to
+// tds.Horde.MaxPromotedActors at a time, so melee, animation and hit reactions near the player are unchanged.
+UCLASS()
+class UTDSHordeSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only run proxies in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Whether enemies of this class can run as proxies (they need a HordeProxyMesh)
+	static bool CanUseProxies(TSubclassOf<ATDSEnemyCharacter> EnemyClass);
+
+	// Adds a proxy of the enemy class, tuned and later promoted as EnemyArchetype if given. Returns false if the class cannot run as a proxy.
+	bool SpawnProxy(TSubclassOf<ATDSEnemyCharacter> EnemyClass, const FTransform& Transform, UTDSEnemyArchetype* EnemyArchetype = nullptr);
+
+	// Whether Actor is the host of one of the horde's instanced meshes, hits on it are hits on a proxy
+	bool IsProxyHost(const AActor* Actor) const;
+
+	// Applies damage already summed by the damage subsystem to the proxy behind an instance of Host's mesh
+	void ReceiveResolvedDamage(const AActor* Host, int32 InstanceIndex, float Damage);
+
+	// Number of living proxies
+	int32 GetNumProxies() const { return NumProxies; }
+
+	// Broadcast when a proxy is killed while still a proxy
+	FOnHordeProxyDied OnProxyDied;
+
+	// Broadcast when a proxy is swapped for a full enemy actor, which reports its own death from then on
+	FOnHordeProxyPromoted OnProxyPromoted;
+
+private:
+	// Finds or creates the archetype for an enemy class and enemy archetype asset
+	int32 FindOrAddArchetype(TSubclassOf<ATDSEnemyCharacter> EnemyClass, UTDSEnemyArchetype* EnemyArchetype);
+
+	// Runs one archetype's proxies for a frame and collects the ones to promote
+	void TickArchetype(FTDSHordeArchetype& Archetype, float DeltaTime, APawn* PlayerPawn, TArray<int32>& OutPromotions);
+
+	// Swaps a proxy for a full enemy actor
+	void PromoteProxy(FTDSHordeArchetype& Archetype, int32 Slot);
+
+	// Frees a proxy's slot and hides its instance
+	void RemoveProxy(FTDSHordeArchetype& Archetype, int32 Slot);
+
+	// Uploads the archetype's instance transforms
+	void UpdateInstances(FTDSHordeArchetype& Archetype);
+
+	TArray<FTDSHordeArchetype> Archetypes;
+
+	// Host actor of each archetype's mesh, by archetype index
+	UPROPERTY()
+	TArray<TObjectPtr<AActor>> HostActors;
+
+	// Enemies promoted from proxies that are still alive, counted against the promotion cap
+	TArray<TWeakObjectPtr<ATDSEnemyCharacter>> PromotedEnemies;
+
+	int32 NumProxies = 0;
+};
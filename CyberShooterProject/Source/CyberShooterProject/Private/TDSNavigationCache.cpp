@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSNavigationCache.h"
+#include "NavigationData.h"
+
+namespace
+{
+	// Random locations tried by SampleWanderPoint before giving up
+	constexpr int32 WanderAttempts = 4;
+
+	// Largest height difference between a cell's centre and its corners for the cell to still count as one flat floor
+	constexpr float InteriorStepHeight = 30.f;
+
+	// Horizontal extent of the corner probes, small so a point just off the navmesh is not snapped onto it
+	constexpr float ProbeExtent = 5.f;
+}
+
+bool FTDSNavigationCache::ProjectPoint(const FVector& Point, float MaxHeightDifference, FVector& OutPoint) const
+{
+	const FIntPoint Cell = Grid->ToCell(Point);
+	if (!Grid->IsValidCell(Cell))
+	{
+		return false;
+	}
+
+	const int32 Index = Grid->ToIndex(Cell);
+	const float Height = Grid->CellPoints[Index].Z;
+	if (!Interior[Index] || FMath::Abs(Point.Z - Height) > MaxHeightDifference)
+	{
+		return false;
+	}
+
+	OutPoint = FVector(Point.X, Point.Y, Height);
+	return true;
+}
+
+bool FTDSNavigationCache::SampleWanderPoint(const FVector& Origin, float Radius, FVector& OutPoint) const
+{
+	// Only wander within the region we stand in. Its cells are joined to ours by straight navmesh runs between cell centres,
+	// so their wander points can be walked to. Points in other regions might be reachable too, but the grid cannot tell.
+	const FIntPoint OriginCell = Grid->ToCell(Origin);
+	if (!Grid->IsValidCell(OriginCell))
+	{
+		return false;
+	}
+
+	const int32 Region = Regions[Grid->ToIndex(OriginCell)];
+	if (Region == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const float RadiusSq = FMath::Square(Radius);
+
+	for (int32 Attempt = 0; Attempt < WanderAttempts; ++Attempt)
+	{
+		// A uniform random location in the circle picks the bucket, then a random point out of that bucket
+		const float Angle = FMath::FRand() * 2.f * PI;
+		const float Distance = Radius * FMath::Sqrt(FMath::FRand());
+		const FIntPoint Cell = Grid->ToCell(Origin + FVector(FMath::Cos(Angle) * Distance, FMath::Sin(Angle) * Distance, 0.f));
+		if (!Grid->IsValidCell(Cell))
+		{
+			continue;
+		}
+
+		const int32 Bucket = (Cell.Y / BucketCells) * BucketsX + Cell.X / BucketCells;
+		const int32 NumPoints = BucketStarts[Bucket + 1] - BucketStarts[Bucket];
+		if (NumPoints == 0)
+		{
+			continue;
+		}
+
+		const int32 PointIndex = BucketStarts[Bucket] + FMath::RandHelper(NumPoints);
+		if (Regions[WanderPointCells[PointIndex]] == Region && FVector::DistSquared2D(WanderPoints[PointIndex], Origin) <= RadiusSq)
+		{
+			OutPoint = WanderPoints[PointIndex];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+TSharedPtr<FTDSNavigationCache> FTDSNavigationCache::Build(const ANavigationData& NavData, const FBox& Bounds, const TSharedRef<const FTDSWalkabilityGrid>& InGrid)
+{
+	const FTDSWalkabilityGrid& CellGrid = *InGrid;
+
+	TSharedPtr<FTDSNavigationCache> Cache = MakeShared<FTDSNavigationCache>();
+	Cache->Grid = InGrid;
+
+	const int32 NumCells = CellGrid.Num();
+	Cache->Regions.Init(INDEX_NONE, NumCells);
+	Cache->Interior.Init(0, NumCells);
+
+	const float CellSize = CellGrid.CellSize;
+	const float CenterZ = Bounds.GetCenter().Z;
+	const float SearchHeight = Bounds.GetExtent().Z + 100.f;
+
+	// Corners are shared by four cells, so they are probed once on their own lattice. The centres were already sampled by the grid.
+	const int32 CornersX = CellGrid.SizeX + 1;
+	TArray<float> CornerHeights;
+	TBitArray<> CornerOnNavMesh(false, CornersX * (CellGrid.SizeY + 1));
+	CornerHeights.Init(0.f, CornerOnNavMesh.Num());
+
+	FNavLocation Projected;
+	for (int32 CornerY = 0; CornerY <= CellGrid.SizeY; ++CornerY)
+	{
+		for (int32 CornerX = 0; CornerX < CornersX; ++CornerX)
+		{
+			const FVector Corner(CellGrid.Origin.X + CornerX * CellSize, CellGrid.Origin.Y + CornerY * CellSize, CenterZ);
+			if (NavData.ProjectPoint(Corner, Projected, FVector(ProbeExtent, ProbeExtent, SearchHeight)))
+			{
+				const int32 CornerIndex = CornerY * CornersX + CornerX;
+				CornerOnNavMesh[CornerIndex] = true;
+				CornerHeights[CornerIndex] = Projected.Location.Z;
+			}
+		}
+	}
+
+	// A walkable cell is interior when all four of its corners are navmesh at about its centre's height
+	for (int32 CellY = 0; CellY < CellGrid.SizeY; ++CellY)
+	{
+		for (int32 CellX = 0; CellX < CellGrid.SizeX; ++CellX)
+		{
+			const int32 Index = CellGrid.ToIndex(FIntPoint(CellX, CellY));
+			if (!CellGrid.Walkable[Index])
+			{
+				continue;
+			}
+
+			Cache->Regions[Index] = 0;
+
+			bool bInterior = true;
+			for (int32 Corner = 0; Corner < 4 && bInterior; ++Corner)
+			{
+				const int32 CornerIndex = (CellY + Corner / 2) * CornersX + CellX + Corner % 2;
+				bInterior = CornerOnNavMesh[CornerIndex] && FMath::Abs(CornerHeights[CornerIndex] - CellGrid.CellPoints[Index].Z) <= InteriorStepHeight;
+			}
+			Cache->Interior[Index] = bInterior ? 1 : 0;
+		}
+	}
+
+	// Flood fill the walkable cells into connected regions through the grid's links, straight neighbours only. Cells either
+	// side of a thin wall or on two floors are both walkable but not linked, so they end up in different regions.
+	const FIntPoint StraightOffsets[4] = { FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1) };
+	int32 NumRegions = 0;
+	TArray<int32> Stack;
+	for (int32 Seed = 0; Seed < NumCells; ++Seed)
+	{
+		if (Cache->Regions[Seed] != 0)
+		{
+			continue;
+		}
+
+		const int32 Region = ++NumRegions;
+		Cache->Regions[Seed] = Region;
+		Stack.Add(Seed);
+
+		while (Stack.Num() > 0)
+		{
+			const int32 Index = Stack.Pop(EAllowShrinking::No);
+			const FIntPoint Cell(Index % CellGrid.SizeX, Index / CellGrid.SizeX);
+
+			for (const FIntPoint& Offset : StraightOffsets)
+			{
+				if (!CellGrid.IsLinked(Cell, Offset))
+				{
+					continue;
+				}
+
+				const int32 NeighbourIndex = CellGrid.ToIndex(Cell + Offset);
+				if (Cache->Regions[NeighbourIndex] == 0)
+				{
+					Cache->Regions[NeighbourIndex] = Region;
+					Stack.Add(NeighbourIndex);
+				}
+			}
+		}
+	}
+
+	// Bucket the wander points with a counting sort, so each bucket's points are contiguous
+	Cache->BucketsX = FMath::DivideAndRoundUp(CellGrid.SizeX, BucketCells);
+	Cache->BucketsY = FMath::DivideAndRoundUp(CellGrid.SizeY, BucketCells);
+	const int32 NumBuckets = Cache->BucketsX * Cache->BucketsY;
+	Cache->BucketStarts.Init(0, NumBuckets + 1);
+
+	const auto BucketOf = [&Cache, &CellGrid](int32 Index)
+	{
+		return (Index / CellGrid.SizeX / BucketCells) * Cache->BucketsX + (Index % CellGrid.SizeX) / BucketCells;
+	};
+
+	for (int32 Index = 0; Index < NumCells; ++Index)
+	{
+		if (Cache->Regions[Index] != INDEX_NONE)
+		{
+			Cache->BucketStarts[BucketOf(Index) + 1]++;
+		}
+	}
+
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		Cache->BucketStarts[Bucket + 1] += Cache->BucketStarts[Bucket];
+	}
+
+	const int32 NumPoints = Cache->BucketStarts[NumBuckets];
+	Cache->WanderPoints.SetNumUninitialized(NumPoints);
+	Cache->WanderPointCells.SetNumUninitialized(NumPoints);
+
+	TArray<int32> BucketFill(Cache->BucketStarts.GetData(), NumBuckets);
+	for (int32 Index = 0; Index < NumCells; ++Index)
+	{
+		if (Cache->Regions[Index] != INDEX_NONE)
+		{
+			const int32 PointIndex = BucketFill[BucketOf(Index)]++;
+			Cache->WanderPoints[PointIndex] = CellGrid.CellPoints[Index];
+			Cache->WanderPointCells[PointIndex] = Index;
+		}
+	}
+
+	return Cache;
+}
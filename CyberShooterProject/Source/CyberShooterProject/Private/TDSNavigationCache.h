@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TDSWalkabilityGrid.h"
+
+class ANavigationData;
+
+// Navmesh lookups for one room, precomputed once because rooms never change while they are played.
+// Laid over the cells of the room's walkability grid (see FTDSWalkabilityGrid), it adds for every cell:
+// - whether the whole cell is navmesh at about its centre's height ("interior"), so a point anywhere inside an interior
+//   cell can be projected by just replacing its Z
+// - the connected walkable region it belongs to, so wander points can be limited to the region an enemy stands in.
+//   Regions are the grid's walkable cells joined through its links.
+// The grid's projected cell centres double as wander points, stored bucket by bucket so one can be picked near any
+// location without searching. Built by Build, which only reads the navmesh, so it can run on a worker thread.
+struct FTDSNavigationCache
+{
+	// Walkability grid the cache was built over, also shared with the flow field
+	TSharedPtr<const FTDSWalkabilityGrid> Grid;
+
+	// Connected walkable region of each cell, INDEX_NONE where the cell centre is not on the navmesh
+	TArray<int32> Regions;
+
+	// Non zero where the whole cell is navmesh at its centre's height
+	TArray<uint8> Interior;
+
+	// Cells per wander bucket side
+	static constexpr int32 BucketCells = 4;
+	int32 BucketsX = 0;
+	int32 BucketsY = 0;
+
+	// Wander points sorted by bucket, the points of bucket B are [BucketStarts[B], BucketStarts[B + 1])
+	TArray<FVector> WanderPoints;
+	TArray<int32> WanderPointCells;
+	TArray<int32> BucketStarts;
+
+	// How long the grid and the cache took to build, for the log
+	double BuildSeconds = 0.0;
+
+	// Projects Point onto the navmesh if it lies in an interior cell within MaxHeightDifference of the navmesh.
+	// Returns false on a miss, the caller should ask the navigation system instead.
+	bool ProjectPoint(const FVector& Point, float MaxHeightDifference, FVector& OutPoint) const;
+
+	// Picks a random wander point within Radius of Origin, in the same walkable region. Makes a fixed number of attempts
+	// and returns false if they all miss, the caller should ask the navigation system instead.
+	bool SampleWanderPoint(const FVector& Origin, float Radius, FVector& OutPoint) const;
+
+	// Builds the cache over InGrid, which was sampled from NavData over Bounds. Only the cell corners are probed again.
+	static TSharedPtr<FTDSNavigationCache> Build(const ANavigationData& NavData, const FBox& Bounds, const TSharedRef<const FTDSWalkabilityGrid>& InGrid);
+};
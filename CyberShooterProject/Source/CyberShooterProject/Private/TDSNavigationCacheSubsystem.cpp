@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSNavigationCacheSubsystem.h"
+#include "CyberShooterProject.h"
+#include "NavigationSystem.h"
+#include "NavigationData.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+
+DECLARE_CYCLE_STAT(TEXT("Nav Cache Build"), STAT_TDSNavCacheBuild, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Nav Cache Wander Hits"), STAT_TDSNavCacheWanderHits, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Nav Cache Wander Misses"), STAT_TDSNavCacheWanderMisses, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Nav Cache Projection Hits"), STAT_TDSNavCacheProjectionHits, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Nav Cache Projection Misses"), STAT_TDSNavCacheProjectionMisses, STATGROUP_CyberShooter);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Nav Cache Wander Hit %"), STAT_TDSNavCacheWanderHitRate, STATGROUP_CyberShooter);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Nav Cache Projection Hit %"), STAT_TDSNavCacheProjectionHitRate, STATGROUP_CyberShooter);
+
+static TAutoConsoleVariable<bool> CVarTDSNavCache(
+	TEXT("tds.NavCache.Enable"),
+	true,
+	TEXT("Answer wander point and combat slot projection queries from the room's navigation cache. 0 sends every query to the navigation system."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTDSNavCacheCellSize(
+	TEXT("tds.NavCache.CellSize"),
+	100.f,
+	TEXT("Cell size of the room's walkability grid, used by both the navigation cache and the chase flow field. Read when a room loads, ")
+	TEXT("grown automatically so a room never needs more than 256 cells a side."),
+	ECVF_Default);
+
+namespace
+{
+	// Largest grid side, bounds the grid and the cache to 64k cells however big the room is
+	constexpr int32 MaxCacheSide = 256;
+}
+
+bool UTDSNavigationCacheSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSNavigationCacheSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Rooms are levels, so this is room load
+	TryLaunchBuild();
+}
+
+void UTDSNavigationCacheSubsystem::Deinitialize()
+{
+	// The build reads the navmesh, wait for it so it does not outlive the world
+	if (BuildTask.IsValid())
+	{
+		BuildTask.Wait();
+		BuildTask = {};
+	}
+
+	Cache.Reset();
+
+	SET_FLOAT_STAT(STAT_TDSNavCacheWanderHitRate, 0.f);
+	SET_FLOAT_STAT(STAT_TDSNavCacheProjectionHitRate, 0.f);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSNavigationCacheSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSNavigationCacheSubsystem, STATGROUP_Tickables);
+}
+
+void UTDSNavigationCacheSubsystem::TryLaunchBuild()
+{
+	if (bBuildLaunched)
+	{
+		return;
+	}
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate) : nullptr;
+	if (!NavData)
+	{
+		return;
+	}
+
+	const FBox Bounds = NavData->GetBounds();
+	if (!Bounds.IsValid)
+	{
+		return;
+	}
+
+	bBuildLaunched = true;
+
+	// The room's navmesh is static, so reading it from a worker is safe, and Deinitialize waits for the build before it goes away
+	const float CellSize = CVarTDSNavCacheCellSize.GetValueOnGameThread();
+	BuildTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [NavData, Bounds, CellSize]()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TDSNavCacheBuild);
+
+		const double StartTime = FPlatformTime::Seconds();
+		const TSharedRef<const FTDSWalkabilityGrid> Grid = FTDSWalkabilityGrid::Build(*NavData, Bounds, CellSize, MaxCacheSide).ToSharedRef();
+		TSharedPtr<FTDSNavigationCache> BuiltCache = FTDSNavigationCache::Build(*NavData, Bounds, Grid);
+		BuiltCache->BuildSeconds = FPlatformTime::Seconds() - StartTime;
+		return BuiltCache;
+	});
+}
+
+void UTDSNavigationCacheSubsystem::FinishBuild()
+{
+	TryLaunchBuild();
+
+	if (BuildTask.IsValid())
+	{
+		BuildTask.Wait();
+		SwapInBuild();
+	}
+}
+
+void UTDSNavigationCacheSubsystem::SwapInBuild()
+{
+	Cache = BuildTask.GetResult();
+	BuildTask = {};
+
+	UE_LOG(LogTemp, Log, TEXT("Navigation cache built in %.1f ms: %d x %d cells of %.0f, %d wander points"),
+		Cache->BuildSeconds * 1000.0, Cache->Grid->SizeX, Cache->Grid->SizeY, Cache->Grid->CellSize, Cache->WanderPoints.Num());
+}
+
+void UTDSNavigationCacheSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// The navmesh may only show up after begin play
+	TryLaunchBuild();
+
+	// Swap in the finished build
+	if (BuildTask.IsValid() && BuildTask.IsCompleted())
+	{
+		SwapInBuild();
+	}
+
+	UpdateHitRateStats(DeltaTime);
+}
+
+bool UTDSNavigationCacheSubsystem::SampleWanderPoint(const FVector& Origin, float Radius, FVector& OutPoint)
+{
+	if (CVarTDSNavCache.GetValueOnGameThread() && Cache.IsValid() && Cache->SampleWanderPoint(Origin, Radius, OutPoint))
+	{
+		INC_DWORD_STAT(STAT_TDSNavCacheWanderHits);
+		WanderHits++;
+		return true;
+	}
+
+	INC_DWORD_STAT(STAT_TDSNavCacheWanderMisses);
+	WanderMisses++;
+	return false;
+}
+
+bool UTDSNavigationCacheSubsystem::ProjectPoint(const FVector& Point, float MaxHeightDifference, FVector& OutPoint)
+{
+	if (CVarTDSNavCache.GetValueOnGameThread() && Cache.IsValid() && Cache->ProjectPoint(Point, MaxHeightDifference, OutPoint))
+	{
+		INC_DWORD_STAT(STAT_TDSNavCacheProjectionHits);
+		ProjectionHits++;
+		return true;
+	}
+
+	INC_DWORD_STAT(STAT_TDSNavCacheProjectionMisses);
+	ProjectionMisses++;
+	return false;
+}
+
+void UTDSNavigationCacheSubsystem::UpdateHitRateStats(float DeltaTime)
+{
+	TimeUntilStatUpdate -= DeltaTime;
+	if (TimeUntilStatUpdate > 0.f)
+	{
+		return;
+	}
+	TimeUntilStatUpdate = 1.f;
+
+	const int32 WanderQueries = WanderHits + WanderMisses;
+	const int32 ProjectionQueries = ProjectionHits + ProjectionMisses;
+	SET_FLOAT_STAT(STAT_TDSNavCacheWanderHitRate, WanderQueries > 0 ? 100.f * WanderHits / WanderQueries : 0.f);
+	SET_FLOAT_STAT(STAT_TDSNavCacheProjectionHitRate, ProjectionQueries > 0 ? 100.f * ProjectionHits / ProjectionQueries : 0.f);
+
+	WanderHits = 0;
+	WanderMisses = 0;
+	ProjectionHits = 0;
+	ProjectionMisses = 0;
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Task.h"
+#include "TDSNavigationCache.h"
+#include "TDSNavigationCacheSubsystem.generated.h"
+
+// This subsystem answers the AI's most repeated navmesh queries from a per-room cache instead of the navigation system.
+// When the room loads, the room's walkability grid (see FTDSWalkabilityGrid) and the cache over it (see FTDSNavigationCache)
+// are built on a worker thread from the room's navmesh. From then on wander targets are picked and combat slots projected
+// with a couple of array lookups, and only queries the cache cannot answer (near walls, steps, or before the cache is ready)
+// go to the navigation system. Hits and misses are counted in stat CyberShooter. The grid is also handed to the flow field,
+// so the room's navmesh is only sampled once.
+UCLASS()
+class UTDSNavigationCacheSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only cache navigation in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Picks a random reachable point within Radius of Origin from the cache. Returns false on a miss, the caller should
+	// fall back to GetRandomReachablePointInRadius.
+	bool SampleWanderPoint(const FVector& Origin, float Radius, FVector& OutPoint);
+
+	// Projects Point onto the navmesh from the cache, for points at most MaxHeightDifference above or below it. Returns false
+	// on a miss, the caller should fall back to ProjectPointToNavigation.
+	bool ProjectPoint(const FVector& Point, float MaxHeightDifference, FVector& OutPoint);
+
+	bool IsReady() const { return Cache.IsValid(); }
+
+	// The room's walkability grid, null until the build has finished
+	TSharedPtr<const FTDSWalkabilityGrid> GetWalkabilityGrid() const { return Cache.IsValid() ? Cache->Grid : nullptr; }
+
+	// Launches the build if it has not started yet and waits for it, for benchmarks that are allowed to hitch
+	void FinishBuild();
+
+private:
+	// Starts the build on a worker thread once the room's navmesh is there
+	void TryLaunchBuild();
+
+	// Takes over the result of the finished build
+	void SwapInBuild();
+
+	// Pushes the per second hit rates to the stat system
+	void UpdateHitRateStats(float DeltaTime);
+
+	// Cache in use, and the build that will produce it
+	TSharedPtr<FTDSNavigationCache> Cache;
+	UE::Tasks::TTask<TSharedPtr<FTDSNavigationCache>> BuildTask;
+	bool bBuildLaunched = false;
+
+	// Hits and misses since the hit rates were last pushed
+	int32 WanderHits = 0;
+	int32 WanderMisses = 0;
+	int32 ProjectionHits = 0;
+	int32 ProjectionMisses = 0;
+	float TimeUntilStatUpdate = 1.f;
+};
@@ -0,0 +1,281 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSPathRequestSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSEnemyAIController.h"
+#include "NavigationSystem.h"
+#include "NavigationData.h"
+#include "NavFilters/NavigationQueryFilter.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+
+DECLARE_CYCLE_STAT(TEXT("Path Request Dispatch"), STAT_TDSPathDispatch, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path Requests Queued"), STAT_TDSPathQueued, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path Requests Dropped"), STAT_TDSPathDropped, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path Requests Completed"), STAT_TDSPathCompleted, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Path Requests Pending"), STAT_TDSPathPending, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Path Requests In Flight"), STAT_TDSPathInFlight, STATGROUP_CyberShooter);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Path Request Latency (ms)"), STAT_TDSPathLatency, STATGROUP_CyberShooter);
+
+static TAutoConsoleVariable<bool> CVarTDSAsyncPaths(
+	TEXT("tds.AI.AsyncPaths"),
+	true,
+	TEXT("Route enemy moves through the budgeted async path request queue. When off, enemies pathfind synchronously with MoveToLocation."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTDSPathBudgetUs(
+	TEXT("tds.AI.PathBudgetUs"),
+	150.f,
+	TEXT("Game thread time in microseconds the path request queue may spend sending requests each frame. At least one request is always sent."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTDSMaxPathsInFlight(
+	TEXT("tds.AI.MaxPathsInFlight"),
+	16,
+	TEXT("Most path searches the queue keeps running on the navigation worker at once."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTDSRepathDistance(
+	TEXT("tds.AI.RepathDistance"),
+	40.f,
+	TEXT("A new path request is skipped while the enemy is still moving to a goal closer than this to the new one."),
+	ECVF_Default);
+
+bool UTDSPathRequestSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSPathRequestSubsystem::Deinitialize()
+{
+	// Results still on their way are ignored once their query is gone
+	Pending.Empty();
+	InFlight.Empty();
+	PathAgents.Empty();
+
+	SET_DWORD_STAT(STAT_TDSPathPending, 0);
+	SET_DWORD_STAT(STAT_TDSPathInFlight, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSPathRequestSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSPathRequestSubsystem, STATGROUP_Tickables);
+}
+
+bool UTDSPathRequestSubsystem::RequestPath(ATDSEnemyAIController* Controller, const FVector& Goal, float AcceptanceRadius, ETDSPathPriority Priority)
+{
+	if (!Controller)
+	{
+		return false;
+	}
+
+	if (!CVarTDSAsyncPaths.GetValueOnGameThread())
+	{
+		Controller->MoveToLocation(Goal, AcceptanceRadius, true);
+		return true;
+	}
+
+	FTDSPathAgent& Agent = PathAgents.FindOrAdd(Controller);
+
+	const int32 PendingIndex = Pending.IndexOfByPredicate([Controller](const FTDSPathRequest& Request)
+	{
+		return Request.Controller == Controller;
+	});
+
+	// Skip the request if we are already on our way (or about to be) to nearly the same place
+	const bool bOnItsWay = PendingIndex != INDEX_NONE || Agent.bAwaitingPath || Controller->GetMoveStatus() == EPathFollowingStatus::Moving;
+	if (bOnItsWay && Agent.bHasLastGoal && FVector::DistSquared(Agent.LastGoal, Goal) < FMath::Square(CVarTDSRepathDistance.GetValueOnGameThread()))
+	{
+		INC_DWORD_STAT(STAT_TDSPathDropped);
+		return false;
+	}
+
+	Agent.LastGoal = Goal;
+	Agent.bHasLastGoal = true;
+
+	// Replace our queued request rather than queueing twice, keeping its place in line
+	if (PendingIndex != INDEX_NONE)
+	{
+		FTDSPathRequest& Request = Pending[PendingIndex];
+		Request.Goal = Goal;
+		Request.AcceptanceRadius = AcceptanceRadius;
+		Request.Priority = FMath::Min(Request.Priority, Priority);
+
+		INC_DWORD_STAT(STAT_TDSPathDropped);
+		return true;
+	}
+
+	FTDSPathRequest& Request = Pending.AddDefaulted_GetRef();
+	Request.Controller = Controller;
+	Request.Goal = Goal;
+	Request.AcceptanceRadius = AcceptanceRadius;
+	Request.Priority = Priority;
+	Request.QueueTime = FPlatformTime::Seconds();
+
+	INC_DWORD_STAT(STAT_TDSPathQueued);
+	return true;
+}
+
+void UTDSPathRequestSubsystem::CancelRequests(ATDSEnemyAIController* Controller)
+{
+	FTDSPathAgent* Agent = PathAgents.Find(Controller);
+	if (!Agent)
+	{
+		return;
+	}
+
+	const int32 NumRemoved = Pending.RemoveAllSwap([Controller](const FTDSPathRequest& Request)
+	{
+		return Request.Controller == Controller;
+	}, EAllowShrinking::No);
+	INC_DWORD_STAT_BY(STAT_TDSPathDropped, NumRemoved);
+
+	// Any path still being searched belongs to an older generation now and is thrown away when it arrives
+	Agent->Generation++;
+	Agent->bAwaitingPath = false;
+	Agent->bHasLastGoal = false;
+}
+
+void UTDSPathRequestSubsystem::UnregisterController(ATDSEnemyAIController* Controller)
+{
+	CancelRequests(Controller);
+	PathAgents.Remove(Controller);
+}
+
+void UTDSPathRequestSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	DispatchRequests();
+
+	SET_DWORD_STAT(STAT_TDSPathPending, Pending.Num());
+	SET_DWORD_STAT(STAT_TDSPathInFlight, InFlight.Num());
+	SET_FLOAT_STAT(STAT_TDSPathLatency, AverageLatencyMs);
+}
+
+void UTDSPathRequestSubsystem::DispatchRequests()
+{
+	if (Pending.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TDSPathDispatch);
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!NavSys)
+	{
+		return;
+	}
+
+	// Most urgent first, then oldest first so nobody starves within a priority
+	Pending.Sort([](const FTDSPathRequest& A, const FTDSPathRequest& B)
+	{
+		if (A.Priority != B.Priority)
+		{
+			return A.Priority < B.Priority;
+		}
+		return A.QueueTime < B.QueueTime;
+	});
+
+	const uint64 BudgetCycles = static_cast<uint64>(FMath::Max(CVarTDSPathBudgetUs.GetValueOnGameThread(), 0.f) * 1e-6 / FPlatformTime::GetSecondsPerCycle64());
+	const int32 MaxInFlight = FMath::Max(CVarTDSMaxPathsInFlight.GetValueOnGameThread(), 1);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	int32 NumProcessed = 0;
+	while (NumProcessed < Pending.Num() && InFlight.Num() < MaxInFlight)
+	{
+		// Always send at least one request so the queue keeps moving on slow frames
+		if (NumProcessed > 0 && FPlatformTime::Cycles64() - StartCycles >= BudgetCycles)
+		{
+			break;
+		}
+
+		const FTDSPathRequest& Request = Pending[NumProcessed++];
+
+		ATDSEnemyAIController* Controller = Request.Controller.Get();
+		if (!Controller || !Controller->GetPawn())
+		{
+			INC_DWORD_STAT(STAT_TDSPathDropped);
+			continue;
+		}
+
+		const FNavAgentProperties& AgentProperties = Controller->GetNavAgentPropertiesRef();
+		const FVector Start = Controller->GetNavAgentLocation();
+
+		const ANavigationData* NavData = NavSys->GetNavDataForProps(AgentProperties, Start);
+		if (!NavData)
+		{
+			INC_DWORD_STAT(STAT_TDSPathDropped);
+			continue;
+		}
+
+		FPathFindingQuery Query(Controller, *NavData, Start, Request.Goal,
+			UNavigationQueryFilter::GetQueryFilter(*NavData, Controller, Controller->GetDefaultNavigationFilterClass()));
+		Query.SetAllowPartialPaths(true);
+
+		const uint32 QueryId = NavSys->FindPathAsync(AgentProperties, Query,
+			FNavPathQueryDelegate::CreateUObject(this, &UTDSPathRequestSubsystem::OnPathFound));
+
+		if (QueryId == INVALID_NAVQUERYID)
+		{
+			INC_DWORD_STAT(STAT_TDSPathDropped);
+			continue;
+		}
+
+		// A new search supersedes whatever was still being searched for this controller
+		FTDSPathAgent& Agent = PathAgents.FindOrAdd(Controller);
+		Agent.Generation++;
+		Agent.bAwaitingPath = true;
+
+		FTDSPathQuery& PathQuery = InFlight.Add(QueryId);
+		PathQuery.Controller = Controller;
+		PathQuery.Goal = Request.Goal;
+		PathQuery.AcceptanceRadius = Request.AcceptanceRadius;
+		PathQuery.QueueTime = Request.QueueTime;
+		PathQuery.Generation = Agent.Generation;
+	}
+
+	Pending.RemoveAt(0, NumProcessed, EAllowShrinking::No);
+}
+
+void UTDSPathRequestSubsystem::OnPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path)
+{
+	FTDSPathQuery PathQuery;
+	if (!InFlight.RemoveAndCopyValue(QueryId, PathQuery))
+	{
+		return;
+	}
+
+	ATDSEnemyAIController* Controller = PathQuery.Controller.Get();
+	FTDSPathAgent* Agent = Controller ? PathAgents.Find(Controller) : nullptr;
+
+	// Cancelled or replaced while it was being searched
+	if (!Agent || Agent->Generation != PathQuery.Generation)
+	{
+		INC_DWORD_STAT(STAT_TDSPathDropped);
+		return;
+	}
+
+	Agent->bAwaitingPath = false;
+
+	const float LatencyMs = static_cast<float>((FPlatformTime::Seconds() - PathQuery.QueueTime) * 1000.0);
+	AverageLatencyMs = FMath::Lerp(AverageLatencyMs, LatencyMs, 0.1f);
+
+	INC_DWORD_STAT(STAT_TDSPathCompleted);
+
+	if (Result == ENavigationQueryResult::Success && Path.IsValid())
+	{
+		Controller->ReceivePath(PathQuery.Goal, PathQuery.AcceptanceRadius, Path);
+	}
+	else
+	{
+		// Let the next request through straight away instead of skipping it as a duplicate of this failed one
+		Agent->bHasLastGoal = false;
+	}
+}
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NavigationSystemTypes.h"
+#include "TDSPathRequestSubsystem.generated.h"
+
+class ATDSEnemyAIController;
+
+// How urgent a path request is, most urgent first
+enum class ETDSPathPriority : uint8
+{
+	// Chasers closing in on the player, about to attack
+	Attacking,
+
+	// Chasers heading for their combat slot
+	Chasing,
+
+	// Idle enemies wandering around
+	Wandering
+};
+
+// A path request waiting in the queue
+struct FTDSPathRequest
+{
+	TWeakObjectPtr<ATDSEnemyAIController> Controller;
+	FVector Goal = FVector::ZeroVector;
+	float AcceptanceRadius = 0.f;
+	ETDSPathPriority Priority = ETDSPathPriority::Wandering;
+
+	// When the request was first queued, for latency
+	double QueueTime = 0.0;
+};
+
+// A path request handed to the navigation system and waiting for its result
+struct FTDSPathQuery
+{
+	TWeakObjectPtr<ATDSEnemyAIController> Controller;
+	FVector Goal = FVector::ZeroVector;
+	float AcceptanceRadius = 0.f;
+	double QueueTime = 0.0;
+
+	// Generation of the controller's requests when this one was sent, results from older generations are thrown away
+	uint32 Generation = 0;
+};
+
+// What the scheduler remembers about each controller
+struct FTDSPathAgent
+{
+	// Goal of the last request that was queued
+	FVector LastGoal = FVector::ZeroVector;
+	bool bHasLastGoal = false;
+
+	// Whether a path is being searched for the controller
+	bool bAwaitingPath = false;
+
+	// Bumped whenever the controller's outstanding requests are cancelled or replaced
+	uint32 Generation = 0;
+};
+
+// This subsystem spreads enemy pathfinding out over frames. Instead of every enemy calling MoveToLocation (a synchronous
+// pathfind on the game thread) whenever its repath cooldown runs out, enemies queue a request here:
+// - a request is skipped when the enemy is still following a path to a goal that has barely moved
+// - a newer request from the same enemy replaces its queued one
+// - each frame queued requests are sent to the navigation system's async pathfinder, most urgent and oldest first, until the
+//   frame's budget (tds.AI.PathBudgetUs) or the in flight limit (tds.AI.MaxPathsInFlight) is reached
+// - when a path comes back the enemy starts following it, unless its requests were cancelled in the meantime
+UCLASS()
+class UTDSPathRequestSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only schedule paths in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Queues a path to Goal for the controller, or moves it straight away with MoveToLocation when tds.AI.AsyncPaths is off.
+	// Returns false if the request was skipped because the controller is already on its way to about the same goal.
+	bool RequestPath(ATDSEnemyAIController* Controller, const FVector& Goal, float AcceptanceRadius, ETDSPathPriority Priority);
+
+	// Drops the controller's queued request and ignores any path still being searched for it, used when it stops moving or changes state
+	void CancelRequests(ATDSEnemyAIController* Controller);
+
+	// Forgets a controller entirely, used when it loses its pawn
+	void UnregisterController(ATDSEnemyAIController* Controller);
+
+	// Number of requests waiting to be sent
+	int32 GetNumQueued() const { return Pending.Num(); }
+
+private:
+	// Sends queued requests to the navigation system until the budget runs out
+	void DispatchRequests();
+
+	// Called by the navigation system when an async path search finishes
+	void OnPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path);
+
+	// Requests waiting to be sent
+	TArray<FTDSPathRequest> Pending;
+
+	// Requests sent to the navigation system, by query id
+	TMap<uint32, FTDSPathQuery> InFlight;
+
+	// Per controller bookkeeping
+	TMap<TObjectKey<ATDSEnemyAIController>, FTDSPathAgent> PathAgents;
+
+	// Smoothed time from queueing a request to its path arriving, in milliseconds
+	float AverageLatencyMs = 0.f;
+};
@@ -1,13 +1,178 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "TDSProjectile.h"
+#include "CyberShooterProject.h"
 
 #include "Components/SphereComponent.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Components/StaticMeshComponent.h"
+#include "TDSProjectilePoolSubsystem.h"
+#include "TDSDamageSubsystem.h"
+#include "TDSAudioEventSubsystem.h"
+#include "TDSCollisionChannels.h"
+#include "TDSCharacter.h"
+#include "TDSEffectSubsystem.h"
+#include "TimerManager.h"
+#include "NiagaraFunctionLibrary.h"
+#include "NiagaraComponent.h"
+#include "Engine/OverlapResult.h"
+#include "HAL/IConsoleManager.h"
 
 #include "Kismet/GameplayStatics.h"
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Effects Spawned"), STAT_TDSImpactEffectsSpawned, STATGROUP_CyberShooter);
+
+namespace
+{
+	// Collision pairs a set of projectiles takes part in, counted from what each projectile's bounds overlap
+	struct FTDSProjectilePairCounts
+	{
+		// Components whose bounds overlap a projectile, every one of these is a broadphase pair
+		int32 Candidates = 0;
+
+		// Candidates where neither side ignores the other, these reach the narrowphase for queries and sweeps
+		int32 QueryPairs = 0;
+
+		// Candidates where both sides also have a physics body, these reach the narrowphase of the physics simulation
+		int32 PhysicsPairs = 0;
+	};
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GTDSCollisionPairBenchmarkCommand(
+	TEXT("tds.Collision.PairBenchmark"),
+	TEXT("Fires N pooled projectiles (default 500) around the player and logs the broadphase and narrowphase pairs they make ")
+	TEXT("with the projectile collision profile, against the old WorldDynamic block-all, query and physics setup. Usage: tds.Collision.PairBenchmark [N]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UTDSProjectilePoolSubsystem* Pool = World ? World->GetSubsystem<UTDSProjectilePoolSubsystem>() : nullptr;
+		if (!Pool)
+		{
+			return;
+		}
+
+		const int32 NumProjectiles = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 500;
+
+		// Fire the player's own projectile class from around the player, so the room's real geometry and enemies are in the way
+		APawn* Player = UGameplayStatics::GetPlayerPawn(World, 0);
+		const ATDSCharacter* PlayerCharacter = Cast<ATDSCharacter>(Player);
+		const TSubclassOf<ATDSProjectile> ProjectileClass = PlayerCharacter && PlayerCharacter->GetProjectileClass()
+			? PlayerCharacter->GetProjectileClass() : TSubclassOf<ATDSProjectile>(ATDSProjectile::StaticClass());
+		const FVector Center = Player ? Player->GetActorLocation() : FVector::ZeroVector;
+
+		FRandomStream Random(1337);
+		TArray<ATDSProjectile*> Projectiles;
+		Projectiles.Reserve(NumProjectiles);
+		for (int32 Index = 0; Index < NumProjectiles; ++Index)
+		{
+			const FVector2D Offset = FVector2D(Random.FRandRange(-1.f, 1.f), Random.FRandRange(-1.f, 1.f)) * 1500.f;
+			const FTransform SpawnTransform(FRotator(0.f, Random.FRandRange(0.f, 360.f), 0.f), Center + FVector(Offset, 0.f));
+			if (ATDSProjectile* Projectile = Pool->AcquireProjectile(ProjectileClass, SpawnTransform, Player, Player, 0.f, 0.f))
+			{
+				Projectiles.Add(Projectile);
+			}
+		}
+
+		TSet<const UPrimitiveComponent*> ProjectileComponents;
+		for (const ATDSProjectile* Projectile : Projectiles)
+		{
+			ProjectileComponents.Add(Projectile->GetCollisionComponent());
+		}
+
+		// The old setup: every projectile a WorldDynamic body blocking all channels, with physics
+		auto LegacyResponse = [&ProjectileComponents](const UPrimitiveComponent* Component, ECollisionChannel Channel)
+		{
+			return ProjectileComponents.Contains(Component) ? ECR_Block : Component->GetCollisionResponseToChannel(Channel);
+		};
+		auto LegacyObjectType = [&ProjectileComponents](const UPrimitiveComponent* Component)
+		{
+			return ProjectileComponents.Contains(Component) ? ECC_WorldDynamic : Component->GetCollisionObjectType();
+		};
+		auto LegacyHasPhysics = [&ProjectileComponents](const UPrimitiveComponent* Component)
+		{
+			return ProjectileComponents.Contains(Component) || CollisionEnabledHasPhysics(Component->GetCollisionEnabled());
+		};
+
+		FTDSProjectilePairCounts Before;
+		FTDSProjectilePairCounts After;
+
+		TArray<FOverlapResult> Overlaps;
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TDSCollisionPairBenchmark), false);
+		for (const ATDSProjectile* Projectile : Projectiles)
+		{
+			const UPrimitiveComponent* Self = Projectile->GetCollisionComponent();
+			if (!Self)
+			{
+				continue;
+			}
+
+			// Everything the projectile's bounds touch, whatever its object type or responses
+			Overlaps.Reset();
+			QueryParams.ClearIgnoredSourceObjects();
+			QueryParams.AddIgnoredComponent(Self);
+			const FBoxSphereBounds Bounds = Self->CalcBounds(Self->GetComponentTransform());
+			World->OverlapMultiByObjectType(
+				Overlaps,
+				Bounds.Origin,
+				FQuat::Identity,
+				FCollisionObjectQueryParams(FCollisionObjectQueryParams::AllObjects),
+				FCollisionShape::MakeBox(Bounds.BoxExtent),
+				QueryParams
+			);
+
+			for (const FOverlapResult& Overlap : Overlaps)
+			{
+				const UPrimitiveComponent* Other = Overlap.GetComponent();
+				if (!Other)
+				{
+					continue;
+				}
+
+				// Projectile pairs are seen from both projectiles, count them once
+				if (ProjectileComponents.Contains(Other) && Other < Self)
+				{
+					continue;
+				}
+
+				Before.Candidates++;
+				After.Candidates++;
+
+				const bool bLegacyQuery = LegacyResponse(Self, LegacyObjectType(Other)) != ECR_Ignore
+					&& LegacyResponse(Other, LegacyObjectType(Self)) != ECR_Ignore;
+				if (bLegacyQuery)
+				{
+					Before.QueryPairs++;
+					if (LegacyHasPhysics(Self) && LegacyHasPhysics(Other))
+					{
+						Before.PhysicsPairs++;
+					}
+				}
+
+				const bool bQuery = Self->GetCollisionResponseToChannel(Other->GetCollisionObjectType()) != ECR_Ignore
+					&& Other->GetCollisionResponseToChannel(Self->GetCollisionObjectType()) != ECR_Ignore;
+				if (bQuery)
+				{
+					After.QueryPairs++;
+					if (CollisionEnabledHasPhysics(Self->GetCollisionEnabled()) && CollisionEnabledHasPhysics(Other->GetCollisionEnabled()))
+					{
+						After.PhysicsPairs++;
+					}
+				}
+			}
+		}
+
+		for (ATDSProjectile* Projectile : Projectiles)
+		{
+			Pool->ReleaseProjectile(Projectile);
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("tds.Collision.PairBenchmark: %d projectiles of %s, %d broadphase pairs"),
+			Projectiles.Num(), *GetNameSafe(ProjectileClass.Get()), After.Candidates);
+		UE_LOG(LogTemp, Log, TEXT("tds.Collision.PairBenchmark: before (WorldDynamic, block all, query and physics) %d query pairs, %d physics pairs"),
+			Before.QueryPairs, Before.PhysicsPairs);
+		UE_LOG(LogTemp, Log, TEXT("tds.Collision.PairBenchmark: after (%s profile) %d query pairs, %d physics pairs"),
+			*TDSCollisionProfiles::Projectile.ToString(), After.QueryPairs, After.PhysicsPairs);
+	}));
+
 // Sets default values
 ATDSProjectile::ATDSProjectile()
 {
@@ -19,10 +184,9 @@ ATDSProjectile::ATDSProjectile()
     Collision = CreateDefaultSubobject<USphereComponent>(TEXT("Collision"));
     Collision->InitSphereRadius(10.f);
 
-	// This means the projectile will block all other objects
-    Collision->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-    Collision->SetCollisionObjectType(ECC_WorldDynamic);
-    Collision->SetCollisionResponseToAllChannels(ECR_Block);
+	// Query only: hits come from the movement sweep, so the projectile never needs a physics body.
+	// The profile blocks the world and enemy hurtboxes and ignores other projectiles and the player.
+    Collision->SetCollisionProfileName(TDSCollisionProfiles::Projectile);
     Collision->SetNotifyRigidBodyCollision(true);
 
 	// Set as root component
@@ -57,11 +221,31 @@ void ATDSProjectile::BeginPlay()
 	// When projectile hits something, call OnHit function
     Collision->OnComponentHit.AddDynamic(this, &ATDSProjectile::OnHit);
 
+	// Pooled projectiles start asleep and wait to be handed out
+	if (bPooled)
+	{
+		DeactivateProjectile();
+		return;
+	}
+
     // Auto-destroy after LifeSeconds
     SetLifeSpan(LifeSeconds);
 	
 }
 
+void ATDSProjectile::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bPooled)
+	{
+		if (UTDSProjectilePoolSubsystem* Pool = OwningPool.Get())
+		{
+			Pool->RemoveDestroyedProjectile(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void ATDSProjectile::OnHit(
     UPrimitiveComponent* HitComp,
     AActor* OtherActor,
@@ -69,29 +253,36 @@ void ATDSProjectile::OnHit(
     FVector NormalImpulse,
     const FHitResult& Hit)
 {
+    // Ignore late hits from a projectile that has already gone back to sleep
+    if (!bProjectileActive) return;
+
     // Prevent self-hit / weird cases
     if (!OtherActor || OtherActor == this || OtherActor == GetOwner()) return;
 
-    UGameplayStatics::ApplyDamage(
-        OtherActor,
-        Damage,
-        GetInstigatorController(),
-        this,
-        UDamageType::StaticClass()
-	);
-
-    if (ImpactSound)
+    // Queue the damage, the damage subsystem applies all of this frame's hits in one pass
+    if (UTDSDamageSubsystem* DamageSubsystem = GetWorld()->GetSubsystem<UTDSDamageSubsystem>())
     {
-        UGameplayStatics::PlaySoundAtLocation(
+        DamageSubsystem->QueueDamage(
+            OtherActor,
+            Damage,
+            GetInstigatorController(),
             this,
-            ImpactSound,
-            GetActorLocation(),
-            ImpactSoundVolume
+            Hit.ImpactPoint,
+            Hit.Item
         );
     }
 
-    // Later: apply damage here
-    Destroy();
+    if (ImpactSound)
+    {
+        if (UTDSAudioEventSubsystem* Audio = GetWorld()->GetSubsystem<UTDSAudioEventSubsystem>())
+        {
+            Audio->PlaySound(ETDSAudioCategory::Impact, ImpactSound, GetActorLocation(), ImpactSoundVolume);
+        }
+    }
+
+    SpawnImpactEffect(this, ImpactEffect, Hit);
+
+    ExpireProjectile();
 }
 
 void ATDSProjectile::InitialiseProjectile(float InDamage, float InSpeed)
@@ -105,3 +296,112 @@ void ATDSProjectile::InitialiseProjectile(float InDamage, float InSpeed)
         ProjectileMovement->Velocity = GetActorForwardVector() * InSpeed;
     }
 }
+
+
+void ATDSProjectile::SpawnImpactEffect(const UObject* WorldContextObject, UNiagaraSystem* Effect, const FHitResult& Hit)
+{
+	if (!Effect) return;
+
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UTDSEffectSubsystem* Effects = World ? World->GetSubsystem<UTDSEffectSubsystem>() : nullptr;
+
+	if (Effects)
+	{
+		Effects->SpawnEffect(Effect, Hit.ImpactPoint, Hit.ImpactNormal.Rotation());
+	}
+	else
+	{
+		// Worlds without the effect subsystem still take the component from the pool, they just are not counted
+		UNiagaraFunctionLibrary::SpawnSystemAtLocation(
+			WorldContextObject,
+			Effect,
+			Hit.ImpactPoint,
+			Hit.ImpactNormal.Rotation(),
+			FVector::OneVector,
+			true,
+			true,
+			ENCPoolMethod::AutoRelease
+		);
+	}
+
+	INC_DWORD_STAT(STAT_TDSImpactEffectsSpawned);
+}
+
+float ATDSProjectile::GetCollisionRadius() const
+{
+	return Collision ? Collision->GetUnscaledSphereRadius() : 0.f;
+}
+
+void ATDSProjectile::MarkAsPooled(UTDSProjectilePoolSubsystem* InPool)
+{
+	OwningPool = InPool;
+	bPooled = true;
+}
+
+void ATDSProjectile::ActivateProjectile(const FTransform& SpawnTransform, float InDamage, float InSpeed, float FlightTimeOffset)
+{
+	bProjectileActive = true;
+
+	// Move to the muzzle without sweeping, the projectile is not colliding yet
+	SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+
+	if (Collision)
+	{
+		Collision->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	}
+
+	if (ProjectileMovement)
+	{
+		// The movement component lets go of its updated component when it stops after a hit, so hook it back up
+		ProjectileMovement->SetUpdatedComponent(Collision);
+		ProjectileMovement->Activate(true);
+	}
+
+	InitialiseProjectile(InDamage, InSpeed);
+
+	// Put the projectile back to sleep once its lifetime runs out
+	GetWorldTimerManager().SetTimer(
+		LifeTimerHandle,
+		this,
+		&ATDSProjectile::ExpireProjectile,
+		FMath::Max(LifeSeconds - FlightTimeOffset, UE_KINDA_SMALL_NUMBER),
+		false
+	);
+}
+
+void ATDSProjectile::DeactivateProjectile()
+{
+	bProjectileActive = false;
+
+	GetWorldTimerManager().ClearTimer(LifeTimerHandle);
+
+	// Stop moving and stop colliding so a sleeping projectile costs nothing
+	if (ProjectileMovement)
+	{
+		ProjectileMovement->StopMovementImmediately();
+		ProjectileMovement->Deactivate();
+	}
+
+	if (Collision)
+	{
+		Collision->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+
+	SetActorHiddenInGame(true);
+}
+
+void ATDSProjectile::ExpireProjectile()
+{
+	// Return pooled projectiles for reuse, destroy the rest like before
+	if (bPooled)
+	{
+		if (UTDSProjectilePoolSubsystem* Pool = OwningPool.Get())
+		{
+			Pool->ReleaseProjectile(this);
+			return;
+		}
+	}
+
+	Destroy();
+}
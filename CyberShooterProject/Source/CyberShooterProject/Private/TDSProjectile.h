@@ -9,6 +9,8 @@
 class USphereComponent;
 class UProjectileMovementComponent;
 class USoundBase;
+class UNiagaraSystem;
+class UTDSProjectilePoolSubsystem;
 
 UCLASS()
 class ATDSProjectile : public AActor
@@ -21,10 +23,46 @@ public:
 
 	void InitialiseProjectile(float InDamage, float InSpeed);
 
+	// Wakes a pooled projectile up at the given transform and launches it with the given damage and speed.
+	// FlightTimeOffset is how long the projectile has already been flying, it is taken off its lifetime.
+	void ActivateProjectile(const FTransform& SpawnTransform, float InDamage, float InSpeed, float FlightTimeOffset = 0.f);
+
+	// Puts the projectile to sleep: hidden, no collision and no movement, ready to be reused by the pool
+	void DeactivateProjectile();
+
+	// Called by the pool before BeginPlay so the projectile recycles itself instead of being destroyed
+	void MarkAsPooled(UTDSProjectilePoolSubsystem* InPool);
+
+	// Whether the projectile is currently flying
+	bool IsProjectileActive() const { return bProjectileActive; }
+
+	// Returns how long the projectile lives before it expires
+	float GetLifeSeconds() const { return LifeSeconds; }
+
+	// Whether shots of this class are simulated by the batched projectile subsystem instead of as actors
+	bool UsesBatchedSimulation() const { return bUseBatchedSimulation; }
+
+	// The hitbox, which carries the projectile's collision profile
+	USphereComponent* GetCollisionComponent() const { return Collision; }
+
+	// Accessors used by the batched projectile subsystem to mirror this class without spawning it
+	float GetCollisionRadius() const;
+	const UStaticMeshComponent* GetMeshComponent() const { return Mesh; }
+	USoundBase* GetImpactSound() const { return ImpactSound; }
+	float GetImpactSoundVolume() const { return ImpactSoundVolume; }
+	UNiagaraSystem* GetImpactEffect() const { return ImpactEffect; }
+
+	// Plays an impact effect at the hit through UTDSEffectSubsystem, which takes the component from the world's shared
+	// Niagara pool so impacts recycle components instead of allocating one per hit. Shared with the batched projectile subsystem.
+	static void SpawnImpactEffect(const UObject* WorldContextObject, UNiagaraSystem* Effect, const FHitResult& Hit);
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Takes a pooled projectile out of its pool when it is destroyed by anything other than the pool
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// Sound to play when the projectile hits something
 	UPROPERTY(EditDefaultsOnly, Category = "Audio|Impact")
 	TObjectPtr<USoundBase> ImpactSound;
@@ -33,6 +71,15 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Audio|Impact", meta = (ClampMin = "0.0"))
 	float ImpactSoundVolume = 1.0f;
 
+	// Effect to play where the projectile hits, pulled from the world's Niagara component pool
+	UPROPERTY(EditDefaultsOnly, Category = "Effects|Impact")
+	TObjectPtr<UNiagaraSystem> ImpactEffect;
+
+	// When set, shots of this class are never spawned as actors. They are simulated in bulk by UTDSProjectileSubsystem
+	// and drawn through a single instanced mesh, which is much cheaper in bullet-dense rooms.
+	UPROPERTY(EditDefaultsOnly, Category = "Simulation")
+	bool bUseBatchedSimulation = false;
+
 private:	
 	
 	// Hitbox component
@@ -64,5 +111,20 @@ private:
 	// Damage dealt by the projectile
 	UPROPERTY(EditDefaultsOnly, Category = "Damage")
 	float Damage = 25.f;
+
+	// Called when the projectile hits something or its lifetime runs out, returns it to the pool or destroys it
+	void ExpireProjectile();
+
+	// The pool this projectile belongs to, null if it was spawned directly
+	TWeakObjectPtr<UTDSProjectilePoolSubsystem> OwningPool;
+
+	// Whether this projectile is owned by a pool
+	bool bPooled = false;
+
+	// Whether the projectile is currently flying
+	bool bProjectileActive = true;
+
+	// Timer handle for returning a pooled projectile after LifeSeconds
+	FTimerHandle LifeTimerHandle;
 };
 
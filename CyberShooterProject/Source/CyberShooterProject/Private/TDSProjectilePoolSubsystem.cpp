@@ -0,0 +1,187 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSProjectilePoolSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSProjectile.h"
+#include "Engine/World.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectile Pool Free"), STAT_TDSProjectilePoolFree, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectile Pool Active"), STAT_TDSProjectilePoolActive, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectile Pool Spawned"), STAT_TDSProjectilePoolSpawned, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Acquired"), STAT_TDSProjectilesAcquired, STATGROUP_CyberShooter);
+
+bool UTDSProjectilePoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSProjectilePoolSubsystem::Deinitialize()
+{
+	// The pooled actors are destroyed with the world, we only need to forget about them
+	Pools.Empty();
+	NumActiveProjectiles = 0;
+	NumSpawnedProjectiles = 0;
+	UpdatePoolStats();
+
+	Super::Deinitialize();
+}
+
+void UTDSProjectilePoolSubsystem::WarmPool(TSubclassOf<ATDSProjectile> ProjectileClass, int32 MinCount)
+{
+	if (!ProjectileClass)
+	{
+		return;
+	}
+
+	FTDSProjectilePool& Pool = Pools.FindOrAdd(ProjectileClass.Get());
+
+	// Spawn the missing projectiles asleep so they are ready before the first shot
+	while (Pool.TotalCount < MinCount)
+	{
+		if (!SpawnPooledProjectile(ProjectileClass, Pool))
+		{
+			break;
+		}
+	}
+
+	UpdatePoolStats();
+}
+
+ATDSProjectile* UTDSProjectilePoolSubsystem::AcquireProjectile(
+	TSubclassOf<ATDSProjectile> ProjectileClass,
+	const FTransform& SpawnTransform,
+	AActor* InOwner,
+	APawn* InInstigator,
+	float Damage,
+	float Speed,
+	float FlightTimeOffset)
+{
+	if (!ProjectileClass)
+	{
+		return nullptr;
+	}
+
+	FTDSProjectilePool& Pool = Pools.FindOrAdd(ProjectileClass.Get());
+
+	// Take a sleeping projectile. Destroyed projectiles leave the pool from their EndPlay, this only skips any still on their way out.
+	ATDSProjectile* Projectile = nullptr;
+	while (!Projectile && Pool.FreeProjectiles.Num() > 0)
+	{
+		Projectile = Pool.FreeProjectiles.Pop(EAllowShrinking::No);
+		if (!IsValid(Projectile))
+		{
+			Projectile = nullptr;
+			Pool.TotalCount--;
+		}
+	}
+
+	// The pool ran dry, grow it by one
+	if (!Projectile)
+	{
+		if (!SpawnPooledProjectile(ProjectileClass, Pool))
+		{
+			return nullptr;
+		}
+
+		Projectile = Pool.FreeProjectiles.Pop(EAllowShrinking::No);
+	}
+
+	Projectile->SetOwner(InOwner);
+	Projectile->SetInstigator(InInstigator);
+	Projectile->ActivateProjectile(SpawnTransform, Damage, Speed, FlightTimeOffset);
+
+	NumActiveProjectiles++;
+	INC_DWORD_STAT(STAT_TDSProjectilesAcquired);
+	UpdatePoolStats();
+
+	return Projectile;
+}
+
+void UTDSProjectilePoolSubsystem::ReleaseProjectile(ATDSProjectile* Projectile)
+{
+	if (!IsValid(Projectile) || !Projectile->IsProjectileActive())
+	{
+		return;
+	}
+
+	Projectile->DeactivateProjectile();
+
+	FTDSProjectilePool& Pool = Pools.FindOrAdd(Projectile->GetClass());
+	Pool.FreeProjectiles.Push(Projectile);
+
+	NumActiveProjectiles = FMath::Max(0, NumActiveProjectiles - 1);
+	UpdatePoolStats();
+}
+
+void UTDSProjectilePoolSubsystem::RemoveDestroyedProjectile(ATDSProjectile* Projectile)
+{
+	FTDSProjectilePool* Pool = Projectile ? Pools.Find(Projectile->GetClass()) : nullptr;
+	if (!Pool)
+	{
+		return;
+	}
+
+	// A sleeping projectile is in the free list, an active one is only counted
+	if (Projectile->IsProjectileActive())
+	{
+		NumActiveProjectiles = FMath::Max(0, NumActiveProjectiles - 1);
+	}
+	else if (Pool->FreeProjectiles.RemoveSingleSwap(Projectile, EAllowShrinking::No) == 0)
+	{
+		// Already skipped by AcquireProjectile, which counted it then
+		return;
+	}
+
+	Pool->TotalCount = FMath::Max(0, Pool->TotalCount - 1);
+	UpdatePoolStats();
+}
+
+int32 UTDSProjectilePoolSubsystem::GetNumFreeProjectiles() const
+{
+	int32 NumFree = 0;
+	for (const TPair<TObjectPtr<UClass>, FTDSProjectilePool>& Pair : Pools)
+	{
+		NumFree += Pair.Value.FreeProjectiles.Num();
+	}
+	return NumFree;
+}
+
+ATDSProjectile* UTDSProjectilePoolSubsystem::SpawnPooledProjectile(TSubclassOf<ATDSProjectile> ProjectileClass, FTDSProjectilePool& Pool)
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	// Defer construction so the projectile knows it is pooled before BeginPlay runs
+	ATDSProjectile* Projectile = World->SpawnActorDeferred<ATDSProjectile>(
+		ProjectileClass,
+		FTransform::Identity,
+		nullptr,
+		nullptr,
+		ESpawnActorCollisionHandlingMethod::AlwaysSpawn
+	);
+
+	if (!Projectile)
+	{
+		return nullptr;
+	}
+
+	Projectile->MarkAsPooled(this);
+	Projectile->FinishSpawning(FTransform::Identity);
+
+	Pool.FreeProjectiles.Push(Projectile);
+	Pool.TotalCount++;
+	NumSpawnedProjectiles++;
+
+	return Projectile;
+}
+
+void UTDSProjectilePoolSubsystem::UpdatePoolStats() const
+{
+	SET_DWORD_STAT(STAT_TDSProjectilePoolFree, GetNumFreeProjectiles());
+	SET_DWORD_STAT(STAT_TDSProjectilePoolActive, NumActiveProjectiles);
+	SET_DWORD_STAT(STAT_TDSProjectilePoolSpawned, NumSpawnedProjectiles);
+}
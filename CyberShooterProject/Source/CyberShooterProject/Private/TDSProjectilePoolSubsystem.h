@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSProjectilePoolSubsystem.generated.h"
+
+class ATDSProjectile;
+
+// The sleeping projectiles of a single projectile class
+USTRUCT()
+struct FTDSProjectilePool
+{
+	GENERATED_BODY()
+
+	// Projectiles that are currently asleep and can be handed out
+	UPROPERTY()
+	TArray<TObjectPtr<ATDSProjectile>> FreeProjectiles;
+
+	// Total number of projectiles of this class owned by the pool (sleeping + active)
+	int32 TotalCount = 0;
+};
+
+// This subsystem recycles projectile actors so firing does not spawn and destroy an actor per shot.
+// Projectiles are pre-warmed asleep, activated when fired, and put back to sleep on hit or when their lifetime runs out.
+UCLASS()
+class UTDSProjectilePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only create the pool in game worlds, the editor world never fires projectiles
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	// Makes sure at least MinCount projectiles of the given class exist, spawning the missing ones asleep
+	void WarmPool(TSubclassOf<ATDSProjectile> ProjectileClass, int32 MinCount);
+
+	// Hands out a sleeping projectile (spawning a new one only if the pool is empty) and activates it at the given transform.
+	// FlightTimeOffset is how long the projectile has already been flying, it is taken off its lifetime.
+	ATDSProjectile* AcquireProjectile(
+		TSubclassOf<ATDSProjectile> ProjectileClass,
+		const FTransform& SpawnTransform,
+		AActor* InOwner,
+		APawn* InInstigator,
+		float Damage,
+		float Speed,
+		float FlightTimeOffset = 0.f);
+
+	// Puts an active projectile back to sleep and returns it to its pool
+	void ReleaseProjectile(ATDSProjectile* Projectile);
+
+	// Forgets a pooled projectile that is being destroyed, asleep or active, so the pool's counts only cover live projectiles.
+	// Called from the projectile's EndPlay.
+	void RemoveDestroyedProjectile(ATDSProjectile* Projectile);
+
+	// Pool size stats, also published to "stat CyberShooter"
+	int32 GetNumFreeProjectiles() const;
+	int32 GetNumActiveProjectiles() const { return NumActiveProjectiles; }
+	int32 GetNumSpawnedProjectiles() const { return NumSpawnedProjectiles; }
+
+private:
+	// Spawns a new sleeping projectile for the given pool
+	ATDSProjectile* SpawnPooledProjectile(TSubclassOf<ATDSProjectile> ProjectileClass, FTDSProjectilePool& Pool);
+
+	// Pushes the current pool sizes to the stat system
+	void UpdatePoolStats() const;
+
+	// One pool per projectile class
+	UPROPERTY()
+	TMap<TObjectPtr<UClass>, FTDSProjectilePool> Pools;
+
+	// Number of projectiles currently flying
+	int32 NumActiveProjectiles = 0;
+
+	// Number of projectile actors this pool has ever spawned, stops growing once the pool is warm
+	int32 NumSpawnedProjectiles = 0;
+};
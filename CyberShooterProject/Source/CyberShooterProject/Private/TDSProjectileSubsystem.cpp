@@ -0,0 +1,464 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSProjectileSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSProjectile.h"
+#include "TDSDamageSubsystem.h"
+#include "TDSAudioEventSubsystem.h"
+#include "TDSCollisionChannels.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/DamageType.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Batched Projectiles Tick"), STAT_TDSBatchedProjectilesTick, STATGROUP_CyberShooter);
+DECLARE_CYCLE_STAT(TEXT("Batched Projectiles Async Sweep Wait"), STAT_TDSBatchedProjectilesSweepWait, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Projectile Sweeps"), STAT_TDSBatchedProjectileSweeps, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Batched Projectiles Live"), STAT_TDSBatchedProjectilesLive, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Projectile Hits"), STAT_TDSBatchedProjectileHits, STATGROUP_CyberShooter);
+
+static TAutoConsoleVariable<int32> CVarTDSProjectileAsyncSweeps(
+	TEXT("tds.Projectiles.AsyncSweeps"),
+	0,
+	TEXT("How batched projectiles resolve their hits.\n")
+	TEXT("0: one batch of blocking sweeps spread over task threads, results applied in the same frame (default)\n")
+	TEXT("1: async sweeps issued at the end of the frame, results applied at the start of the next frame"),
+	ECVF_Default);
+
+namespace
+{
+	// Smallest number of sweeps handed to one task of the blocking batch, fewer than this is not worth a task
+	constexpr int32 SweepsPerTask = 32;
+}
+
+bool UTDSProjectileSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSProjectileSubsystem::Deinitialize()
+{
+	Positions.Empty();
+	Velocities.Empty();
+	Damages.Empty();
+	RemainingLife.Empty();
+	TypeIndices.Empty();
+	Owners.Empty();
+	Instigators.Empty();
+	PendingSweeps.Empty();
+	PendingEnds.Empty();
+	NumPendingSweeps = 0;
+	SweepIgnoredActors.Empty();
+	SweepHits.Empty();
+	SweepBlocked.Empty();
+	Types.Empty();
+	InstanceHost = nullptr;
+
+	SET_DWORD_STAT(STAT_TDSBatchedProjectilesLive, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSProjectileSubsystem, STATGROUP_Tickables);
+}
+
+void UTDSProjectileSubsystem::SpawnProjectile(
+	TSubclassOf<ATDSProjectile> ProjectileClass,
+	const FTransform& SpawnTransform,
+	AActor* InOwner,
+	APawn* InInstigator,
+	float Damage,
+	float Speed,
+	float FlightTimeOffset)
+{
+	const int32 TypeIndex = FindOrAddType(ProjectileClass);
+	if (TypeIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// Same launch rules as ATDSProjectile::InitialiseProjectile: straight along the forward vector, no gravity
+	Positions.Add(SpawnTransform.GetLocation());
+	Velocities.Add(SpawnTransform.GetRotation().GetForwardVector() * Speed);
+	Damages.Add(Damage);
+	RemainingLife.Add(Types[TypeIndex].LifeSeconds - FlightTimeOffset);
+	TypeIndices.Add(TypeIndex);
+	Owners.Add(InOwner);
+	Instigators.Add(InInstigator);
+	PendingSweeps.Add(FTraceHandle());
+	PendingEnds.Add(SpawnTransform.GetLocation());
+}
+
+void UTDSProjectileSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_TDSBatchedProjectilesTick);
+
+	if (!GetWorld())
+	{
+		return;
+	}
+
+	// Sweeps left over from a frame in async mode are always consumed, so switching modes never loses a hit
+	if (CVarTDSProjectileAsyncSweeps.GetValueOnGameThread() != 0)
+	{
+		SimulateAsync(DeltaTime);
+	}
+	else
+	{
+		ConsumeAsyncSweeps();
+		SimulateSync(DeltaTime);
+	}
+
+	UpdateInstances();
+
+	SET_DWORD_STAT(STAT_TDSBatchedProjectilesLive, Positions.Num());
+}
+
+void UTDSProjectileSubsystem::SimulateSync(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+
+	// Expire projectiles first so only the ones still flying are swept
+	for (int32 Index = Positions.Num() - 1; Index >= 0; --Index)
+	{
+		RemainingLife[Index] -= DeltaTime;
+		if (RemainingLife[Index] <= 0.f)
+		{
+			RemoveProjectileAtSwap(Index);
+		}
+	}
+
+	const int32 NumSweeps = Positions.Num();
+	if (NumSweeps == 0)
+	{
+		return;
+	}
+
+	// Resolve the shooters on the game thread, the sweep tasks only read plain pointers
+	SweepIgnoredActors.SetNumUninitialized(NumSweeps, EAllowShrinking::No);
+	for (int32 Index = 0; Index < NumSweeps; ++Index)
+	{
+		SweepIgnoredActors[Index] = Owners[Index].Get();
+	}
+
+	SweepHits.SetNum(NumSweeps, EAllowShrinking::No);
+	SweepBlocked.SetNumUninitialized(NumSweeps, EAllowShrinking::No);
+
+	// Run the whole frame's sweeps as one batch. Scene queries only read the physics scene, which is how UWorld runs
+	// its own async traces on task threads, so the batch is spread over the workers and the game thread waits on it once.
+	ParallelFor(TEXT("TDSProjectileSubsystem.Sweep"), NumSweeps, SweepsPerTask, [this, World, DeltaTime](int32 Index)
+	{
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TDSBatchedProjectileSweep), false);
+
+		// Never hit the actor that fired the shot
+		if (SweepIgnoredActors[Index])
+		{
+			QueryParams.AddIgnoredActor(SweepIgnoredActors[Index]);
+		}
+
+		const FVector Start = Positions[Index];
+		const FVector End = Start + Velocities[Index] * DeltaTime;
+
+		SweepBlocked[Index] = World->SweepSingleByChannel(
+			SweepHits[Index],
+			Start,
+			End,
+			FQuat::Identity,
+			ECC_TDSProjectile,
+			FCollisionShape::MakeSphere(Types[TypeIndices[Index]].CollisionRadius),
+			QueryParams
+		);
+	});
+
+	INC_DWORD_STAT_BY(STAT_TDSBatchedProjectileSweeps, NumSweeps);
+
+	// Apply the results on the game thread. Walking backwards means a swap-remove only ever moves in a projectile
+	// whose result has already been applied, so every unvisited index still lines up with its sweep.
+	for (int32 Index = NumSweeps - 1; Index >= 0; --Index)
+	{
+		if (SweepBlocked[Index])
+		{
+			HandleImpact(Index, SweepHits[Index]);
+			RemoveProjectileAtSwap(Index);
+			continue;
+		}
+
+		Positions[Index] += Velocities[Index] * DeltaTime;
+	}
+}
+
+void UTDSProjectileSubsystem::SimulateAsync(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+
+	// Apply last frame's results first so projectiles that hit something are gone before we move the rest
+	ConsumeAsyncSweeps();
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TDSBatchedProjectileAsyncSweep), false);
+
+	for (int32 Index = Positions.Num() - 1; Index >= 0; --Index)
+	{
+		RemainingLife[Index] -= DeltaTime;
+		if (RemainingLife[Index] <= 0.f)
+		{
+			RemoveProjectileAtSwap(Index);
+			continue;
+		}
+	}
+
+	// Issue every sweep for this frame in one batch, the results are read at the start of next frame
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		const FVector Start = Positions[Index];
+		const FVector End = Start + Velocities[Index] * DeltaTime;
+
+		QueryParams.ClearIgnoredSourceObjects();
+		if (AActor* ShotOwner = Owners[Index].Get())
+		{
+			QueryParams.AddIgnoredActor(ShotOwner);
+		}
+
+		PendingSweeps[Index] = World->AsyncSweepByChannel(
+			EAsyncTraceType::Single,
+			Start,
+			End,
+			FQuat::Identity,
+			ECC_TDSProjectile,
+			FCollisionShape::MakeSphere(Types[TypeIndices[Index]].CollisionRadius),
+			QueryParams
+		);
+		PendingEnds[Index] = End;
+	}
+
+	NumPendingSweeps = Positions.Num();
+	INC_DWORD_STAT_BY(STAT_TDSBatchedProjectileSweeps, NumPendingSweeps);
+}
+
+void UTDSProjectileSubsystem::ConsumeAsyncSweeps()
+{
+	if (NumPendingSweeps == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TDSBatchedProjectilesSweepWait);
+
+	UWorld* World = GetWorld();
+
+	for (int32 Index = Positions.Num() - 1; Index >= 0; --Index)
+	{
+		FTraceHandle& Handle = PendingSweeps[Index];
+		if (!Handle.IsValid())
+		{
+			continue;
+		}
+
+		FTraceDatum Result;
+		const bool bHasResult = World->QueryTraceData(Handle, Result);
+		Handle = FTraceHandle();
+
+		// A missing result means the sweep was dropped, keep the projectile where it is and sweep again this frame
+		if (!bHasResult)
+		{
+			continue;
+		}
+
+		const FHitResult* BlockingHit = Result.OutHits.FindByPredicate([](const FHitResult& Hit)
+		{
+			return Hit.bBlockingHit;
+		});
+
+		if (BlockingHit)
+		{
+			HandleImpact(Index, *BlockingHit);
+			RemoveProjectileAtSwap(Index);
+			continue;
+		}
+
+		Positions[Index] = PendingEnds[Index];
+	}
+
+	NumPendingSweeps = 0;
+}
+
+int32 UTDSProjectileSubsystem::FindOrAddType(TSubclassOf<ATDSProjectile> ProjectileClass)
+{
+	if (!ProjectileClass)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 ExistingIndex = Types.IndexOfByPredicate([ProjectileClass](const FTDSBatchedProjectileType& Type)
+	{
+		return Type.ProjectileClass == ProjectileClass;
+	});
+
+	if (ExistingIndex != INDEX_NONE)
+	{
+		return ExistingIndex;
+	}
+
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return INDEX_NONE;
+	}
+
+	// One hidden actor hosts the instanced meshes of every projectile class
+	if (!InstanceHost)
+	{
+		FActorSpawnParameters Params;
+		Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		InstanceHost = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, Params);
+		if (!InstanceHost)
+		{
+			return INDEX_NONE;
+		}
+
+		USceneComponent* HostRoot = NewObject<USceneComponent>(InstanceHost, TEXT("Root"));
+		InstanceHost->SetRootComponent(HostRoot);
+		HostRoot->RegisterComponent();
+	}
+
+	// Mirror the class defaults so the batched projectile looks, sounds and collides like the actor version
+	const ATDSProjectile* ProjectileDefaults = ProjectileClass->GetDefaultObject<ATDSProjectile>();
+
+	FTDSBatchedProjectileType& NewType = Types.AddDefaulted_GetRef();
+	NewType.ProjectileClass = ProjectileClass;
+	NewType.ImpactSound = ProjectileDefaults->GetImpactSound();
+	NewType.ImpactSoundVolume = ProjectileDefaults->GetImpactSoundVolume();
+	NewType.ImpactEffect = ProjectileDefaults->GetImpactEffect();
+	NewType.CollisionRadius = ProjectileDefaults->GetCollisionRadius();
+	NewType.LifeSeconds = ProjectileDefaults->GetLifeSeconds();
+
+	UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(InstanceHost);
+	Instances->SetupAttachment(InstanceHost->GetRootComponent());
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetGenerateOverlapEvents(false);
+	Instances->SetCanEverAffectNavigation(false);
+	Instances->SetMobility(EComponentMobility::Movable);
+
+	if (const UStaticMeshComponent* MeshDefaults = ProjectileDefaults->GetMeshComponent())
+	{
+		Instances->SetStaticMesh(MeshDefaults->GetStaticMesh());
+		for (int32 MaterialIndex = 0; MaterialIndex < MeshDefaults->GetNumMaterials(); ++MaterialIndex)
+		{
+			Instances->SetMaterial(MaterialIndex, MeshDefaults->GetMaterial(MaterialIndex));
+		}
+		NewType.MeshRelativeTransform = MeshDefaults->GetRelativeTransform();
+	}
+
+	Instances->RegisterComponent();
+	NewType.Instances = Instances;
+
+	return Types.Num() - 1;
+}
+
+void UTDSProjectileSubsystem::HandleImpact(int32 Index, const FHitResult& Hit)
+{
+	INC_DWORD_STAT(STAT_TDSBatchedProjectileHits);
+
+	AActor* HitActor = Hit.GetActor();
+	AActor* ShotOwner = Owners[Index].Get();
+
+	// Same rules as ATDSProjectile::OnHit, there is no projectile actor so the shooter is the damage causer
+	if (HitActor && HitActor != ShotOwner)
+	{
+		if (UTDSDamageSubsystem* DamageSubsystem = GetWorld()->GetSubsystem<UTDSDamageSubsystem>())
+		{
+			APawn* ShotInstigator = Instigators[Index].Get();
+
+			DamageSubsystem->QueueDamage(
+				HitActor,
+				Damages[Index],
+				ShotInstigator ? ShotInstigator->GetController() : nullptr,
+				ShotOwner,
+				Hit.ImpactPoint,
+				Hit.Item
+			);
+		}
+	}
+
+	const FTDSBatchedProjectileType& Type = Types[TypeIndices[Index]];
+	if (Type.ImpactSound)
+	{
+		if (UTDSAudioEventSubsystem* Audio = GetWorld()->GetSubsystem<UTDSAudioEventSubsystem>())
+		{
+			Audio->PlaySound(ETDSAudioCategory::Impact, Type.ImpactSound, Hit.Location, Type.ImpactSoundVolume);
+		}
+	}
+
+	ATDSProjectile::SpawnImpactEffect(this, Type.ImpactEffect, Hit);
+}
+
+void UTDSProjectileSubsystem::RemoveProjectileAtSwap(int32 Index)
+{
+	Positions.RemoveAtSwap(Index, EAllowShrinking::No);
+	Velocities.RemoveAtSwap(Index, EAllowShrinking::No);
+	Damages.RemoveAtSwap(Index, EAllowShrinking::No);
+	RemainingLife.RemoveAtSwap(Index, EAllowShrinking::No);
+	TypeIndices.RemoveAtSwap(Index, EAllowShrinking::No);
+	Owners.RemoveAtSwap(Index, EAllowShrinking::No);
+	Instigators.RemoveAtSwap(Index, EAllowShrinking::No);
+	PendingSweeps.RemoveAtSwap(Index, EAllowShrinking::No);
+	PendingEnds.RemoveAtSwap(Index, EAllowShrinking::No);
+}
+
+void UTDSProjectileSubsystem::UpdateInstances()
+{
+	for (FTDSBatchedProjectileType& Type : Types)
+	{
+		Type.InstanceTransforms.Reset();
+	}
+
+	// Build this frame's instance transforms, rotated to face the direction of travel like bRotationFollowsVelocity
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		FTDSBatchedProjectileType& Type = Types[TypeIndices[Index]];
+		const FTransform ProjectileTransform(Velocities[Index].ToOrientationQuat(), Positions[Index]);
+		Type.InstanceTransforms.Add(Type.MeshRelativeTransform * ProjectileTransform);
+	}
+
+	for (FTDSBatchedProjectileType& Type : Types)
+	{
+		UInstancedStaticMeshComponent* Instances = Type.Instances;
+		if (!Instances)
+		{
+			continue;
+		}
+
+		// Match the instance count to the number of live projectiles, then overwrite every transform in one batch
+		const int32 WantedCount = Type.InstanceTransforms.Num();
+		const int32 CurrentCount = Instances->GetInstanceCount();
+
+		if (CurrentCount < WantedCount)
+		{
+			TArray<FTransform> NewInstances;
+			NewInstances.Init(FTransform::Identity, WantedCount - CurrentCount);
+			Instances->AddInstances(NewInstances, false, true);
+		}
+		else if (CurrentCount > WantedCount)
+		{
+			TArray<int32> InstancesToRemove;
+			for (int32 InstanceIndex = WantedCount; InstanceIndex < CurrentCount; ++InstanceIndex)
+			{
+				InstancesToRemove.Add(InstanceIndex);
+			}
+			Instances->RemoveInstances(InstancesToRemove);
+		}
+
+		if (WantedCount > 0)
+		{
+			Instances->BatchUpdateInstancesTransforms(0, Type.InstanceTransforms, true, true, true);
+		}
+	}
+}
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "TDSProjectileSubsystem.generated.h"
+
+class ATDSProjectile;
+class UInstancedStaticMeshComponent;
+class USoundBase;
+class UNiagaraSystem;
+
+// Everything the subsystem needs to know about one projectile class, read once from its class defaults
+USTRUCT()
+struct FTDSBatchedProjectileType
+{
+	GENERATED_BODY()
+
+	// The projectile class these settings were read from
+	UPROPERTY()
+	TSubclassOf<ATDSProjectile> ProjectileClass;
+
+	// The instanced mesh that draws every live projectile of this class
+	UPROPERTY()
+	TObjectPtr<UInstancedStaticMeshComponent> Instances;
+
+	// Sound to play on impact, and its volume
+	UPROPERTY()
+	TObjectPtr<USoundBase> ImpactSound;
+
+	float ImpactSoundVolume = 1.f;
+
+	// Effect to play on impact
+	UPROPERTY()
+	TObjectPtr<UNiagaraSystem> ImpactEffect;
+
+	// Radius of the sphere swept along the projectile's path
+	float CollisionRadius = 10.f;
+
+	// Lifetime of the projectile in seconds
+	float LifeSeconds = 2.f;
+
+	// Offset of the mesh relative to the projectile's root, so instances line up with the actor version
+	FTransform MeshRelativeTransform = FTransform::Identity;
+
+	// Scratch buffer reused every frame to upload instance transforms
+	TArray<FTransform> InstanceTransforms;
+};
+
+// This subsystem simulates projectiles without actors. Live projectiles are stored as struct-of-arrays,
+// advanced in one loop per frame, swept against the world in a single batch of scene queries and drawn
+// through one instanced static mesh per projectile class. Hits keep the damage and impact sound behaviour of ATDSProjectile::OnHit.
+// By default the batch runs across task threads and is applied in the same frame. With tds.Projectiles.AsyncSweeps enabled
+// the sweeps are issued with UWorld::AsyncSweepByChannel at the end of the frame and their results applied at the start of
+// the next one, so the game thread never waits on the scene queries.
+UCLASS()
+class UTDSProjectileSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only simulate projectiles in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Launches a batched projectile of the given class from the given transform.
+	// FlightTimeOffset is how long the projectile has already been flying, it is taken off its lifetime.
+	void SpawnProjectile(
+		TSubclassOf<ATDSProjectile> ProjectileClass,
+		const FTransform& SpawnTransform,
+		AActor* InOwner,
+		APawn* InInstigator,
+		float Damage,
+		float Speed,
+		float FlightTimeOffset = 0.f);
+
+	// Number of projectiles currently being simulated
+	int32 GetNumLiveProjectiles() const { return Positions.Num(); }
+
+private:
+	// Returns the index of the type entry for the given class, creating it on first use
+	int32 FindOrAddType(TSubclassOf<ATDSProjectile> ProjectileClass);
+
+	// Moves every projectile and resolves its hits this frame, with the sweeps run as one parallel batch
+	void SimulateSync(float DeltaTime);
+
+	// Consumes the async sweeps issued last frame, then issues this frame's sweeps as one batch
+	void SimulateAsync(float DeltaTime);
+
+	// Applies the results of the async sweeps issued last frame, despawning projectiles that hit something
+	void ConsumeAsyncSweeps();
+
+	// Applies damage and plays the impact sound for projectile Index hitting something
+	void HandleImpact(int32 Index, const FHitResult& Hit);
+
+	// Removes projectile Index by swapping the last projectile into its place
+	void RemoveProjectileAtSwap(int32 Index);
+
+	// Uploads this frame's projectile transforms to the instanced meshes
+	void UpdateInstances();
+
+	// Actor that owns the instanced mesh components
+	UPROPERTY()
+	TObjectPtr<AActor> InstanceHost;
+
+	// Known projectile classes
+	UPROPERTY()
+	TArray<FTDSBatchedProjectileType> Types;
+
+	// ---- Live projectiles, struct-of-arrays ----
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<float> Damages;
+	TArray<float> RemainingLife;
+	TArray<int32> TypeIndices;
+	TArray<TWeakObjectPtr<AActor>> Owners;
+	TArray<TWeakObjectPtr<APawn>> Instigators;
+
+	// Async sweep in flight for each projectile, and where the projectile ends up if that sweep hits nothing
+	TArray<FTraceHandle> PendingSweeps;
+	TArray<FVector> PendingEnds;
+
+	// Number of valid entries in PendingSweeps
+	int32 NumPendingSweeps = 0;
+
+	// Scratch buffers for the same-frame sweep batch, one entry per live projectile
+	TArray<AActor*> SweepIgnoredActors;
+	TArray<FHitResult> SweepHits;
+	TArray<bool> SweepBlocked;
+};
@@ -9,6 +9,7 @@
 #include "Kismet/GameplayStatics.h"
 #include "GameFramework/Pawn.h"
 #include "TDSGameInstance.h"
+#include "TDSCollisionChannels.h"
 
 // Sets default values
 ATDSRewardExit::ATDSRewardExit()
@@ -28,11 +29,9 @@ ATDSRewardExit::ATDSRewardExit()
 	TriggerVolume = CreateDefaultSubobject<UBoxComponent>(TEXT("TriggerVolume"));
 	TriggerVolume->SetupAttachment(SceneRoot);
 
-	// Set the collision settings for the trigger volume
+	// Set the collision settings for the trigger volume, it only overlaps pawns and stays off until the exit unlocks
+	TriggerVolume->SetCollisionProfileName(TDSCollisionProfiles::PawnTrigger);
 	TriggerVolume->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	TriggerVolume->SetCollisionObjectType(ECC_WorldDynamic);
-	TriggerVolume->SetCollisionResponseToAllChannels(ECR_Ignore);
-	TriggerVolume->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
 }
 
 // Called when the game starts or when spawned
@@ -2,4 +2,41 @@
 
 
 #include "TDSRoomDefinition.h"
+#include "TDSEnemyArchetype.h"
 
+UTDSEnemyArchetype* UTDSRoomDefinition::PickEnemyArchetype() const
+{
+	float TotalWeight = 0.f;
+	for (const FTDSRoomEnemyEntry& Entry : Enemies)
+	{
+		if (Entry.Archetype)
+		{
+			TotalWeight += FMath::Max(Entry.Weight, 0.f);
+		}
+	}
+
+	if (TotalWeight <= 0.f)
+	{
+		return nullptr;
+	}
+
+	// Walk the entries until the roll falls inside one
+	float Roll = FMath::FRand() * TotalWeight;
+	UTDSEnemyArchetype* Picked = nullptr;
+	for (const FTDSRoomEnemyEntry& Entry : Enemies)
+	{
+		if (!Entry.Archetype || Entry.Weight <= 0.f)
+		{
+			continue;
+		}
+
+		Picked = Entry.Archetype;
+		Roll -= Entry.Weight;
+		if (Roll < 0.f)
+		{
+			break;
+		}
+	}
+
+	return Picked;
+}
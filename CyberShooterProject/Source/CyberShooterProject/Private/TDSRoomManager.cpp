@@ -8,6 +8,10 @@
 #include "TDSPlayerController.h"
 #include "TDSRewardExit.h"
 #include "TDSEnemySpawner.h"
+#include "TDSHordeSubsystem.h"
+#include "TDSRoomDefinition.h"
+#include "TDSEnemyArchetype.h"
+#include "NavigationSystem.h"
 
 // Sets default values
 ATDSRoomManager::ATDSRoomManager()
@@ -81,19 +85,21 @@ void ATDSRoomManager::SpawnRoomEnemies()
         }
     }
 
-    // If there are no spawners found or the default enemy class is not set, log a warning and exit the function to prevent errors
-    if (Spawners.Num() == 0 || !DefaultEnemyClass)
+    // If there are no spawners found, exit the function to prevent errors
+    if (Spawners.Num() == 0)
     {
         return;
     }
 
-    if (!DefaultEnemyClass)
+    UTDSGameInstance* GI = Cast<UTDSGameInstance>(GetGameInstance());
+    if (!GI)
     {
         return;
     }
 
-    UTDSGameInstance* GI = Cast<UTDSGameInstance>(GetGameInstance());
-    if (!GI)
+    // The room's archetypes pick what spawns, rooms without any (or levels opened directly) spawn the default enemy class
+    const UTDSRoomDefinition* Room = GI->CurrentRoomDefinition;
+    if (!DefaultEnemyClass && (!Room || Room->Enemies.Num() == 0))
     {
         return;
     }
@@ -110,10 +116,23 @@ void ATDSRoomManager::SpawnRoomEnemies()
     }
 
 
+    // Horde rooms spawn proxies instead of actors, falling back to actors if the enemy class has no proxy mesh
+    if (bUseHordeProxies && SpawnHordeEnemies(Spawners, SpawnCount, Room))
+    {
+        return;
+    }
+
     // Spawn enemies at the spawners and bind to their death events to track when they die
     for (int32 i = 0; i < SpawnCount; ++i)
     {
-        ATDSEnemyCharacter* SpawnedEnemy = Spawners[i]->SpawnEnemy(DefaultEnemyClass);
+        TSubclassOf<ATDSEnemyCharacter> EnemyClass;
+        UTDSEnemyArchetype* Archetype = nullptr;
+        if (!PickEnemy(Room, EnemyClass, Archetype))
+        {
+            continue;
+        }
+
+        ATDSEnemyCharacter* SpawnedEnemy = Spawners[i]->SpawnEnemy(EnemyClass, Archetype);
 
         if (SpawnedEnemy)
         {
@@ -124,6 +143,92 @@ void ATDSRoomManager::SpawnRoomEnemies()
     }
 
 }
+bool ATDSRoomManager::PickEnemy(const UTDSRoomDefinition* Room, TSubclassOf<ATDSEnemyCharacter>& OutClass, UTDSEnemyArchetype*& OutArchetype) const
+{
+    OutArchetype = Room ? Room->PickEnemyArchetype() : nullptr;
+    OutClass = OutArchetype && OutArchetype->EnemyClass ? OutArchetype->EnemyClass : DefaultEnemyClass;
+    return OutClass != nullptr;
+}
+
+bool ATDSRoomManager::SpawnHordeEnemies(const TArray<ATDSEnemySpawner*>& Spawners, int32 SpawnerCount, const UTDSRoomDefinition* Room)
+{
+    UTDSHordeSubsystem* Horde = GetWorld()->GetSubsystem<UTDSHordeSubsystem>();
+    if (!Horde)
+    {
+        return false;
+    }
+
+    // Mixed rooms only go horde if every class they can pick runs as a proxy
+    bool bAnyArchetype = false;
+    bool bAllClassesUseProxies = true;
+    if (Room)
+    {
+        for (const FTDSRoomEnemyEntry& Entry : Room->Enemies)
+        {
+            if (Entry.Archetype && Entry.Weight > 0.f)
+            {
+                const TSubclassOf<ATDSEnemyCharacter> EntryClass = Entry.Archetype->EnemyClass ? Entry.Archetype->EnemyClass : DefaultEnemyClass;
+                bAllClassesUseProxies &= UTDSHordeSubsystem::CanUseProxies(EntryClass);
+                bAnyArchetype = true;
+            }
+        }
+    }
+
+    if (!bAnyArchetype)
+    {
+        bAllClassesUseProxies = UTDSHordeSubsystem::CanUseProxies(DefaultEnemyClass);
+    }
+
+    if (!bAllClassesUseProxies)
+    {
+        return false;
+    }
+
+    // Proxies are counted like actors: dying as a proxy counts down here, promoted ones report through OnEnemyDied.
+    // This runs for every wave, so drop the previous wave's bindings first or every event would be counted twice.
+    Horde->OnProxyDied.RemoveAll(this);
+    Horde->OnProxyPromoted.RemoveAll(this);
+    Horde->OnProxyDied.AddUObject(this, &ATDSRoomManager::HandleProxyDied);
+    Horde->OnProxyPromoted.AddUObject(this, &ATDSRoomManager::HandleProxyPromoted);
+
+    UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+    const int32 ProxyCount = SpawnerCount * HordeEnemiesPerSpawner;
+    for (int32 i = 0; i < ProxyCount; ++i)
+    {
+        // Round robin over the chosen spawners, scattered onto the navmesh around each
+        FTransform SpawnTransform = Spawners[i % SpawnerCount]->GetActorTransform();
+
+        FNavLocation ScatterPoint;
+        if (NavSys && HordeSpawnScatter > 0.f && NavSys->GetRandomReachablePointInRadius(SpawnTransform.GetLocation(), HordeSpawnScatter, ScatterPoint))
+        {
+            SpawnTransform.SetLocation(FVector(ScatterPoint.Location.X, ScatterPoint.Location.Y, SpawnTransform.GetLocation().Z));
+        }
+
+        TSubclassOf<ATDSEnemyCharacter> EnemyClass;
+        UTDSEnemyArchetype* Archetype = nullptr;
+        if (PickEnemy(Room, EnemyClass, Archetype) && Horde->SpawnProxy(EnemyClass, SpawnTransform, Archetype))
+        {
+            AliveEnemyCount++;
+        }
+    }
+
+    return true;
+}
+
+void ATDSRoomManager::HandleProxyDied()
+{
+    HandleEnemyDied(nullptr);
+}
+
+void ATDSRoomManager::HandleProxyPromoted(ATDSEnemyCharacter* PromotedEnemy)
+{
+    if (PromotedEnemy)
+    {
+        PromotedEnemy->OnEnemyDied.AddDynamic(this, &ATDSRoomManager::HandleEnemyDied);
+    }
+}
+
 // Handle the death of an enemy and update the alive enemy count
 void ATDSRoomManager::HandleEnemyDied(AActor* DeadEnemy)
 {
@@ -8,6 +8,10 @@
 #include "TDSRewardExit.h"
 #include "TDSRoomManager.generated.h"
 
+class ATDSEnemySpawner;
+class UTDSEnemyArchetype;
+class UTDSRoomDefinition;
+
 
 UCLASS()
 class ATDSRoomManager : public AActor
@@ -32,16 +36,29 @@ protected:
 	// This function will be called to spawn enemies in the room based on the current room index and the number of available spawners.
 	void SpawnRoomEnemies();
 
+	// Spawns the room's enemies as horde proxies spread around the chosen spawners. Returns false if any of the room's enemy classes cannot run as a proxy.
+	bool SpawnHordeEnemies(const TArray<ATDSEnemySpawner*>& Spawners, int32 SpawnerCount, const UTDSRoomDefinition* Room);
+
+	// Picks the class and archetype of the next enemy to spawn: by weight from the room's archetypes, or the default enemy class
+	// if the room lists none. Returns false if there is nothing to spawn.
+	bool PickEnemy(const UTDSRoomDefinition* Room, TSubclassOf<ATDSEnemyCharacter>& OutClass, UTDSEnemyArchetype*& OutArchetype) const;
+
+	// A horde proxy was killed before it was promoted
+	void HandleProxyDied();
+
+	// A horde proxy was swapped for a full enemy actor, track its death like any spawned enemy
+	void HandleProxyPromoted(ATDSEnemyCharacter* PromotedEnemy);
+
 	// This variable holds a reference to the reward exit in the room, which can be used to unlock it when the room is cleared.
 	UPROPERTY(EditInstanceOnly, BlueprintReadOnly, Category = "Room")
 	TObjectPtr<ATDSRewardExit> RoomExit;
 
 private:
-	// The number of alive enemies in the room. This will be updated as enemies are killed.
+	// The number of alive enemies in the room, proxies and actors alike. This will be updated as enemies are killed.
 	UPROPERTY(VisibleAnywhere, Category= "Room")
 	int32 AliveEnemyCount = 0;
 
-	// The default enemy class to spawn in
+	// The default enemy class to spawn in, and the class of room archetypes that do not set one
 	UPROPERTY(EditAnywhere, Category = "Spawning")
 	TSubclassOf<ATDSEnemyCharacter> DefaultEnemyClass;
 
@@ -57,6 +74,18 @@ private:
 	UPROPERTY(EditAnywhere, Category = "Spawning")
 	int32 MaxEnemyCount = 6;
 
+	// Spawn the room's enemies as lightweight horde proxies, which become full enemies only near the player. Needs an enemy class with a HordeProxyMesh.
+	UPROPERTY(EditAnywhere, Category = "Spawning|Horde")
+	bool bUseHordeProxies = false;
+
+	// How many proxies each chosen spawner produces in horde rooms
+	UPROPERTY(EditAnywhere, Category = "Spawning|Horde", meta = (EditCondition = "bUseHordeProxies", ClampMin = "1"))
+	int32 HordeEnemiesPerSpawner = 8;
+
+	// How far from its spawner a proxy can appear
+	UPROPERTY(EditAnywhere, Category = "Spawning|Horde", meta = (EditCondition = "bUseHordeProxies", ClampMin = "0.0"))
+	float HordeSpawnScatter = 300.f;
+
 	// Calculate the number of enemies to spawn helper function based on the current room index and the number of available spawners in the room. 
 	// This allows for dynamic scaling of enemy count while ensuring it does not exceed the number of spawners.
 	int32 CalculateSpawnCount(int32 RoomIndex, int32 AvailableSpawnerCount) const;
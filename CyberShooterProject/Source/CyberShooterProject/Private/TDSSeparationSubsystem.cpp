@@ -0,0 +1,285 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSSeparationSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSEnemyCharacter.h"
+#include "TDSSpatialGridSubsystem.h"
+#include "TDSWeakArray.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Character.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+
+DECLARE_CYCLE_STAT(TEXT("Separation Pass"), STAT_TDSSeparationPass, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Separation Agents"), STAT_TDSSeparationAgents, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Separation Overlaps"), STAT_TDSSeparationOverlaps, STATGROUP_CyberShooter);
+
+namespace
+{
+	// What tds.Separation.Benchmark samples every frame
+	enum ETDSSeparationBenchmarkSample
+	{
+		SamplePassSeconds,
+		SampleOverlaps
+	};
+}
+
+static TAutoConsoleVariable<float> CVarTDSSeparationRadius(
+	TEXT("tds.Separation.Radius"),
+	120.f,
+	TEXT("Enemies closer than this to each other push apart, harder the closer they are."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTDSSeparationWeight(
+	TEXT("tds.Separation.Weight"),
+	1.f,
+	TEXT("Strength of the push away from neighbours."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTDSSeparationCohesionWeight(
+	TEXT("tds.Separation.CohesionWeight"),
+	0.15f,
+	TEXT("Strength of the pull towards the centre of the neighbours, keeps a pushed crowd from scattering."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTDSSeparationMaxSpeedFraction(
+	TEXT("tds.Separation.MaxSpeedFraction"),
+	0.5f,
+	TEXT("Largest steering velocity, as a fraction of the enemy's max speed."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorldAndArgs GTDSSeparationBenchmarkCommand(
+	TEXT("tds.Separation.Benchmark"),
+	TEXT("Switches every enemy to an avoidance mode and logs frame time and overlapping enemies over a few seconds. ")
+	TEXT("Spawn a crowd first (tds.AI.SpawnBenchmarkEnemies) and run with vsync off. Arguments: rvo, separation or none (default separation), seconds (default 10)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UTDSSeparationSubsystem* SeparationSubsystem = World ? World->GetSubsystem<UTDSSeparationSubsystem>() : nullptr;
+		if (!SeparationSubsystem)
+		{
+			return;
+		}
+
+		ETDSAvoidanceMode Mode = ETDSAvoidanceMode::Separation;
+		if (Args.Num() > 0 && Args[0].Equals(TEXT("rvo"), ESearchCase::IgnoreCase))
+		{
+			Mode = ETDSAvoidanceMode::RVO;
+		}
+		else if (Args.Num() > 0 && Args[0].Equals(TEXT("none"), ESearchCase::IgnoreCase))
+		{
+			Mode = ETDSAvoidanceMode::None;
+		}
+
+		SeparationSubsystem->StartBenchmark(Mode, Args.Num() > 1 ? FCString::Atof(*Args[1]) : 10.f);
+	}));
+
+bool UTDSSeparationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSSeparationSubsystem::Deinitialize()
+{
+	Agents.Empty();
+	MoveComps.Empty();
+
+	SET_DWORD_STAT(STAT_TDSSeparationAgents, 0);
+	SET_DWORD_STAT(STAT_TDSSeparationOverlaps, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSSeparationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSSeparationSubsystem, STATGROUP_Tickables);
+}
+
+void UTDSSeparationSubsystem::RegisterAgent(ACharacter* Agent)
+{
+	UTDSEnemyMovementComponent* MoveComp = Agent ? Cast<UTDSEnemyMovementComponent>(Agent->GetCharacterMovement()) : nullptr;
+	if (!MoveComp || Agents.Contains(Agent))
+	{
+		return;
+	}
+
+	Agents.Add(Agent);
+	MoveComps.Add(MoveComp);
+}
+
+void UTDSSeparationSubsystem::UnregisterAgent(ACharacter* Agent)
+{
+	const int32 Index = Agents.IndexOfByKey(Agent);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (UTDSEnemyMovementComponent* MoveComp = MoveComps[Index].Get())
+	{
+		MoveComp->SetSeparationVelocity(FVector::ZeroVector);
+	}
+
+	Agents.RemoveAtSwap(Index, EAllowShrinking::No);
+	MoveComps.RemoveAtSwap(Index, EAllowShrinking::No);
+}
+
+void UTDSSeparationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const double PassStartTime = FPlatformTime::Seconds();
+	int32 NumOverlaps = 0;
+
+	// A character destroyed without unregistering loses its movement component too, drop the pair together
+	FTDSWeakArray::RemoveStaleSwap(
+		Agents.Num(),
+		[this](int32 Index) { return !Agents[Index].IsValid() || !MoveComps[Index].IsValid(); },
+		[this](int32 Index)
+		{
+			Agents.RemoveAtSwap(Index, EAllowShrinking::No);
+			MoveComps.RemoveAtSwap(Index, EAllowShrinking::No);
+		});
+
+	const UTDSSpatialGridSubsystem* SpatialGrid = GetWorld()->GetSubsystem<UTDSSpatialGridSubsystem>();
+	if (SpatialGrid && Agents.Num() > 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TDSSeparationPass);
+
+		const float SeparationRadius = FMath::Max(CVarTDSSeparationRadius.GetValueOnGameThread(), 1.f);
+		const float SeparationWeight = CVarTDSSeparationWeight.GetValueOnGameThread();
+		const float CohesionWeight = CVarTDSSeparationCohesionWeight.GetValueOnGameThread();
+		const float MaxSpeedFraction = CVarTDSSeparationMaxSpeedFraction.GetValueOnGameThread();
+
+		TArray<AActor*, TInlineAllocator<32>> Neighbours;
+
+		for (int32 Index = 0; Index < Agents.Num(); ++Index)
+		{
+			const ACharacter* Agent = Agents[Index].Get();
+			UTDSEnemyMovementComponent* MoveComp = MoveComps[Index].Get();
+
+			const FVector Location = Agent->GetActorLocation();
+			const float AgentRadius = Agent->GetSimpleCollisionRadius();
+
+			Neighbours.Reset();
+			SpatialGrid->QueryRadius(Location, SeparationRadius, ETDSGridAgent::Enemy, Neighbours, Agent);
+
+			// Push away from each neighbour, falling off linearly to nothing at the separation radius
+			FVector Push = FVector::ZeroVector;
+			FVector NeighbourCentre = FVector::ZeroVector;
+			for (const AActor* Neighbour : Neighbours)
+			{
+				const FVector NeighbourLocation = Neighbour->GetActorLocation();
+				NeighbourCentre += NeighbourLocation;
+
+				FVector Away = Location - NeighbourLocation;
+				Away.Z = 0.f;
+				const float Dist = Away.Size();
+
+				if (Dist < AgentRadius + Neighbour->GetSimpleCollisionRadius())
+				{
+					NumOverlaps++;
+				}
+
+				if (Dist > KINDA_SMALL_NUMBER)
+				{
+					Push += Away / Dist * (1.f - Dist / SeparationRadius);
+				}
+			}
+
+			FVector Steering = Push * SeparationWeight;
+
+			// Pull gently towards the neighbours' centre so the push spreads a crowd out instead of scattering it
+			if (Neighbours.Num() > 0)
+			{
+				Steering += (NeighbourCentre / Neighbours.Num() - Location).GetSafeNormal2D() * CohesionWeight;
+			}
+
+			const float MaxSteeringSpeed = MoveComp->GetMaxSpeed() * MaxSpeedFraction;
+			MoveComp->SetSeparationVelocity((Steering * MaxSteeringSpeed).GetClampedToMaxSize2D(MaxSteeringSpeed));
+		}
+	}
+
+	// Steered pairs were seen from both sides
+	SET_DWORD_STAT(STAT_TDSSeparationAgents, Agents.Num());
+	SET_DWORD_STAT(STAT_TDSSeparationOverlaps, NumOverlaps / 2);
+
+	if (Benchmark.IsRunning())
+	{
+		Benchmark.AddSample(SamplePassSeconds, FPlatformTime::Seconds() - PassStartTime);
+		Benchmark.AddSample(SampleOverlaps, CountAllOverlaps());
+
+		if (Benchmark.Tick())
+		{
+			FinishBenchmark();
+		}
+	}
+}
+
+int32 UTDSSeparationSubsystem::CountAllOverlaps() const
+{
+	const UTDSSpatialGridSubsystem* SpatialGrid = GetWorld()->GetSubsystem<UTDSSpatialGridSubsystem>();
+	if (!SpatialGrid)
+	{
+		return 0;
+	}
+
+	int32 NumOverlaps = 0;
+	TArray<AActor*, TInlineAllocator<32>> Neighbours;
+
+	for (TActorIterator<ATDSEnemyCharacter> It(GetWorld()); It; ++It)
+	{
+		const ATDSEnemyCharacter* Enemy = *It;
+		if (Enemy->IsDead())
+		{
+			continue;
+		}
+
+		const FVector Location = Enemy->GetActorLocation();
+		const float Radius = Enemy->GetSimpleCollisionRadius();
+
+		Neighbours.Reset();
+		SpatialGrid->QueryRadius(Location, Radius * 2.f, ETDSGridAgent::Enemy, Neighbours, Enemy);
+
+		for (const AActor* Neighbour : Neighbours)
+		{
+			// Each pair once
+			if (Neighbour < Enemy && FVector::Dist2D(Location, Neighbour->GetActorLocation()) < Radius + Neighbour->GetSimpleCollisionRadius())
+			{
+				NumOverlaps++;
+			}
+		}
+	}
+
+	return NumOverlaps;
+}
+
+void UTDSSeparationSubsystem::StartBenchmark(ETDSAvoidanceMode Mode, float Seconds)
+{
+	BenchmarkEnemies = 0;
+	for (TActorIterator<ATDSEnemyCharacter> It(GetWorld()); It; ++It)
+	{
+		if (!It->IsDead())
+		{
+			It->SetAvoidanceMode(Mode);
+			BenchmarkEnemies++;
+		}
+	}
+
+	BenchmarkMode = Mode;
+	Benchmark.Start(Seconds);
+
+	UE_LOG(LogTemp, Log, TEXT("tds.Separation.Benchmark: %d enemies switched to %s, measuring for %.1f s"),
+		BenchmarkEnemies, *UEnum::GetValueAsString(Mode), Benchmark.GetSeconds());
+}
+
+void UTDSSeparationSubsystem::FinishBenchmark()
+{
+	UE_LOG(LogTemp, Log, TEXT("tds.Separation.Benchmark: %s, %d enemies, %s | separation pass %.3f ms avg | %.1f overlapping pairs avg"),
+		*UEnum::GetValueAsString(BenchmarkMode),
+		BenchmarkEnemies,
+		*Benchmark.GetFrameSummary(),
+		Benchmark.GetAverage(SamplePassSeconds) * 1000.0,
+		Benchmark.GetAverage(SampleOverlaps));
+}
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSEnemyMovementComponent.h"
+#include "TDSBenchmark.h"
+#include "TDSSeparationSubsystem.generated.h"
+
+class ACharacter;
+
+// This subsystem is the cheap alternative to RVO avoidance for enemy classes set to ETDSAvoidanceMode::Separation.
+// Once per frame it walks every registered enemy, finds its neighbours in the spatial grid and turns them into a
+// separation push (away from neighbours closer than tds.Separation.Radius, harder the closer they are) plus a small
+// cohesion pull towards their centre, handed to the enemy movement component as a velocity bias.
+// It also counts overlapping capsules, and tds.Separation.Benchmark measures frame time and overlaps for a crowd in
+// either mode so the two can be compared.
+UCLASS()
+class UTDSSeparationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only steer enemies in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Starts or stops steering a character, its movement component must be a UTDSEnemyMovementComponent
+	void RegisterAgent(ACharacter* Agent);
+	void UnregisterAgent(ACharacter* Agent);
+
+	// Switches every live enemy to Mode, then logs average and worst frame time, overlapping enemy pairs and the cost of
+	// the separation pass over the next Seconds. Used by tds.Separation.Benchmark.
+	void StartBenchmark(ETDSAvoidanceMode Mode, float Seconds);
+
+private:
+	// Number of enemy pairs whose capsules overlap, over every enemy in the world whatever its mode
+	int32 CountAllOverlaps() const;
+
+	// Logs the benchmark results
+	void FinishBenchmark();
+
+	// Steered characters and their movement components, at matching indices
+	TArray<TWeakObjectPtr<ACharacter>> Agents;
+	TArray<TWeakObjectPtr<UTDSEnemyMovementComponent>> MoveComps;
+
+	// ---- Benchmark ----
+	FTDSFrameBenchmark Benchmark;
+	ETDSAvoidanceMode BenchmarkMode = ETDSAvoidanceMode::RVO;
+	int32 BenchmarkEnemies = 0;
+};
@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSSpatialGrid.h"
+
+FTDSSpatialGrid::FTDSSpatialGrid(float InCellSize)
+{
+	SetCellSize(InCellSize);
+}
+
+void FTDSSpatialGrid::SetCellSize(float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.f);
+	InvCellSize = 1.f / CellSize;
+
+	// Re-bucket everything with the new cell size
+	CellElements.Reset();
+	for (int32 Index = 0; Index < Locations.Num(); ++Index)
+	{
+		Cells[Index] = ToCell(Locations[Index]);
+		LinkToCell(Index);
+	}
+}
+
+int32 FTDSSpatialGrid::Add(const FVector& Location, uint8 TypeMask)
+{
+	const int32 Index = Locations.Add(Location);
+	Cells.Add(ToCell(Location));
+	Types.Add(TypeMask);
+	SlotsInCell.Add(INDEX_NONE);
+
+	LinkToCell(Index);
+	return Index;
+}
+
+void FTDSSpatialGrid::RemoveAtSwap(int32 Index)
+{
+	if (!Locations.IsValidIndex(Index))
+	{
+		return;
+	}
+
+	UnlinkFromCell(Index);
+
+	// The last element is about to move into Index, point its cell entry at the new index
+	const int32 LastIndex = Locations.Num() - 1;
+	if (Index != LastIndex)
+	{
+		CellElements.FindChecked(Cells[LastIndex])[SlotsInCell[LastIndex]] = Index;
+	}
+
+	Locations.RemoveAtSwap(Index, EAllowShrinking::No);
+	Cells.RemoveAtSwap(Index, EAllowShrinking::No);
+	Types.RemoveAtSwap(Index, EAllowShrinking::No);
+	SlotsInCell.RemoveAtSwap(Index, EAllowShrinking::No);
+}
+
+bool FTDSSpatialGrid::Move(int32 Index, const FVector& NewLocation)
+{
+	Locations[Index] = NewLocation;
+
+	const FIntPoint NewCell = ToCell(NewLocation);
+	if (NewCell == Cells[Index])
+	{
+		return false;
+	}
+
+	UnlinkFromCell(Index);
+	Cells[Index] = NewCell;
+	LinkToCell(Index);
+	return true;
+}
+
+void FTDSSpatialGrid::Reset()
+{
+	Locations.Reset();
+	Cells.Reset();
+	Types.Reset();
+	SlotsInCell.Reset();
+	CellElements.Reset();
+}
+
+void FTDSSpatialGrid::LinkToCell(int32 Index)
+{
+	TArray<int32>& Elements = CellElements.FindOrAdd(Cells[Index]);
+	SlotsInCell[Index] = Elements.Add(Index);
+}
+
+void FTDSSpatialGrid::UnlinkFromCell(int32 Index)
+{
+	TArray<int32>* Elements = CellElements.Find(Cells[Index]);
+	if (!Elements)
+	{
+		return;
+	}
+
+	// Swap the cell's last element into our place and fix up its slot
+	const int32 Slot = SlotsInCell[Index];
+	const int32 MovedIndex = Elements->Last();
+	Elements->RemoveAtSwap(Slot, EAllowShrinking::No);
+	if (MovedIndex != Index)
+	{
+		SlotsInCell[MovedIndex] = Slot;
+	}
+
+	SlotsInCell[Index] = INDEX_NONE;
+
+	// Empty cells keep their (small) list allocated, rooms are small enough that the set of visited cells stays bounded
+}
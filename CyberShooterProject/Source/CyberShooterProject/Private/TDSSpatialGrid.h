@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// A uniform 2D grid over the XY plane for proximity queries. Elements are plain indices with a location and a type mask,
+// kept in per-cell lists that are only touched when an element crosses into another cell. Cells are hashed by their
+// coordinates, so the grid needs no bounds: it is created with the room's world, before the room's actors or navmesh
+// could give any, and agents that wander or get knocked off the navmesh still land in a cell.
+// Queries write element indices into a caller-provided array, so with an inline allocator they do not allocate.
+class FTDSSpatialGrid
+{
+public:
+	explicit FTDSSpatialGrid(float InCellSize = 400.f);
+
+	// Changes the cell size, re-bucketing every element
+	void SetCellSize(float InCellSize);
+	float GetCellSize() const { return CellSize; }
+
+	// Adds an element and returns its index
+	int32 Add(const FVector& Location, uint8 TypeMask);
+
+	// Removes an element. The last element is moved into its index, so the caller must mirror the swap.
+	void RemoveAtSwap(int32 Index);
+
+	// Updates an element's location, moving it to another cell only if it crossed a cell border.
+	// Returns true if the element changed cell.
+	bool Move(int32 Index, const FVector& NewLocation);
+
+	// Removes every element
+	void Reset();
+
+	int32 Num() const { return Locations.Num(); }
+	const FVector& GetLocation(int32 Index) const { return Locations[Index]; }
+
+	// Appends the index of every element matching TypeMask within Radius of Center (in 2D) to OutIndices
+	template <typename AllocatorType>
+	void QueryRadius(const FVector& Center, float Radius, uint8 TypeMask, TArray<int32, AllocatorType>& OutIndices) const
+	{
+		const float RadiusSq = FMath::Square(Radius);
+		const FIntPoint MinCell = ToCell(Center - FVector(Radius, Radius, 0.f));
+		const FIntPoint MaxCell = ToCell(Center + FVector(Radius, Radius, 0.f));
+
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+		{
+			for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+			{
+				const TArray<int32>* Elements = CellElements.Find(FIntPoint(CellX, CellY));
+				if (!Elements)
+				{
+					continue;
+				}
+
+				for (const int32 Index : *Elements)
+				{
+					if ((Types[Index] & TypeMask) != 0 && FVector::DistSquared2D(Locations[Index], Center) <= RadiusSq)
+					{
+						OutIndices.Add(Index);
+					}
+				}
+			}
+		}
+	}
+
+	// Appends the indices of the K closest elements matching TypeMask within MaxRadius of Center (in 2D) to OutIndices, closest first.
+	// Searches outwards one ring of cells at a time and stops as soon as no closer element can exist.
+	template <typename AllocatorType>
+	void QueryNearest(const FVector& Center, int32 K, float MaxRadius, uint8 TypeMask, TArray<int32, AllocatorType>& OutIndices) const
+	{
+		if (K <= 0)
+		{
+			return;
+		}
+
+		// Best candidates so far, kept sorted by distance
+		TArray<TPair<float, int32>, TInlineAllocator<32>> Best;
+
+		const float MaxRadiusSq = FMath::Square(MaxRadius);
+		const FIntPoint CenterCell = ToCell(Center);
+		const int32 MaxRing = FMath::CeilToInt(MaxRadius / CellSize);
+
+		for (int32 Ring = 0; Ring <= MaxRing; ++Ring)
+		{
+			// Everything in this ring is at least (Ring - 1) cells away, stop once the K-th best is closer than that
+			if (Best.Num() >= K && Best[K - 1].Key <= FMath::Square((Ring - 1) * CellSize))
+			{
+				break;
+			}
+
+			for (int32 CellY = CenterCell.Y - Ring; CellY <= CenterCell.Y + Ring; ++CellY)
+			{
+				// Only the border of the ring, the inside was searched by the previous rings
+				const bool bEdgeRow = FMath::Abs(CellY - CenterCell.Y) == Ring;
+				const int32 StepX = bEdgeRow ? 1 : FMath::Max(Ring * 2, 1);
+
+				for (int32 CellX = CenterCell.X - Ring; CellX <= CenterCell.X + Ring; CellX += StepX)
+				{
+					const TArray<int32>* Elements = CellElements.Find(FIntPoint(CellX, CellY));
+					if (!Elements)
+					{
+						continue;
+					}
+
+					for (const int32 Index : *Elements)
+					{
+						if ((Types[Index] & TypeMask) == 0)
+						{
+							continue;
+						}
+
+						const float DistSq = FVector::DistSquared2D(Locations[Index], Center);
+						if (DistSq > MaxRadiusSq || (Best.Num() >= K && DistSq >= Best[K - 1].Key))
+						{
+							continue;
+						}
+
+						// Insert in order, dropping anything pushed past K
+						int32 InsertAt = Best.Num();
+						while (InsertAt > 0 && Best[InsertAt - 1].Key > DistSq)
+						{
+							InsertAt--;
+						}
+						Best.Insert(TPair<float, int32>(DistSq, Index), InsertAt);
+						if (Best.Num() > K)
+						{
+							Best.Pop(EAllowShrinking::No);
+						}
+					}
+				}
+			}
+		}
+
+		for (const TPair<float, int32>& Candidate : Best)
+		{
+			OutIndices.Add(Candidate.Value);
+		}
+	}
+
+private:
+	// Returns the cell a location falls in
+	FIntPoint ToCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt(Location.X * InvCellSize), FMath::FloorToInt(Location.Y * InvCellSize));
+	}
+
+	// Adds/removes an element to/from its cell's list
+	void LinkToCell(int32 Index);
+	void UnlinkFromCell(int32 Index);
+
+	float CellSize = 400.f;
+	float InvCellSize = 1.f / 400.f;
+
+	// ---- Elements, struct-of-arrays ----
+	TArray<FVector> Locations;
+	TArray<FIntPoint> Cells;
+	TArray<uint8> Types;
+
+	// Position of each element inside its cell's list, so unlinking is a swap instead of a search
+	TArray<int32> SlotsInCell;
+
+	// Elements in each occupied cell
+	TMap<FIntPoint, TArray<int32>> CellElements;
+};
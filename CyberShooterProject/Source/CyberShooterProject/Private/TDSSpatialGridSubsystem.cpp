@@ -0,0 +1,267 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSSpatialGridSubsystem.h"
+#include "CyberShooterProject.h"
+#include "TDSCollisionChannels.h"
+#include "TDSEnemyCharacter.h"
+#include "TDSEnemyManager.h"
+#include "TDSWeakArray.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "Kismet/KismetSystemLibrary.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+
+DECLARE_CYCLE_STAT(TEXT("Spatial Grid Update"), STAT_TDSSpatialGridUpdate, STATGROUP_CyberShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Spatial Grid Agents"), STAT_TDSSpatialGridAgents, STATGROUP_CyberShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spatial Grid Cell Changes"), STAT_TDSSpatialGridCellChanges, STATGROUP_CyberShooter);
+
+static TAutoConsoleVariable<float> CVarTDSGridCellSize(
+	TEXT("tds.Grid.CellSize"),
+	400.f,
+	TEXT("Cell size of the spatial grid, read when a world starts. Roughly the most common query radius works best."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorldAndArgs GTDSGridBenchmarkCommand(
+	TEXT("tds.Grid.Benchmark"),
+	TEXT("Times spatial grid radius and k-nearest queries against a brute force scan at 10, 100 and 1000 agents, ")
+	TEXT("then grid radius queries against SphereOverlapActors on crowds of 10, 100 and 1000 enemies spawned around the player, removed again afterwards. ")
+	TEXT("Optional argument: number of queries (default 1000)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UTDSSpatialGridSubsystem* GridSubsystem = World ? World->GetSubsystem<UTDSSpatialGridSubsystem>() : nullptr)
+		{
+			GridSubsystem->RunBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000);
+		}
+	}));
+
+bool UTDSSpatialGridSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTDSSpatialGridSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	Grid.SetCellSize(CVarTDSGridCellSize.GetValueOnGameThread());
+}
+
+void UTDSSpatialGridSubsystem::Deinitialize()
+{
+	Grid.Reset();
+	Agents.Empty();
+	AgentKeys.Empty();
+	AgentIndices.Empty();
+
+	SET_DWORD_STAT(STAT_TDSSpatialGridAgents, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UTDSSpatialGridSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSSpatialGridSubsystem, STATGROUP_Tickables);
+}
+
+void UTDSSpatialGridSubsystem::RegisterAgent(AActor* Agent, ETDSGridAgent Type)
+{
+	if (!Agent || AgentIndices.Contains(Agent))
+	{
+		return;
+	}
+
+	const int32 Index = Grid.Add(Agent->GetActorLocation(), static_cast<uint8>(Type));
+	Agents.Add(Agent);
+	AgentKeys.Add(Agent);
+	AgentIndices.Add(Agent, Index);
+}
+
+void UTDSSpatialGridSubsystem::UnregisterAgent(AActor* Agent)
+{
+	int32 Index = INDEX_NONE;
+	if (AgentIndices.RemoveAndCopyValue(Agent, Index))
+	{
+		RemoveAgentAt(Index);
+	}
+}
+
+void UTDSSpatialGridSubsystem::RemoveAgentAt(int32 Index)
+{
+	Grid.RemoveAtSwap(Index);
+	Agents.RemoveAtSwap(Index, EAllowShrinking::No);
+	AgentKeys.RemoveAtSwap(Index, EAllowShrinking::No);
+
+	// Mirror the swap: whoever was last now lives at Index
+	if (AgentKeys.IsValidIndex(Index))
+	{
+		AgentIndices.FindChecked(AgentKeys[Index]) = Index;
+	}
+}
+
+void UTDSSpatialGridSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_TDSSpatialGridUpdate);
+
+	int32 NumCellChanges = 0;
+
+	// An agent destroyed without unregistering still has a cell in the grid and an entry in AgentIndices,
+	// both go with it so queries never return a dead actor
+	FTDSWeakArray::RemoveStaleSwap(
+		Agents.Num(),
+		[this](int32 Index) { return !Agents[Index].IsValid(); },
+		[this](int32 Index)
+		{
+			AgentIndices.Remove(AgentKeys[Index]);
+			RemoveAgentAt(Index);
+		});
+
+	for (int32 Index = 0; Index < Agents.Num(); ++Index)
+	{
+		const AActor* Agent = Agents[Index].Get();
+		if (Grid.Move(Index, Agent->GetActorLocation()))
+		{
+			NumCellChanges++;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_TDSSpatialGridAgents, Agents.Num());
+	INC_DWORD_STAT_BY(STAT_TDSSpatialGridCellChanges, NumCellChanges);
+}
+
+void UTDSSpatialGridSubsystem::RunBenchmark(int32 NumQueries)
+{
+	NumQueries = FMath::Max(NumQueries, 1);
+
+	const float QueryRadiusSize = 300.f;
+	const int32 NearestCount = 4;
+	const float AreaHalfSize = 2000.f;
+
+	FRandomStream Random(1337);
+
+	// Synthetic crowds, so the scaling can be measured without spawning enemies
+	for (const int32 NumAgents : { 10, 100, 1000 })
+	{
+		FTDSSpatialGrid BenchGrid(Grid.GetCellSize());
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			BenchGrid.Add(FVector(Random.FRandRange(-AreaHalfSize, AreaHalfSize), Random.FRandRange(-AreaHalfSize, AreaHalfSize), 0.f), 1);
+		}
+
+		TArray<FVector> Centers;
+		for (int32 QueryIndex = 0; QueryIndex < NumQueries; ++QueryIndex)
+		{
+			Centers.Add(FVector(Random.FRandRange(-AreaHalfSize, AreaHalfSize), Random.FRandRange(-AreaHalfSize, AreaHalfSize), 0.f));
+		}
+
+		int32 NumFound = 0;
+		TArray<int32, TInlineAllocator<64>> Results;
+
+		double StartTime = FPlatformTime::Seconds();
+		for (const FVector& Center : Centers)
+		{
+			Results.Reset();
+			BenchGrid.QueryRadius(Center, QueryRadiusSize, 1, Results);
+			NumFound += Results.Num();
+		}
+		const double GridRadiusTime = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		for (const FVector& Center : Centers)
+		{
+			Results.Reset();
+			BenchGrid.QueryNearest(Center, NearestCount, AreaHalfSize, 1, Results);
+			NumFound += Results.Num();
+		}
+		const double GridNearestTime = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		const float RadiusSq = FMath::Square(QueryRadiusSize);
+		for (const FVector& Center : Centers)
+		{
+			for (int32 AgentIndex = 0; AgentIndex < BenchGrid.Num(); ++AgentIndex)
+			{
+				if (FVector::DistSquared2D(BenchGrid.GetLocation(AgentIndex), Center) <= RadiusSq)
+				{
+					NumFound++;
+				}
+			}
+		}
+		const double BruteForceTime = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogTemp, Log, TEXT("tds.Grid.Benchmark: %4d agents | grid radius %.3f us | grid %d-nearest %.3f us | brute force radius %.3f us (per query, %d results)"),
+			NumAgents,
+			GridRadiusTime * 1e6 / NumQueries,
+			NearestCount,
+			GridNearestTime * 1e6 / NumQueries,
+			BruteForceTime * 1e6 / NumQueries,
+			NumFound);
+	}
+
+	// Real crowds spawned around the player, against the physics overlap the grid replaces. The crowd grows to each size,
+	// so both are timed over the same enemies, and is removed again at the end.
+	UWorld* World = GetWorld();
+	const TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypes = {
+		UEngineTypes::ConvertToObjectType(ECC_Pawn),
+		UEngineTypes::ConvertToObjectType(ECC_TDSEnemyHurtbox)
+	};
+
+	TArray<ATDSEnemyCharacter*> Crowd;
+	for (const int32 CrowdSize : { 10, 100, 1000 })
+	{
+		UTDSEnemyManager::SpawnBenchmarkEnemies(World, CrowdSize - Crowd.Num(), Crowd);
+		if (Crowd.Num() == 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("tds.Grid.Benchmark: no crowd spawned, the SphereOverlapActors comparison needs a player and a navmesh"));
+			break;
+		}
+
+		// Queries around the enemies themselves, like the separation and combat slot queries
+		TArray<FVector> Centers;
+		for (int32 QueryIndex = 0; QueryIndex < NumQueries; ++QueryIndex)
+		{
+			Centers.Add(Crowd[QueryIndex % Crowd.Num()]->GetActorLocation());
+		}
+
+		int32 NumGridFound = 0;
+		TArray<AActor*, TInlineAllocator<64>> GridResults;
+		double StartTime = FPlatformTime::Seconds();
+		for (const FVector& Center : Centers)
+		{
+			GridResults.Reset();
+			QueryRadius(Center, QueryRadiusSize, ETDSGridAgent::All, GridResults);
+			NumGridFound += GridResults.Num();
+		}
+		const double GridTime = FPlatformTime::Seconds() - StartTime;
+
+		int32 NumOverlapFound = 0;
+		TArray<AActor*> OverlapResults;
+		StartTime = FPlatformTime::Seconds();
+		for (const FVector& Center : Centers)
+		{
+			UKismetSystemLibrary::SphereOverlapActors(World, Center, QueryRadiusSize, ObjectTypes, APawn::StaticClass(), {}, OverlapResults);
+			NumOverlapFound += OverlapResults.Num();
+		}
+		const double OverlapTime = FPlatformTime::Seconds() - StartTime;
+
+		// The overlap also finds capsules whose edge is in range, so it finds a few more than the grid's centre distances
+		UE_LOG(LogTemp, Log, TEXT("tds.Grid.Benchmark: crowd of %4d enemies, %d agents in the grid | grid radius %.3f us, %.1f found | SphereOverlapActors %.3f us, %.1f found (per query)"),
+			Crowd.Num(),
+			Agents.Num(),
+			GridTime * 1e6 / NumQueries,
+			static_cast<double>(NumGridFound) / NumQueries,
+			OverlapTime * 1e6 / NumQueries,
+			static_cast<double>(NumOverlapFound) / NumQueries);
+	}
+
+	for (ATDSEnemyCharacter* Enemy : Crowd)
+	{
+		if (IsValid(Enemy))
+		{
+			Enemy->Destroy();
+		}
+	}
+}
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSSpatialGrid.h"
+#include "TDSSpatialGridSubsystem.generated.h"
+
+// What kind of agent a grid entry is, used as a mask to filter queries
+enum class ETDSGridAgent : uint8
+{
+	None = 0,
+	Enemy = 1 << 0,
+	Player = 1 << 1,
+	All = 0xFF
+};
+ENUM_CLASS_FLAGS(ETDSGridAgent);
+
+// This subsystem keeps the enemies and the player in a uniform spatial grid so proximity questions ("who is within X",
+// "who are my K nearest neighbours") cost a few cell lookups instead of a physics overlap. Agents register when they
+// spawn and unregister when they die. Every frame their locations are refreshed and they only move between cell lists
+// when they cross a cell border. Queries see the locations from the end of the previous frame.
+UCLASS()
+class UTDSSpatialGridSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Only track agents in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Adds an agent to the grid
+	void RegisterAgent(AActor* Agent, ETDSGridAgent Type);
+
+	// Removes an agent from the grid
+	void UnregisterAgent(AActor* Agent);
+
+	// Number of agents in the grid
+	int32 GetNumAgents() const { return Grid.Num(); }
+
+	// Appends every agent of the given types within Radius of Center (in 2D) to OutAgents, skipping Ignore
+	template <typename AllocatorType>
+	void QueryRadius(const FVector& Center, float Radius, ETDSGridAgent Types, TArray<AActor*, AllocatorType>& OutAgents, const AActor* Ignore = nullptr) const
+	{
+		TArray<int32, TInlineAllocator<64>> Indices;
+		Grid.QueryRadius(Center, Radius, static_cast<uint8>(Types), Indices);
+		AppendAgents(Indices, OutAgents, Ignore);
+	}
+
+	// Appends the K agents of the given types closest to Center (in 2D) within MaxRadius to OutAgents, closest first, skipping Ignore
+	template <typename AllocatorType>
+	void QueryNearest(const FVector& Center, int32 K, float MaxRadius, ETDSGridAgent Types, TArray<AActor*, AllocatorType>& OutAgents, const AActor* Ignore = nullptr) const
+	{
+		// Ask for one extra so skipping Ignore still leaves K
+		TArray<int32, TInlineAllocator<32>> Indices;
+		Grid.QueryNearest(Center, Ignore ? K + 1 : K, MaxRadius, static_cast<uint8>(Types), Indices);
+		AppendAgents(Indices, OutAgents, Ignore, K);
+	}
+
+	// Times grid queries against a brute force scan on synthetic crowds, then against SphereOverlapActors on crowds of
+	// enemies spawned for the purpose, logged to LogTemp. Used by tds.Grid.Benchmark.
+	void RunBenchmark(int32 NumQueries);
+
+private:
+	// Removes the agent at Index, mirroring the grid's swap
+	void RemoveAgentAt(int32 Index);
+
+	// Converts grid indices to actors
+	template <typename IndexAllocatorType, typename AllocatorType>
+	void AppendAgents(const TArray<int32, IndexAllocatorType>& Indices, TArray<AActor*, AllocatorType>& OutAgents, const AActor* Ignore, int32 MaxCount = MAX_int32) const
+	{
+		int32 NumAdded = 0;
+		for (const int32 Index : Indices)
+		{
+			AActor* Agent = Agents[Index].Get();
+			if (Agent && Agent != Ignore && NumAdded < MaxCount)
+			{
+				OutAgents.Add(Agent);
+				NumAdded++;
+			}
+		}
+	}
+
+	// The grid, its element indices line up with Agents
+	FTDSSpatialGrid Grid;
+
+	// The actor behind each grid element
+	TArray<TWeakObjectPtr<AActor>> Agents;
+
+	// Map key of each agent, kept alongside Agents so destroyed agents can still be removed from the map
+	TArray<TObjectKey<AActor>> AgentKeys;
+
+	// Grid index of each registered actor
+	TMap<TObjectKey<AActor>, int32> AgentIndices;
+};
@@ -0,0 +1,250 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSTimerWheel.h"
+
+static_assert((FTDSTimerWheel::NearSlots & (FTDSTimerWheel::NearSlots - 1)) == 0 && (FTDSTimerWheel::FarSlots & (FTDSTimerWheel::FarSlots - 1)) == 0, "Timer wheel sizes must be powers of two");
+
+FTDSTimerWheel::FTDSTimerWheel()
+{
+	for (int32& ListHead : ListHeads)
+	{
+		ListHead = INDEX_NONE;
+	}
+}
+
+FTDSTimerHandle FTDSTimerWheel::Arm(float Delay, FSimpleDelegate&& Callback)
+{
+	// Reuse a pooled node if there is one
+	int32 Index = FreeHead;
+	if (Index != INDEX_NONE)
+	{
+		FreeHead = Nodes[Index].Next;
+	}
+	else
+	{
+		Index = Nodes.AddDefaulted();
+	}
+
+	// Due on the first tick at or after now + Delay, and never on the tick already processed
+	const int32 DelayTicks = FMath::Max(FMath::CeilToInt32((Remainder + FMath::Max(Delay, 0.f)) / TickSeconds), 1);
+
+	FNode& Node = Nodes[Index];
+	Node.Callback = MoveTemp(Callback);
+	Node.ExpireTick = CurrentTick + DelayTicks;
+	Node.State = ENodeState::Scheduled;
+
+	Schedule(Index);
+
+	NumActive++;
+	NumArmed++;
+
+	FTDSTimerHandle Handle;
+	Handle.Index = Index;
+	Handle.Generation = Node.Generation;
+	return Handle;
+}
+
+void FTDSTimerWheel::Cancel(FTDSTimerHandle& Handle)
+{
+	if (IsActive(Handle))
+	{
+		if (Nodes[Handle.Index].State == ENodeState::Scheduled)
+		{
+			Unlink(Handle.Index);
+		}
+
+		// An expired node waiting for dispatch is simply released, dispatch skips it by its generation
+		Release(Handle.Index);
+		NumCancelled++;
+	}
+
+	Handle.Invalidate();
+}
+
+bool FTDSTimerWheel::IsActive(const FTDSTimerHandle& Handle) const
+{
+	return Handle.IsValid()
+		&& Nodes.IsValidIndex(Handle.Index)
+		&& Nodes[Handle.Index].Generation == Handle.Generation
+		&& Nodes[Handle.Index].State != ENodeState::Free;
+}
+
+void FTDSTimerWheel::Advance(float DeltaTime)
+{
+	Remainder += DeltaTime;
+	const int32 NumTicks = FMath::FloorToInt32(Remainder / TickSeconds);
+	Remainder -= NumTicks * TickSeconds;
+
+	for (int32 Step = 0; Step < NumTicks; ++Step)
+	{
+		CurrentTick++;
+
+		// Each time the near wheel comes round, bring the next far slot's timers into it, and the overflow's each time the far wheel does
+		const int32 NearIndex = static_cast<int32>(CurrentTick & (NearSlots - 1));
+		if (NearIndex == 0)
+		{
+			const int32 FarIndex = static_cast<int32>((CurrentTick / NearSlots) & (FarSlots - 1));
+			if (FarIndex == 0)
+			{
+				Cascade(OverflowList);
+			}
+			Cascade(FarListBase + FarIndex);
+		}
+
+		ExpireSlot(NearIndex);
+	}
+
+	// Dispatch everything that came due in one go. Callbacks may arm and cancel timers, including ones still in this batch.
+	for (int32 ExpiredIndex = 0; ExpiredIndex < Expired.Num(); ++ExpiredIndex)
+	{
+		const int32 Index = Expired[ExpiredIndex].Key;
+		if (Nodes[Index].State != ENodeState::Expired || Nodes[Index].Generation != Expired[ExpiredIndex].Value)
+		{
+			continue;
+		}
+
+		// Copy the callback out first, arming a timer from it may grow the pool
+		FSimpleDelegate Callback = MoveTemp(Nodes[Index].Callback);
+		Release(Index);
+		NumFired++;
+
+		Callback.ExecuteIfBound();
+	}
+
+	Expired.Reset();
+}
+
+void FTDSTimerWheel::Reset()
+{
+	for (int32 Index = 0; Index < Nodes.Num(); ++Index)
+	{
+		if (Nodes[Index].State != ENodeState::Free)
+		{
+			if (Nodes[Index].State == ENodeState::Scheduled)
+			{
+				Unlink(Index);
+			}
+			Release(Index);
+		}
+	}
+
+	Expired.Reset();
+}
+
+void FTDSTimerWheel::Schedule(int32 Index)
+{
+	const uint64 ExpireTick = Nodes[Index].ExpireTick;
+	const uint64 TicksLeft = ExpireTick > CurrentTick ? ExpireTick - CurrentTick : 0;
+
+	if (TicksLeft < NearSlots)
+	{
+		Link(Index, static_cast<int32>(ExpireTick & (NearSlots - 1)));
+	}
+	else if (TicksLeft < NearSlots * FarSlots)
+	{
+		Link(Index, FarListBase + static_cast<int32>((ExpireTick / NearSlots) & (FarSlots - 1)));
+	}
+	else
+	{
+		Link(Index, OverflowList);
+	}
+}
+
+void FTDSTimerWheel::Link(int32 Index, int32 List)
+{
+	FNode& Node = Nodes[Index];
+	Node.List = List;
+	Node.Prev = INDEX_NONE;
+	Node.Next = ListHeads[List];
+
+	if (Node.Next != INDEX_NONE)
+	{
+		Nodes[Node.Next].Prev = Index;
+	}
+	ListHeads[List] = Index;
+}
+
+void FTDSTimerWheel::Unlink(int32 Index)
+{
+	FNode& Node = Nodes[Index];
+
+	if (Node.Prev != INDEX_NONE)
+	{
+		Nodes[Node.Prev].Next = Node.Next;
+	}
+	else
+	{
+		ListHeads[Node.List] = Node.Next;
+	}
+
+	if (Node.Next != INDEX_NONE)
+	{
+		Nodes[Node.Next].Prev = Node.Prev;
+	}
+
+	Node.Prev = INDEX_NONE;
+	Node.Next = INDEX_NONE;
+	Node.List = INDEX_NONE;
+}
+
+int32 FTDSTimerWheel::TakeList(int32 List)
+{
+	const int32 First = ListHeads[List];
+	ListHeads[List] = INDEX_NONE;
+	return First;
+}
+
+void FTDSTimerWheel::Release(int32 Index)
+{
+	FNode& Node = Nodes[Index];
+	Node.Callback.Unbind();
+	Node.State = ENodeState::Free;
+	Node.Prev = INDEX_NONE;
+	Node.List = INDEX_NONE;
+
+	// Skip 0 on wrap, so a default handle can never match
+	Node.Generation = Node.Generation == MAX_uint32 ? 1 : Node.Generation + 1;
+
+	Node.Next = FreeHead;
+	FreeHead = Index;
+
+	NumActive--;
+}
+
+void FTDSTimerWheel::Cascade(int32 List)
+{
+	int32 Index = TakeList(List);
+	while (Index != INDEX_NONE)
+	{
+		const int32 Next = Nodes[Index].Next;
+		Schedule(Index);
+		Index = Next;
+	}
+}
+
+void FTDSTimerWheel::ExpireSlot(int32 List)
+{
+	int32 Index = TakeList(List);
+	while (Index != INDEX_NONE)
+	{
+		FNode& Node = Nodes[Index];
+		const int32 Next = Node.Next;
+
+		if (Node.ExpireTick <= CurrentTick)
+		{
+			Node.State = ENodeState::Expired;
+			Node.Prev = INDEX_NONE;
+			Node.Next = INDEX_NONE;
+			Node.List = INDEX_NONE;
+			Expired.Add(TPair<int32, uint32>(Index, Node.Generation));
+		}
+		else
+		{
+			// A lap early, keep waiting
+			Schedule(Index);
+		}
+
+		Index = Next;
+	}
+}
@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Handle to a timer on an FTDSTimerWheel. It carries the generation of the timer it was armed for, so a handle kept
+// after its timer fired or was cancelled never touches the timer that reuses the slot.
+struct FTDSTimerHandle
+{
+	int32 Index = INDEX_NONE;
+	uint32 Generation = 0;
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+	void Invalidate() { Index = INDEX_NONE; Generation = 0; }
+};
+
+// A hierarchical timer wheel for the many short, constantly re-armed AI timers.
+// Time advances in fixed ticks of TickSeconds. Timers due within NearSlots ticks live in the near wheel, one list per tick,
+// timers due within NearSlots * FarSlots ticks in the far wheel, one list per NearSlots ticks, which is cascaded into the
+// near wheel as time reaches it, and anything later in an overflow list. Timers are pooled nodes in intrusive lists, so
+// arming and cancelling are O(1) and allocation free once the pool has grown.
+// Timers that come due during Advance are collected first and dispatched together at the end, in the order they were due.
+// A timer cancelled by an earlier callback of the same batch is dropped.
+class FTDSTimerWheel
+{
+public:
+	static constexpr float TickSeconds = 1.f / 64.f;
+	static constexpr int32 NearSlots = 256;
+	static constexpr int32 FarSlots = 64;
+
+	FTDSTimerWheel();
+
+	// Arms a one shot timer that calls Callback after Delay seconds, rounded up to the next tick
+	FTDSTimerHandle Arm(float Delay, FSimpleDelegate&& Callback);
+
+	// Cancels the timer if it has not fired yet, and invalidates the handle either way
+	void Cancel(FTDSTimerHandle& Handle);
+
+	// Whether the handle's timer is still waiting to fire
+	bool IsActive(const FTDSTimerHandle& Handle) const;
+
+	// Moves time forward and dispatches every timer that came due
+	void Advance(float DeltaTime);
+
+	// Drops every timer without calling it
+	void Reset();
+
+	int32 GetNumActive() const { return NumActive; }
+
+	// Timers armed, cancelled and fired since the counters were last reset, for stats
+	int32 NumArmed = 0;
+	int32 NumCancelled = 0;
+	int32 NumFired = 0;
+	void ResetCounters() { NumArmed = 0; NumCancelled = 0; NumFired = 0; }
+
+private:
+	enum class ENodeState : uint8
+	{
+		Free,
+		Scheduled,
+		Expired
+	};
+
+	// One pooled timer, linked into the list of the slot it waits in
+	struct FNode
+	{
+		FSimpleDelegate Callback;
+		uint64 ExpireTick = 0;
+		int32 Prev = INDEX_NONE;
+		int32 Next = INDEX_NONE;
+
+		// List the node is linked into, so it can be unlinked without knowing which wheel it is in
+		int32 List = INDEX_NONE;
+
+		uint32 Generation = 1;
+		ENodeState State = ENodeState::Free;
+	};
+
+	// Puts a scheduled node into the near wheel, the far wheel or the overflow list depending on how far away it is
+	void Schedule(int32 Index);
+
+	void Link(int32 Index, int32 List);
+	void Unlink(int32 Index);
+
+	// Detaches a whole list and returns its first node
+	int32 TakeList(int32 List);
+
+	// Returns a node to the pool and bumps its generation, invalidating every handle to it
+	void Release(int32 Index);
+
+	// Re-schedules every node of a list, used when time reaches a far wheel slot or the overflow list
+	void Cascade(int32 List);
+
+	// Moves the nodes of the current tick's near slot into Expired
+	void ExpireSlot(int32 List);
+
+	// Lists are the near wheel's slots, then the far wheel's, then the overflow list
+	static constexpr int32 FarListBase = NearSlots;
+	static constexpr int32 OverflowList = NearSlots + FarSlots;
+	static constexpr int32 NumLists = NearSlots + FarSlots + 1;
+
+	TArray<FNode> Nodes;
+	int32 FreeHead = INDEX_NONE;
+
+	// First node of each list
+	int32 ListHeads[NumLists];
+
+	// Last tick that was processed, and time left over towards the next one
+	uint64 CurrentTick = 0;
+	float Remainder = 0.f;
+
+	// Nodes that came due this Advance, with the generation they had, in the order they were due
+	TArray<TPair<int32, uint32>> Expired;
+
+	int32 NumActive = 0;
+};
@@ -10,6 +10,7 @@
 #include "TDSGameInstance.h"
 #include "TDSRunData.h"
 #include "TDSUpgradeDefinition.h"
+#include "TDSCollisionChannels.h"
 
 // Sets default values
 ATDSUpgradePickup::ATDSUpgradePickup()
@@ -31,9 +32,7 @@ ATDSUpgradePickup::ATDSUpgradePickup()
 	OverlapBox = CreateDefaultSubobject<UBoxComponent>(TEXT("OverlapBox"));
 	OverlapBox->SetupAttachment(Root);
 	OverlapBox->SetBoxExtent(FVector(50.f, 50.f, 50.f));
-	OverlapBox->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
-	OverlapBox->SetCollisionResponseToAllChannels(ECR_Ignore);
-	OverlapBox->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
+	OverlapBox->SetCollisionProfileName(TDSCollisionProfiles::PawnTrigger);
 	OverlapBox->SetGenerateOverlapEvents(true);
 }
 
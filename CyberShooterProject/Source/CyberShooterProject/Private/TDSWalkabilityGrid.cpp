@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TDSWalkabilityGrid.h"
+#include "NavigationData.h"
+
+namespace
+{
+	// Horizontal extent of the cell centre probes, small so a centre inside a wall is not snapped onto the navmesh beside it
+	constexpr float ProbeExtent = 5.f;
+}
+
+TSharedPtr<FTDSWalkabilityGrid> FTDSWalkabilityGrid::Build(const ANavigationData& NavData, const FBox& Bounds, float InCellSize, int32 MaxSide)
+{
+	const FVector Size = Bounds.GetSize();
+
+	TSharedPtr<FTDSWalkabilityGrid> Grid = MakeShared<FTDSWalkabilityGrid>();
+	Grid->CellSize = FMath::Max3(InCellSize, static_cast<float>(Size.X / MaxSide), static_cast<float>(Size.Y / MaxSide));
+	Grid->CellSize = FMath::Max(Grid->CellSize, 1.f);
+	Grid->Origin = FVector2D(Bounds.Min.X, Bounds.Min.Y);
+	Grid->SizeX = FMath::Clamp(FMath::CeilToInt32(Size.X / Grid->CellSize), 1, MaxSide);
+	Grid->SizeY = FMath::Clamp(FMath::CeilToInt32(Size.Y / Grid->CellSize), 1, MaxSide);
+	Grid->Walkable.Init(0, Grid->Num());
+	Grid->Links.Init(0, Grid->Num());
+	Grid->CellPoints.SetNumZeroed(Grid->Num());
+
+	// A cell counts as walkable if the navmesh covers its centre, at any height inside the room
+	const FVector Extent(ProbeExtent, ProbeExtent, Bounds.GetExtent().Z + 100.f);
+	const FSharedConstNavQueryFilter QueryFilter = NavData.GetDefaultQueryFilter();
+
+	// Link to a neighbour sampled before us when the navmesh runs straight across, a raycast hit means a wall or a gap in
+	// the navmesh lies between the two centres. The height check just skips raycasts that cannot succeed.
+	const auto RunsStraightTo = [&NavData, &QueryFilter, &Grid](const FVector& From, const FVector& To)
+	{
+		FVector HitLocation;
+		return FMath::Abs(To.Z - From.Z) <= Grid->CellSize && !NavData.Raycast(From, To, HitLocation, QueryFilter);
+	};
+
+	FNavLocation Projected;
+	for (int32 CellY = 0; CellY < Grid->SizeY; ++CellY)
+	{
+		for (int32 CellX = 0; CellX < Grid->SizeX; ++CellX)
+		{
+			const int32 Index = Grid->ToIndex(FIntPoint(CellX, CellY));
+			const FVector CellCenter(
+				Grid->Origin.X + (CellX + 0.5f) * Grid->CellSize,
+				Grid->Origin.Y + (CellY + 0.5f) * Grid->CellSize,
+				Bounds.GetCenter().Z);
+
+			if (!NavData.ProjectPoint(CellCenter, Projected, Extent))
+			{
+				continue;
+			}
+
+			Grid->Walkable[Index] = 1;
+			Grid->CellPoints[Index] = Projected.Location;
+
+			if (CellX > 0 && Grid->Walkable[Index - 1] && RunsStraightTo(Grid->CellPoints[Index - 1], Projected.Location))
+			{
+				Grid->Links[Index] |= LinkNegX;
+			}
+			if (CellY > 0 && Grid->Walkable[Index - Grid->SizeX] && RunsStraightTo(Grid->CellPoints[Index - Grid->SizeX], Projected.Location))
+			{
+				Grid->Links[Index] |= LinkNegY;
+			}
+		}
+	}
+
+	return Grid;
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ANavigationData;
+
+// Which cells of a room are walkable and which neighbours are connected, sampled from the navmesh once when the room loads.
+// Built by the navigation cache subsystem and shared read only by everything laid out over the room's cells: the navigation
+// cache groups it into regions and wander points, the flow field runs Dijkstra over it. Build only reads the navmesh, so it
+// can run on a worker thread.
+struct FTDSWalkabilityGrid
+{
+	// World XY of the corner of cell (0, 0)
+	FVector2D Origin = FVector2D::ZeroVector;
+	float CellSize = 100.f;
+
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+
+	// One entry per cell, row major, non zero where the cell's centre is on the navmesh
+	TArray<uint8> Walkable;
+
+	// Bits of Links, set on a walkable cell when the navmesh runs straight across to its -X or -Y neighbour
+	static constexpr uint8 LinkNegX = 1;
+	static constexpr uint8 LinkNegY = 2;
+
+	// One entry per cell, row major. Two walkable cells can still have a wall thinner than a cell between them,
+	// so only neighbours that are linked count as connected.
+	TArray<uint8> Links;
+
+	// Navmesh point under each walkable cell's centre, row major, zero on cells that are not walkable
+	TArray<FVector> CellPoints;
+
+	int32 Num() const { return SizeX * SizeY; }
+	bool IsValidCell(const FIntPoint& Cell) const { return Cell.X >= 0 && Cell.Y >= 0 && Cell.X < SizeX && Cell.Y < SizeY; }
+	int32 ToIndex(const FIntPoint& Cell) const { return Cell.Y * SizeX + Cell.X; }
+
+	// Whether a straight step by Offset, one of the four straight neighbour offsets, leads from Cell to a linked neighbour
+	bool IsLinked(const FIntPoint& Cell, const FIntPoint& Offset) const
+	{
+		const FIntPoint Target = Cell + Offset;
+		if (!IsValidCell(Target))
+		{
+			return false;
+		}
+
+		// The link is stored on whichever of the two cells is further along the axis
+		const FIntPoint& Upper = Offset.X + Offset.Y > 0 ? Target : Cell;
+		return (Links[ToIndex(Upper)] & (Offset.X != 0 ? LinkNegX : LinkNegY)) != 0;
+	}
+
+	FIntPoint ToCell(const FVector& Location) const
+	{
+		return FIntPoint(
+			FMath::FloorToInt32((Location.X - Origin.X) / CellSize),
+			FMath::FloorToInt32((Location.Y - Origin.Y) / CellSize));
+	}
+
+	// Samples the navmesh over Bounds with cells of InCellSize (grown so no side has more than MaxSide cells)
+	static TSharedPtr<FTDSWalkabilityGrid> Build(const ANavigationData& NavData, const FBox& Bounds, float InCellSize, int32 MaxSide);
+};
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Helpers for the subsystems that keep registered objects in arrays of weak pointers. Objects can be destroyed
+// without unregistering (level unloads, Destroy from Blueprints), so those arrays are compacted before each pass.
+struct FTDSWeakArray
+{
+	// Removes every entry of a registration array of Num entries for which IsStale(Index) is true, by calling
+	// RemoveAtSwap(Index). RemoveAtSwap must swap the last entry into Index, like TArray::RemoveAtSwap, and do the
+	// same to any parallel arrays. Walking backwards means the entry swapped in was already checked, so none is
+	// skipped. Returns how many entries were removed.
+	template <typename StaleFuncType, typename RemoveFuncType>
+	static int32 RemoveStaleSwap(int32 Num, StaleFuncType&& IsStale, RemoveFuncType&& RemoveAtSwap)
+	{
+		int32 NumRemoved = 0;
+		for (int32 Index = Num - 1; Index >= 0; --Index)
+		{
+			if (IsStale(Index))
+			{
+				RemoveAtSwap(Index);
+				NumRemoved++;
+			}
+		}
+		return NumRemoved;
+	}
+};
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "TDSTestWorld.h"
+#include "TDSAudioEventSubsystem.h"
+#include "Sound/SoundWave.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTDSAudioEventCountersTest, "CyberShooter.Audio.AudioEvents.HeadlessCounters",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTDSAudioEventCountersTest::RunTest(const FString& Parameters)
+{
+	FTDSScopedTestWorld TestWorld;
+	if (!TestNotNull(TEXT("Test world"), TestWorld.World))
+	{
+		return false;
+	}
+
+	// Behave like -nosound whether or not the test runner has an audio device
+	TestWorld.World->bAllowAudioPlayback = false;
+
+	UTDSAudioEventSubsystem* Audio = TestWorld.World->GetSubsystem<UTDSAudioEventSubsystem>();
+	if (!TestNotNull(TEXT("Audio event subsystem"), Audio))
+	{
+		return false;
+	}
+
+	USoundWave* ShotSound = NewObject<USoundWave>(GetTransientPackage());
+	USoundWave* ImpactSound = NewObject<USoundWave>(GetTransientPackage());
+
+	// Ten shots from the same muzzle, one far away, and an impact right on top of them
+	for (int32 Index = 0; Index < 10; Index++)
+	{
+		Audio->PlaySound(ETDSAudioCategory::Weapon, ShotSound, FVector(Index * 10.f, 0.f, 0.f));
+	}
+	Audio->PlaySound(ETDSAudioCategory::Weapon, ShotSound, FVector(10000.f, 0.f, 0.f));
+	Audio->PlaySound(ETDSAudioCategory::Impact, ImpactSound, FVector::ZeroVector);
+
+	// Requests without a sound are ignored outright
+	Audio->PlaySound(ETDSAudioCategory::Hurt, nullptr, FVector::ZeroVector);
+
+	TestEqual(TEXT("Requests are counted as they are made"), Audio->GetNumRequested(), 12);
+	TestEqual(TEXT("Nothing is merged before the frame ends"), Audio->GetNumCoalesced(), 0);
+
+	TestWorld.Tick(1.f / 60.f);
+
+	TestEqual(TEXT("Requested"), Audio->GetNumRequested(), 12);
+	TestEqual(TEXT("Coalesced"), Audio->GetNumCoalesced(), 9);
+	TestEqual(TEXT("Dropped without an audio device"), Audio->GetNumDropped(), 3);
+	TestEqual(TEXT("Played without an audio device"), Audio->GetNumPlayed(), 0);
+
+	// A quiet frame leaves the counters alone
+	TestWorld.Tick(1.f / 60.f);
+
+	TestEqual(TEXT("Requested after a quiet frame"), Audio->GetNumRequested(), 12);
+	TestEqual(TEXT("Dropped after a quiet frame"), Audio->GetNumDropped(), 3);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
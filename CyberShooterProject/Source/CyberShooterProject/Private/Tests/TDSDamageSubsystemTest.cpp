@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "TDSTestWorld.h"
+#include "TDSDamageSubsystem.h"
+#include "TDSAudioEventSubsystem.h"
+#include "TDSEnemyCharacter.h"
+#include "Sound/SoundWave.h"
+#include "UObject/UnrealType.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	ATDSEnemyCharacter* SpawnTestEnemy(UWorld* World, const FVector& Location, USoundBase* HurtSound)
+	{
+		FActorSpawnParameters Params;
+		Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		ATDSEnemyCharacter* Enemy = World->SpawnActor<ATDSEnemyCharacter>(ATDSEnemyCharacter::StaticClass(), FTransform(Location), Params);
+
+		// The hurt sound is the per target feedback, give it one so we can count how often it is played
+		if (Enemy)
+		{
+			if (FObjectProperty* HurtSoundProperty = FindFProperty<FObjectProperty>(ATDSEnemyCharacter::StaticClass(), TEXT("HurtSound")))
+			{
+				HurtSoundProperty->SetObjectPropertyValue_InContainer(Enemy, HurtSound);
+			}
+		}
+
+		return Enemy;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTDSDamageSubsystemAggregationTest, "CyberShooter.Combat.Damage.Aggregation",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTDSDamageSubsystemAggregationTest::RunTest(const FString& Parameters)
+{
+	FTDSScopedTestWorld TestWorld;
+	if (!TestNotNull(TEXT("Test world"), TestWorld.World))
+	{
+		return false;
+	}
+	TestWorld.World->bAllowAudioPlayback = false;
+
+	UTDSDamageSubsystem* Damage = TestWorld.World->GetSubsystem<UTDSDamageSubsystem>();
+	UTDSAudioEventSubsystem* Audio = TestWorld.World->GetSubsystem<UTDSAudioEventSubsystem>();
+	if (!TestNotNull(TEXT("Damage subsystem"), Damage) || !TestNotNull(TEXT("Audio event subsystem"), Audio))
+	{
+		return false;
+	}
+
+	USoundWave* HurtSound = NewObject<USoundWave>(GetTransientPackage());
+
+	// Far enough apart that their hurt sounds are never merged
+	ATDSEnemyCharacter* Survivor = SpawnTestEnemy(TestWorld.World, FVector(0.f, 0.f, 0.f), HurtSound);
+	ATDSEnemyCharacter* Victim = SpawnTestEnemy(TestWorld.World, FVector(10000.f, 0.f, 0.f), HurtSound);
+	if (!TestNotNull(TEXT("Survivor"), Survivor) || !TestNotNull(TEXT("Victim"), Victim))
+	{
+		return false;
+	}
+
+	const float MaxHealth = Survivor->GetMaxHealth();
+	TestTrue(TEXT("Enemies start at full health"), MaxHealth > 0.f && Survivor->GetCurrentHealth() == MaxHealth);
+
+	// Three small hits on one enemy and three killing hits on the other, all in the same frame
+	const float SmallHit = MaxHealth * 0.1f;
+	for (int32 Hit = 0; Hit < 3; Hit++)
+	{
+		Damage->QueueDamage(Survivor, SmallHit, nullptr, nullptr, Survivor->GetActorLocation());
+		Damage->QueueDamage(Victim, MaxHealth, nullptr, nullptr, Victim->GetActorLocation());
+	}
+
+	// Hits on nothing are ignored
+	Damage->QueueDamage(nullptr, MaxHealth, nullptr, nullptr, FVector::ZeroVector);
+
+	TestEqual(TEXT("Queued damage waits for the end of the frame"), Survivor->GetCurrentHealth(), MaxHealth);
+
+	const int32 HurtSoundsBefore = Audio->GetNumRequested();
+
+	// The frame's damage is resolved once every actor has ticked
+	TestWorld.Tick(1.f / 60.f);
+
+	TestNearlyEqual(TEXT("The survivor took the summed damage"), Survivor->GetCurrentHealth(), MaxHealth - 3.f * SmallHit, 1.e-3f);
+	TestFalse(TEXT("The survivor is alive"), Survivor->IsDead());
+	TestEqual(TEXT("The victim's health is zero"), Victim->GetCurrentHealth(), 0.f);
+	TestTrue(TEXT("The victim is dead"), Victim->IsDead());
+	TestEqual(TEXT("One hurt sound per target, not per hit"), Audio->GetNumRequested() - HurtSoundsBefore, 2);
+
+	// A dead enemy ignores further hits and gives no more feedback
+	Damage->QueueDamage(Victim, SmallHit, nullptr, nullptr, Victim->GetActorLocation());
+	Damage->ResolvePendingDamage();
+
+	TestEqual(TEXT("The victim stays at zero"), Victim->GetCurrentHealth(), 0.f);
+	TestEqual(TEXT("No hurt sound for a dead enemy"), Audio->GetNumRequested() - HurtSoundsBefore, 2);
+
+	// Hits in the next frame are their own batch
+	Damage->QueueDamage(Survivor, SmallHit, nullptr, nullptr, Survivor->GetActorLocation());
+	TestWorld.Tick(1.f / 60.f);
+
+	TestNearlyEqual(TEXT("The survivor took the next frame's hit"), Survivor->GetCurrentHealth(), MaxHealth - 4.f * SmallHit, 1.e-3f);
+	TestEqual(TEXT("One more hurt sound for the next frame"), Audio->GetNumRequested() - HurtSoundsBefore, 3);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,537 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "TDSEnemyDecision.h"
+#include "TDSEnemyManager.h"
+#include "Math/RandomStream.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// Just enough of an actor for the original controller code below to compile unchanged
+	struct FRecordedActor
+	{
+		FVector Location = FVector::ZeroVector;
+		FRotator Rotation = FRotator::ZeroRotator;
+
+		FVector GetActorLocation() const { return Location; }
+		FRotator GetActorRotation() const { return Rotation; }
+		void SetActorRotation(const FRotator& NewRotation) { Rotation = NewRotation; }
+	};
+
+	// ATDSEnemyAIController's FSM from before the decision pass was split out of its Tick. UpdateStateTransitions, RunState,
+	// RotatePawnTowardPlayer and HandleStuck are copied unchanged from that version, and Tick is the order it called them in.
+	// The engine calls they made are stubs that record what was asked for. SetState only records the new state: what it did
+	// on entering a state (slots, attack timers) is the controller's, and the decision pass reads it back the same way.
+	// Distance bands did not exist yet, so this is only compared on inputs without them.
+	struct FOriginalEnemyController
+	{
+		explicit FOriginalEnemyController(const FTDSEnemyDecisionInput& Input)
+		{
+			Player.Location = Input.PlayerLocation;
+			PlayerPawn = Input.bHasPlayer ? &Player : nullptr;
+			Pawn.Location = Input.PawnLocation;
+			Pawn.Rotation = Input.PawnRotation;
+
+			State = Input.State;
+			bIsAttacking = Input.bIsAttacking;
+			WanderTarget = Input.WanderTarget;
+			bHasWanderTarget = Input.bHasWanderTarget;
+			CurrentSlotTarget = Input.CurrentSlotTarget;
+			SmoothedSlotTarget = Input.SmoothedSlotTarget;
+			LastLocation = Input.LastLocation;
+			StuckTime = Input.StuckTime;
+
+			ChaseDistance = Input.ChaseDistance;
+			AttackRange = Input.AttackRange;
+			ChaseTurnSpeed = Input.ChaseTurnSpeed;
+			SlotSmoothingSpeed = Input.SlotSmoothingSpeed;
+			StuckSpeedThreshold = Input.StuckSpeedThreshold;
+			StuckTimeToTrigger = Input.StuckTimeToTrigger;
+		}
+
+		void Tick(float DeltaSeconds)
+		{
+			UpdateStateTransitions();
+			RunState(DeltaSeconds);
+			HandleStuck(DeltaSeconds);
+		}
+
+		// The original code's pawns, so it reads the same as it did
+		using APawn = FRecordedActor;
+
+		APawn Player;
+		APawn Pawn;
+		APawn* PlayerPawn = nullptr;
+		APawn* GetPawn() { return &Pawn; }
+
+		EEnemyState State = EEnemyState::Idle;
+		bool bIsAttacking = false;
+		FVector WanderTarget = FVector::ZeroVector;
+		bool bHasWanderTarget = false;
+		FVector CurrentSlotTarget = FVector::ZeroVector;
+		FVector SmoothedSlotTarget = FVector::ZeroVector;
+		FVector LastLocation = FVector::ZeroVector;
+		float StuckTime = 0.f;
+		float TimeSinceLastWanderMove = 0.f;
+		float TimeSinceLastMove = 0.f;
+
+		float ChaseDistance = 0.f;
+		float AttackRange = 0.f;
+		float ChaseTurnSpeed = 0.f;
+		float SlotSmoothingSpeed = 0.f;
+		float StuckSpeedThreshold = 0.f;
+		float StuckTimeToTrigger = 0.f;
+		float StopDistance = 20.f;
+		float WanderRepathCooldown = 1.f;
+		float RepathCooldown = 0.25f;
+
+		// What the original code asked the engine for
+		bool bStoppedMovement = false;
+		bool bUnstuck = false;
+
+		void SetState(EEnemyState NewState) { State = NewState; }
+		void StopMovement() { bStoppedMovement = true; }
+		void MoveToLocation(const FVector&, float, bool) {}
+		void StartWanderAfterDelay() {}
+		void Unstick() { bUnstuck = true; }
+
+		void UpdateStateTransitions()
+		{
+			// Ensure we have valid references
+			if (!PlayerPawn || !GetPawn()) return;
+
+			// Calculate distance to player
+			const float Dist = FVector::Dist2D(PlayerPawn->GetActorLocation(), GetPawn()->GetActorLocation());
+
+			switch (State) 
+			{
+				// In Idle state, if the player comes within chase distance, switch to Chasing
+				case EEnemyState::Idle:
+				{
+					if (Dist <= ChaseDistance)
+					{
+						SetState(EEnemyState::Chasing);
+					}
+					break;
+				}
+				// In Chasing state, if we get within attack range, switch to Attacking. If the player gets too far away, switch back to Idle
+				case EEnemyState::Chasing:
+				{
+					if (Dist <= AttackRange)
+					{
+						SetState(EEnemyState::Attacking);
+					}
+					else if (Dist > ChaseDistance)
+					{
+						SetState(EEnemyState::Idle);
+					}
+					break;
+				}
+
+				// In Attacking state, if the player moves out of attack range but is still within chase distance, switch back to Chasing. If the player moves out of chase distance, switch back to Idle
+				case EEnemyState::Attacking:
+				{
+					if (Dist > ChaseDistance)
+					{
+						SetState(EEnemyState::Idle);
+					}
+					else if (Dist > AttackRange)
+					{
+						SetState(EEnemyState::Chasing);
+					}
+					break;
+				
+				}
+			}
+		}
+
+		void RunState(float DeltaSeconds)
+		{
+			// Ensure we have a valid pawn reference
+			if (!GetPawn()) return;
+
+			switch (State)
+			{
+				case EEnemyState::Idle:
+				{
+					// If we don't have a wander target, the timer will handle it.
+					if (!bHasWanderTarget) return;
+
+					const float DistToTarget = FVector::Dist2D(WanderTarget, GetPawn()->GetActorLocation());
+					if (DistToTarget <= 120.f)
+					{
+						bHasWanderTarget = false; // Clear the target so we pick a new one after a delay
+						StopMovement(); // Stop movement when we reach the wander target
+						StartWanderAfterDelay(); // Start a new wander after a short delay to create more natural idle behavior
+						return;
+					}
+
+					// Update timer for the last move
+					TimeSinceLastWanderMove += DeltaSeconds;
+					if (TimeSinceLastWanderMove >= WanderRepathCooldown)
+					{
+						// If we've been moving towards the wander target for a while, pick a new one to prevent getting stuck trying to reach an unreachable point
+						MoveToLocation(WanderTarget, 80.f, true);
+						TimeSinceLastWanderMove = 0.f;
+					}
+					break;
+				}
+
+				case EEnemyState::Chasing:
+				{
+					// Face player while chasing (your smooth rotation)
+					RotatePawnTowardPlayer(DeltaSeconds);
+
+					// Smooth slot targetting to help with rotation and make movement look more natural instead of robotic snapping to the slot position
+					SmoothedSlotTarget = FMath::VInterpTo(SmoothedSlotTarget, CurrentSlotTarget, DeltaSeconds, SlotSmoothingSpeed);
+					const float SlotDist = FVector::Dist2D(SmoothedSlotTarget, GetPawn()->GetActorLocation());
+
+					// Only move towards the slot if we're not close enough to it, and use a cooldown to prevent excessive pathfinding calls which can cause performance issues
+					if (SlotDist > StopDistance)
+					{
+						TimeSinceLastMove += DeltaSeconds;
+						if (TimeSinceLastMove >= RepathCooldown)
+						{
+							MoveToLocation(SmoothedSlotTarget, StopDistance, true);
+							TimeSinceLastMove = 0.f;
+						}
+					}
+					else
+					{
+						StopMovement(); // Stop movement if we're close enough to the slot to prevent jittery movement
+					}
+					break;
+				}
+
+				case EEnemyState::Attacking:
+				{
+					// Attacking is handles by the timer so just keep facing the player to ensure we look in the right direction while attacking
+					RotatePawnTowardPlayer(DeltaSeconds);
+					// Ensure we stay still while attacking, in case we got here from chasing and were still moving. We want to be stationary while attacking.
+					StopMovement();
+					break;
+				}
+			}
+		}
+
+		void RotatePawnTowardPlayer(float DeltaSeconds)
+		{
+			// Ensure we have valid references
+			if (!PlayerPawn || !GetPawn()) return;
+
+			// Get the pawn location and calculate the direction vector to the player
+			const FVector PawnLoc = GetPawn()->GetActorLocation();
+			FVector ToPlayer = PlayerPawn->GetActorLocation() - PawnLoc;
+			ToPlayer.Z = 0.f;
+
+			// If the player is exactly above or below the AI, we can't calculate a rotation, so just return
+			if (ToPlayer.IsNearlyZero()) return;
+
+			// Calculate the target rotation to face the player and smoothly interpolate towards it
+			const FRotator TargetRot = ToPlayer.Rotation();
+			const FRotator NewRot = FMath::RInterpTo(
+				GetPawn()->GetActorRotation(),
+				TargetRot,
+				DeltaSeconds,
+				ChaseTurnSpeed
+			);
+
+			GetPawn()->SetActorRotation(NewRot);
+		}
+
+		void HandleStuck(float DeltaSeconds)
+		{
+			// If we're idle or attacking, we don't consider ourselves stuck and just reset the timer and last location. Stuck detection is only relevant while we're trying to move towards a target (chasing), so we can ignore it in other states.
+			if (State == EEnemyState::Idle || bIsAttacking)
+			{
+				StuckTime = 0.f;
+				LastLocation = GetPawn()->GetActorLocation();
+				return;
+			}
+
+			// Ensure we have a valid pawn reference
+			APawn* P = GetPawn();
+			if (!P) return;
+
+			// Get the current location of the pawn
+			const FVector Current = P->GetActorLocation();
+
+			// If this is the first tick or we have no valid last location, initialize it and return
+			if (LastLocation.IsZero())
+			{
+				LastLocation = Current;
+				return;
+			}
+
+			// Calculate the speed of the pawn based on the distance traveled since the last tick
+			const float Speed = FVector::Dist(Current, LastLocation) / FMath::Max(DeltaSeconds, 0.001f);
+			LastLocation = Current;
+
+			// Only consider "stuck" while we are meant to be moving (chasing, not attacking)
+			if (bIsAttacking) { StuckTime = 0.f; return; }
+
+			// If the speed is below the threshold, increment the stuck timer. If it exceeds the time to trigger, attempt to unstick.
+			if (Speed < StuckSpeedThreshold)
+			{
+				StuckTime += DeltaSeconds;
+				// If we've been below the speed threshold for long enough, we consider ourselves stuck and attempt to unstick
+				if (StuckTime >= StuckTimeToTrigger)
+				{
+					Unstick();
+					StuckTime = 0.f;
+				}
+			}
+			else
+			{
+				// If we're moving above the speed threshold, reset the stuck timer
+				StuckTime = 0.f;
+			}
+		}
+	};
+
+	// State the original FSM moved to for Input
+	EEnemyState OriginalTransition(const FTDSEnemyDecisionInput& Input)
+	{
+		FOriginalEnemyController Original(Input);
+		Original.UpdateStateTransitions();
+		return Original.State;
+	}
+
+	// Number of ways the decision pass disagrees with one tick of the original controller. Compute decides the transition,
+	// then, as ATDSEnemyAIController::ApplyDecision does after SetState, the behaviour of the new state is decided again.
+	int32 CountOriginalMismatches(const FTDSEnemyDecisionInput& Input, const FTDSEnemyDecisionOutput& Output, const FOriginalEnemyController& Original)
+	{
+		int32 NumMismatches = 0;
+
+		if (Output.NewState != Original.State || Output.bStateChanged != (Original.State != Input.State))
+		{
+			return 1;
+		}
+
+		FTDSEnemyDecisionInput BehaviourInput = Input;
+		BehaviourInput.State = Output.NewState;
+
+		FTDSEnemyDecisionOutput Behaviour = Output;
+		if (Output.bStateChanged)
+		{
+			FTDSEnemyDecision::ComputeBehaviour(BehaviourInput, Behaviour);
+		}
+
+		const FRotator Rotation = Behaviour.bRotate ? Behaviour.NewRotation : Input.PawnRotation;
+		NumMismatches += Rotation != Original.Pawn.Rotation;
+		NumMismatches += Behaviour.SmoothedSlotTarget != Original.SmoothedSlotTarget;
+		NumMismatches += Behaviour.LastLocation != Original.LastLocation;
+		NumMismatches += Behaviour.StuckTime != Original.StuckTime;
+		NumMismatches += Behaviour.bUnstick != Original.bUnstuck;
+
+		// The distances feed the same compares the original made in RunState
+		if (Output.NewState == EEnemyState::Idle && Input.bHasWanderTarget)
+		{
+			NumMismatches += (Behaviour.WanderDist <= 120.f) != !Original.bHasWanderTarget;
+		}
+		if (Output.NewState == EEnemyState::Chasing)
+		{
+			NumMismatches += (Behaviour.SlotDist <= Original.StopDistance) != Original.bStoppedMovement;
+		}
+
+		return NumMismatches;
+	}
+
+	// An enemy at the origin with the default archetype tuning and the player at PlayerLocation
+	FTDSEnemyDecisionInput MakeInput(EEnemyState State, const FVector& PlayerLocation)
+	{
+		FTDSEnemyDecisionInput Input;
+		Input.DeltaSeconds = 1.f / 60.f;
+		Input.State = State;
+		Input.bHasPlayer = true;
+		Input.PlayerLocation = PlayerLocation;
+		Input.ChaseDistance = 2000.f;
+		Input.AttackRange = 150.f;
+		Input.ChaseTurnSpeed = 8.f;
+		Input.SlotSmoothingSpeed = 6.f;
+		Input.StuckSpeedThreshold = 5.f;
+		Input.StuckTimeToTrigger = 0.6f;
+		return Input;
+	}
+
+	// Random unit vector in the horizontal plane
+	FVector RandomDirection2D(FRandomStream& Random)
+	{
+		const float Angle = Random.FRandRange(0.f, UE_TWO_PI);
+		return FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f);
+	}
+
+	// A spread of enemies in every state around the player, many of them right on the attack and chase radii
+	void MakeRandomInputs(int32 NumInputs, TArray<FTDSEnemyDecisionInput>& OutInputs)
+	{
+		FRandomStream Random(1234);
+		const FVector PlayerLocation(500.f, -300.f, 90.f);
+
+		OutInputs.Reset(NumInputs);
+		for (int32 Index = 0; Index < NumInputs; Index++)
+		{
+			FTDSEnemyDecisionInput Input = MakeInput(static_cast<EEnemyState>(Random.RandHelper(3)), PlayerLocation);
+			Input.DeltaSeconds = Random.FRandRange(1.f / 144.f, 0.1f);
+			Input.bHasPlayer = Random.RandHelper(10) != 0;
+			Input.bIsAttacking = Input.State == EEnemyState::Attacking && Random.RandHelper(2) == 0;
+			Input.bStateFromDistanceBands = Random.RandHelper(8) == 0;
+
+			const float Radii[] = { Input.AttackRange, Input.ChaseDistance, Random.FRandRange(0.f, 3000.f) };
+			const float Radius = Radii[Random.RandHelper(3)] + Random.FRandRange(-0.01f, 0.01f);
+			const FVector Direction = RandomDirection2D(Random);
+			Input.PawnLocation = PlayerLocation + Direction * Radius + FVector(0.f, 0.f, Random.FRandRange(-50.f, 50.f));
+			Input.PawnRotation = FRotator(0.f, Random.FRandRange(-180.f, 180.f), 0.f);
+
+			Input.bHasWanderTarget = Random.RandHelper(2) == 0;
+			Input.WanderTarget = Input.PawnLocation + FVector(Random.FRandRange(-600.f, 600.f), Random.FRandRange(-600.f, 600.f), 0.f);
+			Input.CurrentSlotTarget = PlayerLocation + RandomDirection2D(Random) * 300.f;
+			Input.SmoothedSlotTarget = Input.CurrentSlotTarget + FVector(Random.FRandRange(-100.f, 100.f), Random.FRandRange(-100.f, 100.f), 0.f);
+
+			// Some enemies standing still, some moving, some without a last location yet
+			const int32 Motion = Random.RandHelper(3);
+			Input.LastLocation = Motion == 0 ? FVector::ZeroVector : Input.PawnLocation - Direction * (Motion == 1 ? 0.01f : 5.f);
+			Input.StuckTime = Random.FRandRange(0.f, 0.7f);
+
+			OutInputs.Add(Input);
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTDSEnemyDecisionBoundaryTest, "CyberShooter.AI.EnemyDecision.RecordedBoundaries",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTDSEnemyDecisionBoundaryTest::RunTest(const FString& Parameters)
+{
+	struct FRecordedTransition
+	{
+		const TCHAR* What;
+		EEnemyState State;
+		FVector PlayerLocation;
+		EEnemyState Expected;
+	};
+
+	// Recorded from the original FSM, with the enemy at the origin, attack range 150 and chase distance 2000. The last two
+	// player positions are inside the radii by distance but outside by squared distance, the FSM keeps the distance compare.
+	const FRecordedTransition Recorded[] =
+	{
+		{ TEXT("Chasing, player exactly at attack range"), EEnemyState::Chasing, FVector(150.f, 0.f, 0.f), EEnemyState::Attacking },
+		{ TEXT("Chasing, player just past attack range"), EEnemyState::Chasing, FVector(150.01f, 0.f, 0.f), EEnemyState::Chasing },
+		{ TEXT("Attacking, player exactly at attack range"), EEnemyState::Attacking, FVector(0.f, -150.f, 0.f), EEnemyState::Attacking },
+		{ TEXT("Attacking, player just past attack range"), EEnemyState::Attacking, FVector(0.f, -150.01f, 0.f), EEnemyState::Chasing },
+		{ TEXT("Idle, player exactly at chase distance"), EEnemyState::Idle, FVector(-2000.f, 0.f, 0.f), EEnemyState::Chasing },
+		{ TEXT("Idle, player just past chase distance"), EEnemyState::Idle, FVector(-2000.1f, 0.f, 0.f), EEnemyState::Idle },
+		{ TEXT("Chasing, player exactly at chase distance"), EEnemyState::Chasing, FVector(0.f, 2000.f, 0.f), EEnemyState::Chasing },
+		{ TEXT("Attacking, player just past chase distance"), EEnemyState::Attacking, FVector(0.f, 2000.1f, 0.f), EEnemyState::Idle },
+		{ TEXT("Chasing, player above the enemy"), EEnemyState::Chasing, FVector(0.f, 0.f, 5000.f), EEnemyState::Attacking },
+		{ TEXT("Chasing, player on the attack range rounding edge"), EEnemyState::Chasing, FVector(30.985693f, 146.76474f, 0.f), EEnemyState::Attacking },
+		{ TEXT("Idle, player on the chase distance rounding edge"), EEnemyState::Idle, FVector(1828.88989f, 809.420715f, 0.f), EEnemyState::Chasing },
+	};
+
+	for (const FRecordedTransition& Case : Recorded)
+	{
+		const FTDSEnemyDecisionInput Input = MakeInput(Case.State, Case.PlayerLocation);
+		FTDSEnemyDecisionOutput Output;
+		FTDSEnemyDecision::Compute(Input, Output);
+
+		TestEqual(Case.What, Output.NewState, Case.Expected);
+		TestEqual(*FString::Printf(TEXT("%s, state change flagged"), Case.What), Output.bStateChanged, Case.Expected != Case.State);
+		TestEqual(*FString::Printf(TEXT("%s, matches the original FSM"), Case.What), Output.NewState, OriginalTransition(Input));
+	}
+
+	// Distance bands drive the state on their own, and without a player there is nothing to react to
+	FTDSEnemyDecisionInput BandInput = MakeInput(EEnemyState::Idle, FVector(10.f, 0.f, 0.f));
+	BandInput.bStateFromDistanceBands = true;
+	TestEqual(TEXT("No transition when distance bands drive the state"), FTDSEnemyDecision::ComputeTransition(BandInput), EEnemyState::Idle);
+
+	FTDSEnemyDecisionInput NoPlayerInput = MakeInput(EEnemyState::Attacking, FVector(10000.f, 0.f, 0.f));
+	NoPlayerInput.bHasPlayer = false;
+	TestEqual(TEXT("No transition without a player"), FTDSEnemyDecision::ComputeTransition(NoPlayerInput), EEnemyState::Attacking);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTDSEnemyDecisionOriginalTest, "CyberShooter.AI.EnemyDecision.MatchesOriginalController",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTDSEnemyDecisionOriginalTest::RunTest(const FString& Parameters)
+{
+	TArray<FTDSEnemyDecisionInput> Inputs;
+	MakeRandomInputs(4096, Inputs);
+
+	int32 NumCompared = 0;
+	int32 NumStateChanges = 0;
+	int32 NumMismatches = 0;
+	int32 NumBandMismatches = 0;
+
+	for (const FTDSEnemyDecisionInput& Input : Inputs)
+	{
+		FTDSEnemyDecisionOutput Output;
+		FTDSEnemyDecision::Compute(Input, Output);
+
+		// Enemies driven by distance band events keep their state here, the band subsystem changes it
+		if (Input.bStateFromDistanceBands)
+		{
+			NumBandMismatches += Output.bStateChanged || Output.NewState != Input.State;
+			continue;
+		}
+
+		FOriginalEnemyController Original(Input);
+		Original.Tick(Input.DeltaSeconds);
+
+		NumCompared++;
+		NumStateChanges += Original.State != Input.State;
+		NumMismatches += CountOriginalMismatches(Input, Output, Original) > 0;
+	}
+
+	AddInfo(FString::Printf(TEXT("%d enemies compared with the original controller, %d changed state"), NumCompared, NumStateChanges));
+	TestTrue(TEXT("Some enemies changed state"), NumStateChanges > 0);
+	TestEqual(TEXT("Enemies whose decision differs from the original controller"), NumMismatches, 0);
+	TestEqual(TEXT("Band driven enemies whose state changed"), NumBandMismatches, 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTDSEnemyDecisionParallelTest, "CyberShooter.AI.EnemyDecision.ParallelMatchesSerial",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTDSEnemyDecisionParallelTest::RunTest(const FString& Parameters)
+{
+	TArray<FTDSEnemyDecisionInput> Inputs;
+	MakeRandomInputs(4096, Inputs);
+
+	// The enemy manager's compute stage run in order on this thread is the reference
+	TArray<FTDSEnemyDecisionOutput> SerialOutputs;
+	SerialOutputs.SetNum(Inputs.Num());
+	UTDSEnemyManager::ComputeDecisions(Inputs, SerialOutputs, false, 1);
+
+	int32 NumSerialMismatches = 0;
+	for (int32 Index = 0; Index < Inputs.Num(); Index++)
+	{
+		FTDSEnemyDecisionOutput Output;
+		FTDSEnemyDecision::Compute(Inputs[Index], Output);
+		NumSerialMismatches += !FTDSEnemyDecision::Identical(Output, SerialOutputs[Index]);
+	}
+	TestEqual(TEXT("Serial pass differs from Compute"), NumSerialMismatches, 0);
+
+	// The same stage across worker threads, at the default batch size (tds.AI.ParallelDecisionsMinBatch) and around it
+	for (const int32 MinBatch : { 1, 7, 32, 512 })
+	{
+		TArray<FTDSEnemyDecisionOutput> Outputs;
+		Outputs.SetNum(Inputs.Num());
+		UTDSEnemyManager::ComputeDecisions(Inputs, Outputs, true, MinBatch);
+
+		int32 NumMismatches = 0;
+		for (int32 Index = 0; Index < Inputs.Num(); Index++)
+		{
+			NumMismatches += !FTDSEnemyDecision::Identical(Outputs[Index], SerialOutputs[Index]);
+		}
+		TestEqual(*FString::Printf(TEXT("Parallel pass with batches of %d, enemies that differ from the serial pass"), MinBatch), NumMismatches, 0);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
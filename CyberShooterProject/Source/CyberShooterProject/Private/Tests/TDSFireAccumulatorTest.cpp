@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "TDSFireAccumulator.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTDSFireAccumulatorRateTest, "CyberShooter.Combat.FireAccumulator.ShotsPerSecond",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTDSFireAccumulatorRateTest::RunTest(const FString& Parameters)
+{
+	// Holds the trigger for a few seconds at each frame rate and fire interval and checks the fire rate never caps at the frame rate
+	const float FrameRates[] = { 30.f, 60.f, 144.f };
+	const float FireIntervals[] = { 0.25f, 0.1f, 0.05f, 0.02f, 0.01f };
+	const float Seconds = 4.f;
+	const int32 MaxShots = 32;
+	const float MaxShotAge = 1.f / 30.f;
+
+	for (const float FrameRate : FrameRates)
+	{
+		const float DeltaSeconds = 1.f / FrameRate;
+		const int32 NumFrames = FMath::RoundToInt(Seconds * FrameRate);
+
+		for (const float FireInterval : FireIntervals)
+		{
+			FTDSFireAccumulator Accumulator;
+			int32 NumShots = Accumulator.PressTrigger(FireInterval) ? 1 : 0;
+
+			TArray<float, TInlineAllocator<16>> ShotAges;
+			for (int32 Frame = 0; Frame < NumFrames; Frame++)
+			{
+				ShotAges.Reset();
+				NumShots += Accumulator.Advance(DeltaSeconds, FireInterval, MaxShots, MaxShotAge, ShotAges);
+
+				// Every shot in a frame was due during that frame, oldest first
+				for (int32 Index = 0; Index < ShotAges.Num(); Index++)
+				{
+					TestTrue(TEXT("Shot age fits in the frame"), ShotAges[Index] >= 0.f && ShotAges[Index] <= DeltaSeconds + UE_KINDA_SMALL_NUMBER);
+					if (Index > 0)
+					{
+						TestTrue(TEXT("Shots are oldest first"), ShotAges[Index] <= ShotAges[Index - 1]);
+					}
+				}
+			}
+
+			// Allow a shot or two for where the last frame ends relative to the next shot and for float drift
+			const float SimulatedSeconds = NumFrames * DeltaSeconds;
+			const float ExpectedShotsPerSecond = 1.f / FireInterval;
+			const float ShotsPerSecond = NumShots / SimulatedSeconds;
+			TestNearlyEqual(
+				FString::Printf(TEXT("Shots per second at %.0f Hz with a %.2f s interval"), FrameRate, FireInterval),
+				ShotsPerSecond, ExpectedShotsPerSecond, 2.f / SimulatedSeconds);
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTDSFireAccumulatorHitchTest, "CyberShooter.Combat.FireAccumulator.Hitch",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTDSFireAccumulatorHitchTest::RunTest(const FString& Parameters)
+{
+	// A hitch of about a second at a 0.01 s interval owes almost a hundred shots, only the newest MaxShots are fired
+	const float FireInterval = 0.01f;
+	const float HitchSeconds = 0.995f;
+	const int32 MaxShots = 8;
+	const float MaxShotAge = 1.f / 30.f;
+
+	// Without clamping the ages, the kept shots are the consecutive ones due right before the end of the frame
+	{
+		FTDSFireAccumulator Accumulator;
+		Accumulator.PressTrigger(FireInterval);
+
+		TArray<float> ShotAges;
+		const int32 NumShots = Accumulator.Advance(HitchSeconds, FireInterval, MaxShots, HitchSeconds, ShotAges);
+
+		TestEqual(TEXT("Shots after a hitch are capped"), NumShots, MaxShots);
+		if (ShotAges.Num() == MaxShots)
+		{
+			TestTrue(TEXT("The newest shot is kept"), ShotAges.Last() < FireInterval);
+			TestNearlyEqual(TEXT("The kept shots are the newest ones"), ShotAges[0], (MaxShots - 1) * FireInterval + ShotAges.Last(), 1.e-3f);
+		}
+
+		// Nothing from the hitch is still owed on the next frame
+		ShotAges.Reset();
+		const int32 NumNextShots = Accumulator.Advance(1.f / 60.f, FireInterval, MaxShots, HitchSeconds, ShotAges);
+		TestTrue(TEXT("The hitch does not spill into the next frame"), NumNextShots <= 2);
+	}
+
+	// With clamping, no shot is moved further forward than one frame's worth of flight
+	{
+		FTDSFireAccumulator Accumulator;
+		Accumulator.PressTrigger(FireInterval);
+
+		TArray<float> ShotAges;
+		Accumulator.Advance(HitchSeconds, FireInterval, MaxShots, MaxShotAge, ShotAges);
+
+		TestEqual(TEXT("Clamping does not change the shot count"), ShotAges.Num(), MaxShots);
+		for (const float ShotAge : ShotAges)
+		{
+			TestTrue(TEXT("Shot age is clamped"), ShotAge <= MaxShotAge);
+		}
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
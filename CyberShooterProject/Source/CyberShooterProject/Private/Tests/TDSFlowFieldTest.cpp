@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "TDSFlowField.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// A fully walkable grid with every cell linked to its neighbours
+	FTDSWalkabilityGrid MakeOpenGrid(int32 SizeX, int32 SizeY)
+	{
+		FTDSWalkabilityGrid Grid;
+		Grid.SizeX = SizeX;
+		Grid.SizeY = SizeY;
+		Grid.Walkable.Init(1, Grid.Num());
+		Grid.Links.Init(0, Grid.Num());
+
+		for (int32 CellY = 0; CellY < SizeY; ++CellY)
+		{
+			for (int32 CellX = 0; CellX < SizeX; ++CellX)
+			{
+				uint8& Links = Grid.Links[Grid.ToIndex(FIntPoint(CellX, CellY))];
+				Links |= CellX > 0 ? FTDSWalkabilityGrid::LinkNegX : 0;
+				Links |= CellY > 0 ? FTDSWalkabilityGrid::LinkNegY : 0;
+			}
+		}
+
+		return Grid;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTDSFlowFieldThinWallTest, "CyberShooter.AI.FlowField.ThinWall",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTDSFlowFieldThinWallTest::RunTest(const FString& Parameters)
+{
+	// A wall thinner than a cell between columns 1 and 2, with a gap in the last row. Every cell is still walkable,
+	// only the links across the wall are missing.
+	FTDSWalkabilityGrid Grid = MakeOpenGrid(4, 4);
+	for (int32 CellY = 0; CellY < 3; ++CellY)
+	{
+		Grid.Links[Grid.ToIndex(FIntPoint(2, CellY))] &= ~FTDSWalkabilityGrid::LinkNegX;
+	}
+
+	const TSharedPtr<FTDSFlowField> Field = FTDSFlowField::Build(Grid, FIntPoint(0, 0));
+	if (!TestTrue(TEXT("Field built"), Field.IsValid()))
+	{
+		return false;
+	}
+
+	const auto DistanceAt = [&Grid, &Field](int32 CellX, int32 CellY)
+	{
+		return Field->Distances[Grid.ToIndex(FIntPoint(CellX, CellY))];
+	};
+
+	// Straight through the wall would be two cells, round through the gap it is two steps and a diagonal down to the gap,
+	// one step across and three back up
+	TestNearlyEqual(TEXT("Cells beside the wall are reached round it"), DistanceAt(2, 0), 6.f + UE_SQRT_2, 1.e-4f);
+	TestNearlyEqual(TEXT("Cells on the open side keep the direct distance"), DistanceAt(1, 0), 1.f, 1.e-4f);
+	TestTrue(TEXT("Cells behind the wall are reachable"), DistanceAt(3, 0) < MAX_flt);
+
+	// No direction may point across the wall
+	for (int32 CellY = 0; CellY < 3; ++CellY)
+	{
+		const FVector2f& Direction = Field->Directions[Grid.ToIndex(FIntPoint(2, CellY))];
+		TestTrue(*FString::Printf(TEXT("Cell (2, %d) does not flow through the wall"), CellY), Direction.X >= 0.f || Direction.Y > 0.f);
+	}
+
+	// Diagonals may not cut the wall's end either
+	TestNotEqual(TEXT("The wall's end is not cut diagonally"), Field->Directions[Grid.ToIndex(FIntPoint(2, 2))], FVector2f(-1.f, -1.f).GetSafeNormal());
+
+	// With the gap closed the far side cannot be reached at all
+	Grid.Links[Grid.ToIndex(FIntPoint(2, 3))] &= ~FTDSWalkabilityGrid::LinkNegX;
+	const TSharedPtr<FTDSFlowField> ClosedField = FTDSFlowField::Build(Grid, FIntPoint(0, 0));
+	TestEqual(TEXT("A closed wall leaves the far side unreachable"), ClosedField->Distances[Grid.ToIndex(FIntPoint(3, 3))], MAX_flt);
+	TestTrue(TEXT("Unreachable cells have no direction"), ClosedField->Directions[Grid.ToIndex(FIntPoint(2, 0))].IsZero());
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "TDSTestWorld.h"
+#include "TDSFireAccumulator.h"
+#include "TDSProjectile.h"
+#include "TDSProjectilePoolSubsystem.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTDSProjectilePoolSteadyFireTest, "CyberShooter.Combat.ProjectilePool.SteadyFire",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTDSProjectilePoolSteadyFireTest::RunTest(const FString& Parameters)
+{
+	FTDSScopedTestWorld TestWorld;
+	if (!TestNotNull(TEXT("Test world"), TestWorld.World))
+	{
+		return false;
+	}
+
+	UTDSProjectilePoolSubsystem* Pool = TestWorld.World->GetSubsystem<UTDSProjectilePoolSubsystem>();
+	if (!TestNotNull(TEXT("Projectile pool subsystem"), Pool))
+	{
+		return false;
+	}
+
+	// Fire as fast as the fastest upgrade allows for a full minute at 60 Hz, nothing in the empty world for the shots to hit
+	const TSubclassOf<ATDSProjectile> ProjectileClass = ATDSProjectile::StaticClass();
+	const float FireInterval = 0.02f;
+	const float DeltaSeconds = 1.f / 60.f;
+	const float FireSeconds = 60.f;
+	const int32 MaxShotsPerFrame = 32;
+	const float LifeSeconds = GetDefault<ATDSProjectile>()->GetLifeSeconds();
+
+	// Warm the pool the same way the character does, for every shot that can be in flight at once
+	Pool->WarmPool(ProjectileClass, FMath::CeilToInt(LifeSeconds / FireInterval) + MaxShotsPerFrame);
+
+	// Every projectile spawned or destroyed from here on
+	int32 NumSpawned = 0;
+	int32 NumDestroyed = 0;
+	const FDelegateHandle SpawnedHandle = TestWorld.World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateLambda([&NumSpawned](AActor* Actor)
+	{
+		if (Actor->IsA<ATDSProjectile>())
+		{
+			NumSpawned++;
+		}
+	}));
+	const FDelegateHandle DestroyedHandle = TestWorld.World->AddOnActorDestroyedHandler(FOnActorDestroyed::FDelegate::CreateLambda([&NumDestroyed](AActor* Actor)
+	{
+		if (Actor->IsA<ATDSProjectile>())
+		{
+			NumDestroyed++;
+		}
+	}));
+
+	FTDSFireAccumulator FireAccumulator;
+	FireAccumulator.PressTrigger(FireInterval);
+	Pool->AcquireProjectile(ProjectileClass, FTransform::Identity, nullptr, nullptr, 25.f, 2000.f);
+
+	// Warm-up is the first projectile lifetime plus a second, after that every shot must come from a recycled projectile
+	const int32 NumFrames = FMath::RoundToInt(FireSeconds / DeltaSeconds);
+	const int32 NumWarmupFrames = FMath::CeilToInt((LifeSeconds + 1.f) / DeltaSeconds);
+	int32 NumSpawnedAfterWarmup = 0;
+	int32 NumDestroyedAfterWarmup = 0;
+	int32 NumShots = 1;
+
+	TArray<float, TInlineAllocator<16>> ShotAges;
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		if (Frame == NumWarmupFrames)
+		{
+			NumSpawnedAfterWarmup = NumSpawned;
+			NumDestroyedAfterWarmup = NumDestroyed;
+		}
+
+		ShotAges.Reset();
+		FireAccumulator.Advance(DeltaSeconds, FireInterval, MaxShotsPerFrame, DeltaSeconds, ShotAges);
+		for (const float ShotAge : ShotAges)
+		{
+			Pool->AcquireProjectile(ProjectileClass, FTransform::Identity, nullptr, nullptr, 25.f, 2000.f, ShotAge);
+			NumShots++;
+		}
+
+		// Lifetime timers run with the world, so this is what sends the projectiles back to the pool
+		TestWorld.Tick(DeltaSeconds);
+	}
+
+	TestWorld.World->RemoveOnActorSpawnedHandler(SpawnedHandle);
+	TestWorld.World->RemoveOnActorDestroyedHandler(DestroyedHandle);
+
+	AddInfo(FString::Printf(TEXT("%d shots over %.0f s, %d projectiles owned by the pool, %d spawned during warm-up"),
+		NumShots, FireSeconds, Pool->GetNumSpawnedProjectiles(), NumSpawnedAfterWarmup));
+
+	TestTrue(TEXT("Shots were fired at the requested rate"), NumShots >= FMath::FloorToInt(FireSeconds / FireInterval));
+	TestEqual(TEXT("No projectiles spawned after warm-up"), NumSpawned, NumSpawnedAfterWarmup);
+	TestEqual(TEXT("No projectiles destroyed after warm-up"), NumDestroyed, NumDestroyedAfterWarmup);
+	TestEqual(TEXT("No projectiles destroyed at all"), NumDestroyed, 0);
+	TestTrue(TEXT("Every live projectile is accounted for by the pool"),
+		Pool->GetNumActiveProjectiles() + Pool->GetNumFreeProjectiles() == Pool->GetNumSpawnedProjectiles());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTDSProjectilePoolExternalDestroyTest, "CyberShooter.Combat.ProjectilePool.ExternalDestroy",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FTDSProjectilePoolExternalDestroyTest::RunTest(const FString& Parameters)
+{
+	FTDSScopedTestWorld TestWorld;
+	if (!TestNotNull(TEXT("Test world"), TestWorld.World))
+	{
+		return false;
+	}
+
+	UTDSProjectilePoolSubsystem* Pool = TestWorld.World->GetSubsystem<UTDSProjectilePoolSubsystem>();
+	if (!TestNotNull(TEXT("Projectile pool subsystem"), Pool))
+	{
+		return false;
+	}
+
+	const TSubclassOf<ATDSProjectile> ProjectileClass = ATDSProjectile::StaticClass();
+	Pool->WarmPool(ProjectileClass, 4);
+
+	// Two projectiles in flight, two asleep
+	ATDSProjectile* Active = Pool->AcquireProjectile(ProjectileClass, FTransform::Identity, nullptr, nullptr, 25.f, 2000.f);
+	Pool->AcquireProjectile(ProjectileClass, FTransform::Identity, nullptr, nullptr, 25.f, 2000.f);
+	if (!TestNotNull(TEXT("Acquired projectile"), Active))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("Active before"), Pool->GetNumActiveProjectiles(), 2);
+	TestEqual(TEXT("Free before"), Pool->GetNumFreeProjectiles(), 2);
+
+	// Destroyed by something other than the pool, one in flight and one asleep
+	Active->Destroy();
+	ATDSProjectile* Sleeping = Pool->AcquireProjectile(ProjectileClass, FTransform::Identity, nullptr, nullptr, 25.f, 2000.f);
+	Pool->ReleaseProjectile(Sleeping);
+	Sleeping->Destroy();
+
+	TestEqual(TEXT("Destroyed active projectile is no longer counted as active"), Pool->GetNumActiveProjectiles(), 1);
+	TestEqual(TEXT("Destroyed sleeping projectile left the free list"), Pool->GetNumFreeProjectiles(), 1);
+
+	// The pool only counts the two live projectiles, so warming back to four spawns two new ones
+	const int32 SpawnedBefore = Pool->GetNumSpawnedProjectiles();
+	Pool->WarmPool(ProjectileClass, 4);
+	TestEqual(TEXT("Warming replaces the destroyed projectiles"), Pool->GetNumSpawnedProjectiles() - SpawnedBefore, 2);
+	TestEqual(TEXT("Free after warming"), Pool->GetNumFreeProjectiles(), 3);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+
+// An empty game world for automation tests, created without a map or game mode and torn down when it goes out of scope.
+// Game world subsystems are created with it, so tests can drive them the same way a room does.
+struct FTDSScopedTestWorld
+{
+	UWorld* World = nullptr;
+
+	FTDSScopedTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("TDSTestWorld"));
+		if (!World)
+		{
+			return;
+		}
+
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+
+		// Without a game mode nothing dispatches BeginPlay, do it ourselves so actors and their timers behave like in a room
+		if (!World->GetBegunPlay())
+		{
+			World->GetWorldSettings()->NotifyBeginPlay();
+		}
+	}
+
+	~FTDSScopedTestWorld()
+	{
+		if (World)
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+		}
+	}
+
+	FTDSScopedTestWorld(const FTDSScopedTestWorld&) = delete;
+	FTDSScopedTestWorld& operator=(const FTDSScopedTestWorld&) = delete;
+
+	// Ticks the whole world once
+	void Tick(float DeltaSeconds)
+	{
+		World->Tick(LEVELTICK_All, DeltaSeconds);
+	}
+};
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -6,6 +6,8 @@
 #include "Engine/DataAsset.h"
 #include "TDSRoomDefinition.generated.h"
 
+class UTDSEnemyArchetype;
+
 // This is the enumeration for the different types of rooms in the game. It can be used to define the type of room in the TDSRoomDefinition data asset.
 UENUM(BlueprintType)
 enum class ETDSRoomType : uint8
@@ -15,6 +17,20 @@ enum class ETDSRoomType : uint8
     Boss
 };
 
+// One kind of enemy a room spawns, and how often it comes up compared to the room's other entries
+USTRUCT(BlueprintType)
+struct FTDSRoomEnemyEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Room")
+	TObjectPtr<UTDSEnemyArchetype> Archetype;
+
+	// Relative chance of each spawned enemy being of this archetype
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Room", meta = (ClampMin = "0.0"))
+	float Weight = 1.f;
+};
+
 UCLASS(BlueprintType)
 class UTDSRoomDefinition : public UDataAsset
 {
@@ -29,4 +45,11 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Room")
     FName LevelName;
 
+	// The archetypes the room's enemies are picked from, by weight. Leave empty to spawn the room manager's default enemy class.
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Room|Enemies")
+    TArray<FTDSRoomEnemyEntry> Enemies;
+
+	// Picks one of Enemies by weight, nullptr if there is nothing to pick
+	UTDSEnemyArchetype* PickEnemyArchetype() const;
+
 };